@@ -2,14 +2,54 @@
 #include <stdlib.h>
 #include <assert.h>
 #include "cstl/unordered_map.h"
+#include "cstl/unordered_flat_set.h"
 #include "cstl/vector.h"
 #include "AST.h"
+#include "resolver.h"
+#include "output.h"
 
-CSTL_VECTOR_IMPLEMENT(ASTVector, AST)
-CSTL_VECTOR_IMPLEMENT(SymbolVector, Symbol)
-CSTL_UNORDERED_MAP_IMPLEMENT(StrSymMap, const char *, Symbol, StrSymMap_hash_string, strcmp)
+static void *AST_arenaAllocate(void *arena, size_t size) {
+  return Arena_malloc((Arena *)arena, size);
+}
+
+static void *AST_arenaReallocate(void *arena, void *p, size_t size) {
+  return Arena_realloc((Arena *)arena, p, size);
+}
+
+static void AST_arenaDeallocate(void *arena, void *p) {
+  /* Arena_release frees the blocks with the rest of the tree */
+  (void)arena;
+  (void)p;
+}
+
+/* The vectors of the tree live in the front-end arena with the nodes. */
+static const CstlAllocator ASTArenaAllocator = {
+  &ASTArena, AST_arenaAllocate, AST_arenaReallocate, AST_arenaDeallocate
+};
+
+CSTL_VECTOR_IMPLEMENT_SMALL_ALLOCATOR(ASTVector, AST, 4, &ASTArenaAllocator)
+CSTL_VECTOR_IMPLEMENT_SMALL_ALLOCATOR(SymbolVector, Symbol, 4, &ASTArenaAllocator)
+CSTL_VECTOR_INTERFACE(FunctionVector, Symbol *)
+CSTL_VECTOR_IMPLEMENT_ALLOCATOR(FunctionVector, Symbol *, &ASTArenaAllocator)
+CSTL_UNORDERED_MAP_IMPLEMENT_POOL(StrSymMap, const char *, Symbol, StrSymMap_hash_string, strcmp)
+
+static size_t SymbolSet_hashSymbol(const Symbol *symbol) {
+  return (size_t)symbol / sizeof(void *);
+}
+
+static int SymbolSet_compareSymbol(const Symbol *a, const Symbol *b) {
+  return a != b;
+}
+
+CSTL_UNORDERED_FLAT_SET_IMPLEMENT(SymbolSet, const Symbol *, SymbolSet_hashSymbol, SymbolSet_compareSymbol)
 
 StrSymMap *SymbolTable;
+Arena ASTArena;
+FlatNode *FlatNodes;
+static size_t FlatSize;
+static size_t FlatCapacity;
+/* Functions defined since the last flattening; only code that runs needs their flat bodies. */
+static FunctionVector *Unflattened;
 
 int AST_comparer(const void *a, const void *b) {
   if (a == b) {
@@ -20,12 +60,7 @@ int AST_comparer(const void *a, const void *b) {
 
 
 AST *AST_alloc() {
-  AST *p = (AST *)malloc(sizeof(AST));
-  if (!p) {
-    fprintf(stderr, "Cannot allocate memory for AST.\n");
-    abort();
-  }
-  return p;
+  return (AST *)Arena_alloc(&ASTArena, sizeof(AST));
 }
 
 AST* AST_makeValue(int v) {
@@ -40,6 +75,7 @@ AST *AST_makeString(const char *str) {
   AST *p = AST_alloc();
   p->code = VAL_STRING;
   p->AST_string = str;
+  p->AST_format = Output_parseFormat(str);
   return p;
 }
 
@@ -115,6 +151,18 @@ AST *AST_makeFunction(AST *name, AST *params, AST *body) {
   sym->type = SYM_FUNC;
   sym->SYM_param = AST_to_symbol_vector(params->AST_list);
   sym->SYM_body  = body;
+  sym->SYM_hotness = 0;
+  sym->SYM_native = NULL;
+  sym->SYM_pure = false;
+  sym->SYM_memo = NULL;
+  // resolve now: global initializers are evaluated while parsing and may call it
+  Resolver_resolveFunction(sym);
+  // but flatten it only when one does (see AST_flattenDefined)
+  sym->SYM_flat = FLAT_NONE;
+  if (!Unflattened) {
+    Unflattened = FunctionVector_new();
+  }
+  FunctionVector_push_back(Unflattened, sym);
   return name;
 }
 
@@ -144,18 +192,169 @@ AST *AST_getList(AST *p, unsigned long index) {
 }
 
 void AST_free(AST *ast) {
-  if (ast != NULL) {
-      free(ast);
+  /* nodes are released with ASTArena */
+  (void)ast;
+}
+
+// Returns the index of n new nodes, which the caller fills.
+static FlatIndex Flat_reserve(size_t n) {
+  if (FlatSize == 0) {
+    FlatSize = 1;   // FLAT_NONE
+  }
+  if (FlatSize + n > FlatCapacity) {
+    size_t capacity = FlatCapacity ? FlatCapacity * 2 : 1024;
+    while (capacity < FlatSize + n) {
+      capacity *= 2;
+    }
+    if (capacity > UINT32_MAX) {
+      fprintf(stderr, "The program is too large.\n");
+      exit(EXIT_FAILURE);
+    }
+    FlatNode *nodes = (FlatNode *)realloc(FlatNodes, sizeof(FlatNode) * capacity);
+    if (!nodes) {
+      fprintf(stderr, "Cannot allocate memory for AST.\n");
+      abort();
+    }
+    FlatNodes = nodes;
+    FlatCapacity = capacity;
   }
+  FlatIndex index = FlatSize;
+  FlatSize += n;
+  return index;
 }
 
-Symbol *Symbol_alloc() {
-  Symbol *p = (Symbol *)malloc(sizeof(Symbol));
-  if (!p) {
-    fprintf(stderr, "Cannot allocate memory for Symbol.\n");
-    abort();
+static void Flat_fill(FlatIndex at, AST *ast);
+
+// Reserves the children first, so that they are consecutive, then lays out their subtrees.
+static FlatIndex Flat_children(AST **children, size_t n) {
+  FlatIndex first = Flat_reserve(n);
+  for (size_t i = 0; i < n; ++i) {
+    Flat_fill(first + i, children[i]);
   }
-  return p;
+  return first;
+}
+
+static void Flat_fill(FlatIndex at, AST *ast) {
+  FlatNode node = { ast->code, FLAT_NONE, { 0 } };
+  switch (ast->code) {
+    case ETC_LIST: {
+      const size_t n = ASTVector_size(ast->AST_list);
+      node.un.count = n;
+      node.first = Flat_reserve(n);
+      for (size_t i = 0; i < n; ++i) {
+        Flat_fill(node.first + i, ASTVector_at(ast->AST_list, i));
+      }
+      break;
+    }
+    case VAL_NUM:
+      node.un.value = ast->AST_value;
+      break;
+    case VAL_SYMBOL:
+      node.un.symbol = ast->AST_symbol;
+      break;
+    case VAL_LOCAL:
+      node.un.slot = ast->AST_slot;
+      break;
+    case VAL_STRING:
+      node.un.format = ast->AST_format;
+      break;
+    case OP_ASSIGN:
+    case OP_REF_ARRAY:
+      node.un.symbol = ast->AST_left->AST_symbol;
+      node.first = Flat_children(&ast->AST_right, 1);
+      break;
+    case OP_ASSIGN_LOCAL:
+      node.un.slot = ast->AST_left->AST_slot;
+      node.first = Flat_children(&ast->AST_right, 1);
+      break;
+    case OP_ASSIGN_ARRAY: {
+      AST *children[] = { ast->AST_second, ast->AST_third };
+      node.un.symbol = ast->AST_first->AST_symbol;
+      node.first = Flat_children(children, 2);
+      break;
+    }
+    case OP_CALL: {
+      ASTVector *args = ast->AST_right->AST_list;
+      const size_t n = ASTVector_size(args);
+      node.un.count = n;
+      node.first = Flat_reserve(n + 1);
+      Flat_fill(node.first, ast->AST_left);
+      for (size_t i = 0; i < n; ++i) {
+        Flat_fill(node.first + 1 + i, ASTVector_at(args, i));
+      }
+      break;
+    }
+    case CODE_PRINTLN:
+      node.un.format = ast->AST_left->AST_format;
+      if (ast->AST_right) {
+        node.first = Flat_children(&ast->AST_right, 1);
+      }
+      break;
+    case CODE_RETURN:
+      if (ast->AST_unary) {
+        node.first = Flat_children(&ast->AST_unary, 1);
+      }
+      break;
+    case CODE_FOR: {
+      AST *children[] = {
+        AST_getList(ast->AST_left, 0),
+        AST_getList(ast->AST_left, 1),
+        AST_getList(ast->AST_left, 2),
+        ast->AST_right
+      };
+      node.first = Flat_children(children, 4);
+      break;
+    }
+    default:
+      if (OP_ADD <= ast->code && ast->code <= OP_COMPARE_NEQ) {
+        AST *children[] = { ast->AST_left, ast->AST_right };
+        node.first = Flat_children(children, 2);
+      }
+      break;
+  }
+  FlatNodes[at] = node;
+}
+
+FlatIndex AST_flatten(AST *ast) {
+  FlatIndex root = Flat_reserve(1);
+  Flat_fill(root, ast);
+  return root;
+}
+
+void AST_flattenDefined(void) {
+  if (!Unflattened) {
+    return;
+  }
+  for (size_t i = 0; i < FunctionVector_size(Unflattened); ++i) {
+    Symbol *sym = *FunctionVector_at(Unflattened, i);
+    // a function defined twice is listed twice
+    if (sym->type == SYM_FUNC && sym->SYM_flat == FLAT_NONE) {
+      sym->SYM_flat = AST_flatten(sym->SYM_body);
+    }
+  }
+  FunctionVector_clear(Unflattened);
+}
+
+void AST_flattenProgram(void) {
+  FlatSize = 0;
+  if (Unflattened) {
+    FunctionVector_clear(Unflattened);
+  }
+  StrSymMapIterator end = StrSymMap_end(SymbolTable);
+  for (StrSymMapIterator it = StrSymMap_begin(SymbolTable); it != end; it = StrSymMap_next(it)) {
+    Symbol *sym = StrSymMap_value(it);
+    if (sym->type == SYM_FUNC) {
+      sym->SYM_flat = AST_flatten(sym->SYM_body);
+    }
+  }
+}
+
+size_t AST_flatSize(void) {
+  return FlatSize;
+}
+
+Symbol *Symbol_alloc() {
+  return (Symbol *)Arena_alloc(&ASTArena, sizeof(Symbol));
 }
 
 Symbol *Symbol_new(char *name) {
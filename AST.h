@@ -1,18 +1,29 @@
 #ifndef ylaciexpr_AST_h
 #define ylaciexpr_AST_h
 
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
 #define MAX_SYMBOL_LEN (128)
 
 typedef struct AST_ AST;
 typedef struct symbol_ Symbol;
 typedef enum code_ CodeType;
+typedef struct format_ Format;
+typedef int (*NativeFunction)(int *frame);
+typedef uint32_t FlatIndex;
 
 #include "cstl/vector.h"
 #include "cstl/unordered_map.h"
+#include "cstl/unordered_flat_set.h"
+#include "arena.h"
 
 CSTL_VECTOR_INTERFACE(ASTVector, AST)
 CSTL_VECTOR_INTERFACE(SymbolVector, Symbol)
 CSTL_UNORDERED_MAP_INTERFACE(StrSymMap, const char *, Symbol)
+/* Set of symbols by identity, for analyses over the whole program */
+CSTL_UNORDERED_FLAT_SET_INTERFACE(SymbolSet, const Symbol *)
 
 enum code_ {
     ETC_LIST,
@@ -37,7 +48,10 @@ enum code_ {
     OP_ASSIGN,
     OP_ASSIGN_ARRAY,
     OP_CALL,
-    OP_REF_ARRAY
+    OP_REF_ARRAY,
+    /* resolved variable references (see resolver.h) */
+    VAL_LOCAL,
+    OP_ASSIGN_LOCAL
 };
 
 typedef enum symbol_type {
@@ -59,6 +73,11 @@ struct symbol_ {
         struct {
             SymbolVector *params;
             AST *body;
+            unsigned long hotness;  /* calls and loop iterations, counted for the JIT */
+            NativeFunction native;  /* compiled body, or NULL */
+            bool pure;              /* see purity.h */
+            struct memo_ *memo;     /* result cache, or NULL (see memo.h) */
+            FlatIndex flat;         /* flattened body (see FlatNode) */
         } func;
     } un;
 };
@@ -66,6 +85,11 @@ struct symbol_ {
 #define SYM_value un.value
 #define SYM_param un.func.params
 #define SYM_body  un.func.body
+#define SYM_hotness un.func.hotness
+#define SYM_native un.func.native
+#define SYM_pure un.func.pure
+#define SYM_memo un.func.memo
+#define SYM_flat un.func.flat
 #define SYM_array_data un.array.data
 #define SYM_array_size un.array.size
 
@@ -75,12 +99,21 @@ struct AST_ {
         /* For value (leaf node) */
         int value;
 
-        /* For string */
-        const char *str;
+        /* For string (format is the pre-parsed form used by println) */
+        struct {
+            const char *text;
+            Format *format;
+        } string;
 
         /* For symbol */
         Symbol *symbol;
 
+        /* For local variable (symbol is kept for diagnostics) */
+        struct {
+            Symbol *symbol;
+            int index;
+        } local;
+
         /* For list */
         ASTVector *list;
         
@@ -100,7 +133,8 @@ struct AST_ {
 };
 
 #define AST_value un.value
-#define AST_string un.str
+#define AST_string un.string.text
+#define AST_format un.string.format
 /* For Unary Expression */
 #define AST_unary un.unary
 /* For Binary Expression */
@@ -114,6 +148,54 @@ struct AST_ {
 #define AST_list un.list
 /* For Symbol Expression */
 #define AST_symbol un.symbol
+/* For Local Variable Expression */
+#define AST_slot un.local.index
+
+/*
+ * Flattened tree, walked by the AST engine.
+ * All nodes live in FlatNodes and refer to their children by 32-bit
+ * index.  The children of a node are consecutive, starting at first, so
+ * a statement list is a range of count nodes.  By code:
+ *   ETC_LIST          count statements
+ *   VAL_NUM           value
+ *   VAL_SYMBOL        symbol
+ *   VAL_LOCAL         slot
+ *   VAL_STRING        format
+ *   binary operators  left and right
+ *   OP_ASSIGN         symbol; the value
+ *   OP_ASSIGN_LOCAL   slot; the value
+ *   OP_ASSIGN_ARRAY   symbol; the index and the value
+ *   OP_REF_ARRAY      symbol; the index
+ *   OP_CALL           count arguments; the callee (a VAL_SYMBOL) and the arguments
+ *   CODE_PRINTLN      format; the value, or first is FLAT_NONE
+ *   CODE_RETURN       the value, or first is FLAT_NONE
+ *   CODE_FOR          init, cond, update and the body
+ * Node 0 is never used, so FLAT_NONE is no child.
+ */
+#define FLAT_NONE ((FlatIndex)0)
+
+typedef struct {
+    CodeType code;
+    FlatIndex first;
+    union {
+        int value;
+        int slot;
+        uint32_t count;
+        Symbol *symbol;
+        const Format *format;
+    } un;
+} FlatNode;
+
+/* Pointers into FlatNodes stay valid until the next AST_flatten, AST_flattenDefined or AST_flattenProgram. */
+extern FlatNode *FlatNodes;
+
+/* Appends the tree to FlatNodes and returns the index of its root. */
+FlatIndex AST_flatten(AST *ast);
+/* Flattens the bodies of the functions defined since, for code run while parsing. */
+void AST_flattenDefined(void);
+/* Rebuilds FlatNodes from the bodies of all functions, e.g. after optimization. */
+void AST_flattenProgram(void);
+size_t AST_flatSize(void);
 
 /* Normal Expression */
 AST *AST_makeValue(int v);
@@ -126,6 +208,7 @@ AST *AST_makeFor(AST *init, AST *cond, AST *update, AST *block);
 
 /* Symbol Definition */
 AST *AST_makeSymbol(char *name);
+AST *AST_wrapSymbol(Symbol *symbol);
 Symbol *AST_lookupSymbol(char *name);
 /* Declarations */
 AST *AST_makeFunction(AST *name, AST *params, AST *body);
@@ -141,6 +224,8 @@ AST *AST_getList(AST *p, unsigned long index);
 Symbol *Symbol_new(char *name);
 
 extern StrSymMap *SymbolTable;
+/* Owns the nodes, vectors, symbols and identifier names of the program, and the closures converted from it. */
+extern Arena ASTArena;
 
 /* called from parser */
 void AST_initializeVariable(AST *name, AST *expr);
@@ -0,0 +1,113 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "arena.h"
+
+#define ARENA_ALIGN (2 * sizeof(void *))
+#define ARENA_ROUND(n) (((n) + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1))
+
+struct arena_chunk_ {
+    ArenaChunk *next;
+    size_t size;
+};
+
+#define CHUNK_HEADER ARENA_ROUND(sizeof(ArenaChunk))
+#define BLOCK_HEADER ARENA_ROUND(sizeof(size_t))
+
+static ArenaChunk *Arena_newChunk(Arena *arena, size_t size) {
+    ArenaChunk *chunk = (ArenaChunk *)malloc(CHUNK_HEADER + size);
+    if (!chunk) {
+        fprintf(stderr, "Cannot allocate memory for the arena.\n");
+        abort();
+    }
+    chunk->size = size;
+    arena->reserved += CHUNK_HEADER + size;
+    ++arena->chunk_count;
+    return chunk;
+}
+
+void *Arena_alloc(Arena *arena, size_t size) {
+    size = ARENA_ROUND(size ? size : 1);
+    ++arena->allocations;
+    arena->used += size;
+    if ((size_t)(arena->end - arena->cur) >= size) {
+        void *p = arena->cur;
+        arena->cur += size;
+        return p;
+    }
+    const size_t chunk_size = arena->chunk_size ? arena->chunk_size : ARENA_DEFAULT_CHUNK;
+    if (size > chunk_size / 4) {
+        // a large block gets a chunk of its own, behind the current one
+        ArenaChunk *chunk = Arena_newChunk(arena, size);
+        if (arena->chunks) {
+            chunk->next = arena->chunks->next;
+            arena->chunks->next = chunk;
+        } else {
+            chunk->next = NULL;
+            arena->chunks = chunk;
+        }
+        return (char *)chunk + CHUNK_HEADER;
+    }
+    ArenaChunk *chunk = Arena_newChunk(arena, chunk_size);
+    chunk->next = arena->chunks;
+    arena->chunks = chunk;
+    arena->cur = (char *)chunk + CHUNK_HEADER + size;
+    arena->end = (char *)chunk + CHUNK_HEADER + chunk_size;
+    return (char *)chunk + CHUNK_HEADER;
+}
+
+char *Arena_strndup(Arena *arena, const char *s, size_t len) {
+    char *p = (char *)Arena_alloc(arena, len + 1);
+    memcpy(p, s, len);
+    p[len] = '\0';
+    return p;
+}
+
+void *Arena_malloc(Arena *arena, size_t size) {
+    char *p = (char *)Arena_alloc(arena, BLOCK_HEADER + size);
+    *(size_t *)p = size;
+    return p + BLOCK_HEADER;
+}
+
+void *Arena_realloc(Arena *arena, void *p, size_t size) {
+    if (!p) {
+        return Arena_malloc(arena, size);
+    }
+    size_t *header = (size_t *)((char *)p - BLOCK_HEADER);
+    const size_t old = *header;
+    if (size <= old) {
+        *header = size;
+        return p;
+    }
+    // the last block of the current chunk grows in place
+    char *block_end = (char *)p + ARENA_ROUND(old);
+    const size_t extra = ARENA_ROUND(size) - ARENA_ROUND(old);
+    if (block_end == arena->cur && (size_t)(arena->end - arena->cur) >= extra) {
+        arena->cur += extra;
+        arena->used += extra;
+        *header = size;
+        return p;
+    }
+    void *q = Arena_malloc(arena, size);
+    memcpy(q, p, old);
+    return q;
+}
+
+void Arena_release(Arena *arena) {
+    for (ArenaChunk *chunk = arena->chunks; chunk; ) {
+        ArenaChunk *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    const size_t chunk_size = arena->chunk_size;
+    memset(arena, 0, sizeof(*arena));
+    arena->chunk_size = chunk_size;
+}
+
+void Arena_printStats(const Arena *arena, const char *name, FILE *out) {
+    fprintf(out, "%s: %lu allocations, %lu bytes used, %lu bytes in %lu chunks\n",
+            name, arena->allocations, (unsigned long)arena->used,
+            (unsigned long)arena->reserved, arena->chunk_count);
+}
+
+/* vim: set et ts=4 sts=4 sw=4: */
@@ -0,0 +1,43 @@
+#ifndef tinyc_arena_h
+#define tinyc_arena_h
+
+#include <stddef.h>
+#include <stdio.h>
+
+#define ARENA_DEFAULT_CHUNK (64 * 1024)
+
+/*
+ * Region allocator.
+ * Blocks are carved off the current chunk in allocation order and are
+ * never freed one by one; Arena_release returns every chunk at once.
+ * A zero-initialized Arena is ready to use.
+ */
+typedef struct arena_chunk_ ArenaChunk;
+
+typedef struct {
+    ArenaChunk *chunks;     /* the current chunk first */
+    char *cur;
+    char *end;
+    size_t chunk_size;      /* 0 means ARENA_DEFAULT_CHUNK */
+    unsigned long allocations;
+    unsigned long chunk_count;
+    size_t used;            /* bytes handed out, with alignment */
+    size_t reserved;        /* bytes obtained from malloc */
+} Arena;
+
+void *Arena_alloc(Arena *arena, size_t size);
+char *Arena_strndup(Arena *arena, const char *s, size_t len);
+
+/*
+ * malloc/realloc-compatible pair for code that resizes its blocks (such as
+ * CSTL containers); these blocks carry their size in front of them.
+ */
+void *Arena_malloc(Arena *arena, size_t size);
+void *Arena_realloc(Arena *arena, void *p, size_t size);
+
+void Arena_release(Arena *arena);
+void Arena_printStats(const Arena *arena, const char *name, FILE *out);
+
+#endif
+
+/* vim: set et ts=4 sts=4 sw=4: */
@@ -0,0 +1,15 @@
+#!/bin/bash
+# Runs every benchmark program on each engine.
+# Usage: bench/run.sh [path to tiny-c] [engine...]
+cd "$(dirname "$0")"
+TINYC=${1:-../tiny-c}
+shift
+ENGINES=${*:-ast closure vm jit}
+TIMEFORMAT="%3R s"
+
+for prog in *.tc; do
+    for engine in $ENGINES; do
+        echo "== $prog ($engine)"
+        time "$TINYC" --engine=$engine --stats < "$prog"
+    done
+done
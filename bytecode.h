@@ -0,0 +1,69 @@
+#ifndef tinyc_bytecode_h
+#define tinyc_bytecode_h
+
+#include <stdio.h>
+#include "cstl/vector.h"
+#include "AST.h"
+
+/*
+ * Instruction set of the stack VM.
+ * Every instruction is one int word followed by its operands (also int words).
+ * Jump offsets are relative to the word following the whole instruction.
+ */
+typedef enum opcode_ {
+    BC_PUSH,            /* PUSH value */
+    BC_POP,
+    BC_LOAD_LOCAL,      /* LOAD_LOCAL slot */
+    BC_STORE_LOCAL,     /* STORE_LOCAL slot (leaves the value on the stack) */
+    BC_LOAD_GLOBAL,     /* LOAD_GLOBAL symbol */
+    BC_STORE_GLOBAL,    /* STORE_GLOBAL symbol (leaves the value on the stack) */
+    BC_LOAD_ARRAY,      /* LOAD_ARRAY symbol (pops the index) */
+    BC_STORE_ARRAY,     /* STORE_ARRAY symbol (pops the value and the index) */
+    BC_ADD,
+    BC_SUB,
+    BC_MUL,
+    BC_DIV,
+    BC_LT,
+    BC_GT,
+    BC_LE,
+    BC_GE,
+    BC_EQ,
+    BC_NEQ,
+    BC_JUMP,            /* JUMP offset */
+    BC_JUMP_IF_TRUE,    /* JUMP_IF_TRUE offset (pops the condition) */
+    BC_CHECK_CALL,      /* CHECK_CALL symbol argc (reports a call that cannot succeed) */
+    BC_CALL,            /* CALL symbol argc */
+    BC_TAIL_CALL,       /* TAIL_CALL symbol argc (replaces the current frame) */
+    BC_RETURN,
+    BC_PRINTLN,         /* PRINTLN format */
+    BC_PRINTLN_VALUE    /* PRINTLN_VALUE format (pops the value) */
+} Opcode;
+
+/* A symbol referenced from the code, either a global variable or a function. */
+typedef struct {
+    Symbol *symbol;
+    int entry;          /* code offset of the function body, or -1 */
+    int argc;
+    int max_stack;      /* operand stack words needed by the body */
+    struct memo_ *memo; /* result cache of the function, or NULL */
+} BCSymbol;
+
+CSTL_VECTOR_INTERFACE(CodeVector, int)
+CSTL_VECTOR_INTERFACE(BCSymbolVector, BCSymbol)
+CSTL_VECTOR_INTERFACE(FormatVector, const Format *)
+
+typedef struct {
+    CodeVector *code;
+    BCSymbolVector *symbols;
+    FormatVector *formats;
+    int main;           /* index of the entry function in symbols */
+} Bytecode;
+
+/* Compiles the entry function and every function reachable from it. */
+Bytecode *Bytecode_compile(Symbol *main);
+void Bytecode_delete(Bytecode *bc);
+void Bytecode_dump(Bytecode *bc, FILE *out);
+
+#endif
+
+/* vim: set et ts=4 sts=4 sw=4: */
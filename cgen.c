@@ -0,0 +1,553 @@
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <assert.h>
+#include "cstl/vector.h"
+#include "cgen.h"
+
+/*
+ * Expressions are translated to C expressions without side effects; calls
+ * and assignments are emitted as statements before the expression that uses
+ * their value.  An operand is copied into a temporary when a later operand
+ * has side effects or when both could fail, so the generated program does
+ * things in the same order as the interpreter.
+ */
+
+CSTL_VECTOR_INTERFACE(SymbolRefVector, Symbol *)
+CSTL_VECTOR_IMPLEMENT(SymbolRefVector, Symbol *)
+
+typedef struct {
+    FILE *out;
+    int indent;
+    int temps;
+} CGen;
+
+static const char Prelude[] =
+    "#include <stdio.h>\n"
+    "#include <stdlib.h>\n"
+    "\n"
+    "static int tc_undefined(const char *prefix, const char *name) {\n"
+    "    fprintf(stderr, \"%s undefined or uninitialized symbol: %s\\n\", prefix, name);\n"
+    "    abort();\n"
+    "}\n"
+    "\n"
+    "static int tc_unexpectedType(const char *name, int type) {\n"
+    "    fprintf(stderr, \"Error: symbol '%s' found but it has unexpected type (%d).\\n\", name, type);\n"
+    "    exit(EXIT_FAILURE);\n"
+    "}\n"
+    "\n"
+    "static int tc_unassignable(const char *name) {\n"
+    "    fprintf(stderr, \"Error: Attempt to assign to the unassignable variable %s.\\n\", name);\n"
+    "    abort();\n"
+    "}\n"
+    "\n"
+    "static int tc_notArray(const char *name) {\n"
+    "    fprintf(stderr, \"Error: Attempt to assign to non-array variable %s.\\n\", name);\n"
+    "    exit(EXIT_FAILURE);\n"
+    "}\n"
+    "\n"
+    "static int tc_argumentError(int given, int expected) {\n"
+    "    fprintf(stderr, \"Argument Error (%d args given, but expects %d)\\n\", given, expected);\n"
+    "    abort();\n"
+    "}\n"
+    "\n"
+    "static inline int tc_index(int index, size_t size) {\n"
+    "    if (size <= (size_t)index) {\n"
+    "        fprintf(stderr, \"Error: Index out of range.\\n\");\n"
+    "        exit(EXIT_FAILURE);\n"
+    "    }\n"
+    "    return index;\n"
+    "}\n"
+    "\n"
+    "static inline int tc_load(int bound, int value, const char *name) {\n"
+    "    return bound ? value : tc_undefined(\"[expr] Used\", name);\n"
+    "}\n"
+    "\n"
+    "/* the interpreter wraps around on overflow */\n"
+    "static inline int tc_add(int a, int b) { return (int)((unsigned)a + (unsigned)b); }\n"
+    "static inline int tc_sub(int a, int b) { return (int)((unsigned)a - (unsigned)b); }\n"
+    "static inline int tc_mul(int a, int b) { return (int)((unsigned)a * (unsigned)b); }\n"
+    "\n";
+
+static char *CGen_format(const char *format, ...) {
+    va_list ap;
+    va_start(ap, format);
+    int n = vsnprintf(NULL, 0, format, ap);
+    va_end(ap);
+    char *s = (char *)malloc(n + 1);
+    if (!s) {
+        fprintf(stderr, "Cannot allocate memory for C code.\n");
+        abort();
+    }
+    va_start(ap, format);
+    vsnprintf(s, n + 1, format, ap);
+    va_end(ap);
+    return s;
+}
+
+static void CGen_line(CGen *g, const char *format, ...) {
+    va_list ap;
+    fprintf(g->out, "%*s", g->indent * 4, "");
+    va_start(ap, format);
+    vfprintf(g->out, format, ap);
+    va_end(ap);
+    fputc('\n', g->out);
+}
+
+static void CGen_bytes(FILE *out, const char *s, size_t n) {
+    fputc('"', out);
+    for (size_t i = 0; i < n; ++i) {
+        const unsigned char c = s[i];
+        if (c == '"' || c == '\\' || c == '?') {
+            fprintf(out, "\\%c", c);
+        } else if (c < 0x20 || c >= 0x7f) {
+            fprintf(out, "\\%03o", c);
+        } else {
+            fputc(c, out);
+        }
+    }
+    fputc('"', out);
+}
+
+static void CGen_string(FILE *out, const char *s) {
+    CGen_bytes(out, s, strlen(s));
+}
+
+// Globals that are not values yet need a flag to report reads before the first assignment.
+static bool CGen_isChecked(const Symbol *symbol) {
+    return symbol->type == SYM_UNBOUND;
+}
+
+static bool CGen_hasSideEffects(const AST *ast) {
+    if (!ast) {
+        return false;
+    }
+    switch (ast->code) {
+        case OP_CALL:
+        case OP_ASSIGN:
+        case OP_ASSIGN_LOCAL:
+        case OP_ASSIGN_ARRAY:
+            return true;
+        case OP_ADD:
+        case OP_SUB:
+        case OP_MUL:
+        case OP_DIV:
+        case OP_COMPARE_LT:
+        case OP_COMPARE_GT:
+        case OP_COMPARE_LE:
+        case OP_COMPARE_GE:
+        case OP_COMPARE_EQ:
+        case OP_COMPARE_NEQ:
+            return CGen_hasSideEffects(ast->AST_left) || CGen_hasSideEffects(ast->AST_right);
+        case OP_REF_ARRAY:
+            return CGen_hasSideEffects(ast->AST_right);
+        default:
+            return false;
+    }
+}
+
+// Whether evaluating the expression can stop the program (bounds checks, undefined globals, division).
+static bool CGen_canFail(const AST *ast) {
+    switch (ast->code) {
+        case VAL_SYMBOL:
+            return ast->AST_symbol->type != SYM_VALUE;
+        case OP_REF_ARRAY:
+        case OP_DIV:
+        case OP_CALL:
+        case OP_ASSIGN:
+        case OP_ASSIGN_ARRAY:
+            return true;
+        case OP_ADD:
+        case OP_SUB:
+        case OP_MUL:
+        case OP_COMPARE_LT:
+        case OP_COMPARE_GT:
+        case OP_COMPARE_LE:
+        case OP_COMPARE_GE:
+        case OP_COMPARE_EQ:
+        case OP_COMPARE_NEQ:
+            return CGen_canFail(ast->AST_left) || CGen_canFail(ast->AST_right);
+        case OP_ASSIGN_LOCAL:
+            return CGen_canFail(ast->AST_right);
+        default:
+            return false;
+    }
+}
+
+static char *CGen_expression(CGen *g, AST *expr);
+
+// Copies the value of an expression into a new temporary and returns its name.
+static char *CGen_temporary(CGen *g, char *value) {
+    char *name = CGen_format("t%d", g->temps++);
+    CGen_line(g, "int %s = %s;", name, value);
+    free(value);
+    return name;
+}
+
+// Translates an operand that is followed by the given one in evaluation order.
+static char *CGen_operand(CGen *g, AST *expr, const AST *next) {
+    char *value = CGen_expression(g, expr);
+    if (expr->code != VAL_NUM
+            && (CGen_hasSideEffects(next) || (CGen_canFail(expr) && CGen_canFail(next)))) {
+        value = CGen_temporary(g, value);
+    }
+    return value;
+}
+
+static char *CGen_binary(CGen *g, AST *expr) {
+    static const char *const operators[] = {
+        [OP_COMPARE_LT] = "<", [OP_COMPARE_GT] = ">", [OP_COMPARE_LE] = "<=",
+        [OP_COMPARE_GE] = ">=", [OP_COMPARE_EQ] = "==", [OP_COMPARE_NEQ] = "!=",
+        [OP_DIV] = "/",
+    };
+    char *left = CGen_operand(g, expr->AST_left, expr->AST_right);
+    char *right = CGen_expression(g, expr->AST_right);
+    char *value;
+    switch (expr->code) {
+        case OP_ADD: value = CGen_format("tc_add(%s, %s)", left, right); break;
+        case OP_SUB: value = CGen_format("tc_sub(%s, %s)", left, right); break;
+        case OP_MUL: value = CGen_format("tc_mul(%s, %s)", left, right); break;
+        default:     value = CGen_format("(%s %s %s)", left, operators[expr->code], right); break;
+    }
+    free(left);
+    free(right);
+    return value;
+}
+
+static char *CGen_global(const Symbol *symbol) {
+    switch (symbol->type) {
+        case SYM_VALUE:
+            return CGen_format("v_%s", symbol->name);
+        case SYM_UNBOUND:
+            return CGen_format("tc_load(b_%s, v_%s, \"%s\")", symbol->name, symbol->name, symbol->name);
+        default:
+            return CGen_format("tc_unexpectedType(\"%s\", %d)", symbol->name, symbol->type);
+    }
+}
+
+static char *CGen_assign(CGen *g, AST *expr) {
+    const Symbol *symbol = expr->AST_left->AST_symbol;
+    char *value = CGen_expression(g, expr->AST_right);
+    if (symbol->type != SYM_UNBOUND && symbol->type != SYM_VALUE) {
+        CGen_line(g, "(void)%s;", value);
+        CGen_line(g, "tc_unassignable(\"%s\");", symbol->name);
+        free(value);
+        return CGen_format("0");
+    }
+    CGen_line(g, "v_%s = %s;", symbol->name, value);
+    free(value);
+    if (CGen_isChecked(symbol)) {
+        CGen_line(g, "b_%s = 1;", symbol->name);
+    }
+    return CGen_format("v_%s", symbol->name);
+}
+
+static char *CGen_refArray(CGen *g, AST *expr) {
+    const Symbol *array = expr->AST_left->AST_symbol;
+    char *index = CGen_expression(g, expr->AST_right);
+    char *value;
+    if (array->type == SYM_ARRAY) {
+        value = CGen_format("a_%s[tc_index(%s, %lu)]", array->name, index, (unsigned long)array->SYM_array_size);
+    } else if (array->type == SYM_UNBOUND) {
+        value = CGen_format("(%s, tc_undefined(\"[func] Used an\", \"%s\"))", index, array->name);
+    } else {
+        value = CGen_format("(%s, tc_unexpectedType(\"%s\", %d))", index, array->name, array->type);
+    }
+    free(index);
+    return value;
+}
+
+static char *CGen_assignArray(CGen *g, AST *expr) {
+    const Symbol *array = expr->AST_first->AST_symbol;
+    char *index = CGen_operand(g, expr->AST_second, expr->AST_third);
+    char *value = CGen_temporary(g, CGen_expression(g, expr->AST_third));
+    if (array->type == SYM_ARRAY) {
+        CGen_line(g, "a_%s[tc_index(%s, %lu)] = %s;", array->name, index, (unsigned long)array->SYM_array_size, value);
+    } else {
+        CGen_line(g, "(void)%s;", index);
+        CGen_line(g, "tc_notArray(\"%s\");", array->name);
+    }
+    free(index);
+    return value;
+}
+
+// Emits the call as a statement; returns the temporary holding the result unless discard is set.
+static char *CGen_call(CGen *g, AST *expr, bool discard) {
+    const Symbol *callee = expr->AST_left->AST_symbol;
+    ASTVector *args = expr->AST_right->AST_list;
+    const size_t argc = ASTVector_size(args);
+    if (callee->type != SYM_FUNC) {
+        if (callee->type == SYM_UNBOUND) {
+            CGen_line(g, "tc_undefined(\"[func] Used an\", \"%s\");", callee->name);
+        } else {
+            CGen_line(g, "tc_unexpectedType(\"%s\", %d);", callee->name, callee->type);
+        }
+        return discard ? NULL : CGen_format("0");
+    }
+    if (argc != SymbolVector_size(callee->SYM_param)) {
+        CGen_line(g, "tc_argumentError(%lu, %lu);", (unsigned long)argc, (unsigned long)SymbolVector_size(callee->SYM_param));
+        return discard ? NULL : CGen_format("0");
+    }
+    char **values = (char **)malloc(sizeof(char *) * (argc + 1));
+    if (!values) {
+        fprintf(stderr, "Cannot allocate memory for C code.\n");
+        abort();
+    }
+    for (size_t i = 0; i < argc; ++i) {
+        AST *arg = ASTVector_at(args, i);
+        values[i] = CGen_expression(g, arg);
+        bool later_effects = false, later_fails = false;
+        for (size_t j = i + 1; j < argc; ++j) {
+            later_effects = later_effects || CGen_hasSideEffects(ASTVector_at(args, j));
+            later_fails = later_fails || CGen_canFail(ASTVector_at(args, j));
+        }
+        if (arg->code != VAL_NUM && (later_effects || (later_fails && CGen_canFail(arg)))) {
+            values[i] = CGen_temporary(g, values[i]);
+        }
+    }
+    fprintf(g->out, "%*s", g->indent * 4, "");
+    char *result = NULL;
+    if (!discard) {
+        result = CGen_format("t%d", g->temps++);
+        fprintf(g->out, "int %s = ", result);
+    }
+    fprintf(g->out, "f_%s(", callee->name);
+    for (size_t i = 0; i < argc; ++i) {
+        fprintf(g->out, "%s%s", i ? ", " : "", values[i]);
+        free(values[i]);
+    }
+    fprintf(g->out, ");\n");
+    free(values);
+    return result;
+}
+
+static char *CGen_expression(CGen *g, AST *expr) {
+    switch (expr->code) {
+        case VAL_NUM:
+            return CGen_format("%d", expr->AST_value);
+        case VAL_SYMBOL:
+            return CGen_global(expr->AST_symbol);
+        case VAL_LOCAL:
+            return CGen_format("p%d", expr->AST_slot);
+        case OP_ADD:
+        case OP_SUB:
+        case OP_MUL:
+        case OP_DIV:
+        case OP_COMPARE_LT:
+        case OP_COMPARE_GT:
+        case OP_COMPARE_LE:
+        case OP_COMPARE_GE:
+        case OP_COMPARE_EQ:
+        case OP_COMPARE_NEQ:
+            return CGen_binary(g, expr);
+        case OP_ASSIGN:
+            return CGen_assign(g, expr);
+        case OP_ASSIGN_LOCAL: {
+            char *value = CGen_expression(g, expr->AST_right);
+            CGen_line(g, "p%d = %s;", expr->AST_left->AST_slot, value);
+            free(value);
+            return CGen_format("p%d", expr->AST_left->AST_slot);
+        }
+        case OP_ASSIGN_ARRAY:
+            return CGen_assignArray(g, expr);
+        case OP_REF_ARRAY:
+            return CGen_refArray(g, expr);
+        case OP_CALL:
+            return CGen_call(g, expr, false);
+        default:
+            fprintf(stderr, "unknown expression (type: %d)\n", expr->code);
+            abort();
+    }
+}
+
+// Evaluates the expression for its effects only.
+static void CGen_discard(CGen *g, AST *expr) {
+    if (expr->code == OP_CALL) {
+        CGen_call(g, expr, true);
+        return;
+    }
+    char *value = CGen_expression(g, expr);
+    if (CGen_canFail(expr) && !CGen_hasSideEffects(expr)) {
+        CGen_line(g, "(void)%s;", value);
+    }
+    free(value);
+}
+
+static void CGen_statement(CGen *g, AST *ast);
+
+static void CGen_statements(CGen *g, ASTVector *statements) {
+    const size_t n = ASTVector_size(statements);
+    for (size_t i = 0; i < n; ++i) {
+        CGen_statement(g, ASTVector_at(statements, i));
+    }
+}
+
+static void CGen_for(CGen *g, AST *ast) {
+    ASTVector *for_stmt = ast->AST_left->AST_list;
+    CGen_discard(g, ASTVector_at(for_stmt, 0));
+    CGen_line(g, "for (;;) {");
+    ++g->indent;
+    char *cond = CGen_expression(g, ASTVector_at(for_stmt, 1));
+    CGen_line(g, "if (!%s) break;", cond);
+    free(cond);
+    CGen_statements(g, ast->AST_right->AST_list);
+    CGen_discard(g, ASTVector_at(for_stmt, 2));
+    --g->indent;
+    CGen_line(g, "}");
+}
+
+static void CGen_statement(CGen *g, AST *ast) {
+    switch (ast->code) {
+        case ETC_LIST:
+            CGen_line(g, "{");
+            ++g->indent;
+            CGen_statements(g, ast->AST_list);
+            --g->indent;
+            CGen_line(g, "}");
+            break;
+        case CODE_PRINTLN: {
+            char *value = ast->AST_right ? CGen_expression(g, ast->AST_right) : NULL;
+            fprintf(g->out, "%*sprintf(", g->indent * 4, "");
+            CGen_string(g->out, ast->AST_left->AST_string);
+            fprintf(g->out, value ? ", %s);\n" : ");\n", value);
+            CGen_line(g, "putchar('\\n');");
+            free(value);
+            break;
+        }
+        case CODE_RETURN:
+            if (ast->AST_unary) {
+                char *value = CGen_expression(g, ast->AST_unary);
+                CGen_line(g, "return %s;", value);
+                free(value);
+            } else {
+                CGen_line(g, "return 0;");
+            }
+            break;
+        case CODE_FOR:
+            CGen_for(g, ast);
+            break;
+        // statements without side effects are not evaluated by the tree walker either
+        case OP_REF_ARRAY:
+        case CODE_VAR:
+        case VAL_NUM:
+        case VAL_SYMBOL:
+        case VAL_LOCAL:
+        case OP_ADD:
+        case OP_SUB:
+        case OP_MUL:
+        case OP_DIV:
+        case OP_COMPARE_LT:
+        case OP_COMPARE_GT:
+        case OP_COMPARE_LE:
+        case OP_COMPARE_GE:
+        case OP_COMPARE_EQ:
+        case OP_COMPARE_NEQ:
+            break;
+        default:
+            CGen_discard(g, ast);
+            break;
+    }
+}
+
+static void CGen_signature(CGen *g, const Symbol *func) {
+    const size_t argc = SymbolVector_size(func->SYM_param);
+    fprintf(g->out, "static int f_%s(", func->name);
+    for (size_t i = 0; i < argc; ++i) {
+        fprintf(g->out, "%sint p%lu", i ? ", " : "", (unsigned long)i);
+    }
+    fprintf(g->out, argc ? ")" : "void)");
+}
+
+static void CGen_declare(CGen *g, const Symbol *symbol) {
+    switch (symbol->type) {
+        case SYM_VALUE:
+            fprintf(g->out, "static int v_%s = %d;\n", symbol->name, symbol->SYM_value);
+            break;
+        case SYM_UNBOUND:
+            fprintf(g->out, "static int v_%s, b_%s;\n", symbol->name, symbol->name);
+            break;
+        case SYM_ARRAY: {
+            const size_t size = symbol->SYM_array_size;
+            fprintf(g->out, "static int a_%s[%lu]", symbol->name, (unsigned long)(size ? size : 1));
+            size_t used = size;
+            while (used > 0 && symbol->SYM_array_data[used - 1] == 0) {
+                --used;
+            }
+            if (used) {
+                fprintf(g->out, " = {");
+                for (size_t i = 0; i < used; ++i) {
+                    fprintf(g->out, "%s%d", i % 16 ? ", " : "\n    ", symbol->SYM_array_data[i]);
+                }
+                fprintf(g->out, "\n}");
+            }
+            fprintf(g->out, ";\n");
+            break;
+        }
+        case SYM_FUNC:
+            CGen_signature(g, symbol);
+            fprintf(g->out, ";\n");
+            break;
+    }
+}
+
+static int CGen_compareNames(const void *a, const void *b) {
+    return strcmp((*(Symbol *const *)a)->name, (*(Symbol *const *)b)->name);
+}
+
+void CGen_emitProgram(Symbol *main, const char *printed, size_t printed_len, FILE *out) {
+    assert(main->type == SYM_FUNC);
+    CGen g = { out, 0, 0 };
+    // sorted by name so that the output does not depend on the hash table
+    SymbolRefVector *symbols = SymbolRefVector_new();
+    StrSymMapIterator it;
+    for (it = StrSymMap_begin(SymbolTable); it != StrSymMap_end(SymbolTable); it = StrSymMap_next(it)) {
+        Symbol *symbol = StrSymMap_value(it);
+        if (!SymbolRefVector_push_back(symbols, symbol)) {
+            fprintf(stderr, "Cannot allocate memory for C code.\n");
+            abort();
+        }
+    }
+    const size_t n = SymbolRefVector_size(symbols);
+    if (n) {
+        qsort(SymbolRefVector_at(symbols, 0), n, sizeof(Symbol *), CGen_compareNames);
+    }
+
+    fprintf(out, "/* Generated by tiny-c --emit-c */\n%s", Prelude);
+    for (size_t i = 0; i < n; ++i) {
+        CGen_declare(&g, *SymbolRefVector_at(symbols, i));
+    }
+    for (size_t i = 0; i < n; ++i) {
+        const Symbol *func = *SymbolRefVector_at(symbols, i);
+        if (func->type != SYM_FUNC) {
+            continue;
+        }
+        assert(func->SYM_body->code == ETC_LIST);
+        fputc('\n', out);
+        CGen_signature(&g, func);
+        fprintf(out, " {\n");
+        g.indent = 1;
+        g.temps = 0;
+        CGen_statements(&g, func->SYM_body->AST_list);
+        CGen_line(&g, "return 0;");
+        g.indent = 0;
+        fprintf(out, "}\n");
+    }
+    fprintf(out, "\nint main(void) {\n");
+    if (printed_len) {
+        fprintf(out, "    /* printed by the initializers of the globals */\n    fwrite(");
+        CGen_bytes(out, printed, printed_len);
+        fprintf(out, ", 1, %lu, stdout);\n", (unsigned long)printed_len);
+    }
+    const size_t argc = SymbolVector_size(main->SYM_param);
+    if (argc) {
+        fprintf(out, "    return tc_argumentError(0, %lu);\n", (unsigned long)argc);
+    } else {
+        fprintf(out, "    return f_%s();\n", main->name);
+    }
+    fprintf(out, "}\n");
+    SymbolRefVector_delete(symbols);
+}
+
+/* vim: set et ts=4 sts=4 sw=4: */
@@ -0,0 +1,21 @@
+#ifndef tinyc_cgen_h
+#define tinyc_cgen_h
+
+#include <stdio.h>
+#include "AST.h"
+
+/*
+ * Ahead-of-time backend.
+ * Writes a self-contained C99 program equivalent to the parsed one: every
+ * function in the SymbolTable, the globals and arrays with the values their
+ * declarations left, and a main() that runs 'main' and exits with its
+ * result.  Evaluation order, bounds checks and error messages follow the
+ * bytecode VM.
+ * The initializers of the globals ran while parsing; main() first prints
+ * the printed_len characters of what they printed.
+ */
+void CGen_emitProgram(Symbol *main, const char *printed, size_t printed_len, FILE *out);
+
+#endif
+
+/* vim: set et ts=4 sts=4 sw=4: */
@@ -0,0 +1,576 @@
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <assert.h>
+#include "cstl/vector.h"
+#include "cstl/unordered_flat_map.h"
+#include "closure.h"
+#include "memo.h"
+#include "output.h"
+
+/* Statement handlers return false once a return statement has been executed. */
+
+static FrameStack *Frames = NULL;
+static int ReturnValue = 0;
+/* Callee of a pending tail call; its arguments are on top of the frame stack. */
+static const ClosureFunction *TailCallee = NULL;
+
+static size_t SymFuncMap_hashSymbol(const Symbol *symbol) {
+    return (size_t)symbol / sizeof(void *);
+}
+
+static int SymFuncMap_compareSymbol(const Symbol *a, const Symbol *b) {
+    return a != b;
+}
+
+CSTL_UNORDERED_FLAT_MAP_INTERFACE(SymFuncMap, const Symbol *, ClosureFunction *)
+CSTL_UNORDERED_FLAT_MAP_IMPLEMENT(SymFuncMap, const Symbol *, ClosureFunction *, SymFuncMap_hashSymbol, SymFuncMap_compareSymbol)
+CSTL_VECTOR_INTERFACE(ClosureFunctionVector, ClosureFunction *)
+CSTL_VECTOR_IMPLEMENT(ClosureFunctionVector, ClosureFunction *)
+
+typedef struct {
+    SymFuncMap *functions;
+    ClosureFunctionVector *pending;     /* functions whose body is not converted yet */
+} Converter;
+
+/*
+ * Runtime errors
+ */
+
+static void Closure_undefinedSymbol(const char *prefix, const Symbol *symbol) {
+    fprintf(stderr, "%s undefined or uninitialized symbol: %s\n", prefix, symbol->name);
+    abort();
+}
+
+static void Closure_unexpectedType(const Symbol *symbol) {
+    fprintf(stderr, "Error: symbol '%s' found but it has unexpected type (%d).\n", symbol->name, symbol->type);
+    exit(EXIT_FAILURE);
+}
+
+static void Closure_unassignable(const Symbol *symbol) {
+    fprintf(stderr, "Error: Attempt to assign to the unassignable variable %s.\n", symbol->name);
+    abort();
+}
+
+static inline int Closure_readGlobal(const Symbol *symbol) {
+    if (symbol->type != SYM_VALUE) {
+        if (symbol->type == SYM_UNBOUND) Closure_undefinedSymbol("[expr] Used", symbol);
+        Closure_unexpectedType(symbol);
+    }
+    return symbol->SYM_value;
+}
+
+static inline int Closure_writeGlobal(Symbol *symbol, const int value) {
+    if (symbol->type != SYM_UNBOUND && symbol->type != SYM_VALUE) {
+        Closure_unassignable(symbol);
+    }
+    symbol->type = SYM_VALUE;
+    return symbol->SYM_value = value;
+}
+
+static inline int *Closure_element(const Symbol *array, const size_t idx) {
+    if (array->type != SYM_ARRAY) {
+        if (array->type == SYM_UNBOUND) Closure_undefinedSymbol("[func] Used an", array);
+        Closure_unexpectedType(array);
+    }
+    if (array->SYM_array_size <= idx) {
+        fprintf(stderr, "Error: Index out of range.\n");
+        exit(EXIT_FAILURE);
+    }
+    return &array->SYM_array_data[idx];
+}
+
+/*
+ * Expression handlers
+ */
+
+static int Closure_const(const Closure *c) {
+    return c->a.value;
+}
+
+static int Closure_local(const Closure *c) {
+    return Frames->fp[c->a.slot];
+}
+
+static int Closure_global(const Closure *c) {
+    return Closure_readGlobal(c->a.symbol);
+}
+
+// The left operand is evaluated first, as on the VM.
+#define CLOSURE_BINARY(name, op) \
+static int Closure_##name(const Closure *c) { \
+    const int left = c->a.child->run(c->a.child); \
+    return left op c->b.child->run(c->b.child); \
+} \
+static int Closure_##name##_any_const(const Closure *c) { \
+    return c->a.child->run(c->a.child) op c->b.value; \
+} \
+static int Closure_##name##_local_const(const Closure *c) { \
+    return Frames->fp[c->a.slot] op c->b.value; \
+} \
+static int Closure_##name##_local_local(const Closure *c) { \
+    return Frames->fp[c->a.slot] op Frames->fp[c->b.slot]; \
+} \
+static int Closure_##name##_global_const(const Closure *c) { \
+    return Closure_readGlobal(c->a.symbol) op c->b.value; \
+}
+
+CLOSURE_BINARY(add, +)
+CLOSURE_BINARY(sub, -)
+CLOSURE_BINARY(mul, *)
+CLOSURE_BINARY(div, /)
+CLOSURE_BINARY(lt, <)
+CLOSURE_BINARY(gt, >)
+CLOSURE_BINARY(le, <=)
+CLOSURE_BINARY(ge, >=)
+CLOSURE_BINARY(eq, ==)
+CLOSURE_BINARY(neq, !=)
+
+typedef enum {
+    SHAPE_ANY,
+    SHAPE_ANY_CONST,
+    SHAPE_LOCAL_CONST,
+    SHAPE_LOCAL_LOCAL,
+    SHAPE_GLOBAL_CONST,
+    SHAPE_COUNT
+} BinaryShape;
+
+#define CLOSURE_BINARY_ROW(name) { \
+    [SHAPE_ANY] = Closure_##name, \
+    [SHAPE_ANY_CONST] = Closure_##name##_any_const, \
+    [SHAPE_LOCAL_CONST] = Closure_##name##_local_const, \
+    [SHAPE_LOCAL_LOCAL] = Closure_##name##_local_local, \
+    [SHAPE_GLOBAL_CONST] = Closure_##name##_global_const, \
+}
+
+/* indexed by CodeType - OP_ADD */
+static const ClosureHandler BinaryHandlers[][SHAPE_COUNT] = {
+    CLOSURE_BINARY_ROW(add),
+    CLOSURE_BINARY_ROW(sub),
+    CLOSURE_BINARY_ROW(mul),
+    CLOSURE_BINARY_ROW(div),
+    CLOSURE_BINARY_ROW(lt),
+    CLOSURE_BINARY_ROW(gt),
+    CLOSURE_BINARY_ROW(le),
+    CLOSURE_BINARY_ROW(ge),
+    CLOSURE_BINARY_ROW(eq),
+    CLOSURE_BINARY_ROW(neq),
+};
+
+static int Closure_assignLocal(const Closure *c) {
+    // the frame stack may move while evaluating the value
+    const int value = c->a.child->run(c->a.child);
+    return Frames->fp[c->b.slot] = value;
+}
+
+// local = local + constant
+static int Closure_addLocalConst(const Closure *c) {
+    return Frames->fp[c->a.slot] += c->b.value;
+}
+
+static int Closure_assignGlobal(const Closure *c) {
+    return Closure_writeGlobal(c->b.symbol, c->a.child->run(c->a.child));
+}
+
+// global = global + constant
+static int Closure_addGlobalConst(const Closure *c) {
+    Symbol *symbol = c->a.symbol;
+    return Closure_writeGlobal(symbol, Closure_readGlobal(symbol) + c->b.value);
+}
+
+static int Closure_refArray(const Closure *c) {
+    return *Closure_element(c->a.symbol, c->b.child->run(c->b.child));
+}
+
+static int Closure_assignArray(const Closure *c) {
+    const size_t idx = c->b.child->run(c->b.child);
+    const int value = c->c.child->run(c->c.child);
+    if (c->a.symbol->type != SYM_ARRAY) {
+        fprintf(stderr, "Error: Attempt to assign to non-array variable %s.\n", c->a.symbol->name);
+        exit(EXIT_FAILURE);
+    }
+    return *Closure_element(c->a.symbol, idx) = value;
+}
+
+static int Closure_invoke(const ClosureFunction *f) {
+    Memo *memo = f->symbol->SYM_memo;
+    // the key outlives the frame, which tail calls overwrite
+    int key[memo ? MEMO_KEY_SIZE(f->argc) : 1];
+    if (memo) {
+        int cached;
+        if (Memo_lookup(memo, Frames->top - f->argc, key, &cached)) {
+            Frames->top -= f->argc;
+            return cached;
+        }
+    }
+    const size_t caller = FrameStack_enter(Frames, f->argc);
+    int returned;
+    // a tail call replaces the current frame instead of nesting a new one
+    while ((returned = !f->body->run(f->body)) && TailCallee) {
+        f = TailCallee;
+        TailCallee = NULL;
+        memmove(Frames->fp, Frames->top - f->argc, f->argc * sizeof(int));
+        Frames->top = Frames->fp + f->argc;
+        ++Frames->calls;
+    }
+    FrameStack_leave(Frames, caller);
+    const int result = returned ? ReturnValue : 0;
+    if (memo) {
+        Memo_store(memo, key, result);
+    }
+    return result;
+}
+
+static int Closure_call(const Closure *c) {
+    Closure **args = c->b.list;
+    for (int i = 0; i < c->n; ++i) {
+        FrameStack_push(Frames, args[i]->run(args[i]));
+    }
+    return Closure_invoke(c->a.function);
+}
+
+// return f(...): leaves the arguments on the frame stack for Closure_invoke.
+static int Closure_tailCall(const Closure *c) {
+    Closure **args = c->b.list;
+    for (int i = 0; i < c->n; ++i) {
+        FrameStack_push(Frames, args[i]->run(args[i]));
+    }
+    TailCallee = c->a.function;
+    return false;
+}
+
+// A call that cannot succeed; reported when it is reached, as by the AST walker.
+static int Closure_badCall(const Closure *c) {
+    const ClosureFunction *f = c->a.function;
+    if (f->symbol->type != SYM_FUNC) {
+        if (f->symbol->type == SYM_UNBOUND) Closure_undefinedSymbol("[func] Used an", f->symbol);
+        Closure_unexpectedType(f->symbol);
+    }
+    fprintf(stderr, "Argument Error (%d args given, but expects %d)\n", c->n, f->argc);
+    abort();
+}
+
+/*
+ * Statement handlers
+ */
+
+static int Closure_block(const Closure *c) {
+    Closure **items = c->a.list;
+    for (int i = 0; i < c->n; ++i) {
+        if (!items[i]->run(items[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static int Closure_expression(const Closure *c) {
+    c->a.child->run(c->a.child);
+    return true;
+}
+
+static int Closure_println(const Closure *c) {
+    Output_println(c->a.format, 0);
+    return true;
+}
+
+static int Closure_printlnValue(const Closure *c) {
+    Output_println(c->a.format, c->b.child->run(c->b.child));
+    return true;
+}
+
+static int Closure_return(const Closure *c) {
+    ReturnValue = c->a.child->run(c->a.child);
+    return false;
+}
+
+static int Closure_returnVoid(const Closure *c) {
+    ReturnValue = 0;
+    return false;
+}
+
+static int Closure_for(const Closure *c) {
+    const Closure *cond = c->b.child, *update = c->c.child, *body = c->d.child;
+    for (c->a.child->run(c->a.child); cond->run(cond); update->run(update)) {
+        if (!body->run(body)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * Conversion
+ */
+
+static Closure *convertExpression(Converter *cv, AST *expr);
+static Closure *convertStatement(Converter *cv, AST *ast);
+
+/* The closures live in the front-end arena with the AST they were converted from. */
+static void *Closure_alloc(size_t size) {
+    void *p = Arena_alloc(&ASTArena, size);
+    memset(p, 0, size);
+    return p;
+}
+
+static Closure *Closure_new(ClosureHandler run) {
+    Closure *c = (Closure *)Closure_alloc(sizeof(Closure));
+    c->run = run;
+    return c;
+}
+
+static ClosureFunction *functionFor(Converter *cv, Symbol *symbol) {
+    SymFuncMapIterator it = SymFuncMap_find(cv->functions, symbol);
+    if (it != SymFuncMap_end(cv->functions)) {
+        return *SymFuncMap_value(it);
+    }
+    ClosureFunction *f = (ClosureFunction *)Closure_alloc(sizeof(ClosureFunction));
+    f->symbol = symbol;
+    if (symbol->type == SYM_FUNC) {
+        f->argc = SymbolVector_size(symbol->SYM_param);
+        ClosureFunctionVector_push_back(cv->pending, f);
+    }
+    SymFuncMap_insert(cv->functions, symbol, f, NULL);
+    return f;
+}
+
+static Closure *convertBinary(Converter *cv, AST *expr) {
+    const ClosureHandler *handlers = BinaryHandlers[expr->code - OP_ADD];
+    AST *left = expr->AST_left;
+    AST *right = expr->AST_right;
+    Closure *c;
+    if (right->code == VAL_NUM) {
+        if (left->code == VAL_LOCAL) {
+            c = Closure_new(handlers[SHAPE_LOCAL_CONST]);
+            c->a.slot = left->AST_slot;
+        } else if (left->code == VAL_SYMBOL) {
+            c = Closure_new(handlers[SHAPE_GLOBAL_CONST]);
+            c->a.symbol = left->AST_symbol;
+        } else {
+            c = Closure_new(handlers[SHAPE_ANY_CONST]);
+            c->a.child = convertExpression(cv, left);
+        }
+        c->b.value = right->AST_value;
+    } else if (left->code == VAL_LOCAL && right->code == VAL_LOCAL) {
+        c = Closure_new(handlers[SHAPE_LOCAL_LOCAL]);
+        c->a.slot = left->AST_slot;
+        c->b.slot = right->AST_slot;
+    } else {
+        c = Closure_new(handlers[SHAPE_ANY]);
+        c->a.child = convertExpression(cv, left);
+        c->b.child = convertExpression(cv, right);
+    }
+    return c;
+}
+
+// Returns the constant k if expr is (target + k) or (target - k), with target the same variable.
+static bool isIncrement(AST *target, AST *expr, int *k) {
+    if ((expr->code != OP_ADD && expr->code != OP_SUB) || expr->AST_right->code != VAL_NUM) {
+        return false;
+    }
+    AST *var = expr->AST_left;
+    if (var->code != target->code) {
+        return false;
+    }
+    if (target->code == VAL_LOCAL ? var->AST_slot != target->AST_slot : var->AST_symbol != target->AST_symbol) {
+        return false;
+    }
+    const int value = expr->AST_right->AST_value;
+    if (expr->code == OP_SUB && value == INT_MIN) {
+        return false;
+    }
+    *k = expr->code == OP_ADD ? value : -value;
+    return true;
+}
+
+static Closure *convertAssign(Converter *cv, AST *expr) {
+    AST *target = expr->AST_left;
+    const bool local = expr->code == OP_ASSIGN_LOCAL;
+    int k;
+    Closure *c;
+    if (isIncrement(target, expr->AST_right, &k)) {
+        c = Closure_new(local ? Closure_addLocalConst : Closure_addGlobalConst);
+        c->b.value = k;
+        if (local) {
+            c->a.slot = target->AST_slot;
+        } else {
+            c->a.symbol = target->AST_symbol;
+        }
+        return c;
+    }
+    c = Closure_new(local ? Closure_assignLocal : Closure_assignGlobal);
+    c->a.child = convertExpression(cv, expr->AST_right);
+    if (local) {
+        c->b.slot = target->AST_slot;
+    } else {
+        c->b.symbol = target->AST_symbol;
+    }
+    return c;
+}
+
+static Closure **convertList(Converter *cv, ASTVector *list, bool statements, int *n) {
+    const size_t size = ASTVector_size(list);
+    Closure **items = (Closure **)Closure_alloc(sizeof(Closure *) * (size ? size : 1));
+    *n = 0;
+    for (size_t i = 0; i < size; ++i) {
+        AST *ast = ASTVector_at(list, i);
+        Closure *item = statements ? convertStatement(cv, ast) : convertExpression(cv, ast);
+        if (item) {
+            items[(*n)++] = item;
+        }
+    }
+    return items;
+}
+
+static Closure *convertCall(Converter *cv, AST *expr) {
+    ClosureFunction *f = functionFor(cv, expr->AST_left->AST_symbol);
+    Closure *c = Closure_new(Closure_call);
+    c->a.function = f;
+    c->b.list = convertList(cv, expr->AST_right->AST_list, false, &c->n);
+    if (f->symbol->type != SYM_FUNC || c->n != f->argc) {
+        c->run = Closure_badCall;
+    }
+    return c;
+}
+
+static Closure *convertExpression(Converter *cv, AST *expr) {
+    Closure *c;
+    switch (expr->code) {
+        case VAL_NUM:
+            c = Closure_new(Closure_const);
+            c->a.value = expr->AST_value;
+            return c;
+        case VAL_LOCAL:
+            c = Closure_new(Closure_local);
+            c->a.slot = expr->AST_slot;
+            return c;
+        case VAL_SYMBOL:
+            c = Closure_new(Closure_global);
+            c->a.symbol = expr->AST_symbol;
+            return c;
+        case OP_ADD:
+        case OP_SUB:
+        case OP_MUL:
+        case OP_DIV:
+        case OP_COMPARE_LT:
+        case OP_COMPARE_GT:
+        case OP_COMPARE_LE:
+        case OP_COMPARE_GE:
+        case OP_COMPARE_EQ:
+        case OP_COMPARE_NEQ:
+            return convertBinary(cv, expr);
+        case OP_ASSIGN:
+        case OP_ASSIGN_LOCAL:
+            return convertAssign(cv, expr);
+        case OP_REF_ARRAY:
+            c = Closure_new(Closure_refArray);
+            c->a.symbol = expr->AST_left->AST_symbol;
+            c->b.child = convertExpression(cv, expr->AST_right);
+            return c;
+        case OP_ASSIGN_ARRAY:
+            c = Closure_new(Closure_assignArray);
+            c->a.symbol = expr->AST_first->AST_symbol;
+            c->b.child = convertExpression(cv, expr->AST_second);
+            c->c.child = convertExpression(cv, expr->AST_third);
+            return c;
+        case OP_CALL:
+            return convertCall(cv, expr);
+        default:
+            fprintf(stderr, "unknown expression (type: %d)\n", expr->code);
+            abort();
+    }
+}
+
+static Closure *convertBlock(Converter *cv, AST *ast) {
+    assert(ast->code == ETC_LIST);
+    Closure *c = Closure_new(Closure_block);
+    c->a.list = convertList(cv, ast->AST_list, true, &c->n);
+    return c;
+}
+
+// Returns NULL for statements that the AST walker does not evaluate.
+static Closure *convertStatement(Converter *cv, AST *ast) {
+    Closure *c;
+    switch (ast->code) {
+        case ETC_LIST:
+            return convertBlock(cv, ast);
+        case CODE_PRINTLN:
+            if (ast->AST_right) {
+                c = Closure_new(Closure_printlnValue);
+                c->b.child = convertExpression(cv, ast->AST_right);
+            } else {
+                c = Closure_new(Closure_println);
+            }
+            c->a.format = ast->AST_left->AST_format;
+            return c;
+        case CODE_RETURN:
+            if (!ast->AST_unary) {
+                return Closure_new(Closure_returnVoid);
+            }
+            if (ast->AST_unary->code == OP_CALL) {
+                Closure *call = convertCall(cv, ast->AST_unary);
+                if (call->run == Closure_call) {
+                    call->run = Closure_tailCall;
+                    return call;
+                }
+                c = Closure_new(Closure_return);
+                c->a.child = call;
+                return c;
+            }
+            c = Closure_new(Closure_return);
+            c->a.child = convertExpression(cv, ast->AST_unary);
+            return c;
+        case CODE_FOR: {
+            ASTVector *for_stmt = ast->AST_left->AST_list;
+            c = Closure_new(Closure_for);
+            c->a.child = convertExpression(cv, ASTVector_at(for_stmt, 0));
+            c->b.child = convertExpression(cv, ASTVector_at(for_stmt, 1));
+            c->c.child = convertExpression(cv, ASTVector_at(for_stmt, 2));
+            c->d.child = convertBlock(cv, ast->AST_right);
+            return c;
+        }
+        case OP_REF_ARRAY:
+        case CODE_VAR:
+        case VAL_NUM:
+        case VAL_SYMBOL:
+        case VAL_LOCAL:
+        case OP_ADD:
+        case OP_SUB:
+        case OP_MUL:
+        case OP_DIV:
+        case OP_COMPARE_LT:
+        case OP_COMPARE_GT:
+        case OP_COMPARE_LE:
+        case OP_COMPARE_GE:
+        case OP_COMPARE_EQ:
+        case OP_COMPARE_NEQ:
+            return NULL;
+        default:
+            c = Closure_new(Closure_expression);
+            c->a.child = convertExpression(cv, ast);
+            return c;
+    }
+}
+
+int Closure_execute(Symbol *main, FrameStack *frames) {
+    Converter cv = { SymFuncMap_new(), ClosureFunctionVector_new() };
+    ClosureFunction *entry = functionFor(&cv, main);
+    while (!ClosureFunctionVector_empty(cv.pending)) {
+        ClosureFunction *f = *ClosureFunctionVector_back(cv.pending);
+        ClosureFunctionVector_pop_back(cv.pending);
+        f->body = convertBlock(&cv, f->symbol->SYM_body);
+    }
+    SymFuncMap_delete(cv.functions);
+    ClosureFunctionVector_delete(cv.pending);
+
+    if (entry->argc != 0) {
+        fprintf(stderr, "Argument Error (0 args given, but expects %d)\n", entry->argc);
+        abort();
+    }
+    Frames = frames;
+    return Closure_invoke(entry);
+}
+
+/* vim: set et ts=4 sts=4 sw=4: */
@@ -0,0 +1,47 @@
+#ifndef tinyc_closure_h
+#define tinyc_closure_h
+
+#include "AST.h"
+#include "frame.h"
+
+/*
+ * Closure-compiled evaluator.
+ * Each AST node is converted once into a Closure holding a handler
+ * specialized for the shape of the node (e.g. "local + constant"), so
+ * evaluation is a chain of indirect calls with no dispatch on CodeType.
+ */
+typedef struct closure_ Closure;
+typedef struct closure_function_ ClosureFunction;
+typedef int (*ClosureHandler)(const Closure *closure);
+
+typedef union {
+    Closure *child;
+    Closure **list;
+    ClosureFunction *function;
+    Symbol *symbol;
+    const Format *format;
+    int value;
+    int slot;
+} ClosureOperand;
+
+struct closure_ {
+    ClosureHandler run;
+    ClosureOperand a;
+    ClosureOperand b;
+    ClosureOperand c;
+    ClosureOperand d;
+    int n;      /* number of items in a list operand */
+};
+
+struct closure_function_ {
+    Symbol *symbol;
+    Closure *body;      /* NULL unless the symbol is a function */
+    int argc;
+};
+
+/* Converts main and every function reachable from it, then runs main on the frame stack. */
+int Closure_execute(Symbol *main, FrameStack *frames);
+
+#endif
+
+/* vim: set et ts=4 sts=4 sw=4: */
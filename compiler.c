@@ -0,0 +1,382 @@
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <assert.h>
+#include "cstl/vector.h"
+#include "cstl/unordered_map.h"
+#include "bytecode.h"
+#include "output.h"
+
+CSTL_VECTOR_IMPLEMENT(CodeVector, int)
+CSTL_VECTOR_IMPLEMENT(BCSymbolVector, BCSymbol)
+CSTL_VECTOR_IMPLEMENT(FormatVector, const Format *)
+
+static size_t SymIndexMap_hashSymbol(const Symbol *symbol) {
+    return (size_t)symbol / sizeof(void *);
+}
+
+static int SymIndexMap_compareSymbol(const Symbol *a, const Symbol *b) {
+    return a != b;
+}
+
+CSTL_UNORDERED_MAP_INTERFACE(SymIndexMap, const Symbol *, int)
+CSTL_UNORDERED_MAP_IMPLEMENT_POOL(SymIndexMap, const Symbol *, int, SymIndexMap_hashSymbol, SymIndexMap_compareSymbol)
+
+typedef struct {
+    Bytecode *bc;
+    SymIndexMap *indices;
+    int depth;
+    int max_depth;
+} Compiler;
+
+static const struct {
+    const char *name;
+    int operands;
+} OpcodeInfo[] = {
+    [BC_PUSH]          = { "PUSH", 1 },
+    [BC_POP]           = { "POP", 0 },
+    [BC_LOAD_LOCAL]    = { "LOAD_LOCAL", 1 },
+    [BC_STORE_LOCAL]   = { "STORE_LOCAL", 1 },
+    [BC_LOAD_GLOBAL]   = { "LOAD_GLOBAL", 1 },
+    [BC_STORE_GLOBAL]  = { "STORE_GLOBAL", 1 },
+    [BC_LOAD_ARRAY]    = { "LOAD_ARRAY", 1 },
+    [BC_STORE_ARRAY]   = { "STORE_ARRAY", 1 },
+    [BC_ADD]           = { "ADD", 0 },
+    [BC_SUB]           = { "SUB", 0 },
+    [BC_MUL]           = { "MUL", 0 },
+    [BC_DIV]           = { "DIV", 0 },
+    [BC_LT]            = { "LT", 0 },
+    [BC_GT]            = { "GT", 0 },
+    [BC_LE]            = { "LE", 0 },
+    [BC_GE]            = { "GE", 0 },
+    [BC_EQ]            = { "EQ", 0 },
+    [BC_NEQ]           = { "NEQ", 0 },
+    [BC_JUMP]          = { "JUMP", 1 },
+    [BC_JUMP_IF_TRUE]  = { "JUMP_IF_TRUE", 1 },
+    [BC_CHECK_CALL]    = { "CHECK_CALL", 2 },
+    [BC_CALL]          = { "CALL", 2 },
+    [BC_TAIL_CALL]     = { "TAIL_CALL", 2 },
+    [BC_RETURN]        = { "RETURN", 0 },
+    [BC_PRINTLN]       = { "PRINTLN", 1 },
+    [BC_PRINTLN_VALUE] = { "PRINTLN_VALUE", 1 },
+};
+
+static void compileStatement(Compiler *c, AST *ast);
+static void compileExpression(Compiler *c, AST *expr);
+static void compileCall(Compiler *c, AST *expr, Opcode op);
+
+static int emit(Compiler *c, int word) {
+    if (!CodeVector_push_back(c->bc->code, word)) {
+        fprintf(stderr, "Cannot allocate memory for bytecode.\n");
+        abort();
+    }
+    return CodeVector_size(c->bc->code) - 1;
+}
+
+// stack_effect : how many words the instruction leaves on the operand stack
+static int emitOp(Compiler *c, Opcode op, int stack_effect) {
+    c->depth += stack_effect;
+    if (c->depth > c->max_depth) {
+        c->max_depth = c->depth;
+    }
+    return emit(c, op);
+}
+
+// Returns the position of the offset operand to be patched.
+static int emitJump(Compiler *c, Opcode op, int stack_effect) {
+    emitOp(c, op, stack_effect);
+    return emit(c, 0);
+}
+
+static void patchJump(Compiler *c, int operand, int target) {
+    *CodeVector_at(c->bc->code, operand) = target - (operand + 1);
+}
+
+static int here(Compiler *c) {
+    return CodeVector_size(c->bc->code);
+}
+
+static int symbolIndex(Compiler *c, const Symbol *symbol) {
+    SymIndexMapIterator it = SymIndexMap_find(c->indices, symbol);
+    if (it != SymIndexMap_end(c->indices)) {
+        return *SymIndexMap_value(it);
+    }
+    BCSymbol entry = { (Symbol *)symbol, -1, 0, 0, symbol->type == SYM_FUNC ? symbol->SYM_memo : NULL };
+    int index = BCSymbolVector_size(c->bc->symbols);
+    if (!BCSymbolVector_push_back(c->bc->symbols, entry)
+            || !SymIndexMap_insert(c->indices, symbol, index, NULL)) {
+        fprintf(stderr, "Cannot allocate memory for bytecode.\n");
+        abort();
+    }
+    return index;
+}
+
+static int formatIndex(Compiler *c, const Format *format) {
+    FormatVector_push_back(c->bc->formats, format);
+    return FormatVector_size(c->bc->formats) - 1;
+}
+
+static Opcode binaryOpcode(CodeType code) {
+    switch (code) {
+        case OP_ADD:            return BC_ADD;
+        case OP_SUB:            return BC_SUB;
+        case OP_MUL:            return BC_MUL;
+        case OP_DIV:            return BC_DIV;
+        case OP_COMPARE_LT:     return BC_LT;
+        case OP_COMPARE_GT:     return BC_GT;
+        case OP_COMPARE_LE:     return BC_LE;
+        case OP_COMPARE_GE:     return BC_GE;
+        case OP_COMPARE_EQ:     return BC_EQ;
+        case OP_COMPARE_NEQ:    return BC_NEQ;
+        default:
+            fprintf(stderr, "unknown binary operator (type: %d)\n", code);
+            abort();
+    }
+}
+
+static void compileExpression(Compiler *c, AST *expr) {
+    switch (expr->code) {
+        case VAL_NUM:
+            emitOp(c, BC_PUSH, 1);
+            emit(c, expr->AST_value);
+            break;
+        case VAL_SYMBOL:
+            emitOp(c, BC_LOAD_GLOBAL, 1);
+            emit(c, symbolIndex(c, expr->AST_symbol));
+            break;
+        case VAL_LOCAL:
+            emitOp(c, BC_LOAD_LOCAL, 1);
+            emit(c, expr->AST_slot);
+            break;
+        case OP_ADD:
+        case OP_SUB:
+        case OP_MUL:
+        case OP_DIV:
+        case OP_COMPARE_LT:
+        case OP_COMPARE_GT:
+        case OP_COMPARE_LE:
+        case OP_COMPARE_GE:
+        case OP_COMPARE_EQ:
+        case OP_COMPARE_NEQ:
+            compileExpression(c, expr->AST_left);
+            compileExpression(c, expr->AST_right);
+            emitOp(c, binaryOpcode(expr->code), -1);
+            break;
+        case OP_ASSIGN:
+            compileExpression(c, expr->AST_right);
+            emitOp(c, BC_STORE_GLOBAL, 0);
+            emit(c, symbolIndex(c, expr->AST_left->AST_symbol));
+            break;
+        case OP_ASSIGN_LOCAL:
+            compileExpression(c, expr->AST_right);
+            emitOp(c, BC_STORE_LOCAL, 0);
+            emit(c, expr->AST_left->AST_slot);
+            break;
+        case OP_ASSIGN_ARRAY:
+            compileExpression(c, expr->AST_second);
+            compileExpression(c, expr->AST_third);
+            emitOp(c, BC_STORE_ARRAY, -1);
+            emit(c, symbolIndex(c, expr->AST_first->AST_symbol));
+            break;
+        case OP_REF_ARRAY:
+            compileExpression(c, expr->AST_right);
+            emitOp(c, BC_LOAD_ARRAY, 0);
+            emit(c, symbolIndex(c, expr->AST_left->AST_symbol));
+            break;
+        case OP_CALL:
+            compileCall(c, expr, BC_CALL);
+            break;
+        default:
+            fprintf(stderr, "unknown expression (type: %d)\n", expr->code);
+            abort();
+    }
+}
+
+// A tail call leaves nothing on the stack since execution continues in the callee.
+// A call to a non-function or with the wrong number of arguments fails before the
+// arguments are evaluated, as in the tree walker.
+static void compileCall(Compiler *c, AST *expr, Opcode op) {
+    ASTVector *args = expr->AST_right->AST_list;
+    const int argc = ASTVector_size(args);
+    const Symbol *callee = expr->AST_left->AST_symbol;
+    if (callee->type != SYM_FUNC || (size_t)argc != SymbolVector_size(callee->SYM_param)) {
+        emitOp(c, BC_CHECK_CALL, 0);
+        emit(c, symbolIndex(c, callee));
+        emit(c, argc);
+    }
+    for (int i = 0; i < argc; ++i) {
+        compileExpression(c, ASTVector_at(args, i));
+    }
+    emitOp(c, op, op == BC_TAIL_CALL ? -argc : 1 - argc);
+    emit(c, symbolIndex(c, expr->AST_left->AST_symbol));
+    emit(c, argc);
+}
+
+static void compileStatements(Compiler *c, ASTVector *statements) {
+    const size_t n = ASTVector_size(statements);
+    for (size_t i = 0; i < n; ++i) {
+        compileStatement(c, ASTVector_at(statements, i));
+    }
+}
+
+// The condition is placed after the body so that each iteration takes a single jump.
+static void compileFor(Compiler *c, AST *ast) {
+    ASTVector *for_stmt = ast->AST_left->AST_list;
+    compileExpression(c, ASTVector_at(for_stmt, 0));
+    emitOp(c, BC_POP, -1);
+    int to_cond = emitJump(c, BC_JUMP, 0);
+    int body = here(c);
+    compileStatements(c, ast->AST_right->AST_list);
+    compileExpression(c, ASTVector_at(for_stmt, 2));
+    emitOp(c, BC_POP, -1);
+    patchJump(c, to_cond, here(c));
+    compileExpression(c, ASTVector_at(for_stmt, 1));
+    int to_body = emitJump(c, BC_JUMP_IF_TRUE, -1);
+    patchJump(c, to_body, body);
+}
+
+static void compileStatement(Compiler *c, AST *ast) {
+    switch (ast->code) {
+        case ETC_LIST:
+            compileStatements(c, ast->AST_list);
+            break;
+        case CODE_PRINTLN:
+            if (ast->AST_right) {
+                compileExpression(c, ast->AST_right);
+                emitOp(c, BC_PRINTLN_VALUE, -1);
+            } else {
+                emitOp(c, BC_PRINTLN, 0);
+            }
+            emit(c, formatIndex(c, ast->AST_left->AST_format));
+            break;
+        case CODE_RETURN:
+            if (ast->AST_unary && ast->AST_unary->code == OP_CALL) {
+                compileCall(c, ast->AST_unary, BC_TAIL_CALL);
+                break;
+            }
+            if (ast->AST_unary) {
+                compileExpression(c, ast->AST_unary);
+            } else {
+                emitOp(c, BC_PUSH, 1);
+                emit(c, 0);
+            }
+            emitOp(c, BC_RETURN, -1);
+            break;
+        case CODE_FOR:
+            compileFor(c, ast);
+            break;
+        // statements without side effects are not evaluated by the tree walker either
+        case OP_REF_ARRAY:
+        case CODE_VAR:
+        case VAL_NUM:
+        case VAL_SYMBOL:
+        case VAL_LOCAL:
+        case OP_ADD:
+        case OP_SUB:
+        case OP_MUL:
+        case OP_DIV:
+        case OP_COMPARE_LT:
+        case OP_COMPARE_GT:
+        case OP_COMPARE_LE:
+        case OP_COMPARE_GE:
+        case OP_COMPARE_EQ:
+        case OP_COMPARE_NEQ:
+            break;
+        default:
+            compileExpression(c, ast);
+            emitOp(c, BC_POP, -1);
+            break;
+    }
+}
+
+static void compileFunction(Compiler *c, int index) {
+    Symbol *sym = BCSymbolVector_at(c->bc->symbols, index)->symbol;
+    assert(sym->SYM_body->code == ETC_LIST);
+    c->depth = 0;
+    c->max_depth = 1;
+    int entry = here(c);
+    compileStatements(c, sym->SYM_body->AST_list);
+    emitOp(c, BC_PUSH, 1);
+    emit(c, 0);
+    emitOp(c, BC_RETURN, -1);
+
+    BCSymbol *f = BCSymbolVector_at(c->bc->symbols, index);
+    f->entry = entry;
+    f->argc = SymbolVector_size(sym->SYM_param);
+    f->max_stack = c->max_depth;
+}
+
+Bytecode *Bytecode_compile(Symbol *main) {
+    Bytecode *bc = (Bytecode *)malloc(sizeof(Bytecode));
+    if (!bc) {
+        fprintf(stderr, "Cannot allocate memory for bytecode.\n");
+        abort();
+    }
+    bc->code = CodeVector_new();
+    bc->symbols = BCSymbolVector_new();
+    bc->formats = FormatVector_new();
+
+    Compiler c = { bc, SymIndexMap_new(), 0, 0 };
+    bc->main = symbolIndex(&c, main);
+    // Functions referenced while compiling are appended to symbols, so this
+    // also reaches every function called from main.
+    for (size_t i = 0; i < BCSymbolVector_size(bc->symbols); ++i) {
+        BCSymbol *entry = BCSymbolVector_at(bc->symbols, i);
+        if (entry->symbol->type == SYM_FUNC && entry->entry < 0) {
+            compileFunction(&c, i);
+        }
+    }
+    SymIndexMap_delete(c.indices);
+    return bc;
+}
+
+void Bytecode_delete(Bytecode *bc) {
+    if (bc) {
+        CodeVector_delete(bc->code);
+        BCSymbolVector_delete(bc->symbols);
+        FormatVector_delete(bc->formats);
+        free(bc);
+    }
+}
+
+void Bytecode_dump(Bytecode *bc, FILE *out) {
+    const size_t nsyms = BCSymbolVector_size(bc->symbols);
+    const int *code = CodeVector_size(bc->code) ? CodeVector_at(bc->code, 0) : NULL;
+    const int n = CodeVector_size(bc->code);
+    for (int pc = 0; pc < n; pc += 1 + OpcodeInfo[code[pc]].operands) {
+        for (size_t i = 0; i < nsyms; ++i) {
+            BCSymbol *f = BCSymbolVector_at(bc->symbols, i);
+            if (f->entry == pc) {
+                fprintf(out, "%s: (argc %d, stack %d)\n", f->symbol->name, f->argc, f->max_stack);
+            }
+        }
+        fprintf(out, "%6d  %-14s", pc, OpcodeInfo[code[pc]].name);
+        for (int i = 1; i <= OpcodeInfo[code[pc]].operands; ++i) {
+            fprintf(out, " %d", code[pc + i]);
+        }
+        switch (code[pc]) {
+            case BC_LOAD_GLOBAL:
+            case BC_STORE_GLOBAL:
+            case BC_LOAD_ARRAY:
+            case BC_STORE_ARRAY:
+            case BC_CHECK_CALL:
+            case BC_CALL:
+            case BC_TAIL_CALL:
+                fprintf(out, "\t; %s", BCSymbolVector_at(bc->symbols, code[pc + 1])->symbol->name);
+                break;
+            case BC_JUMP:
+            case BC_JUMP_IF_TRUE:
+                fprintf(out, "\t; -> %d", pc + 2 + code[pc + 1]);
+                break;
+            case BC_PRINTLN:
+            case BC_PRINTLN_VALUE:
+                fprintf(out, "\t; \"%s\"", (*FormatVector_at(bc->formats, code[pc + 1]))->text);
+                break;
+            default:
+                break;
+        }
+        fprintf(out, "\n");
+    }
+}
+
+/* vim: set et ts=4 sts=4 sw=4: */
@@ -0,0 +1,943 @@
+/*
+ * Copyright (c) 2006-2010, KATO Noriaki
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/*!
+ * \file btree.h
+ * \brief B+木(btree_set/btree_map共通部)
+ *
+ * 要素は全て葉に格納し、1つの葉に複数の要素を並べて持つ。
+ * 内部ノードは区切りのキーと子へのポインタだけを持つ。
+ * 葉はheadを番兵にした循環双方向リストでつながっていて、順方向・逆方向の走査は葉を順に辿る。
+ *
+ * イテレータは葉の中の1バイトのスロットを指す。スロットには自身の添字が入っていて、
+ * イテレータから要素と葉の先頭を求められる。
+ *
+ * このファイルを直接インクルードしないこと
+ */
+#ifndef CSTL_BTREE_H_INCLUDED
+#define CSTL_BTREE_H_INCLUDED
+
+#include <stdlib.h>
+#include <stddef.h>
+#include "common.h"
+
+
+#ifndef CSTL_LESS
+#define CSTL_LESS(x, y)		((x) == (y) ? 0 : (x) < (y) ? -1 : 1)
+#define CSTL_GREATER(x, y)	((x) == (y) ? 0 : (x) > (y) ? -1 : 1)
+#endif
+
+/* 葉・内部ノードの大きさの目安(バイト) */
+#define CSTL_BTREE_NODE_BYTES	512
+/* 葉・内部ノードに入る要素数の下限 */
+#define CSTL_BTREE_MIN_ORDER	8
+/* 木の高さの上限。挿入時に確保しておく内部ノードの数の上限になる */
+#define CSTL_BTREE_MAX_HEIGHT	64
+
+/* 1個がsizeバイトのものをCSTL_BTREE_NODE_BYTESに詰めた時の個数。CSTL_BTREE_MIN_ORDER以上max以下 */
+#define CSTL_BTREE_ORDER(size, max)	\
+	(CSTL_BTREE_NODE_BYTES / (size) < CSTL_BTREE_MIN_ORDER ? CSTL_BTREE_MIN_ORDER :\
+	 CSTL_BTREE_NODE_BYTES / (size) > (max) ? (max) : CSTL_BTREE_NODE_BYTES / (size))
+
+/* イテレータposの葉 */
+#define CSTL_BTREE_LEAF(pos, Name)	\
+	((Name##BTreeLeaf *) ((char *) ((pos) - (pos)->index) - offsetof(Name##BTreeLeaf, slots)))
+/* イテレータposの要素 */
+#define CSTL_BTREE_ELEM(pos, Name)	(CSTL_BTREE_LEAF(pos, Name)->elems[(pos)->index])
+
+
+#define CSTL_BTREE_INTERFACE(Name, KeyType)	\
+\
+typedef struct Name Name;\
+typedef struct Name##BTreeSlot *Name##Iterator;\
+\
+Name *Name##_new(void);\
+void Name##_delete(Name *self);\
+void Name##_clear(Name *self);\
+int Name##_empty(Name *self);\
+size_t Name##_size(Name *self);\
+int Name##_insert_range(Name *self, Name##Iterator first, Name##Iterator last);\
+Name##Iterator Name##_erase(Name *self, Name##Iterator pos);\
+Name##Iterator Name##_erase_range(Name *self, Name##Iterator first, Name##Iterator last);\
+size_t Name##_erase_key(Name *self, KeyType key);\
+size_t Name##_count(Name *self, KeyType key);\
+Name##Iterator Name##_find(Name *self, KeyType key);\
+Name##Iterator Name##_lower_bound(Name *self, KeyType key);\
+Name##Iterator Name##_upper_bound(Name *self, KeyType key);\
+void Name##_equal_range(Name *self, KeyType key, Name##Iterator *first, Name##Iterator *last);\
+Name##Iterator Name##_begin(Name *self);\
+Name##Iterator Name##_end(Name *self);\
+Name##Iterator Name##_rbegin(Name *self);\
+Name##Iterator Name##_rend(Name *self);\
+Name##Iterator Name##_next(Name##Iterator pos);\
+Name##Iterator Name##_prev(Name##Iterator pos);\
+void Name##_swap(Name *self, Name *x);\
+
+
+/*
+ * Name##BTreeElemは呼び出し側で定義しておくこと。
+ * メンバにkeyを持つ
+ */
+#define CSTL_BTREE_IMPLEMENT(Name, KeyType, Compare)	\
+\
+typedef struct Name##BTreeSlot Name##BTreeSlot;\
+typedef struct Name##BTreeNode Name##BTreeNode;\
+typedef struct Name##BTreeLeaf Name##BTreeLeaf;\
+\
+enum {\
+	Name##_LEAF_MAX = CSTL_BTREE_ORDER(sizeof(Name##BTreeElem) + 1, 255),\
+	Name##_LEAF_MIN = Name##_LEAF_MAX / 2,\
+	Name##_NODE_MAX = CSTL_BTREE_ORDER(sizeof(KeyType) + sizeof(void *), 1024),\
+	Name##_NODE_MIN = Name##_NODE_MAX / 2\
+};\
+\
+/*! \
+ * \brief スロット構造体\
+ *\
+ * indexは葉の中での自身の添字\
+ */\
+struct Name##BTreeSlot {\
+	unsigned char index;\
+};\
+\
+/*! \
+ * \brief 内部ノード構造体\
+ *\
+ * children[i]の要素はkeys[i]より小さく、children[i + 1]の要素はkeys[i]以上\
+ */\
+struct Name##BTreeNode {\
+	Name##BTreeNode *parent;\
+	int count; /* キーの数。子の数はcount + 1 */\
+	KeyType keys[Name##_NODE_MAX];\
+	void *children[Name##_NODE_MAX + 1];\
+};\
+\
+/*! \
+ * \brief 葉構造体\
+ */\
+struct Name##BTreeLeaf {\
+	Name##BTreeNode *parent;\
+	int count; /* 要素数。headは常に0 */\
+	Name##BTreeLeaf *prev;\
+	Name##BTreeLeaf *next;\
+	Name##BTreeElem elems[Name##_LEAF_MAX];\
+	Name##BTreeSlot slots[Name##_LEAF_MAX];\
+	CSTL_MAGIC(Name##BTreeLeaf *magic;) /* 所属する木のhead */\
+};\
+\
+/*! \
+ * \brief btree_set/btree_map構造体\
+ */\
+struct Name {\
+	Name##BTreeLeaf *head; /* 葉のリストの番兵。&head->slots[0]がend() */\
+	void *root; /* 空ならばNULL */\
+	int height; /* 内部ノードの段数。0ならばrootは葉 */\
+	size_t size;\
+	CSTL_MAGIC(Name *magic;)\
+};\
+\
+static Name##BTreeLeaf *Name##BTree_new_leaf(Name *self)\
+{\
+	Name##BTreeLeaf *leaf;\
+	int i;\
+	leaf = (Name##BTreeLeaf *) malloc(sizeof(Name##BTreeLeaf));\
+	if (!leaf) return 0;\
+	for (i = 0; i < Name##_LEAF_MAX; i++) {\
+		leaf->slots[i].index = (unsigned char) i;\
+	}\
+	leaf->parent = 0;\
+	leaf->count = 0;\
+	CSTL_MAGIC(leaf->magic = self->head);\
+	CSTL_UNUSED_PARAM(self);\
+	return leaf;\
+}\
+\
+/* leafをposの後ろにつなぐ */\
+static void Name##BTree_link_leaf(Name##BTreeLeaf *pos, Name##BTreeLeaf *leaf)\
+{\
+	leaf->prev = pos;\
+	leaf->next = pos->next;\
+	pos->next->prev = leaf;\
+	pos->next = leaf;\
+}\
+\
+static void Name##BTree_unlink_leaf(Name##BTreeLeaf *leaf)\
+{\
+	leaf->prev->next = leaf->next;\
+	leaf->next->prev = leaf->prev;\
+}\
+\
+/* levelの段にあるchildの親をparentにする。levelが0ならばchildは葉 */\
+static void Name##BTree_set_parent(void *child, int level, Name##BTreeNode *parent)\
+{\
+	if (level == 0) {\
+		((Name##BTreeLeaf *) child)->parent = parent;\
+	} else {\
+		((Name##BTreeNode *) child)->parent = parent;\
+	}\
+}\
+\
+static Name##BTreeNode *Name##BTree_get_parent(void *child, int level)\
+{\
+	if (level == 0) {\
+		return ((Name##BTreeLeaf *) child)->parent;\
+	}\
+	return ((Name##BTreeNode *) child)->parent;\
+}\
+\
+static int Name##BTree_child_index(Name##BTreeNode *node, void *child)\
+{\
+	int i;\
+	for (i = 0; node->children[i] != child; i++) {\
+		CSTL_ASSERT(i < node->count && "BTree_child_index");\
+	}\
+	return i;\
+}\
+\
+/* keyが入るべき葉。空の木では呼ばないこと */\
+static Name##BTreeLeaf *Name##BTree_find_leaf(Name *self, KeyType key)\
+{\
+	void *node = self->root;\
+	int h;\
+	int lo;\
+	int hi;\
+	int mid;\
+	Name##BTreeNode *n;\
+	for (h = self->height; h > 0; h--) {\
+		n = (Name##BTreeNode *) node;\
+		lo = 0;\
+		hi = n->count;\
+		while (lo < hi) {\
+			mid = (lo + hi) >> 1;\
+			if (Compare(key, n->keys[mid]) < 0) {\
+				hi = mid;\
+			} else {\
+				lo = mid + 1;\
+			}\
+		}\
+		node = n->children[lo];\
+	}\
+	return (Name##BTreeLeaf *) node;\
+}\
+\
+/* leafの中でkey以上の最初の要素の添字 */\
+static int Name##BTree_leaf_lower_bound(Name##BTreeLeaf *leaf, KeyType key)\
+{\
+	int lo = 0;\
+	int hi = leaf->count;\
+	int mid;\
+	while (lo < hi) {\
+		mid = (lo + hi) >> 1;\
+		if (Compare(leaf->elems[mid].key, key) < 0) {\
+			lo = mid + 1;\
+		} else {\
+			hi = mid;\
+		}\
+	}\
+	return lo;\
+}\
+\
+/* leafの中でkeyより大きい最初の要素の添字 */\
+static int Name##BTree_leaf_upper_bound(Name##BTreeLeaf *leaf, KeyType key)\
+{\
+	int lo = 0;\
+	int hi = leaf->count;\
+	int mid;\
+	while (lo < hi) {\
+		mid = (lo + hi) >> 1;\
+		if (Compare(key, leaf->elems[mid].key) < 0) {\
+			hi = mid;\
+		} else {\
+			lo = mid + 1;\
+		}\
+	}\
+	return lo;\
+}\
+\
+/* leafのidx番目の要素のイテレータ。idxが要素数と等しければ次の葉の先頭(またはend()) */\
+static Name##Iterator Name##BTree_slot(Name##BTreeLeaf *leaf, int idx)\
+{\
+	if (idx < leaf->count) {\
+		return &leaf->slots[idx];\
+	}\
+	return &leaf->next->slots[0];\
+}\
+\
+static void Name##BTree_free_node(void *node, int level)\
+{\
+	int i;\
+	Name##BTreeNode *n;\
+	if (level > 0) {\
+		n = (Name##BTreeNode *) node;\
+		for (i = 0; i <= n->count; i++) {\
+			Name##BTree_free_node(n->children[i], level - 1);\
+		}\
+	}\
+	free(node);\
+}\
+\
+/* \
+ * keyの要素を挿入し、そのイテレータを返す。要素のkey以外のメンバは呼び出し側で設定する。\
+ * 既にkeyの要素があれば、そのイテレータを返す。\
+ * メモリ不足の場合はNULLを返し、木は変更しない\
+ */\
+static Name##Iterator Name##_insert_key(Name *self, KeyType key, int *inserted)\
+{\
+	Name##BTreeLeaf *leaf;\
+	Name##BTreeLeaf *right;\
+	Name##BTreeNode *p;\
+	Name##BTreeNode *q;\
+	Name##BTreeNode *spare[CSTL_BTREE_MAX_HEIGHT];\
+	KeyType keys[Name##_NODE_MAX + 1];\
+	void *children[Name##_NODE_MAX + 2];\
+	Name##Iterator pos;\
+	void *left_child;\
+	void *right_child;\
+	KeyType sep;\
+	int i;\
+	int j;\
+	int idx;\
+	int lcount;\
+	int need;\
+	int level;\
+	*inserted = 0;\
+	if (self->root) {\
+		leaf = Name##BTree_find_leaf(self, key);\
+		idx = Name##BTree_leaf_lower_bound(leaf, key);\
+		if (idx < leaf->count && Compare(key, leaf->elems[idx].key) == 0) {\
+			return &leaf->slots[idx];\
+		}\
+	} else {\
+		leaf = Name##BTree_new_leaf(self);\
+		if (!leaf) return 0;\
+		Name##BTree_link_leaf(self->head, leaf);\
+		self->root = leaf;\
+		idx = 0;\
+	}\
+	if (leaf->count < Name##_LEAF_MAX) {\
+		for (i = leaf->count; i > idx; i--) {\
+			leaf->elems[i] = leaf->elems[i - 1];\
+		}\
+		leaf->elems[idx].key = key;\
+		leaf->count++;\
+		self->size++;\
+		*inserted = 1;\
+		return &leaf->slots[idx];\
+	}\
+	/* 分割に必要なノードを先に全て確保しておけば、途中で失敗しない */\
+	right = Name##BTree_new_leaf(self);\
+	if (!right) return 0;\
+	need = 0;\
+	for (p = leaf->parent; p && p->count == Name##_NODE_MAX; p = p->parent) {\
+		need++;\
+	}\
+	if (!p) {\
+		/* 新しい根 */\
+		need++;\
+	}\
+	CSTL_ASSERT(need <= CSTL_BTREE_MAX_HEIGHT && "BTree_insert_key");\
+	for (i = 0; i < need; i++) {\
+		spare[i] = (Name##BTreeNode *) malloc(sizeof(Name##BTreeNode));\
+		if (!spare[i]) {\
+			while (i > 0) {\
+				free(spare[--i]);\
+			}\
+			free(right);\
+			return 0;\
+		}\
+	}\
+	/* 葉の分割。末尾への追加ならば左の葉を満杯のまま残す */\
+	if (idx == Name##_LEAF_MAX && leaf->next == self->head) {\
+		lcount = Name##_LEAF_MAX;\
+	} else {\
+		lcount = (Name##_LEAF_MAX + 1) / 2;\
+	}\
+	if (idx < lcount) {\
+		for (i = lcount - 1; i < Name##_LEAF_MAX; i++) {\
+			right->elems[i - lcount + 1] = leaf->elems[i];\
+		}\
+		for (i = lcount - 1; i > idx; i--) {\
+			leaf->elems[i] = leaf->elems[i - 1];\
+		}\
+		leaf->elems[idx].key = key;\
+		pos = &leaf->slots[idx];\
+	} else {\
+		for (i = lcount, j = 0; i < Name##_LEAF_MAX; i++) {\
+			if (i == idx) j++;\
+			right->elems[j++] = leaf->elems[i];\
+		}\
+		right->elems[idx - lcount].key = key;\
+		pos = &right->slots[idx - lcount];\
+	}\
+	right->count = Name##_LEAF_MAX + 1 - lcount;\
+	leaf->count = lcount;\
+	Name##BTree_link_leaf(leaf, right);\
+	/* 区切りのキーを親に挿入する。親が満杯ならば親も分割する */\
+	sep = right->elems[0].key;\
+	left_child = leaf;\
+	right_child = right;\
+	level = 0;\
+	for (;;) {\
+		p = Name##BTree_get_parent(left_child, level);\
+		if (!p) {\
+			p = spare[--need];\
+			p->parent = 0;\
+			p->count = 1;\
+			p->keys[0] = sep;\
+			p->children[0] = left_child;\
+			p->children[1] = right_child;\
+			Name##BTree_set_parent(left_child, level, p);\
+			Name##BTree_set_parent(right_child, level, p);\
+			self->root = p;\
+			self->height++;\
+			break;\
+		}\
+		j = Name##BTree_child_index(p, left_child);\
+		if (p->count < Name##_NODE_MAX) {\
+			for (i = p->count; i > j; i--) {\
+				p->keys[i] = p->keys[i - 1];\
+				p->children[i + 1] = p->children[i];\
+			}\
+			p->keys[j] = sep;\
+			p->children[j + 1] = right_child;\
+			p->count++;\
+			Name##BTree_set_parent(right_child, level, p);\
+			break;\
+		}\
+		for (i = 0; i < j; i++) {\
+			keys[i] = p->keys[i];\
+		}\
+		keys[j] = sep;\
+		for (i = j; i < Name##_NODE_MAX; i++) {\
+			keys[i + 1] = p->keys[i];\
+		}\
+		for (i = 0; i <= j; i++) {\
+			children[i] = p->children[i];\
+		}\
+		children[j + 1] = right_child;\
+		for (i = j + 1; i <= Name##_NODE_MAX; i++) {\
+			children[i + 1] = p->children[i];\
+		}\
+		/* keys[NODE_MIN]を親に上げ、それより右をqに移す */\
+		q = spare[--need];\
+		p->count = Name##_NODE_MIN;\
+		q->count = Name##_NODE_MAX - Name##_NODE_MIN;\
+		for (i = 0; i < p->count; i++) {\
+			p->keys[i] = keys[i];\
+		}\
+		for (i = 0; i <= p->count; i++) {\
+			p->children[i] = children[i];\
+			Name##BTree_set_parent(children[i], level, p);\
+		}\
+		for (i = 0; i < q->count; i++) {\
+			q->keys[i] = keys[Name##_NODE_MIN + 1 + i];\
+		}\
+		for (i = 0; i <= q->count; i++) {\
+			q->children[i] = children[Name##_NODE_MIN + 1 + i];\
+			Name##BTree_set_parent(q->children[i], level, q);\
+		}\
+		q->parent = p->parent;\
+		sep = keys[Name##_NODE_MIN];\
+		left_child = p;\
+		right_child = q;\
+		level++;\
+	}\
+	CSTL_ASSERT(need == 0 && "BTree_insert_key");\
+	self->size++;\
+	*inserted = 1;\
+	return pos;\
+}\
+\
+/* \
+ * 内部ノードnからkeys[k]とchildren[k + 1]を取り除く。\
+ * nの要素が少なくなりすぎたら兄弟から借りるか兄弟と併合し、必要ならば根まで繰り返す\
+ */\
+static void Name##BTree_remove(Name *self, Name##BTreeNode *n, int k)\
+{\
+	Name##BTreeNode *p;\
+	Name##BTreeNode *sib;\
+	int i;\
+	int ci;\
+	int level = 1;\
+	for (;;) {\
+		for (i = k + 1; i < n->count; i++) {\
+			n->keys[i - 1] = n->keys[i];\
+			n->children[i] = n->children[i + 1];\
+		}\
+		n->count--;\
+		p = n->parent;\
+		if (!p) {\
+			if (n->count == 0) {\
+				/* 根の子が1つになったら、その子を根にする */\
+				self->root = n->children[0];\
+				Name##BTree_set_parent(self->root, level - 1, 0);\
+				free(n);\
+				self->height--;\
+			}\
+			return;\
+		}\
+		if (n->count >= Name##_NODE_MIN) return;\
+		ci = Name##BTree_child_index(p, n);\
+		if (ci > 0) {\
+			sib = (Name##BTreeNode *) p->children[ci - 1];\
+			if (sib->count + 1 + n->count <= Name##_NODE_MAX) {\
+				/* nを左の兄弟に併合する */\
+				sib->keys[sib->count] = p->keys[ci - 1];\
+				for (i = 0; i < n->count; i++) {\
+					sib->keys[sib->count + 1 + i] = n->keys[i];\
+				}\
+				for (i = 0; i <= n->count; i++) {\
+					sib->children[sib->count + 1 + i] = n->children[i];\
+					Name##BTree_set_parent(n->children[i], level - 1, sib);\
+				}\
+				sib->count += n->count + 1;\
+				free(n);\
+				n = p;\
+				k = ci - 1;\
+				level++;\
+				continue;\
+			}\
+			/* 左の兄弟の最後の子を借りる */\
+			for (i = n->count; i > 0; i--) {\
+				n->keys[i] = n->keys[i - 1];\
+			}\
+			for (i = n->count + 1; i > 0; i--) {\
+				n->children[i] = n->children[i - 1];\
+			}\
+			n->keys[0] = p->keys[ci - 1];\
+			n->children[0] = sib->children[sib->count];\
+			Name##BTree_set_parent(n->children[0], level - 1, n);\
+			p->keys[ci - 1] = sib->keys[sib->count - 1];\
+			sib->count--;\
+			n->count++;\
+		} else {\
+			sib = (Name##BTreeNode *) p->children[1];\
+			if (n->count + 1 + sib->count <= Name##_NODE_MAX) {\
+				/* 右の兄弟をnに併合する */\
+				n->keys[n->count] = p->keys[0];\
+				for (i = 0; i < sib->count; i++) {\
+					n->keys[n->count + 1 + i] = sib->keys[i];\
+				}\
+				for (i = 0; i <= sib->count; i++) {\
+					n->children[n->count + 1 + i] = sib->children[i];\
+					Name##BTree_set_parent(sib->children[i], level - 1, n);\
+				}\
+				n->count += sib->count + 1;\
+				free(sib);\
+				n = p;\
+				k = 0;\
+				level++;\
+				continue;\
+			}\
+			/* 右の兄弟の最初の子を借りる */\
+			n->keys[n->count] = p->keys[0];\
+			n->children[n->count + 1] = sib->children[0];\
+			Name##BTree_set_parent(sib->children[0], level - 1, n);\
+			n->count++;\
+			p->keys[0] = sib->keys[0];\
+			for (i = 1; i < sib->count; i++) {\
+				sib->keys[i - 1] = sib->keys[i];\
+			}\
+			for (i = 1; i <= sib->count; i++) {\
+				sib->children[i - 1] = sib->children[i];\
+			}\
+			sib->count--;\
+		}\
+		return;\
+	}\
+}\
+\
+Name *Name##_new(void)\
+{\
+	Name *self;\
+	self = (Name *) malloc(sizeof(Name));\
+	if (!self) return 0;\
+	self->head = 0;\
+	self->head = Name##BTree_new_leaf(self);\
+	if (!self->head) {\
+		free(self);\
+		return 0;\
+	}\
+	CSTL_MAGIC(self->head->magic = self->head);\
+	self->head->prev = self->head;\
+	self->head->next = self->head;\
+	self->root = 0;\
+	self->height = 0;\
+	self->size = 0;\
+	CSTL_MAGIC(self->magic = self);\
+	return self;\
+}\
+\
+void Name##_delete(Name *self)\
+{\
+	if (!self) return;\
+	CSTL_ASSERT(self->magic == self && "BTree(Set|Map)_delete");\
+	Name##_clear(self);\
+	free(self->head);\
+	CSTL_MAGIC(self->magic = 0);\
+	free(self);\
+}\
+\
+void Name##_clear(Name *self)\
+{\
+	CSTL_ASSERT(self && "BTree(Set|Map)_clear");\
+	CSTL_ASSERT(self->magic == self && "BTree(Set|Map)_clear");\
+	if (self->root) {\
+		Name##BTree_free_node(self->root, self->height);\
+	}\
+	self->head->prev = self->head;\
+	self->head->next = self->head;\
+	self->root = 0;\
+	self->height = 0;\
+	self->size = 0;\
+}\
+\
+int Name##_empty(Name *self)\
+{\
+	CSTL_ASSERT(self && "BTree(Set|Map)_empty");\
+	CSTL_ASSERT(self->magic == self && "BTree(Set|Map)_empty");\
+	return self->size == 0;\
+}\
+\
+size_t Name##_size(Name *self)\
+{\
+	CSTL_ASSERT(self && "BTree(Set|Map)_size");\
+	CSTL_ASSERT(self->magic == self && "BTree(Set|Map)_size");\
+	return self->size;\
+}\
+\
+int Name##_insert_range(Name *self, Name##Iterator first, Name##Iterator last)\
+{\
+	Name##Iterator pos;\
+	Name##Iterator tmp;\
+	Name##BTreeElem *elem;\
+	unsigned char *inserted;\
+	size_t n;\
+	size_t i;\
+	int success;\
+	CSTL_ASSERT(self && "BTree(Set|Map)_insert_range");\
+	CSTL_ASSERT(self->magic == self && "BTree(Set|Map)_insert_range");\
+	CSTL_ASSERT(first && "BTree(Set|Map)_insert_range");\
+	CSTL_ASSERT(last && "BTree(Set|Map)_insert_range");\
+	CSTL_ASSERT(CSTL_BTREE_LEAF(first, Name)->magic && "BTree(Set|Map)_insert_range");\
+	CSTL_ASSERT(CSTL_BTREE_LEAF(last, Name)->magic && "BTree(Set|Map)_insert_range");\
+	n = 0;\
+	for (pos = first; pos != last; pos = Name##_next(pos)) {\
+		n++;\
+	}\
+	if (!n) return 1;\
+	/* 挿入した要素のビットを立てておき、失敗したら削除して元に戻す */\
+	inserted = (unsigned char *) malloc((n + 7) / 8);\
+	if (!inserted) return 0;\
+	for (pos = first, i = 0; pos != last; pos = Name##_next(pos), i++) {\
+		elem = &CSTL_BTREE_ELEM(pos, Name);\
+		tmp = Name##_insert_key(self, elem->key, &success);\
+		if (!tmp) {\
+			n = i;\
+			for (pos = first, i = 0; i < n; pos = Name##_next(pos), i++) {\
+				if (inserted[i / 8] & (1 << (i % 8))) {\
+					Name##_erase_key(self, CSTL_BTREE_ELEM(pos, Name).key);\
+				}\
+			}\
+			free(inserted);\
+			return 0;\
+		}\
+		if (success) {\
+			CSTL_BTREE_ELEM(tmp, Name) = *elem;\
+			inserted[i / 8] |= (unsigned char) (1 << (i % 8));\
+		} else {\
+			inserted[i / 8] &= (unsigned char) ~(1 << (i % 8));\
+		}\
+	}\
+	free(inserted);\
+	return 1;\
+}\
+\
+Name##Iterator Name##_erase(Name *self, Name##Iterator pos)\
+{\
+	Name##BTreeLeaf *leaf;\
+	Name##BTreeLeaf *sib;\
+	Name##BTreeNode *p;\
+	int i;\
+	int idx;\
+	int ci;\
+	CSTL_ASSERT(self && "BTree(Set|Map)_erase");\
+	CSTL_ASSERT(self->magic == self && "BTree(Set|Map)_erase");\
+	CSTL_ASSERT(pos && "BTree(Set|Map)_erase");\
+	CSTL_ASSERT(CSTL_BTREE_LEAF(pos, Name)->magic == self->head && "BTree(Set|Map)_erase");\
+	CSTL_ASSERT(pos != Name##_end(self) && "BTree(Set|Map)_erase");\
+	leaf = CSTL_BTREE_LEAF(pos, Name);\
+	idx = pos->index;\
+	for (i = idx + 1; i < leaf->count; i++) {\
+		leaf->elems[i - 1] = leaf->elems[i];\
+	}\
+	leaf->count--;\
+	self->size--;\
+	p = leaf->parent;\
+	if (!p) {\
+		if (leaf->count == 0) {\
+			Name##BTree_unlink_leaf(leaf);\
+			free(leaf);\
+			self->root = 0;\
+			return &self->head->slots[0];\
+		}\
+		return Name##BTree_slot(leaf, idx);\
+	}\
+	/* 末尾の葉は空になるまでそのままにする */\
+	if (leaf->count >= Name##_LEAF_MIN || (leaf->count > 0 && leaf->next == self->head)) {\
+		return Name##BTree_slot(leaf, idx);\
+	}\
+	ci = Name##BTree_child_index(p, leaf);\
+	if (ci > 0) {\
+		sib = (Name##BTreeLeaf *) p->children[ci - 1];\
+		if (sib->count + leaf->count <= Name##_LEAF_MAX) {\
+			/* 左の兄弟に併合する */\
+			for (i = 0; i < leaf->count; i++) {\
+				sib->elems[sib->count + i] = leaf->elems[i];\
+			}\
+			idx += sib->count;\
+			sib->count += leaf->count;\
+			Name##BTree_unlink_leaf(leaf);\
+			free(leaf);\
+			leaf = sib;\
+			Name##BTree_remove(self, p, ci - 1);\
+		} else {\
+			/* 左の兄弟の最後の要素を借りる */\
+			for (i = leaf->count; i > 0; i--) {\
+				leaf->elems[i] = leaf->elems[i - 1];\
+			}\
+			leaf->elems[0] = sib->elems[--sib->count];\
+			leaf->count++;\
+			idx++;\
+			p->keys[ci - 1] = leaf->elems[0].key;\
+		}\
+	} else {\
+		sib = (Name##BTreeLeaf *) p->children[1];\
+		if (leaf->count + sib->count <= Name##_LEAF_MAX) {\
+			/* 右の兄弟を併合する */\
+			for (i = 0; i < sib->count; i++) {\
+				leaf->elems[leaf->count + i] = sib->elems[i];\
+			}\
+			leaf->count += sib->count;\
+			Name##BTree_unlink_leaf(sib);\
+			free(sib);\
+			Name##BTree_remove(self, p, 0);\
+		} else {\
+			/* 右の兄弟の最初の要素を借りる */\
+			leaf->elems[leaf->count++] = sib->elems[0];\
+			for (i = 1; i < sib->count; i++) {\
+				sib->elems[i - 1] = sib->elems[i];\
+			}\
+			sib->count--;\
+			p->keys[0] = sib->elems[0].key;\
+		}\
+	}\
+	return Name##BTree_slot(leaf, idx);\
+}\
+\
+Name##Iterator Name##_erase_range(Name *self, Name##Iterator first, Name##Iterator last)\
+{\
+	Name##Iterator pos;\
+	size_t n = 0;\
+	CSTL_ASSERT(self && "BTree(Set|Map)_erase_range");\
+	CSTL_ASSERT(self->magic == self && "BTree(Set|Map)_erase_range");\
+	CSTL_ASSERT(first && "BTree(Set|Map)_erase_range");\
+	CSTL_ASSERT(last && "BTree(Set|Map)_erase_range");\
+	CSTL_ASSERT(CSTL_BTREE_LEAF(first, Name)->magic == self->head && "BTree(Set|Map)_erase_range");\
+	CSTL_ASSERT(CSTL_BTREE_LEAF(last, Name)->magic == self->head && "BTree(Set|Map)_erase_range");\
+	if (first == Name##_begin(self) && last == Name##_end(self)) {\
+		Name##_clear(self);\
+		return Name##_end(self);\
+	}\
+	/* 削除で要素が葉の間を移動するとlastが無効になるので、先に数えておく */\
+	for (pos = first; pos != last; pos = Name##_next(pos)) {\
+		n++;\
+	}\
+	pos = first;\
+	while (n > 0) {\
+		pos = Name##_erase(self, pos);\
+		n--;\
+	}\
+	return pos;\
+}\
+\
+size_t Name##_erase_key(Name *self, KeyType key)\
+{\
+	Name##Iterator pos;\
+	CSTL_ASSERT(self && "BTree(Set|Map)_erase_key");\
+	CSTL_ASSERT(self->magic == self && "BTree(Set|Map)_erase_key");\
+	pos = Name##_find(self, key);\
+	if (pos == Name##_end(self)) {\
+		return 0;\
+	}\
+	Name##_erase(self, pos);\
+	return 1;\
+}\
+\
+size_t Name##_count(Name *self, KeyType key)\
+{\
+	CSTL_ASSERT(self && "BTree(Set|Map)_count");\
+	CSTL_ASSERT(self->magic == self && "BTree(Set|Map)_count");\
+	return Name##_find(self, key) != Name##_end(self);\
+}\
+\
+Name##Iterator Name##_find(Name *self, KeyType key)\
+{\
+	Name##BTreeLeaf *leaf;\
+	int idx;\
+	CSTL_ASSERT(self && "BTree(Set|Map)_find");\
+	CSTL_ASSERT(self->magic == self && "BTree(Set|Map)_find");\
+	if (!self->root) {\
+		return &self->head->slots[0];\
+	}\
+	leaf = Name##BTree_find_leaf(self, key);\
+	idx = Name##BTree_leaf_lower_bound(leaf, key);\
+	if (idx < leaf->count && Compare(key, leaf->elems[idx].key) == 0) {\
+		return &leaf->slots[idx];\
+	}\
+	return &self->head->slots[0];\
+}\
+\
+Name##Iterator Name##_lower_bound(Name *self, KeyType key)\
+{\
+	Name##BTreeLeaf *leaf;\
+	CSTL_ASSERT(self && "BTree(Set|Map)_lower_bound");\
+	CSTL_ASSERT(self->magic == self && "BTree(Set|Map)_lower_bound");\
+	if (!self->root) {\
+		return &self->head->slots[0];\
+	}\
+	leaf = Name##BTree_find_leaf(self, key);\
+	return Name##BTree_slot(leaf, Name##BTree_leaf_lower_bound(leaf, key));\
+}\
+\
+Name##Iterator Name##_upper_bound(Name *self, KeyType key)\
+{\
+	Name##BTreeLeaf *leaf;\
+	CSTL_ASSERT(self && "BTree(Set|Map)_upper_bound");\
+	CSTL_ASSERT(self->magic == self && "BTree(Set|Map)_upper_bound");\
+	if (!self->root) {\
+		return &self->head->slots[0];\
+	}\
+	leaf = Name##BTree_find_leaf(self, key);\
+	return Name##BTree_slot(leaf, Name##BTree_leaf_upper_bound(leaf, key));\
+}\
+\
+void Name##_equal_range(Name *self, KeyType key, Name##Iterator *first, Name##Iterator *last)\
+{\
+	CSTL_ASSERT(self && "BTree(Set|Map)_equal_range");\
+	CSTL_ASSERT(self->magic == self && "BTree(Set|Map)_equal_range");\
+	CSTL_ASSERT(first && "BTree(Set|Map)_equal_range");\
+	CSTL_ASSERT(last && "BTree(Set|Map)_equal_range");\
+	*first = Name##_lower_bound(self, key);\
+	*last = *first;\
+	if (*first != Name##_end(self) && Compare(key, CSTL_BTREE_ELEM(*first, Name).key) == 0) {\
+		*last = Name##_next(*first);\
+	}\
+}\
+\
+Name##Iterator Name##_begin(Name *self)\
+{\
+	CSTL_ASSERT(self && "BTree(Set|Map)_begin");\
+	CSTL_ASSERT(self->magic == self && "BTree(Set|Map)_begin");\
+	return &self->head->next->slots[0];\
+}\
+\
+Name##Iterator Name##_end(Name *self)\
+{\
+	CSTL_ASSERT(self && "BTree(Set|Map)_end");\
+	CSTL_ASSERT(self->magic == self && "BTree(Set|Map)_end");\
+	return &self->head->slots[0];\
+}\
+\
+Name##Iterator Name##_rbegin(Name *self)\
+{\
+	Name##BTreeLeaf *leaf;\
+	CSTL_ASSERT(self && "BTree(Set|Map)_rbegin");\
+	CSTL_ASSERT(self->magic == self && "BTree(Set|Map)_rbegin");\
+	leaf = self->head->prev;\
+	return &leaf->slots[leaf->count ? leaf->count - 1 : 0];\
+}\
+\
+Name##Iterator Name##_rend(Name *self)\
+{\
+	CSTL_ASSERT(self && "BTree(Set|Map)_rend");\
+	CSTL_ASSERT(self->magic == self && "BTree(Set|Map)_rend");\
+	return &self->head->slots[0];\
+}\
+\
+Name##Iterator Name##_next(Name##Iterator pos)\
+{\
+	Name##BTreeLeaf *leaf;\
+	CSTL_ASSERT(pos && "BTree(Set|Map)_next");\
+	leaf = CSTL_BTREE_LEAF(pos, Name);\
+	CSTL_ASSERT(leaf->magic && "BTree(Set|Map)_next");\
+	CSTL_ASSERT(pos->index < leaf->count && "BTree(Set|Map)_next");\
+	if (pos->index + 1 < leaf->count) {\
+		return pos + 1;\
+	}\
+	return &leaf->next->slots[0];\
+}\
+\
+Name##Iterator Name##_prev(Name##Iterator pos)\
+{\
+	Name##BTreeLeaf *leaf;\
+	CSTL_ASSERT(pos && "BTree(Set|Map)_prev");\
+	leaf = CSTL_BTREE_LEAF(pos, Name);\
+	CSTL_ASSERT(leaf->magic && "BTree(Set|Map)_prev");\
+	CSTL_ASSERT(pos->index < leaf->count && "BTree(Set|Map)_prev");\
+	if (pos->index > 0) {\
+		return pos - 1;\
+	}\
+	/* 前の葉がheadならばrend()になる */\
+	leaf = leaf->prev;\
+	return &leaf->slots[leaf->count ? leaf->count - 1 : 0];\
+}\
+\
+void Name##_swap(Name *self, Name *x)\
+{\
+	Name##BTreeLeaf *tmp_head;\
+	void *tmp_root;\
+	int tmp_height;\
+	size_t tmp_size;\
+	CSTL_ASSERT(self && "BTree(Set|Map)_swap");\
+	CSTL_ASSERT(x && "BTree(Set|Map)_swap");\
+	CSTL_ASSERT(self->magic == self && "BTree(Set|Map)_swap");\
+	CSTL_ASSERT(x->magic == x && "BTree(Set|Map)_swap");\
+	tmp_head = self->head;\
+	tmp_root = self->root;\
+	tmp_height = self->height;\
+	tmp_size = self->size;\
+	self->head = x->head;\
+	self->root = x->root;\
+	self->height = x->height;\
+	self->size = x->size;\
+	x->head = tmp_head;\
+	x->root = tmp_root;\
+	x->height = tmp_height;\
+	x->size = tmp_size;\
+}\
+\
+
+
+#endif /* CSTL_BTREE_H_INCLUDED */
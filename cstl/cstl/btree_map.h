@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) 2006-2010, KATO Noriaki
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/*!
+ * \file btree_map.h
+ * \brief btree_mapコンテナ
+ *
+ * mapと同じ関数を持つ、B+木の順序付きコンテナ。
+ * 赤黒木が要素ごとにノードを確保するのに対し、1つの葉に数十個の要素を並べて格納するので、
+ * 検索と走査でのキャッシュミスとmalloc/freeの回数が少ない。
+ *
+ * mapとの違い
+ * - 挿入・削除で要素が葉の間を移動するので、全てのイテレータと要素へのポインタが無効になる。
+ *   ただし、erase()の戻り値のイテレータは有効である。
+ * - multimapに相当するものはない。
+ */
+#ifndef CSTL_BTREE_MAP_H_INCLUDED
+#define CSTL_BTREE_MAP_H_INCLUDED
+
+#include <stdlib.h>
+#include "common.h"
+#include "btree.h"
+
+
+/*! 
+ * \brief インターフェイスマクロ
+ * 
+ * \param Name コンテナ名
+ * \param KeyType 要素のキーの型
+ * \param ValueType 要素の値の型
+ */
+#define CSTL_BTREE_MAP_INTERFACE(Name, KeyType, ValueType)	\
+CSTL_EXTERN_C_BEGIN()\
+CSTL_BTREE_INTERFACE(Name, KeyType)\
+Name##Iterator Name##_insert(Name *self, KeyType key, ValueType value, int *success);\
+Name##Iterator Name##_insert_ref(Name *self, KeyType key, ValueType const *value, int *success);\
+KeyType const *Name##_key(Name##Iterator pos);\
+ValueType *Name##_value(Name##Iterator pos);\
+ValueType *Name##_at(Name *self, KeyType key);\
+CSTL_EXTERN_C_END()\
+
+/*! 
+ * \brief 実装マクロ
+ * 
+ * \param Name コンテナ名
+ * \param KeyType 要素のキーの型
+ * \param ValueType 要素の値の型
+ * \param Compare 要素の比較ルーチン
+ */
+#define CSTL_BTREE_MAP_IMPLEMENT(Name, KeyType, ValueType, Compare)	\
+\
+typedef struct Name##BTreeElem Name##BTreeElem;\
+/*! \
+ * \brief btree_map要素構造体\
+ */\
+struct Name##BTreeElem {\
+	KeyType key;\
+	ValueType value;\
+};\
+\
+CSTL_BTREE_IMPLEMENT(Name, KeyType, Compare)\
+\
+/* at()で挿入する要素の値 */\
+static ValueType Name##BTree_nil_value;\
+\
+Name##Iterator Name##_insert(Name *self, KeyType key, ValueType value, int *success)\
+{\
+	CSTL_ASSERT(self && "BTreeMap_insert");\
+	CSTL_ASSERT(self->magic == self && "BTreeMap_insert");\
+	return Name##_insert_ref(self, key, &value, success);\
+}\
+\
+Name##Iterator Name##_insert_ref(Name *self, KeyType key, ValueType const *value, int *success)\
+{\
+	Name##Iterator pos;\
+	int inserted;\
+	CSTL_ASSERT(self && "BTreeMap_insert_ref");\
+	CSTL_ASSERT(self->magic == self && "BTreeMap_insert_ref");\
+	CSTL_ASSERT(value && "BTreeMap_insert_ref");\
+	pos = Name##_insert_key(self, key, &inserted);\
+	if (inserted) {\
+		CSTL_BTREE_ELEM(pos, Name).value = *value;\
+	}\
+	if (success) *success = inserted;\
+	return pos;\
+}\
+\
+KeyType const *Name##_key(Name##Iterator pos)\
+{\
+	CSTL_ASSERT(pos && "BTreeMap_key");\
+	CSTL_ASSERT(CSTL_BTREE_LEAF(pos, Name)->magic && "BTreeMap_key");\
+	CSTL_ASSERT(pos->index < CSTL_BTREE_LEAF(pos, Name)->count && "BTreeMap_key"); /* pos != end() */\
+	return &CSTL_BTREE_ELEM(pos, Name).key;\
+}\
+\
+ValueType *Name##_value(Name##Iterator pos)\
+{\
+	CSTL_ASSERT(pos && "BTreeMap_value");\
+	CSTL_ASSERT(CSTL_BTREE_LEAF(pos, Name)->magic && "BTreeMap_value");\
+	CSTL_ASSERT(pos->index < CSTL_BTREE_LEAF(pos, Name)->count && "BTreeMap_value"); /* pos != end() */\
+	return &CSTL_BTREE_ELEM(pos, Name).value;\
+}\
+\
+ValueType *Name##_at(Name *self, KeyType key)\
+{\
+	Name##Iterator pos;\
+	int inserted;\
+	CSTL_ASSERT(self && "BTreeMap_at");\
+	CSTL_ASSERT(self->magic == self && "BTreeMap_at");\
+	pos = Name##_insert_key(self, key, &inserted);\
+	if (!pos) {\
+		/* メモリ不足 */\
+		return 0;\
+	}\
+	if (inserted) {\
+		CSTL_BTREE_ELEM(pos, Name).value = Name##BTree_nil_value;\
+	}\
+	return &CSTL_BTREE_ELEM(pos, Name).value;\
+}\
+\
+
+#endif /* CSTL_BTREE_MAP_H_INCLUDED */
@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2006-2010, KATO Noriaki
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/*!
+ * \file btree_set.h
+ * \brief btree_setコンテナ
+ *
+ * setと同じ関数を持つ、B+木の順序付きコンテナ。
+ * setとの違いはbtree_map.hを参照。
+ */
+#ifndef CSTL_BTREE_SET_H_INCLUDED
+#define CSTL_BTREE_SET_H_INCLUDED
+
+#include <stdlib.h>
+#include "common.h"
+#include "btree.h"
+
+
+/*! 
+ * \brief インターフェイスマクロ
+ * 
+ * \param Name コンテナ名
+ * \param Type 要素の型
+ */
+#define CSTL_BTREE_SET_INTERFACE(Name, Type)	\
+CSTL_EXTERN_C_BEGIN()\
+CSTL_BTREE_INTERFACE(Name, Type)\
+Name##Iterator Name##_insert(Name *self, Type data, int *success);\
+Type const *Name##_data(Name##Iterator pos);\
+CSTL_EXTERN_C_END()\
+
+/*! 
+ * \brief 実装マクロ
+ * 
+ * \param Name コンテナ名
+ * \param Type 要素の型
+ * \param Compare 要素の比較ルーチン
+ */
+#define CSTL_BTREE_SET_IMPLEMENT(Name, Type, Compare)	\
+\
+typedef struct Name##BTreeElem Name##BTreeElem;\
+/*! \
+ * \brief btree_set要素構造体\
+ */\
+struct Name##BTreeElem {\
+	Type key;\
+};\
+\
+CSTL_BTREE_IMPLEMENT(Name, Type, Compare)\
+\
+Name##Iterator Name##_insert(Name *self, Type data, int *success)\
+{\
+	Name##Iterator pos;\
+	int inserted;\
+	CSTL_ASSERT(self && "BTreeSet_insert");\
+	CSTL_ASSERT(self->magic == self && "BTreeSet_insert");\
+	pos = Name##_insert_key(self, data, &inserted);\
+	if (success) *success = inserted;\
+	return pos;\
+}\
+\
+Type const *Name##_data(Name##Iterator pos)\
+{\
+	CSTL_ASSERT(pos && "BTreeSet_data");\
+	CSTL_ASSERT(CSTL_BTREE_LEAF(pos, Name)->magic && "BTreeSet_data");\
+	CSTL_ASSERT(pos->index < CSTL_BTREE_LEAF(pos, Name)->count && "BTreeSet_data"); /* pos != end() */\
+	return &CSTL_BTREE_ELEM(pos, Name).key;\
+}\
+\
+
+#endif /* CSTL_BTREE_SET_H_INCLUDED */
@@ -53,5 +53,39 @@
 
 #define CSTL_UNUSED_PARAM(x)	(void) x
 
+#include <stddef.h>
+
+/*! 
+ * \brief アロケータ
+ *
+ * *_IMPLEMENT_ALLOCATOR()でコンテナのメモリの確保先を指定する。
+ * ctxは各関数の第1引数にそのまま渡される。
+ */
+typedef struct CstlAllocator {
+	void *ctx;
+	void *(*allocate)(void *ctx, size_t size);
+	void *(*reallocate)(void *ctx, void *ptr, size_t size);
+	void (*deallocate)(void *ctx, void *ptr);
+} CstlAllocator;
+
+/* アロケータを指定しない場合。malloc/realloc/freeを直接呼ぶ */
+#define CSTL_DEFAULT_ALLOCATOR	((CstlAllocator const *) 0)
+
+/* 
+ * Allocatorは(CstlAllocator const *)の式。
+ * CSTL_DEFAULT_ALLOCATORや静的なオブジェクトのアドレスなら、分岐は定数畳み込みで消える。
+ * void const *での比較は、アドレスが常に真になる警告(-Waddress)を避けるため。
+ */
+#define CSTL_ALLOCATOR_IS_DEFAULT(Allocator)	((void const *) (Allocator) == (void const *) 0)
+#define CSTL_ALLOCATE(Allocator, size)	\
+	(CSTL_ALLOCATOR_IS_DEFAULT(Allocator) ? malloc(size) :\
+	 (Allocator)->allocate((Allocator)->ctx, (size)))
+#define CSTL_REALLOCATE(Allocator, ptr, size)	\
+	(CSTL_ALLOCATOR_IS_DEFAULT(Allocator) ? realloc((ptr), (size)) :\
+	 (Allocator)->reallocate((Allocator)->ctx, (ptr), (size)))
+#define CSTL_DEALLOCATE(Allocator, ptr)	\
+	(CSTL_ALLOCATOR_IS_DEFAULT(Allocator) ? free(ptr) :\
+	 (Allocator)->deallocate((Allocator)->ctx, (ptr)))
+
 
 #endif /* CSTL_COMMON_H_INCLUDED */
@@ -0,0 +1,483 @@
+/*
+ * Copyright (c) 2006-2010, KATO Noriaki
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/*!
+ * \file concurrent_unordered_map.h
+ * \brief concurrent_unordered_mapコンテナ
+ *
+ * 複数のスレッドから同時に検索・挿入・削除できるハッシュテーブル。
+ * テーブルをセグメントに分け、セグメントごとに読み書きロックを持つ(ロックストライピング)。
+ * 異なるセグメントへの操作は並行に進み、同じセグメントへの検索同士も並行に進む。
+ * セグメントはそれぞれのロックの中で独立に作り直す。
+ *
+ * 要素へのポインタやイテレータは他のスレッドの削除で無効になるため返さない。
+ * 検索は値をコピーして返し、値の更新は Name_update() に渡した関数でロックの中で行う。
+ *
+ * POSIXではpthread_rwlock_t、WindowsではSRWLOCKを使う。
+ */
+#ifndef CSTL_CONCURRENT_UNORDERED_MAP_H_INCLUDED
+#define CSTL_CONCURRENT_UNORDERED_MAP_H_INCLUDED
+
+#include <stdlib.h>
+#include "common.h"
+#include "hashtable.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#define CSTL_RWLOCK					SRWLOCK
+#define CSTL_RWLOCK_INIT(l)			(InitializeSRWLock(l), 1)
+#define CSTL_RWLOCK_DESTROY(l)		((void) (l))
+#define CSTL_RWLOCK_RDLOCK(l)		AcquireSRWLockShared(l)
+#define CSTL_RWLOCK_RDUNLOCK(l)		ReleaseSRWLockShared(l)
+#define CSTL_RWLOCK_WRLOCK(l)		AcquireSRWLockExclusive(l)
+#define CSTL_RWLOCK_WRUNLOCK(l)		ReleaseSRWLockExclusive(l)
+#else
+#include <pthread.h>
+#define CSTL_RWLOCK					pthread_rwlock_t
+#define CSTL_RWLOCK_INIT(l)			(pthread_rwlock_init(l, 0) == 0)
+#define CSTL_RWLOCK_DESTROY(l)		pthread_rwlock_destroy(l)
+#define CSTL_RWLOCK_RDLOCK(l)		pthread_rwlock_rdlock(l)
+#define CSTL_RWLOCK_RDUNLOCK(l)		pthread_rwlock_unlock(l)
+#define CSTL_RWLOCK_WRLOCK(l)		pthread_rwlock_wrlock(l)
+#define CSTL_RWLOCK_WRUNLOCK(l)		pthread_rwlock_unlock(l)
+#endif
+
+/* Name_new()のセグメント数 */
+#define CSTL_CONCURRENT_SEGMENTS		64
+/* セグメント数の上限 */
+#define CSTL_CONCURRENT_MAX_SEGMENTS	65536
+/* セグメントの最初のバケット数(2のべき乗) */
+#define CSTL_CONCURRENT_MIN_BUCKETS		8
+/* 隣のセグメントとキャッシュラインを共有しないための詰め物の大きさ */
+#define CSTL_CONCURRENT_CACHE_LINE		64
+
+
+/*!
+ * \brief インターフェイスマクロ
+ *
+ * \param Name コンテナ名
+ * \param KeyType 要素のキーの型
+ * \param ValueType 要素の値の型
+ */
+#define CSTL_CONCURRENT_UNORDERED_MAP_INTERFACE(Name, KeyType, ValueType)	\
+\
+/*! \
+ * \brief concurrent_unordered_map構造体\
+ */\
+typedef struct Name Name;\
+\
+CSTL_EXTERN_C_BEGIN()\
+CSTL_HASH_FUNCTIONS_INTERFACE(Name)\
+Name *Name##_new(void);\
+Name *Name##_new_segments(size_t n);\
+void Name##_delete(Name *self);\
+void Name##_clear(Name *self);\
+int Name##_empty(Name *self);\
+size_t Name##_size(Name *self);\
+int Name##_insert(Name *self, KeyType key, ValueType value, int *success);\
+int Name##_assign(Name *self, KeyType key, ValueType value);\
+int Name##_find(Name *self, KeyType key, ValueType *value);\
+int Name##_update(Name *self, KeyType key, void (*func)(ValueType *, void *), void *arg);\
+size_t Name##_erase_key(Name *self, KeyType key);\
+void Name##_foreach(Name *self, void (*func)(KeyType const *, ValueType const *, void *), void *arg);\
+size_t Name##_segment_count(Name *self);\
+CSTL_EXTERN_C_END()\
+
+
+/*!
+ * \brief 実装マクロ
+ *
+ * \param Name コンテナ名
+ * \param KeyType 要素のキーの型
+ * \param ValueType 要素の値の型
+ * \param Hasher ハッシュ関数
+ * \param Compare 要素の比較ルーチン
+ */
+#define CSTL_CONCURRENT_UNORDERED_MAP_IMPLEMENT(Name, KeyType, ValueType, Hasher, Compare)	\
+\
+typedef struct Name##Node Name##Node;\
+/*! \
+ * \brief ノード\
+ *\
+ * hashはHasherの値にCSTL_HASH_FIBONACCIを掛けたもの。\
+ * 上位ビットでセグメントを、その下のビットでバケットを選ぶ\
+ */\
+struct Name##Node {\
+	Name##Node *next;\
+	CSTL_HASH_WORD hash;\
+	KeyType key;\
+	ValueType value;\
+};\
+\
+/*! \
+ * \brief セグメント\
+ *\
+ * padは隣のセグメントのlockやsizeと同じキャッシュラインに乗らないためのもの\
+ */\
+typedef struct Name##Segment {\
+	CSTL_RWLOCK lock;\
+	Name##Node **buckets;\
+	size_t bucket_count;\
+	int shift;\
+	size_t size;\
+	char pad[CSTL_CONCURRENT_CACHE_LINE];\
+} Name##Segment;\
+\
+/*! \
+ * \brief concurrent_unordered_map構造体\
+ */\
+struct Name {\
+	Name##Segment *segments;\
+	size_t segment_count;\
+	int segment_bits;\
+	CSTL_MAGIC(Name *magic;)\
+};\
+\
+CSTL_HASH_FUNCTIONS_IMPLEMENT(Name)\
+\
+static CSTL_HASH_WORD Name##_hash(KeyType key)\
+{\
+	return (CSTL_HASH_WORD) Hasher(key) * CSTL_HASH_FIBONACCI;\
+}\
+\
+static Name##Segment *Name##_segment(Name *self, CSTL_HASH_WORD hash)\
+{\
+	/* segment_bitsが0でもCSTL_HASH_WORD_BITSビットのシフトにならないように2回に分ける */\
+	return &self->segments[(size_t) ((hash >> 1) >> (CSTL_HASH_WORD_BITS - 1 - self->segment_bits))];\
+}\
+\
+static size_t Name##_index(Name *self, Name##Segment *seg, CSTL_HASH_WORD hash)\
+{\
+	return (size_t) ((hash << self->segment_bits) >> seg->shift);\
+}\
+\
+/* segのロックを取ってから呼ぶこと */\
+static Name##Node **Name##_lookup(Name *self, Name##Segment *seg, KeyType key, CSTL_HASH_WORD hash)\
+{\
+	Name##Node **p;\
+	for (p = &seg->buckets[Name##_index(self, seg, hash)]; *p; p = &(*p)->next) {\
+		if ((*p)->hash == hash && Compare((*p)->key, key) == 0) {\
+			break;\
+		}\
+	}\
+	return p;\
+}\
+\
+static Name##Node **Name##_new_buckets(size_t n)\
+{\
+	Name##Node **buckets;\
+	size_t i;\
+	buckets = (Name##Node **) malloc(sizeof(Name##Node *) * n);\
+	if (!buckets) return 0;\
+	for (i = 0; i < n; i++) {\
+		buckets[i] = 0;\
+	}\
+	return buckets;\
+}\
+\
+/* segの書き込みロックを取ってから呼ぶこと。失敗しても元のバケットのまま続ける */\
+static void Name##_grow(Name *self, Name##Segment *seg)\
+{\
+	Name##Node **buckets;\
+	Name##Node *node;\
+	Name##Node *next;\
+	size_t i;\
+	size_t idx;\
+	/* セグメントのビットとバケットのビットを合わせてCSTL_HASH_WORD_BITSビットまで */\
+	if (seg->shift <= self->segment_bits) return;\
+	buckets = Name##_new_buckets(seg->bucket_count * 2);\
+	if (!buckets) return;\
+	seg->shift--;\
+	for (i = 0; i < seg->bucket_count; i++) {\
+		for (node = seg->buckets[i]; node; node = next) {\
+			next = node->next;\
+			idx = Name##_index(self, seg, node->hash);\
+			node->next = buckets[idx];\
+			buckets[idx] = node;\
+		}\
+	}\
+	free(seg->buckets);\
+	seg->buckets = buckets;\
+	seg->bucket_count *= 2;\
+}\
+\
+static void Name##_free_nodes(Name##Node *node)\
+{\
+	Name##Node *next;\
+	for (; node; node = next) {\
+		next = node->next;\
+		free(node);\
+	}\
+}\
+\
+Name *Name##_new(void)\
+{\
+	return Name##_new_segments(CSTL_CONCURRENT_SEGMENTS);\
+}\
+\
+Name *Name##_new_segments(size_t n)\
+{\
+	Name *self;\
+	size_t i;\
+	int bits = 0;\
+	if (n > CSTL_CONCURRENT_MAX_SEGMENTS) n = CSTL_CONCURRENT_MAX_SEGMENTS;\
+	while (((size_t) 1 << bits) < n) bits++;\
+	self = (Name *) malloc(sizeof(Name));\
+	if (!self) return 0;\
+	self->segment_count = (size_t) 1 << bits;\
+	self->segment_bits = bits;\
+	self->segments = (Name##Segment *) malloc(sizeof(Name##Segment) * self->segment_count);\
+	if (!self->segments) {\
+		free(self);\
+		return 0;\
+	}\
+	for (i = 0; i < self->segment_count; i++) {\
+		Name##Segment *seg = &self->segments[i];\
+		seg->buckets = Name##_new_buckets(CSTL_CONCURRENT_MIN_BUCKETS);\
+		if (!seg->buckets) break;\
+		if (!CSTL_RWLOCK_INIT(&seg->lock)) {\
+			free(seg->buckets);\
+			break;\
+		}\
+		seg->bucket_count = CSTL_CONCURRENT_MIN_BUCKETS;\
+		seg->shift = CSTL_HASH_WORD_BITS;\
+		while (((size_t) 1 << (CSTL_HASH_WORD_BITS - seg->shift)) < seg->bucket_count) seg->shift--;\
+		seg->size = 0;\
+	}\
+	if (i < self->segment_count) {\
+		while (i-- > 0) {\
+			CSTL_RWLOCK_DESTROY(&self->segments[i].lock);\
+			free(self->segments[i].buckets);\
+		}\
+		free(self->segments);\
+		free(self);\
+		return 0;\
+	}\
+	CSTL_MAGIC(self->magic = self);\
+	return self;\
+}\
+\
+void Name##_delete(Name *self)\
+{\
+	size_t i, j;\
+	if (!self) return;\
+	CSTL_ASSERT(self->magic == self && "ConcurrentUnorderedMap_delete");\
+	for (i = 0; i < self->segment_count; i++) {\
+		Name##Segment *seg = &self->segments[i];\
+		for (j = 0; j < seg->bucket_count; j++) {\
+			Name##_free_nodes(seg->buckets[j]);\
+		}\
+		free(seg->buckets);\
+		CSTL_RWLOCK_DESTROY(&seg->lock);\
+	}\
+	CSTL_MAGIC(self->magic = 0);\
+	free(self->segments);\
+	free(self);\
+}\
+\
+void Name##_clear(Name *self)\
+{\
+	size_t i, j;\
+	Name##Node *list;\
+	Name##Node *node;\
+	CSTL_ASSERT(self && "ConcurrentUnorderedMap_clear");\
+	CSTL_ASSERT(self->magic == self && "ConcurrentUnorderedMap_clear");\
+	for (i = 0; i < self->segment_count; i++) {\
+		Name##Segment *seg = &self->segments[i];\
+		list = 0;\
+		CSTL_RWLOCK_WRLOCK(&seg->lock);\
+		for (j = 0; j < seg->bucket_count; j++) {\
+			while ((node = seg->buckets[j]) != 0) {\
+				seg->buckets[j] = node->next;\
+				node->next = list;\
+				list = node;\
+			}\
+		}\
+		seg->size = 0;\
+		CSTL_RWLOCK_WRUNLOCK(&seg->lock);\
+		Name##_free_nodes(list);\
+	}\
+}\
+\
+size_t Name##_size(Name *self)\
+{\
+	size_t i;\
+	size_t n = 0;\
+	CSTL_ASSERT(self && "ConcurrentUnorderedMap_size");\
+	CSTL_ASSERT(self->magic == self && "ConcurrentUnorderedMap_size");\
+	for (i = 0; i < self->segment_count; i++) {\
+		CSTL_RWLOCK_RDLOCK(&self->segments[i].lock);\
+		n += self->segments[i].size;\
+		CSTL_RWLOCK_RDUNLOCK(&self->segments[i].lock);\
+	}\
+	return n;\
+}\
+\
+int Name##_empty(Name *self)\
+{\
+	CSTL_ASSERT(self && "ConcurrentUnorderedMap_empty");\
+	CSTL_ASSERT(self->magic == self && "ConcurrentUnorderedMap_empty");\
+	return Name##_size(self) == 0;\
+}\
+\
+size_t Name##_segment_count(Name *self)\
+{\
+	CSTL_ASSERT(self && "ConcurrentUnorderedMap_segment_count");\
+	CSTL_ASSERT(self->magic == self && "ConcurrentUnorderedMap_segment_count");\
+	return self->segment_count;\
+}\
+\
+/* assignが真ならキーがあれば値を上書きする */\
+static int Name##_insert_or_assign(Name *self, KeyType key, ValueType value, int *success, int assign)\
+{\
+	CSTL_HASH_WORD hash = Name##_hash(key);\
+	Name##Segment *seg = Name##_segment(self, hash);\
+	Name##Node **p;\
+	Name##Node *node;\
+	CSTL_RWLOCK_WRLOCK(&seg->lock);\
+	p = Name##_lookup(self, seg, key, hash);\
+	if (*p) {\
+		if (assign) {\
+			(*p)->value = value;\
+		}\
+		CSTL_RWLOCK_WRUNLOCK(&seg->lock);\
+		if (success) *success = 0;\
+		return 1;\
+	}\
+	node = (Name##Node *) malloc(sizeof(Name##Node));\
+	if (!node) {\
+		CSTL_RWLOCK_WRUNLOCK(&seg->lock);\
+		if (success) *success = 0;\
+		return 0;\
+	}\
+	node->hash = hash;\
+	node->key = key;\
+	node->value = value;\
+	node->next = 0;\
+	*p = node;\
+	seg->size++;\
+	if (seg->size > seg->bucket_count) {\
+		Name##_grow(self, seg);\
+	}\
+	CSTL_RWLOCK_WRUNLOCK(&seg->lock);\
+	if (success) *success = 1;\
+	return 1;\
+}\
+\
+int Name##_insert(Name *self, KeyType key, ValueType value, int *success)\
+{\
+	CSTL_ASSERT(self && "ConcurrentUnorderedMap_insert");\
+	CSTL_ASSERT(self->magic == self && "ConcurrentUnorderedMap_insert");\
+	return Name##_insert_or_assign(self, key, value, success, 0);\
+}\
+\
+int Name##_assign(Name *self, KeyType key, ValueType value)\
+{\
+	CSTL_ASSERT(self && "ConcurrentUnorderedMap_assign");\
+	CSTL_ASSERT(self->magic == self && "ConcurrentUnorderedMap_assign");\
+	return Name##_insert_or_assign(self, key, value, 0, 1);\
+}\
+\
+int Name##_find(Name *self, KeyType key, ValueType *value)\
+{\
+	CSTL_HASH_WORD hash;\
+	Name##Segment *seg;\
+	Name##Node *node;\
+	CSTL_ASSERT(self && "ConcurrentUnorderedMap_find");\
+	CSTL_ASSERT(self->magic == self && "ConcurrentUnorderedMap_find");\
+	hash = Name##_hash(key);\
+	seg = Name##_segment(self, hash);\
+	CSTL_RWLOCK_RDLOCK(&seg->lock);\
+	node = *Name##_lookup(self, seg, key, hash);\
+	if (node && value) {\
+		*value = node->value;\
+	}\
+	CSTL_RWLOCK_RDUNLOCK(&seg->lock);\
+	return node != 0;\
+}\
+\
+int Name##_update(Name *self, KeyType key, void (*func)(ValueType *, void *), void *arg)\
+{\
+	CSTL_HASH_WORD hash;\
+	Name##Segment *seg;\
+	Name##Node *node;\
+	CSTL_ASSERT(self && "ConcurrentUnorderedMap_update");\
+	CSTL_ASSERT(self->magic == self && "ConcurrentUnorderedMap_update");\
+	CSTL_ASSERT(func && "ConcurrentUnorderedMap_update");\
+	hash = Name##_hash(key);\
+	seg = Name##_segment(self, hash);\
+	CSTL_RWLOCK_WRLOCK(&seg->lock);\
+	node = *Name##_lookup(self, seg, key, hash);\
+	if (node) {\
+		func(&node->value, arg);\
+	}\
+	CSTL_RWLOCK_WRUNLOCK(&seg->lock);\
+	return node != 0;\
+}\
+\
+size_t Name##_erase_key(Name *self, KeyType key)\
+{\
+	CSTL_HASH_WORD hash;\
+	Name##Segment *seg;\
+	Name##Node **p;\
+	Name##Node *node;\
+	CSTL_ASSERT(self && "ConcurrentUnorderedMap_erase_key");\
+	CSTL_ASSERT(self->magic == self && "ConcurrentUnorderedMap_erase_key");\
+	hash = Name##_hash(key);\
+	seg = Name##_segment(self, hash);\
+	CSTL_RWLOCK_WRLOCK(&seg->lock);\
+	p = Name##_lookup(self, seg, key, hash);\
+	node = *p;\
+	if (node) {\
+		*p = node->next;\
+		seg->size--;\
+	}\
+	CSTL_RWLOCK_WRUNLOCK(&seg->lock);\
+	if (!node) return 0;\
+	free(node);\
+	return 1;\
+}\
+\
+void Name##_foreach(Name *self, void (*func)(KeyType const *, ValueType const *, void *), void *arg)\
+{\
+	size_t i, j;\
+	Name##Node *node;\
+	CSTL_ASSERT(self && "ConcurrentUnorderedMap_foreach");\
+	CSTL_ASSERT(self->magic == self && "ConcurrentUnorderedMap_foreach");\
+	CSTL_ASSERT(func && "ConcurrentUnorderedMap_foreach");\
+	for (i = 0; i < self->segment_count; i++) {\
+		Name##Segment *seg = &self->segments[i];\
+		CSTL_RWLOCK_RDLOCK(&seg->lock);\
+		for (j = 0; j < seg->bucket_count; j++) {\
+			for (node = seg->buckets[j]; node; node = node->next) {\
+				func(&node->key, &node->value, arg);\
+			}\
+		}\
+		CSTL_RWLOCK_RDUNLOCK(&seg->lock);\
+	}\
+}\
+\
+
+
+#endif /* CSTL_CONCURRENT_UNORDERED_MAP_H_INCLUDED */
@@ -95,12 +95,22 @@ CSTL_EXTERN_C_END()\
  * \param Type 要素の型
  */
 #define CSTL_DEQUE_IMPLEMENT(Name, Type)	\
+CSTL_DEQUE_IMPLEMENT_ALLOCATOR(Name, Type, CSTL_DEFAULT_ALLOCATOR)\
+
+/*! 
+ * \brief アロケータを指定する実装マクロ
+ * 
+ * \param Name コンテナ名
+ * \param Type 要素の型
+ * \param Allocator アロケータ(CstlAllocator const *)の式
+ */
+#define CSTL_DEQUE_IMPLEMENT_ALLOCATOR(Name, Type, Allocator)	\
 \
 CSTL_RING_INTERFACE(Name##_Ring, Type)\
-CSTL_RING_IMPLEMENT_FOR_DEQUE(Name##_Ring, Type)\
+CSTL_RING_IMPLEMENT_FOR_DEQUE(Name##_Ring, Type, Allocator)\
 CSTL_VECTOR_INTERFACE(Name##_RingVector, Name##_Ring*)\
-CSTL_VECTOR_IMPLEMENT_BASE(Name##_RingVector, Name##_Ring*)\
-CSTL_VECTOR_IMPLEMENT_RESERVE(Name##_RingVector, Name##_Ring*)\
+CSTL_VECTOR_IMPLEMENT_BASE(Name##_RingVector, Name##_Ring*, Allocator)\
+CSTL_VECTOR_IMPLEMENT_RESERVE(Name##_RingVector, Name##_Ring*, Allocator)\
 CSTL_VECTOR_IMPLEMENT_MOVE_FORWARD(Name##_RingVector, Name##_Ring*)\
 CSTL_VECTOR_IMPLEMENT_MOVE_BACKWARD(Name##_RingVector, Name##_Ring*)\
 CSTL_VECTOR_IMPLEMENT_INSERT_N_NO_DATA(Name##_RingVector, Name##_Ring*)\
@@ -338,18 +348,18 @@ static void Name##_move_forward(Name *self, size_t first, size_t last, size_t n)
 Name *Name##_new(void)\
 {\
 	Name *self;\
-	self = (Name *) malloc(sizeof(Name));\
+	self = (Name *) CSTL_ALLOCATE(Allocator, sizeof(Name));\
 	if (!self) return 0;\
 	self->map = Name##_RingVector_new_reserve(Name##_INITIAL_MAP_SIZE);\
 	if (!self->map) {\
-		free(self);\
+		CSTL_DEALLOCATE(Allocator, self);\
 		return 0;\
 	}\
 	Name##_RingVector_resize(self->map, Name##_INITIAL_MAP_SIZE, 0);\
 	self->pool = Name##_RingVector_new_reserve(Name##_INITIAL_MAP_SIZE);\
 	if (!self->pool) {\
 		Name##_RingVector_delete(self->map);\
-		free(self);\
+		CSTL_DEALLOCATE(Allocator, self);\
 		return 0;\
 	}\
 	self->begin = CSTL_VECTOR_SIZE(self->map) / 2;\
@@ -359,7 +369,7 @@ Name *Name##_new(void)\
 	if (!CSTL_VECTOR_AT(self->map, self->begin)) {\
 		Name##_RingVector_delete(self->map);\
 		Name##_RingVector_delete(self->pool);\
-		free(self);\
+		CSTL_DEALLOCATE(Allocator, self);\
 		return 0;\
 	}\
 	CSTL_MAGIC(self->magic = self);\
@@ -383,7 +393,7 @@ void Name##_delete(Name *self)\
 	Name##_RingVector_delete(self->map);\
 	Name##_RingVector_delete(self->pool);\
 	CSTL_MAGIC(self->magic = 0);\
-	free(self);\
+	CSTL_DEALLOCATE(Allocator, self);\
 }\
 \
 int Name##_push_back(Name *self, Type data)\
@@ -0,0 +1,615 @@
+/*
+ * Copyright (c) 2006-2010, KATO Noriaki
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/*!
+ * \file flat_hashtable.h
+ * \brief オープンアドレス法のハッシュテーブル(unordered_flat_map/unordered_flat_set共通部)
+ *
+ * 要素はノードを確保せずスロット配列に直接格納する。
+ * スロットごとに1バイトの制御バイトを持ち、検索では制御バイトを
+ * 16個(1グループ)ずつSSE2で比較する(Swiss table方式)。
+ *
+ * このファイルを直接インクルードしないこと
+ */
+#ifndef CSTL_FLAT_HASHTABLE_H_INCLUDED
+#define CSTL_FLAT_HASHTABLE_H_INCLUDED
+
+#include <stdlib.h>
+#include <string.h>
+#include "common.h"
+#include "hashtable.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CSTL_FLAT_SSE2
+#endif
+
+/*
+ * 制御バイト。0〜127は使用中(ハッシュ値の7ビット)、負の値は空き。
+ * DELETEDは検索を打ち切らない空き(墓標)
+ */
+#define CSTL_FLAT_EMPTY		((signed char) -128)
+#define CSTL_FLAT_DELETED	((signed char) -2)
+/* 1グループの制御バイト数 */
+#define CSTL_FLAT_GROUP		16
+/* 最大負荷率の上限。常に空きスロットが残るようにする */
+#define CSTL_FLAT_MAX_MLF	0.875f
+
+/* グループgの制御バイトのうちcと等しいもののビットマスクをmに入れる */
+#ifdef CSTL_FLAT_SSE2
+#define CSTL_FLAT_MATCH(g, c, m)	\
+	((m) = (unsigned int) _mm_movemask_epi8(_mm_cmpeq_epi8(\
+				_mm_loadu_si128((const __m128i *) (g)), _mm_set1_epi8(c))))
+/* 空き(EMPTYまたはDELETED)は符号ビットが立っている */
+#define CSTL_FLAT_MATCH_FREE(g, m)	\
+	((m) = (unsigned int) _mm_movemask_epi8(_mm_loadu_si128((const __m128i *) (g))))
+#else
+#define CSTL_FLAT_MATCH(g, c, m)	\
+	do {\
+		int i_;\
+		(m) = 0;\
+		for (i_ = 0; i_ < CSTL_FLAT_GROUP; i_++) {\
+			if ((g)[i_] == (c)) (m) |= 1u << i_;\
+		}\
+	} while (0)
+#define CSTL_FLAT_MATCH_FREE(g, m)	\
+	do {\
+		int i_;\
+		(m) = 0;\
+		for (i_ = 0; i_ < CSTL_FLAT_GROUP; i_++) {\
+			if ((g)[i_] < 0) (m) |= 1u << i_;\
+		}\
+	} while (0)
+#endif
+
+/* 0でないmの最下位の立っているビットの位置をnに入れる */
+#if defined(__GNUC__)
+#define CSTL_FLAT_CTZ(m, n)	((n) = __builtin_ctz(m))
+#else
+#define CSTL_FLAT_CTZ(m, n)	\
+	do {\
+		unsigned int m_ = (m);\
+		for ((n) = 0; !(m_ & 1u); m_ >>= 1) (n)++;\
+	} while (0)
+#endif
+
+
+#define CSTL_FLAT_HASHTABLE_INTERFACE(Name, KeyType, ValueType)	\
+\
+typedef struct Name Name;\
+typedef struct Name##Node *Name##Iterator;\
+typedef struct Name##Node *Name##LocalIterator;\
+CSTL_HASH_FUNCTIONS_INTERFACE(Name)\
+Name *Name##_new(void);\
+Name *Name##_new_rehash(size_t n);\
+Name *Name##_new_pow2(size_t n);\
+void Name##_delete(Name *self);\
+void Name##_clear(Name *self);\
+int Name##_empty(Name *self);\
+size_t Name##_size(Name *self);\
+int Name##_insert_range(Name *self, Name##Iterator first, Name##Iterator last);\
+Name##Iterator Name##_erase(Name *self, Name##Iterator pos);\
+Name##Iterator Name##_erase_range(Name *self, Name##Iterator first, Name##Iterator last);\
+size_t Name##_erase_key(Name *self, KeyType key);\
+size_t Name##_count(Name *self, KeyType key);\
+Name##Iterator Name##_find(Name *self, KeyType key);\
+void Name##_equal_range(Name *self, KeyType key, Name##Iterator *first, Name##Iterator *last);\
+Name##Iterator Name##_begin(Name *self);\
+Name##Iterator Name##_end(Name *self);\
+Name##Iterator Name##_next(Name##Iterator pos);\
+void Name##_swap(Name *self, Name *x);\
+size_t Name##_bucket_count(Name *self);\
+size_t Name##_bucket_size(Name *self, size_t idx);\
+size_t Name##_bucket(Name *self, KeyType key);\
+Name##LocalIterator Name##_bucket_begin(Name *self, size_t idx);\
+Name##LocalIterator Name##_bucket_end(Name *self, size_t idx);\
+Name##LocalIterator Name##_bucket_next(Name##LocalIterator pos);\
+float Name##_load_factor(Name *self);\
+float Name##_get_max_load_factor(Name *self);\
+void Name##_set_max_load_factor(Name *self, float z);\
+int Name##_rehash(Name *self, size_t n);\
+\
+
+
+/*
+ * Name##Nodeは呼び出し側で定義しておくこと。
+ * メンバにkeyと、0: 空き、1: 使用中、2: end()を表すusedを持つ
+ */
+#define CSTL_FLAT_HASHTABLE_IMPLEMENT(Name, KeyType, ValueType, Hasher, Compare)	\
+\
+CSTL_HASH_FUNCTIONS_IMPLEMENT(Name)\
+\
+static const float Name##_minimum_mlf = 1e-3f;\
+static const float Name##_default_mlf = CSTL_FLAT_MAX_MLF;\
+\
+/*! \
+ * \brief unordered_flat_set/unordered_flat_map構造体\
+ */\
+struct Name {\
+	signed char *ctrl; /* capacity個の制御バイト */\
+	Name##Node *slots; /* capacity + 1個のスロット。末尾はend() */\
+	size_t capacity; /* 2のべき乗 */\
+	size_t size;\
+	size_t deleted; /* DELETEDの数 */\
+	size_t limit; /* size + deletedがこれを超えたら作り直す */\
+	int shift; /* CSTL_HASH_WORD_BITS - log2(グループ数) */\
+	float max_load_factor;\
+	CSTL_MAGIC(Name *magic;)\
+};\
+\
+/* n以上のスロット数(2グループ以上の2のべき乗)。*shiftも更新する */\
+static size_t Name##_next_capacity(size_t n, int *shift)\
+{\
+	size_t cap;\
+	int bits;\
+	for (cap = CSTL_FLAT_GROUP * 2, bits = 1; cap < n && bits < 30; cap <<= 1, bits++) {\
+		;\
+	}\
+	*shift = CSTL_HASH_WORD_BITS - bits;\
+	return cap;\
+}\
+\
+static size_t Name##_limit(size_t capacity, float mlf)\
+{\
+	size_t limit = (size_t) (capacity * mlf);\
+	return limit < capacity ? limit : capacity - 1;\
+}\
+\
+/* ハッシュ値から最初に調べるグループと制御バイトを求める */\
+static size_t Name##_group(Name *self, size_t hash_val, signed char *h2)\
+{\
+	CSTL_HASH_WORD h = (CSTL_HASH_WORD) hash_val * CSTL_HASH_FIBONACCI;\
+	*h2 = (signed char) ((h >> (self->shift - 7)) & 0x7f);\
+	return (size_t) (h >> self->shift);\
+}\
+\
+/* ハッシュ値がhash_valのkeyのスロットを探す。なければend() */\
+static Name##Node *Name##_find_hash(Name *self, KeyType key, size_t hash_val)\
+{\
+	signed char h2;\
+	size_t mask = (self->capacity / CSTL_FLAT_GROUP) - 1;\
+	size_t g = Name##_group(self, hash_val, &h2);\
+	size_t step;\
+	for (step = 0; step <= mask; g = (g + ++step) & mask) {\
+		const signed char *ctrl = self->ctrl + g * CSTL_FLAT_GROUP;\
+		unsigned int m;\
+		CSTL_FLAT_MATCH(ctrl, h2, m);\
+		while (m) {\
+			Name##Node *node;\
+			int i;\
+			CSTL_FLAT_CTZ(m, i);\
+			node = &self->slots[g * CSTL_FLAT_GROUP + i];\
+			if (Compare(node->key, key) == 0) {\
+				return node;\
+			}\
+			m &= m - 1;\
+		}\
+		CSTL_FLAT_MATCH(ctrl, CSTL_FLAT_EMPTY, m);\
+		if (m) {\
+			/* EMPTYがあるグループより先には置かれていない */\
+			break;\
+		}\
+	}\
+	return &self->slots[self->capacity];\
+}\
+\
+/* ハッシュ値がhash_valの要素を置ける最初の空きスロットの添字を返す */\
+static size_t Name##_find_free(Name *self, size_t hash_val, signed char *h2)\
+{\
+	size_t mask = (self->capacity / CSTL_FLAT_GROUP) - 1;\
+	size_t g = Name##_group(self, hash_val, h2);\
+	size_t step = 0;\
+	for (;;) {\
+		unsigned int m;\
+		CSTL_FLAT_MATCH_FREE(self->ctrl + g * CSTL_FLAT_GROUP, m);\
+		if (m) {\
+			int i;\
+			CSTL_FLAT_CTZ(m, i);\
+			return g * CSTL_FLAT_GROUP + i;\
+		}\
+		/* size < capacityなので必ず見つかる */\
+		g = (g + ++step) & mask;\
+	}\
+}\
+\
+static int Name##_alloc_table(Name *self, size_t n)\
+{\
+	int shift;\
+	size_t cap = Name##_next_capacity(n, &shift);\
+	signed char *ctrl;\
+	Name##Node *slots;\
+	ctrl = (signed char *) malloc(cap);\
+	if (!ctrl) return 0;\
+	slots = (Name##Node *) malloc(sizeof(Name##Node) * (cap + 1)); /* +1はend()の分 */\
+	if (!slots) {\
+		free(ctrl);\
+		return 0;\
+	}\
+	memset(ctrl, CSTL_FLAT_EMPTY, cap);\
+	memset(slots, 0, sizeof(Name##Node) * (cap + 1));\
+	slots[cap].used = 2; /* end()。nextはここで止まる */\
+	self->ctrl = ctrl;\
+	self->slots = slots;\
+	self->capacity = cap;\
+	self->shift = shift;\
+	self->size = 0;\
+	self->deleted = 0;\
+	self->limit = Name##_limit(cap, self->max_load_factor);\
+	return 1;\
+}\
+\
+/* n個以上のスロットを持つテーブルに作り直す。DELETEDはなくなる */\
+static int Name##_resize(Name *self, size_t n)\
+{\
+	signed char *old_ctrl = self->ctrl;\
+	Name##Node *old_slots = self->slots;\
+	size_t old_cap = self->capacity;\
+	size_t old_size = self->size;\
+	size_t i;\
+	if (!Name##_alloc_table(self, n)) {\
+		/* selfは変更されていない */\
+		return 0;\
+	}\
+	for (i = 0; i < old_cap; i++) {\
+		if (old_ctrl[i] >= 0) {\
+			signed char h2;\
+			size_t idx = Name##_find_free(self, Hasher(old_slots[i].key), &h2);\
+			self->ctrl[idx] = h2;\
+			self->slots[idx] = old_slots[i];\
+		}\
+	}\
+	self->size = old_size;\
+	free(old_ctrl);\
+	free(old_slots);\
+	return 1;\
+}\
+\
+/* 挿入後の要素数がcountになっても作り直さずに済むようにする */\
+static int Name##_reserve(Name *self, size_t count)\
+{\
+	if (count + self->deleted <= self->limit) {\
+		return 1;\
+	}\
+	if (count <= self->limit / 2) {\
+		/* 墓標が多いだけなので同じ大きさで作り直す */\
+		return Name##_resize(self, self->capacity);\
+	}\
+	return Name##_resize(self, (size_t) (count / self->max_load_factor) + 1);\
+}\
+\
+/* \
+ * keyのスロットを返す。なければスロットを確保してkeyを入れ、*insertedを1にする。\
+ * 値は呼び出し側で入れること。メモリ不足の場合は0を返す\
+ */\
+static Name##Node *Name##_insert_key(Name *self, KeyType key, int *inserted)\
+{\
+	size_t hash_val = Hasher(key);\
+	size_t idx;\
+	signed char h2;\
+	Name##Node *node;\
+	*inserted = 0;\
+	node = Name##_find_hash(self, key, hash_val);\
+	if (node != Name##_end(self)) {\
+		return node;\
+	}\
+	idx = Name##_find_free(self, hash_val, &h2);\
+	if (self->ctrl[idx] == CSTL_FLAT_EMPTY && self->size + self->deleted + 1 > self->limit) {\
+		if (!Name##_reserve(self, self->size + 1)) {\
+			return 0;\
+		}\
+		idx = Name##_find_free(self, hash_val, &h2);\
+	}\
+	if (self->ctrl[idx] == CSTL_FLAT_DELETED) {\
+		self->deleted--;\
+	}\
+	self->ctrl[idx] = h2;\
+	node = &self->slots[idx];\
+	node->key = key;\
+	node->used = 1;\
+	self->size++;\
+	*inserted = 1;\
+	return node;\
+}\
+\
+static Name *Name##_new_capacity(size_t n)\
+{\
+	Name *self;\
+	self = (Name *) malloc(sizeof(Name));\
+	if (!self) return 0;\
+	self->max_load_factor = Name##_default_mlf;\
+	if (!Name##_alloc_table(self, n)) {\
+		free(self);\
+		return 0;\
+	}\
+	CSTL_MAGIC(self->magic = self);\
+	return self;\
+}\
+\
+Name *Name##_new(void)\
+{\
+	return Name##_new_capacity(0);\
+}\
+\
+Name *Name##_new_rehash(size_t n)\
+{\
+	return Name##_new_capacity(n);\
+}\
+\
+Name *Name##_new_pow2(size_t n)\
+{\
+	return Name##_new_capacity(n);\
+}\
+\
+void Name##_delete(Name *self)\
+{\
+	if (!self) return;\
+	CSTL_ASSERT(self->magic == self && "Unordered(Set|Map)_delete");\
+	free(self->ctrl);\
+	free(self->slots);\
+	CSTL_MAGIC(self->magic = 0);\
+	free(self);\
+}\
+\
+void Name##_clear(Name *self)\
+{\
+	size_t i;\
+	CSTL_ASSERT(self && "Unordered(Set|Map)_clear");\
+	CSTL_ASSERT(self->magic == self && "Unordered(Set|Map)_clear");\
+	if (self->size == 0 && self->deleted == 0) {\
+		return;\
+	}\
+	memset(self->ctrl, CSTL_FLAT_EMPTY, self->capacity);\
+	for (i = 0; i < self->capacity; i++) {\
+		self->slots[i].used = 0;\
+	}\
+	self->size = 0;\
+	self->deleted = 0;\
+}\
+\
+int Name##_empty(Name *self)\
+{\
+	CSTL_ASSERT(self && "Unordered(Set|Map)_empty");\
+	CSTL_ASSERT(self->magic == self && "Unordered(Set|Map)_empty");\
+	return self->size == 0;\
+}\
+\
+size_t Name##_size(Name *self)\
+{\
+	CSTL_ASSERT(self && "Unordered(Set|Map)_size");\
+	CSTL_ASSERT(self->magic == self && "Unordered(Set|Map)_size");\
+	return self->size;\
+}\
+\
+Name##Iterator Name##_begin(Name *self)\
+{\
+	Name##Node *pos;\
+	CSTL_ASSERT(self && "Unordered(Set|Map)_begin");\
+	CSTL_ASSERT(self->magic == self && "Unordered(Set|Map)_begin");\
+	for (pos = self->slots; !pos->used; pos++) {\
+		;\
+	}\
+	return pos;\
+}\
+\
+Name##Iterator Name##_end(Name *self)\
+{\
+	CSTL_ASSERT(self && "Unordered(Set|Map)_end");\
+	CSTL_ASSERT(self->magic == self && "Unordered(Set|Map)_end");\
+	return &self->slots[self->capacity];\
+}\
+\
+Name##Iterator Name##_next(Name##Iterator pos)\
+{\
+	CSTL_ASSERT(pos && "Unordered(Set|Map)_next");\
+	CSTL_ASSERT(pos->used == 1 && "Unordered(Set|Map)_next"); /* pos != end() */\
+	do {\
+		pos++;\
+	} while (!pos->used);\
+	return pos;\
+}\
+\
+Name##Iterator Name##_erase(Name *self, Name##Iterator pos)\
+{\
+	size_t idx;\
+	unsigned int m;\
+	Name##Iterator next;\
+	CSTL_ASSERT(self && "Unordered(Set|Map)_erase");\
+	CSTL_ASSERT(self->magic == self && "Unordered(Set|Map)_erase");\
+	CSTL_ASSERT(pos && "Unordered(Set|Map)_erase");\
+	CSTL_ASSERT(pos >= self->slots && pos < &self->slots[self->capacity] && "Unordered(Set|Map)_erase");\
+	CSTL_ASSERT(pos->used == 1 && "Unordered(Set|Map)_erase");\
+	next = Name##_next(pos);\
+	idx = (size_t) (pos - self->slots);\
+	/* \
+	 * グループにEMPTYが残っていれば、このグループを通り過ぎて置かれた要素はない。\
+	 * その場合はEMPTYに戻し、そうでなければ検索を打ち切らないようDELETEDにする\
+	 */\
+	CSTL_FLAT_MATCH(self->ctrl + (idx & ~(size_t) (CSTL_FLAT_GROUP - 1)), CSTL_FLAT_EMPTY, m);\
+	if (m) {\
+		self->ctrl[idx] = CSTL_FLAT_EMPTY;\
+	} else {\
+		self->ctrl[idx] = CSTL_FLAT_DELETED;\
+		self->deleted++;\
+	}\
+	pos->used = 0;\
+	self->size--;\
+	return next;\
+}\
+\
+Name##Iterator Name##_erase_range(Name *self, Name##Iterator first, Name##Iterator last)\
+{\
+	CSTL_ASSERT(self && "Unordered(Set|Map)_erase_range");\
+	CSTL_ASSERT(self->magic == self && "Unordered(Set|Map)_erase_range");\
+	CSTL_ASSERT(first && "Unordered(Set|Map)_erase_range");\
+	CSTL_ASSERT(last && "Unordered(Set|Map)_erase_range");\
+	while (first != last) {\
+		first = Name##_erase(self, first);\
+	}\
+	return first;\
+}\
+\
+size_t Name##_erase_key(Name *self, KeyType key)\
+{\
+	Name##Iterator pos;\
+	CSTL_ASSERT(self && "Unordered(Set|Map)_erase_key");\
+	CSTL_ASSERT(self->magic == self && "Unordered(Set|Map)_erase_key");\
+	pos = Name##_find_hash(self, key, Hasher(key));\
+	if (pos == Name##_end(self)) {\
+		return 0;\
+	}\
+	Name##_erase(self, pos);\
+	return 1;\
+}\
+\
+size_t Name##_count(Name *self, KeyType key)\
+{\
+	CSTL_ASSERT(self && "Unordered(Set|Map)_count");\
+	CSTL_ASSERT(self->magic == self && "Unordered(Set|Map)_count");\
+	return Name##_find_hash(self, key, Hasher(key)) != Name##_end(self);\
+}\
+\
+Name##Iterator Name##_find(Name *self, KeyType key)\
+{\
+	CSTL_ASSERT(self && "Unordered(Set|Map)_find");\
+	CSTL_ASSERT(self->magic == self && "Unordered(Set|Map)_find");\
+	return Name##_find_hash(self, key, Hasher(key));\
+}\
+\
+void Name##_equal_range(Name *self, KeyType key, Name##Iterator *first, Name##Iterator *last)\
+{\
+	CSTL_ASSERT(self && "Unordered(Set|Map)_equal_range");\
+	CSTL_ASSERT(self->magic == self && "Unordered(Set|Map)_equal_range");\
+	CSTL_ASSERT(first && "Unordered(Set|Map)_equal_range");\
+	CSTL_ASSERT(last && "Unordered(Set|Map)_equal_range");\
+	*first = Name##_find_hash(self, key, Hasher(key));\
+	*last = (*first == Name##_end(self)) ? *first : Name##_next(*first);\
+}\
+\
+void Name##_swap(Name *self, Name *x)\
+{\
+	Name tmp;\
+	CSTL_ASSERT(self && "Unordered(Set|Map)_swap");\
+	CSTL_ASSERT(x && "Unordered(Set|Map)_swap");\
+	CSTL_ASSERT(self->magic == self && "Unordered(Set|Map)_swap");\
+	CSTL_ASSERT(x->magic == x && "Unordered(Set|Map)_swap");\
+	tmp = *self;\
+	*self = *x;\
+	*x = tmp;\
+	CSTL_MAGIC(self->magic = self);\
+	CSTL_MAGIC(x->magic = x);\
+}\
+\
+size_t Name##_bucket_count(Name *self)\
+{\
+	CSTL_ASSERT(self && "Unordered(Set|Map)_bucket_count");\
+	CSTL_ASSERT(self->magic == self && "Unordered(Set|Map)_bucket_count");\
+	return self->capacity;\
+}\
+\
+size_t Name##_bucket_size(Name *self, size_t idx)\
+{\
+	CSTL_ASSERT(self && "Unordered(Set|Map)_bucket_size");\
+	CSTL_ASSERT(self->magic == self && "Unordered(Set|Map)_bucket_size");\
+	CSTL_ASSERT(idx < self->capacity && "Unordered(Set|Map)_bucket_size");\
+	return self->ctrl[idx] >= 0;\
+}\
+\
+size_t Name##_bucket(Name *self, KeyType key)\
+{\
+	Name##Iterator pos;\
+	size_t hash_val;\
+	signed char h2;\
+	CSTL_ASSERT(self && "Unordered(Set|Map)_bucket");\
+	CSTL_ASSERT(self->magic == self && "Unordered(Set|Map)_bucket");\
+	hash_val = Hasher(key);\
+	pos = Name##_find_hash(self, key, hash_val);\
+	if (pos != Name##_end(self)) {\
+		return (size_t) (pos - self->slots);\
+	}\
+	return Name##_group(self, hash_val, &h2) * CSTL_FLAT_GROUP;\
+}\
+\
+Name##LocalIterator Name##_bucket_begin(Name *self, size_t idx)\
+{\
+	CSTL_ASSERT(self && "Unordered(Set|Map)_bucket_begin");\
+	CSTL_ASSERT(self->magic == self && "Unordered(Set|Map)_bucket_begin");\
+	CSTL_ASSERT(idx < self->capacity && "Unordered(Set|Map)_bucket_begin");\
+	return self->ctrl[idx] >= 0 ? &self->slots[idx] : &self->slots[idx + 1];\
+}\
+\
+Name##LocalIterator Name##_bucket_end(Name *self, size_t idx)\
+{\
+	CSTL_ASSERT(self && "Unordered(Set|Map)_bucket_end");\
+	CSTL_ASSERT(self->magic == self && "Unordered(Set|Map)_bucket_end");\
+	CSTL_ASSERT(idx < self->capacity && "Unordered(Set|Map)_bucket_end");\
+	return &self->slots[idx + 1];\
+}\
+\
+Name##LocalIterator Name##_bucket_next(Name##LocalIterator pos)\
+{\
+	CSTL_ASSERT(pos && "Unordered(Set|Map)_bucket_next");\
+	CSTL_ASSERT(pos->used == 1 && "Unordered(Set|Map)_bucket_next");\
+	/* 1スロットに1要素なので次はbucket_end() */\
+	return pos + 1;\
+}\
+\
+float Name##_load_factor(Name *self)\
+{\
+	CSTL_ASSERT(self && "Unordered(Set|Map)_load_factor");\
+	CSTL_ASSERT(self->magic == self && "Unordered(Set|Map)_load_factor");\
+	return (float) self->size / (float) self->capacity;\
+}\
+\
+float Name##_get_max_load_factor(Name *self)\
+{\
+	CSTL_ASSERT(self && "Unordered(Set|Map)_get_max_load_factor");\
+	CSTL_ASSERT(self->magic == self && "Unordered(Set|Map)_get_max_load_factor");\
+	return self->max_load_factor;\
+}\
+\
+void Name##_set_max_load_factor(Name *self, float z)\
+{\
+	CSTL_ASSERT(self && "Unordered(Set|Map)_set_max_load_factor");\
+	CSTL_ASSERT(self->magic == self && "Unordered(Set|Map)_set_max_load_factor");\
+	if (z < Name##_minimum_mlf) {\
+		z = Name##_minimum_mlf;\
+	} else if (z > CSTL_FLAT_MAX_MLF) {\
+		z = CSTL_FLAT_MAX_MLF;\
+	}\
+	self->max_load_factor = z;\
+	self->limit = Name##_limit(self->capacity, z);\
+}\
+\
+int Name##_rehash(Name *self, size_t n)\
+{\
+	size_t m;\
+	CSTL_ASSERT(self && "Unordered(Set|Map)_rehash");\
+	CSTL_ASSERT(self->magic == self && "Unordered(Set|Map)_rehash");\
+	m = (size_t) (self->size / self->max_load_factor) + 1;\
+	return Name##_resize(self, n > m ? n : m);\
+}\
+\
+
+
+#endif /* CSTL_FLAT_HASHTABLE_H_INCLUDED */
@@ -36,18 +36,166 @@
 #define CSTL_HASHTABLE_H_INCLUDED
 
 #include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+#include <limits.h>
 #include "common.h"
 #include "vector.h"
+#include "node_pool.h"
 
 
 #define CSTL_EQUAL_TO(x, y)		((x) == (y) ? 0 : 1)
 
+/* 
+ * ハッシュの計算に使う符号なし整数型CSTL_HASH_WORDとそのビット数。
+ * long longのあるC99/C++11以降は64ビットで計算する。
+ * long longのないC89/C++98ではsize_tで計算し、文字列のハッシュはFNV-1aになる。
+ */
+#if defined(ULLONG_MAX) && ((defined(__STDC_VERSION__) && __STDC_VERSION__ >= 199901L) ||\
+	(defined(__cplusplus) && __cplusplus >= 201103L))
+#define CSTL_HASH_WORD	unsigned long long
+#define CSTL_HASH_WORD_BITS	64
+/* 文字列ハッシュ(wyhash系)の定数 */
+#define CSTL_HASH_P0	0xa0761d6478bd642fULL
+#define CSTL_HASH_P1	0xe7037ed1a0b428dbULL
+#define CSTL_HASH_P2	0x8ebc6af09c88c6e3ULL
+/* 2^64 / 黄金比。2のべき乗バケットでのフィボナッチハッシュに使用 */
+#define CSTL_HASH_FIBONACCI	0x9e3779b97f4a7c15ULL
+/* 64x64->128ビットの積の上位と下位のxorをrに入れる */
+#ifdef __SIZEOF_INT128__
+#define CSTL_HASH_MUM(a, b, r)	\
+	do {\
+		__extension__ unsigned __int128 m_ = __extension__ ((unsigned __int128) (a) * (b));\
+		(r) = (unsigned long long) (m_ >> 64) ^ (unsigned long long) m_;\
+	} while (0)
+#else
+#define CSTL_HASH_MUM(a, b, r)	\
+	do {\
+		unsigned long long ha_ = (a) >> 32, la_ = (a) & 0xffffffffULL;\
+		unsigned long long hb_ = (b) >> 32, lb_ = (b) & 0xffffffffULL;\
+		unsigned long long rh_ = ha_ * hb_, rm0_ = ha_ * lb_, rm1_ = hb_ * la_, rl_ = la_ * lb_;\
+		unsigned long long t_ = rl_ + (rm0_ << 32);\
+		unsigned long long lo_ = t_ + (rm1_ << 32);\
+		unsigned long long hi_ = rh_ + (rm0_ >> 32) + (rm1_ >> 32) + (t_ < rl_) + (lo_ < t_);\
+		(r) = hi_ ^ lo_;\
+	} while (0)
+#endif
+/* バイト列と整数のハッシュ関数 */
+#define CSTL_HASH_WORD_FUNCTIONS(Name)	\
+\
+static unsigned long long Name##_hash_mum(unsigned long long a, unsigned long long b)\
+{\
+	unsigned long long r;\
+	CSTL_HASH_MUM(a, b, r);\
+	return r;\
+}\
+\
+static unsigned long long Name##_hash_read8(const unsigned char *p)\
+{\
+	unsigned long long v;\
+	memcpy(&v, p, 8);\
+	return v;\
+}\
+\
+static unsigned long long Name##_hash_read4(const unsigned char *p)\
+{\
+	unsigned int v;\
+	memcpy(&v, p, 4);\
+	return v;\
+}\
+\
+/* 長さnのバイト列のハッシュ(wyhash系: 16バイトずつ乗算で混ぜる) */\
+static size_t Name##_hash_bytes(const void *data, size_t n)\
+{\
+	const unsigned char *p = (const unsigned char *) data;\
+	unsigned long long seed = CSTL_HASH_P0;\
+	unsigned long long a, b;\
+	if (n <= 16) {\
+		if (n >= 4) {\
+			size_t k = (n >> 3) << 2;\
+			a = (Name##_hash_read4(p) << 32) | Name##_hash_read4(p + k);\
+			b = (Name##_hash_read4(p + n - 4) << 32) | Name##_hash_read4(p + n - 4 - k);\
+		} else if (n > 0) {\
+			a = ((unsigned long long) p[0] << 16) | ((unsigned long long) p[n >> 1] << 8) | p[n - 1];\
+			b = 0;\
+		} else {\
+			a = b = 0;\
+		}\
+	} else {\
+		size_t i = n;\
+		while (i > 16) {\
+			seed = Name##_hash_mum(Name##_hash_read8(p) ^ CSTL_HASH_P1, Name##_hash_read8(p + 8) ^ seed);\
+			p += 16;\
+			i -= 16;\
+		}\
+		a = Name##_hash_read8(p + i - 16);\
+		b = Name##_hash_read8(p + i - 8);\
+	}\
+	return (size_t) Name##_hash_mum(CSTL_HASH_P1 ^ n, Name##_hash_mum(a ^ CSTL_HASH_P1, b ^ seed ^ CSTL_HASH_P2));\
+}\
+\
+/* \
+ * 整数のハッシュ(MurmurHash3のfmix64)。全ビットに拡散する。\
+ * Name##_hash_intなどは恒等写像のままなので、等間隔のキーや\
+ * 下位ビットの偏ったキーではHasherにこちらを使うこと\
+ */\
+size_t Name##_hash_mix(size_t n)\
+{\
+	unsigned long long x = n;\
+	x ^= x >> 33;\
+	x *= 0xff51afd7ed558ccdULL;\
+	x ^= x >> 33;\
+	x *= 0xc4ceb9fe1a85ec53ULL;\
+	x ^= x >> 33;\
+	return (size_t) x;\
+}\
 
-#define CSTL_HASHTABLE_INTERFACE(Name, KeyType, ValueType)	\
+#else
+#define CSTL_HASH_WORD	size_t
+#define CSTL_HASH_WORD_BITS	((int) (sizeof(size_t) * CHAR_BIT))
+/* 64ビットの定数はunsigned longに収まらない場合があるので、32ビットずつ組み立てる */
+#define CSTL_HASH_CONSTANT(hi, lo, lo32)	\
+	(sizeof(size_t) > 4 ? ((size_t) (hi) << 16 << 16 | (size_t) (lo)) : (size_t) (lo32))
+/* 2^(size_tのビット数) / 黄金比。2のべき乗バケットでのフィボナッチハッシュに使用 */
+#define CSTL_HASH_FIBONACCI	CSTL_HASH_CONSTANT(0x9e3779b9UL, 0x7f4a7c15UL, 0x9e3779b9UL)
+/* FNV-1aの初期値と素数 */
+#define CSTL_HASH_FNV_BASIS	CSTL_HASH_CONSTANT(0xcbf29ce4UL, 0x84222325UL, 0x811c9dc5UL)
+#define CSTL_HASH_FNV_PRIME	CSTL_HASH_CONSTANT(0x00000100UL, 0x000001b3UL, 0x01000193UL)
+/* バイト列と整数のハッシュ関数 */
+#define CSTL_HASH_WORD_FUNCTIONS(Name)	\
 \
-typedef struct Name Name;\
-typedef struct Name##Node *Name##Iterator;\
-typedef struct Name##Node *Name##LocalIterator;\
+/* 長さnのバイト列のハッシュ(FNV-1a) */\
+static size_t Name##_hash_bytes(const void *data, size_t n)\
+{\
+	const unsigned char *p = (const unsigned char *) data;\
+	size_t h = CSTL_HASH_FNV_BASIS;\
+	size_t i;\
+	for (i = 0; i < n; i++) {\
+		h = (h ^ p[i]) * CSTL_HASH_FNV_PRIME;\
+	}\
+	return h;\
+}\
+\
+/* \
+ * 整数のハッシュ。上位ビットを下位に混ぜてから黄金比を掛ける。\
+ * Name##_hash_intなどは恒等写像のままなので、等間隔のキーや\
+ * 下位ビットの偏ったキーではHasherにこちらを使うこと\
+ */\
+size_t Name##_hash_mix(size_t x)\
+{\
+	x ^= x >> (CSTL_HASH_WORD_BITS / 2);\
+	x *= CSTL_HASH_FIBONACCI;\
+	x ^= x >> (CSTL_HASH_WORD_BITS / 2);\
+	return x;\
+}\
+
+#endif /* CSTL_HASH_WORD */
+
+
+/* 
+ * ハッシュ関数群。hashtableとflat_hashtableで共有する
+ */
+#define CSTL_HASH_FUNCTIONS_INTERFACE(Name)	\
 size_t Name##_hash_string(register const char *str);\
 size_t Name##_hash_wstring(register const wchar_t *str);\
 size_t Name##_hash_char(char n);\
@@ -59,56 +207,22 @@ size_t Name##_hash_int(int n);\
 size_t Name##_hash_uint(unsigned int n);\
 size_t Name##_hash_long(long n);\
 size_t Name##_hash_ulong(unsigned long n);\
-Name *Name##_new(void);\
-Name *Name##_new_rehash(size_t n);\
-void Name##_delete(Name *self);\
-void Name##_clear(Name *self);\
-int Name##_empty(Name *self);\
-size_t Name##_size(Name *self);\
-int Name##_insert_range(Name *self, Name##Iterator first, Name##Iterator last);\
-Name##Iterator Name##_erase(Name *self, Name##Iterator pos);\
-Name##Iterator Name##_erase_range(Name *self, Name##Iterator first, Name##Iterator last);\
-size_t Name##_erase_key(Name *self, KeyType key);\
-size_t Name##_count(Name *self, KeyType key);\
-Name##Iterator Name##_find(Name *self, KeyType key);\
-void Name##_equal_range(Name *self, KeyType key, Name##Iterator *first, Name##Iterator *last);\
-Name##Iterator Name##_begin(Name *self);\
-Name##Iterator Name##_end(Name *self);\
-Name##Iterator Name##_next(Name##Iterator pos);\
-void Name##_swap(Name *self, Name *x);\
-size_t Name##_bucket_count(Name *self);\
-size_t Name##_bucket_size(Name *self, size_t idx);\
-size_t Name##_bucket(Name *self, KeyType key);\
-Name##LocalIterator Name##_bucket_begin(Name *self, size_t idx);\
-Name##LocalIterator Name##_bucket_end(Name *self, size_t idx);\
-Name##LocalIterator Name##_bucket_next(Name##LocalIterator pos);\
-float Name##_load_factor(Name *self);\
-float Name##_get_max_load_factor(Name *self);\
-void Name##_set_max_load_factor(Name *self, float z);\
-int Name##_rehash(Name *self, size_t n);\
+size_t Name##_hash_mix(size_t n);\
 \
 
 
-#define CSTL_HASHTABLE_IMPLEMENT(Name, KeyType, ValueType, Hasher, Compare)	\
+#define CSTL_HASH_FUNCTIONS_IMPLEMENT(Name)	\
+\
+CSTL_HASH_WORD_FUNCTIONS(Name)\
 \
 size_t Name##_hash_string(register const char *str)\
 {\
-	register int c;\
-	register int val = 0;\
-	while ((c = *str++) != '\0') {\
-		val = val * 997 + c;\
-	}\
-	return (size_t) (val + (val >> 5));\
+	return Name##_hash_bytes(str, strlen(str));\
 }\
 \
 size_t Name##_hash_wstring(register const wchar_t *str)\
 {\
-	register int c;\
-	register int val = 0;\
-	while ((c = *str++) != '\0') {\
-		val = val * 997 + c;\
-	}\
-	return (size_t) (val + (val >> 5));\
+	return Name##_hash_bytes(str, wcslen(str) * sizeof(wchar_t));\
 }\
 \
 size_t Name##_hash_char(char n)\
@@ -156,6 +270,51 @@ size_t Name##_hash_ulong(unsigned long n)\
     return (size_t) n;\
 }\
 \
+
+
+#define CSTL_HASHTABLE_INTERFACE(Name, KeyType, ValueType)	\
+\
+typedef struct Name Name;\
+typedef struct Name##Node *Name##Iterator;\
+typedef struct Name##Node *Name##LocalIterator;\
+CSTL_HASH_FUNCTIONS_INTERFACE(Name)\
+Name *Name##_new(void);\
+Name *Name##_new_rehash(size_t n);\
+void Name##_delete(Name *self);\
+void Name##_clear(Name *self);\
+int Name##_empty(Name *self);\
+size_t Name##_size(Name *self);\
+int Name##_insert_range(Name *self, Name##Iterator first, Name##Iterator last);\
+Name##Iterator Name##_erase(Name *self, Name##Iterator pos);\
+Name##Iterator Name##_erase_range(Name *self, Name##Iterator first, Name##Iterator last);\
+size_t Name##_erase_key(Name *self, KeyType key);\
+size_t Name##_count(Name *self, KeyType key);\
+Name##Iterator Name##_find(Name *self, KeyType key);\
+void Name##_equal_range(Name *self, KeyType key, Name##Iterator *first, Name##Iterator *last);\
+Name##Iterator Name##_begin(Name *self);\
+Name##Iterator Name##_end(Name *self);\
+Name##Iterator Name##_next(Name##Iterator pos);\
+void Name##_swap(Name *self, Name *x);\
+size_t Name##_bucket_count(Name *self);\
+size_t Name##_bucket_size(Name *self, size_t idx);\
+size_t Name##_bucket(Name *self, KeyType key);\
+Name##LocalIterator Name##_bucket_begin(Name *self, size_t idx);\
+Name##LocalIterator Name##_bucket_end(Name *self, size_t idx);\
+Name##LocalIterator Name##_bucket_next(Name##LocalIterator pos);\
+float Name##_load_factor(Name *self);\
+float Name##_get_max_load_factor(Name *self);\
+void Name##_set_max_load_factor(Name *self, float z);\
+int Name##_rehash(Name *self, size_t n);\
+Name *Name##_new_pow2(size_t n);\
+void Name##_set_incremental_rehash(Name *self, size_t step);\
+\
+
+
+#define CSTL_HASHTABLE_IMPLEMENT(Name, KeyType, ValueType, Hasher, Compare, Pooled, Allocator)	\
+\
+CSTL_HASH_FUNCTIONS_IMPLEMENT(Name)\
+CSTL_NODE_POOL_IMPLEMENT(Name, Name##Node, Allocator)\
+\
 static Name##Node *Name##Node_insert(Name##Node *list, Name##Node *node, Name##Node **bucket)\
 {\
 	node->bucket = bucket;\
@@ -166,27 +325,6 @@ static Name##Node *Name##Node_insert(Name##Node *list, Name##Node *node, Name##N
 	return node;\
 }\
 \
-static Name##Node *Name##Node_erase(Name##Node *list)\
-{\
-	Name##Node *tmp;\
-	if (!list) {\
-		return list;\
-	}\
-	tmp = list->next;\
-	CSTL_MAGIC(list->magic = 0);\
-	free(list);\
-	return tmp;\
-}\
-\
-static Name##Node *Name##Node_clear(Name##Node *list)\
-{\
-	register Name##Node *pos;\
-	for (pos = list; pos != 0;) {\
-		pos = Name##Node_erase(pos);\
-	}\
-	return pos;\
-}\
-\
 static size_t Name##Node_size(Name##Node *list)\
 {\
 	register size_t count = 0;\
@@ -198,8 +336,8 @@ static size_t Name##Node_size(Name##Node *list)\
 }\
 \
 CSTL_VECTOR_INTERFACE(Name##Node_Vector, Name##Node *)\
-CSTL_VECTOR_IMPLEMENT_BASE(Name##Node_Vector, Name##Node *)\
-CSTL_VECTOR_IMPLEMENT_RESERVE(Name##Node_Vector, Name##Node *)\
+CSTL_VECTOR_IMPLEMENT_BASE(Name##Node_Vector, Name##Node *, Allocator)\
+CSTL_VECTOR_IMPLEMENT_RESERVE(Name##Node_Vector, Name##Node *, Allocator)\
 CSTL_VECTOR_IMPLEMENT_MOVE_BACKWARD(Name##Node_Vector, Name##Node *)\
 CSTL_VECTOR_IMPLEMENT_INSERT_N_NO_DATA(Name##Node_Vector, Name##Node *)\
 CSTL_VECTOR_IMPLEMENT_SIZE(Name##Node_Vector, Name##Node *)\
@@ -253,10 +391,52 @@ struct Name {\
 	Name##Node_Vector *buckets;\
 	size_t size;\
 	float max_load_factor;\
+	int shift; /* 0: バケット数は素数で剰余を取る。それ以外: バケット数は2のべき乗でCSTL_HASH_WORD_BITS - log2(バケット数) */\
 	Name##Node end_node;\
+	/* 段階的再ハッシュ */\
+	size_t rehash_step; /* 1回の操作で移すバケット数。0なら一度に再ハッシュする */\
+	Name##Node_Vector *old_buckets; /* 移動中の旧バケット。移動中でなければ0 */\
+	int old_shift;\
+	size_t rehash_pos; /* 旧バケットのうち、これより前は移動済み */\
+	Name##Node rehash_node; /* 旧バケットの末尾の番兵。nextはここから新バケットへ続ける */\
+	Name##NodePool pool; /* Pooledの場合のノードの確保先 */\
 	CSTL_MAGIC(Name *magic;)\
 };\
 \
+/* ノードを確保する。Pooledならselfのノードプールから確保する */\
+static Name##Node *Name##_alloc_node(Name *self)\
+{\
+	if (Pooled) {\
+		return Name##NodePool_alloc(&self->pool);\
+	}\
+	return (Name##Node *) CSTL_ALLOCATE(Allocator, sizeof(Name##Node));\
+}\
+\
+static Name##Node *Name##Node_erase(Name *self, Name##Node *list)\
+{\
+	Name##Node *tmp;\
+	if (!list) {\
+		return list;\
+	}\
+	tmp = list->next;\
+	CSTL_MAGIC(list->magic = 0);\
+	if (Pooled) {\
+		Name##NodePool_free(&self->pool, list);\
+	} else {\
+		CSTL_DEALLOCATE(Allocator, list);\
+	}\
+	return tmp;\
+}\
+\
+static Name##Node *Name##Node_clear(Name *self, Name##Node *list)\
+{\
+	register Name##Node *pos;\
+	for (pos = list; pos != 0;) {\
+		pos = Name##Node_erase(self, pos);\
+	}\
+	return pos;\
+}\
+\
 static size_t Name##_next_prime(size_t n)\
 {\
 	register size_t i;\
@@ -268,21 +448,140 @@ static size_t Name##_next_prime(size_t n)\
 	return Name##_primes[Name##_PRIMES_SIZE - 1];\
 }\
 \
-Name *Name##_new(void)\
+/* n以上のバケット数。2のべき乗モードでは*shiftも更新する */\
+static size_t Name##_next_bucket_count(size_t n, int *shift)\
 {\
-	return Name##_new_rehash(0);\
+	size_t nbuckets;\
+	int bits;\
+	if (!*shift) {\
+		return Name##_next_prime(n);\
+	}\
+	for (nbuckets = 8, bits = 3; nbuckets < n && bits < 30; nbuckets <<= 1, bits++) {\
+		;\
+	}\
+	*shift = CSTL_HASH_WORD_BITS - bits;\
+	return nbuckets;\
 }\
 \
-Name *Name##_new_rehash(size_t n)\
+/* ハッシュ値をバケットの添字にする。2のべき乗モードではフィボナッチハッシュ(乗算と上位ビット) */\
+static size_t Name##_reduce(size_t hash_val, size_t nbuckets, int shift)\
+{\
+	if (shift) {\
+		return (size_t) (((CSTL_HASH_WORD) hash_val * CSTL_HASH_FIBONACCI) >> shift);\
+	}\
+	return hash_val % nbuckets;\
+}\
+\
+/* nodeをbucketsに入れる。unordered_multiset/unordered_multimapでは同じキーの隣に入れる */\
+static void Name##_place(Name##Node_Vector *buckets, Name##Node *node, size_t nbuckets, int shift);\
+\
+/* \
+ * slotから後ろで最初のノードを返す。\
+ * 旧バケットの末尾のrehash_node(nextが自分自身)からは新バケットの先頭へ続ける\
+ */\
+static Name##Node *Name##_scan(Name##Node **slot)\
+{\
+	Name##Node *node;\
+	while (!(node = *slot)) {\
+		slot++;\
+	}\
+	if (node->next == node) {\
+		return Name##_scan(node->bucket);\
+	}\
+	return node;\
+}\
+\
+/* 旧バケットidxのノードを全て新バケットへ移す */\
+static void Name##_migrate_bucket(Name *self, size_t idx)\
+{\
+	Name##Node **alias = Name##Node_Vector_at(self->old_buckets, idx);\
+	size_t nbuckets = Name##Node_Vector_size(self->buckets) - 1;\
+	while (*alias) {\
+		Name##Node *node = *alias;\
+		*alias = node->next;\
+		node->next = 0;\
+		Name##_place(self->buckets, node, nbuckets, self->shift);\
+	}\
+}\
+\
+static void Name##_rehash_finish(Name *self)\
+{\
+	size_t old_count;\
+	if (!self->old_buckets) {\
+		return;\
+	}\
+	old_count = Name##Node_Vector_size(self->old_buckets) - 1;\
+	for (; self->rehash_pos < old_count; self->rehash_pos++) {\
+		Name##_migrate_bucket(self, self->rehash_pos);\
+	}\
+	Name##Node_Vector_delete(self->old_buckets);\
+	self->old_buckets = 0;\
+}\
+\
+/* \
+ * 段階的再ハッシュを進める。\
+ * hash_valのキーが入っていた旧バケットを移し、さらに旧バケットを先頭から\
+ * rehash_step個(空のバケットは10倍まで)移す。\
+ * 旧バケットに新しいノードは入らないので、空の旧バケットは移動済みと同じ\
+ */\
+static void Name##_migrate(Name *self, size_t hash_val)\
+{\
+	size_t old_count = Name##Node_Vector_size(self->old_buckets) - 1;\
+	size_t n = self->rehash_step;\
+	size_t empty = self->rehash_step * 10;\
+	Name##_migrate_bucket(self, Name##_reduce(hash_val, old_count, self->old_shift));\
+	while (self->rehash_pos < old_count) {\
+		if (*Name##Node_Vector_at(self->old_buckets, self->rehash_pos)) {\
+			if (n == 0) break;\
+			Name##_migrate_bucket(self, self->rehash_pos);\
+			n--;\
+		} else if (empty-- == 0) {\
+			break;\
+		}\
+		self->rehash_pos++;\
+	}\
+	if (self->rehash_pos == old_count) {\
+		Name##Node_Vector_delete(self->old_buckets);\
+		self->old_buckets = 0;\
+	}\
+}\
+\
+/* ハッシュ値をバケットの添字にする。段階的再ハッシュ中は先に再ハッシュを進める */\
+static size_t Name##_index(Name *self, size_t hash_val)\
+{\
+	if (self->old_buckets) {\
+		Name##_migrate(self, hash_val);\
+	}\
+	return Name##_reduce(hash_val, Name##_bucket_count(self), self->shift);\
+}\
+\
+/* 段階的再ハッシュを始める。nbuckets個の空のバケットを新バケットにする */\
+static void Name##_rehash_start(Name *self, Name##Node_Vector *new_buckets, int shift)\
+{\
+	/* self->bucketsのオブジェクトはノードのmagicが指しているので入れ替えない */\
+	Name##Node_Vector_swap(self->buckets, new_buckets);\
+	self->old_buckets = new_buckets;\
+	self->old_shift = self->shift;\
+	self->shift = shift;\
+	self->rehash_pos = 0;\
+	*Name##Node_Vector_back(self->buckets) = &self->end_node;\
+	*Name##Node_Vector_back(self->old_buckets) = &self->rehash_node;\
+	self->rehash_node.next = &self->rehash_node;\
+	self->rehash_node.bucket = Name##Node_Vector_at(self->buckets, 0);\
+}\
+\
+static Name *Name##_new_buckets(size_t n, int pow2)\
 {\
 	size_t nbuckets;\
+	int shift = pow2;\
 	Name *self;\
-	self = (Name *) malloc(sizeof(Name));\
+	self = (Name *) CSTL_ALLOCATE(Allocator, sizeof(Name));\
 	if (!self) return 0;\
-	nbuckets = Name##_next_prime(n);\
+	nbuckets = Name##_next_bucket_count(n, &shift);\
+	self->shift = shift;\
 	self->buckets = Name##Node_Vector_new_reserve(nbuckets + 1); /* +1はend()の分 */\
 	if (!self->buckets) {\
-		free(self);\
+		CSTL_DEALLOCATE(Allocator, self);\
 		return 0;\
 	}\
 	Name##Node_Vector_resize(self->buckets, nbuckets + 1, 0);\
@@ -292,18 +591,39 @@ Name *Name##_new_rehash(size_t n)\
 	CSTL_MAGIC(self->end_node.magic = self->buckets);\
 	self->size = 0;\
 	self->max_load_factor = Name##_default_mlf;\
+	self->rehash_step = 0;\
+	self->old_buckets = 0;\
+	self->old_shift = 0;\
+	self->rehash_pos = 0;\
+	Name##NodePool_init(&self->pool);\
 	CSTL_MAGIC(self->magic = self);\
 	return self;\
 }\
 \
+Name *Name##_new(void)\
+{\
+	return Name##_new_buckets(0, 0);\
+}\
+\
+Name *Name##_new_rehash(size_t n)\
+{\
+	return Name##_new_buckets(n, 0);\
+}\
+\
+Name *Name##_new_pow2(size_t n)\
+{\
+	return Name##_new_buckets(n, 1);\
+}\
+\
 void Name##_delete(Name *self)\
 {\
 	if (!self) return;\
 	CSTL_ASSERT(self->magic == self && "Unordered(Set|Map)_delete");\
 	Name##_clear(self);\
+	CSTL_ASSERT(!self->old_buckets && "Unordered(Set|Map)_delete");\
 	Name##Node_Vector_delete(self->buckets);\
 	CSTL_MAGIC(self->magic = 0);\
-	free(self);\
+	CSTL_DEALLOCATE(Allocator, self);\
 }\
 \
 void Name##_clear(Name *self)\
@@ -312,6 +632,11 @@ void Name##_clear(Name *self)\
 	size_t bc;\
 	CSTL_ASSERT(self && "Unordered(Set|Map)_clear");\
 	CSTL_ASSERT(self->magic == self && "Unordered(Set|Map)_clear");\
+	Name##_rehash_finish(self);\
+	if (Pooled) {\
+		/* ノードはチャンクごとまとめて解放し、バケットは空にするだけ */\
+		Name##NodePool_clear(&self->pool);\
+	}\
 	if (self->size == 0) {\
 		return;\
 	}\
@@ -319,7 +644,11 @@ void Name##_clear(Name *self)\
 	for (i = 0; i < bc; i++) {\
 		Name##Node **alias;\
 		alias = Name##Node_Vector_at(self->buckets, i);\
-		*alias = Name##Node_clear(*alias);\
+		if (Pooled) {\
+			*alias = 0;\
+		} else {\
+			*alias = Name##Node_clear(self, *alias);\
+		}\
 	}\
 	self->size = 0;\
 }\
@@ -340,22 +669,15 @@ size_t Name##_size(Name *self)\
 \
 Name##Iterator Name##_begin(Name *self)\
 {\
-	register size_t i;\
 	CSTL_ASSERT(self && "Unordered(Set|Map)_begin");\
 	CSTL_ASSERT(self->magic == self && "Unordered(Set|Map)_begin");\
 	if (self->size == 0) {\
 		return Name##_end(self);\
 	}\
-	for (i = 0;; i++) {\
-		Name##Node **alias;\
-		alias = Name##Node_Vector_at(self->buckets, i);\
-		if (*alias) {\
-			return *alias;\
-		}\
+	if (self->old_buckets) {\
+		return Name##_scan(Name##Node_Vector_at(self->old_buckets, self->rehash_pos));\
 	}\
-	/* NOTREACHED */\
-	CSTL_ASSERT(0 && "Unordered(Set|Map)_begin");\
-	return 0;\
+	return Name##_scan(Name##Node_Vector_at(self->buckets, 0));\
 }\
 \
 Name##Iterator Name##_end(Name *self)\
@@ -367,21 +689,13 @@ Name##Iterator Name##_end(Name *self)\
 \
 Name##Iterator Name##_next(Name##Iterator pos)\
 {\
-	register size_t i;\
 	CSTL_ASSERT(pos && "Unordered(Set|Map)_next");\
 	CSTL_ASSERT(pos->magic && "Unordered(Set|Map)_next");\
 	CSTL_ASSERT(pos->bucket && "Unordered(Set|Map)_next"); /* pos != end() */\
 	if (pos->next) {\
 		return pos->next;\
 	}\
-	for (i = 1;; i++) {\
-		if (pos->bucket[i]) {\
-			return pos->bucket[i];\
-		}\
-	}\
-	/* NOTREACHED */\
-	CSTL_ASSERT(0 && "Unordered(Set|Map)_next");\
-	return 0;\
+	return Name##_scan(pos->bucket + 1);\
 }\
 \
 static Name##Iterator Name##_find_node(Name *self, KeyType key, size_t idx)\
@@ -402,7 +716,7 @@ Name##Iterator Name##_find(Name *self, KeyType key)\
 	size_t idx;\
 	CSTL_ASSERT(self && "Unordered(Set|Map)_find");\
 	CSTL_ASSERT(self->magic == self && "Unordered(Set|Map)_find");\
-	idx = Hasher(key) % Name##_bucket_count(self);\
+	idx = Name##_index(self, Hasher(key));\
 	return Name##_find_node(self, key, idx);\
 }\
 \
@@ -444,11 +758,41 @@ size_t Name##_count(Name *self, KeyType key)\
 	return count;\
 }\
 \
+/* 段階的再ハッシュの状態を入れ替え、rehash_nodeを指し直す */\
+static void Name##_swap_rehash(Name *self, Name *x)\
+{\
+	Name##Node_Vector *tmp_old_buckets = self->old_buckets;\
+	size_t tmp_step = self->rehash_step;\
+	size_t tmp_pos = self->rehash_pos;\
+	int tmp_old_shift = self->old_shift;\
+	Name *t[2];\
+	int i;\
+	self->old_buckets = x->old_buckets;\
+	self->rehash_step = x->rehash_step;\
+	self->rehash_pos = x->rehash_pos;\
+	self->old_shift = x->old_shift;\
+	x->old_buckets = tmp_old_buckets;\
+	x->rehash_step = tmp_step;\
+	x->rehash_pos = tmp_pos;\
+	x->old_shift = tmp_old_shift;\
+	t[0] = self;\
+	t[1] = x;\
+	for (i = 0; i < 2; i++) {\
+		if (t[i]->old_buckets) {\
+			*Name##Node_Vector_back(t[i]->old_buckets) = &t[i]->rehash_node;\
+			t[i]->rehash_node.next = &t[i]->rehash_node;\
+			t[i]->rehash_node.bucket = Name##Node_Vector_at(t[i]->buckets, 0);\
+		}\
+	}\
+}\
+\
 void Name##_swap(Name *self, Name *x)\
 {\
 	Name##Node_Vector *tmp_buckets;\
 	size_t tmp_size;\
 	float tmp_max_load_factor;\
+	int tmp_shift;\
+	Name##NodePool tmp_pool;\
 	CSTL_ASSERT(self && "Unordered(Set|Map)_swap");\
 	CSTL_ASSERT(x && "Unordered(Set|Map)_swap");\
 	CSTL_ASSERT(self->magic == self && "Unordered(Set|Map)_swap");\
@@ -456,12 +800,19 @@ void Name##_swap(Name *self, Name *x)\
 	tmp_buckets = self->buckets;\
 	tmp_size = self->size;\
 	tmp_max_load_factor = self->max_load_factor;\
+	tmp_shift = self->shift;\
 	self->buckets = x->buckets;\
 	self->size = x->size;\
 	self->max_load_factor = x->max_load_factor;\
+	self->shift = x->shift;\
 	x->buckets = tmp_buckets;\
 	x->size = tmp_size;\
 	x->max_load_factor = tmp_max_load_factor;\
+	x->shift = tmp_shift;\
+	tmp_pool = self->pool;\
+	self->pool = x->pool;\
+	x->pool = tmp_pool;\
+	Name##_swap_rehash(self, x);\
 	CSTL_ASSERT(*Name##Node_Vector_back(self->buckets) == &x->end_node && "Unordered(Set|Map)_swap");\
 	CSTL_ASSERT(*Name##Node_Vector_back(x->buckets) == &self->end_node && "Unordered(Set|Map)_swap");\
 	*Name##Node_Vector_back(self->buckets) = &self->end_node;\
@@ -484,6 +835,7 @@ size_t Name##_bucket_size(Name *self, size_t idx)\
 	CSTL_ASSERT(self && "Unordered(Set|Map)_bucket_size");\
 	CSTL_ASSERT(self->magic == self && "Unordered(Set|Map)_bucket_size");\
 	CSTL_ASSERT(idx < Name##_bucket_count(self) && "Unordered(Set|Map)_bucket_size");\
+	Name##_rehash_finish(self);\
 	return Name##Node_size(*Name##Node_Vector_at(self->buckets, idx));\
 }\
 \
@@ -491,7 +843,7 @@ size_t Name##_bucket(Name *self, KeyType key)\
 {\
 	CSTL_ASSERT(self && "Unordered(Set|Map)_bucket");\
 	CSTL_ASSERT(self->magic == self && "Unordered(Set|Map)_bucket");\
-	return Hasher(key) % Name##_bucket_count(self);\
+	return Name##_index(self, Hasher(key));\
 }\
 \
 Name##LocalIterator Name##_bucket_begin(Name *self, size_t idx)\
@@ -499,6 +851,7 @@ Name##LocalIterator Name##_bucket_begin(Name *self, size_t idx)\
 	CSTL_ASSERT(self && "Unordered(Set|Map)_bucket_begin");\
 	CSTL_ASSERT(self->magic == self && "Unordered(Set|Map)_bucket_begin");\
 	CSTL_ASSERT(idx < Name##_bucket_count(self) && "Unordered(Set|Map)_bucket_begin");\
+	Name##_rehash_finish(self);\
 	return *Name##Node_Vector_at(self->buckets, idx);\
 }\
 \
@@ -541,6 +894,16 @@ void Name##_set_max_load_factor(Name *self, float z)\
 	self->max_load_factor = (z < Name##_minimum_mlf) ? Name##_minimum_mlf : z;\
 }\
 \
+void Name##_set_incremental_rehash(Name *self, size_t step)\
+{\
+	CSTL_ASSERT(self && "Unordered(Set|Map)_set_incremental_rehash");\
+	CSTL_ASSERT(self->magic == self && "Unordered(Set|Map)_set_incremental_rehash");\
+	if (!step) {\
+		Name##_rehash_finish(self);\
+	}\
+	self->rehash_step = step;\
+}\
+\
 Name##Iterator Name##_erase(Name *self, Name##Iterator pos)\
 {\
 	Name##Node *ret;\
@@ -556,10 +919,10 @@ Name##Iterator Name##_erase(Name *self, Name##Iterator pos)\
 		;\
 	}\
 	if (prev) {\
-		prev->next = Name##Node_erase(pos);\
+		prev->next = Name##Node_erase(self, pos);\
 	} else {\
 		Name##Node **tmp = pos->bucket;\
-		*tmp = Name##Node_erase(pos);\
+		*tmp = Name##Node_erase(self, pos);\
 	}\
 	self->size--;\
 	return ret;\
@@ -601,15 +964,26 @@ size_t Name##_erase_key(Name *self, KeyType key)\
 
 
 #define CSTL_HASHTABLE_IMPLEMENT_REHASH(Name, KeyType, ValueType, Hasher, Compare)	\
+static void Name##_place(Name##Node_Vector *buckets, Name##Node *node, size_t nbuckets, int shift)\
+{\
+	Name##Node **alias;\
+	alias = Name##Node_Vector_at(buckets, Name##_reduce(Hasher(node->key), nbuckets, shift));\
+	*alias = Name##Node_insert(*alias, node, alias);\
+}\
+\
 int Name##_rehash(Name *self, size_t n)\
 {\
 	register Name##Node *node;\
 	size_t nbuckets;\
+	int shift;\
 	Name##Node_Vector *new_buckets;\
 	Name##Node *end_pos;\
 	CSTL_ASSERT(self && "Unordered(Set|Map)_rehash");\
 	CSTL_ASSERT(self->magic == self && "Unordered(Set|Map)_rehash");\
-	nbuckets = Name##_next_prime(n);\
+	/* 前の段階的再ハッシュが終わっていなければ終わらせる */\
+	Name##_rehash_finish(self);\
+	shift = self->shift;\
+	nbuckets = Name##_next_bucket_count(n, &shift);\
 	if (nbuckets <= Name##_bucket_count(self)) {\
 		return 1;\
 	}\
@@ -618,20 +992,20 @@ int Name##_rehash(Name *self, size_t n)\
 		return 0;\
 	}\
 	Name##Node_Vector_resize(new_buckets, nbuckets + 1, 0);\
+	if (self->rehash_step && self->size) {\
+		/* ノードは以降の操作で少しずつ移す */\
+		Name##_rehash_start(self, new_buckets, shift);\
+		return 1;\
+	}\
 \
 	end_pos = Name##_end(self);\
 	/* 各ノードに対して再ハッシュ */\
 	for (node = Name##_begin(self); node != end_pos;) {\
-		size_t idx;\
-		Name##Node **alias;\
 		Name##Node *tmp = Name##_next(node);\
 		/* nodeをリストから取り外す */\
 		*node->bucket = node->next;\
 		node->next = 0;\
-\
-		idx = Hasher(node->key) % nbuckets;\
-		alias = Name##Node_Vector_at(new_buckets, idx);\
-		*alias = Name##Node_insert(*alias, node, alias);\
+		Name##_place(new_buckets, node, nbuckets, shift);\
 		node = tmp;\
 	}\
 	/* end()を指すポインタ */\
@@ -640,21 +1014,47 @@ int Name##_rehash(Name *self, size_t n)\
 \
 	Name##Node_Vector_swap(self->buckets, new_buckets);\
 	Name##Node_Vector_delete(new_buckets);\
+	self->shift = shift;\
 	return 1;\
 }\
 \
 
 
 #define CSTL_HASHTABLE_IMPLEMENT_REHASH_MULTI(Name, KeyType, ValueType, Hasher, Compare)	\
+static void Name##_place(Name##Node_Vector *buckets, Name##Node *node, size_t nbuckets, int shift)\
+{\
+	register Name##Node *pos;\
+	register Name##Node *prev;\
+	Name##Node **alias;\
+	alias = Name##Node_Vector_at(buckets, Name##_reduce(Hasher(node->key), nbuckets, shift));\
+	/* 同じキーを並べるため、バケットの各要素のキーをチェック */\
+	for (pos = *alias, prev = 0; pos != 0; prev = pos, pos = pos->next) {\
+		if (Compare(node->key, pos->key) == 0) {\
+			pos = Name##Node_insert(pos, node, alias);\
+			if (prev) {\
+				prev->next = pos;\
+			} else {\
+				*alias = pos;\
+			}\
+			return;\
+		}\
+	}\
+	*alias = Name##Node_insert(*alias, node, alias);\
+}\
+\
 int Name##_rehash(Name *self, size_t n)\
 {\
 	register Name##Node *node;\
 	size_t nbuckets;\
+	int shift;\
 	Name##Node_Vector *new_buckets;\
 	Name##Node *end_pos;\
 	CSTL_ASSERT(self && "UnorderedMulti(Set|Map)_rehash");\
 	CSTL_ASSERT(self->magic == self && "UnorderedMulti(Set|Map)_rehash");\
-	nbuckets = Name##_next_prime(n);\
+	/* 前の段階的再ハッシュが終わっていなければ終わらせる */\
+	Name##_rehash_finish(self);\
+	shift = self->shift;\
+	nbuckets = Name##_next_bucket_count(n, &shift);\
 	if (nbuckets <= Name##_bucket_count(self)) {\
 		return 1;\
 	}\
@@ -663,35 +1063,20 @@ int Name##_rehash(Name *self, size_t n)\
 		return 0;\
 	}\
 	Name##Node_Vector_resize(new_buckets, nbuckets + 1, 0);\
+	if (self->rehash_step && self->size) {\
+		/* ノードは以降の操作で少しずつ移す */\
+		Name##_rehash_start(self, new_buckets, shift);\
+		return 1;\
+	}\
 \
 	end_pos = Name##_end(self);\
 	/* 各ノードに対して再ハッシュ */\
 	for (node = Name##_begin(self); node != end_pos;) {\
-		register Name##Node *pos;\
-		register Name##Node *prev;\
-		size_t idx;\
-		Name##Node **alias;\
 		Name##Node *tmp = Name##_next(node);\
 		/* nodeをリストから取り外す */\
 		*node->bucket = node->next;\
 		node->next = 0;\
-\
-		idx = Hasher(node->key) % nbuckets;\
-		alias = Name##Node_Vector_at(new_buckets, idx);\
-		/* 同じキーを並べるため、バケットの各要素のキーをチェック */\
-		for (pos = *alias, prev = 0; pos != 0; prev = pos, pos = pos->next) {\
-			if (Compare(node->key, pos->key) == 0) {\
-				pos = Name##Node_insert(pos, node, alias);\
-				if (prev) {\
-					prev->next = pos;\
-				} else {\
-					*alias = pos;\
-				}\
-				goto next;\
-			}\
-		}\
-		*alias = Name##Node_insert(*alias, node, alias);\
-next:\
+		Name##_place(new_buckets, node, nbuckets, shift);\
 		node = tmp;\
 	}\
 	/* end()を指すポインタ */\
@@ -700,8 +1085,10 @@ next:\
 \
 	Name##Node_Vector_swap(self->buckets, new_buckets);\
 	Name##Node_Vector_delete(new_buckets);\
+	self->shift = shift;\
 	return 1;\
 }\
 \
 
+
 #endif /* CSTL_HASHTABLE_H_INCLUDED */
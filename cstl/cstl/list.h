@@ -35,6 +35,7 @@
 
 #include <stdlib.h>
 #include "common.h"
+#include "node_pool.h"
 
 
 #if !defined(NDEBUG) && defined(CSTL_DEBUG)
@@ -106,6 +107,32 @@ CSTL_EXTERN_C_END()\
  * \param Type 要素の型
  */
 #define CSTL_LIST_IMPLEMENT(Name, Type)	\
+CSTL_COMMON_LIST_IMPLEMENT(Name, Type, 0, CSTL_DEFAULT_ALLOCATOR)\
+
+/*! 
+ * \brief ノードプールを使う実装マクロ
+ *
+ * CSTL_LIST_IMPLEMENT() と同じだが、ノードをコンテナごとのノードプールから確保する。
+ * ノードはチャンク単位でまとめて確保し、clear()/delete()でまとめて解放する。
+ * ノードはリストごとのプールに属するため、別のリストとの間でsplice()/merge()を行ってはならない。
+ * 
+ * \param Name コンテナ名
+ * \param Type 要素の型
+ */
+#define CSTL_LIST_IMPLEMENT_POOL(Name, Type)	\
+CSTL_COMMON_LIST_IMPLEMENT(Name, Type, 1, CSTL_DEFAULT_ALLOCATOR)\
+
+/*! 
+ * \brief アロケータを指定する実装マクロ
+ * 
+ * \param Name コンテナ名
+ * \param Type 要素の型
+ * \param Allocator アロケータ(CstlAllocator const *)の式
+ */
+#define CSTL_LIST_IMPLEMENT_ALLOCATOR(Name, Type, Allocator)	\
+CSTL_COMMON_LIST_IMPLEMENT(Name, Type, 0, Allocator)\
+
+#define CSTL_COMMON_LIST_IMPLEMENT(Name, Type, Pooled, Allocator)	\
 /*! \
  * \brief list構造体\
  */\
@@ -116,13 +143,48 @@ struct Name {\
 	CSTL_MAGIC(Name *magic;)\
 };\
 \
+CSTL_NODE_POOL_IMPLEMENT(Name, Name, Allocator)\
+\
+/*! \
+ * \brief Pooledの場合のリストの先頭\
+ *\
+ * selfはnodeを指す。poolはノードの確保先で、\
+ * insert_n()などで使う一時的なリストでは元のリストのownを指す\
+ */\
+typedef struct Name##Head {\
+	Name node;\
+	Name##NodePool *pool;\
+	Name##NodePool own;\
+} Name##Head;\
+\
+static Name##NodePool *Name##_pool(Name *self)\
+{\
+	return ((Name##Head *) self)->pool;\
+}\
+\
+/* selfに挿入する要素を一旦ためておく空のリストxを作る */\
+static void Name##_init_temp(Name##Head *x, Name *self)\
+{\
+	x->node.next = &x->node;\
+	x->node.prev = &x->node;\
+	CSTL_MAGIC(x->node.magic = &x->node);\
+	if (Pooled) {\
+		x->pool = Name##_pool(self);\
+	}\
+}\
+\
 Name *Name##_new(void)\
 {\
 	Name *self;\
-	self = (Name *) malloc(sizeof(Name));\
+	self = (Name *) CSTL_ALLOCATE(Allocator, Pooled ? sizeof(Name##Head) : sizeof(Name));\
 	if (!self) return 0;\
 	self->next = self;\
 	self->prev = self;\
+	if (Pooled) {\
+		Name##Head *h = (Name##Head *) self;\
+		h->pool = &h->own;\
+		Name##NodePool_init(&h->own);\
+	}\
 	CSTL_MAGIC(self->magic = self);\
 	return self;\
 }\
@@ -133,7 +195,7 @@ void Name##_delete(Name *self)\
 	CSTL_ASSERT(self->magic == self && "List_delete");\
 	Name##_clear(self);\
 	CSTL_MAGIC(self->magic = 0);\
-	free(self);\
+	CSTL_DEALLOCATE(Allocator, self);\
 }\
 \
 int Name##_push_back(Name *self, Type data)\
@@ -205,6 +267,13 @@ void Name##_clear(Name *self)\
 {\
 	CSTL_ASSERT(self && "List_clear");\
 	CSTL_ASSERT(self->magic == self && "List_clear");\
+	if (Pooled && Name##_pool(self) == &((Name##Head *) self)->own) {\
+		/* ノードはチャンクごとまとめて解放する */\
+		self->next = self;\
+		self->prev = self;\
+		Name##NodePool_clear(Name##_pool(self));\
+		return;\
+	}\
 	Name##_erase_range(self, CSTL_LIST_BEGIN(self), CSTL_LIST_END(self));\
 }\
 \
@@ -293,8 +362,11 @@ Name##Iterator Name##_insert_ref(Name *self, Name##Iterator pos, Type const *dat
 	CSTL_ASSERT(pos && "List_insert_ref");\
 	CSTL_ASSERT((pos->magic == CSTL_MAGIC_LIST(Name) || pos->magic == self) && "List_insert_ref");\
 	CSTL_ASSERT(data && "List_insert_ref");\
-	CSTL_UNUSED_PARAM(self);\
-	node = (Name *) malloc(sizeof(Name));\
+	if (Pooled) {\
+		node = Name##NodePool_alloc(Name##_pool(self));\
+	} else {\
+		node = (Name *) CSTL_ALLOCATE(Allocator, sizeof(Name));\
+	}\
 	if (!node) return 0;\
 	node->data = *data;\
 	node->next = pos;\
@@ -316,51 +388,47 @@ int Name##_insert_n(Name *self, Name##Iterator pos, size_t n, Type data)\
 \
 int Name##_insert_n_ref(Name *self, Name##Iterator pos, size_t n, Type const *data)\
 {\
-	Name x;\
+	Name##Head x;\
 	register size_t i;\
 	CSTL_ASSERT(self && "List_insert_n_ref");\
 	CSTL_ASSERT(self->magic == self && "List_insert_n_ref");\
 	CSTL_ASSERT(pos && "List_insert_n_ref");\
 	CSTL_ASSERT((pos->magic == CSTL_MAGIC_LIST(Name) || pos->magic == self) && "List_insert_n_ref");\
 	CSTL_ASSERT(data && "List_insert_n_ref");\
-	x.next = &x;\
-	x.prev = &x;\
-	CSTL_MAGIC(x.magic = &x);\
+	Name##_init_temp(&x, self);\
 	for (i = 0; i < n; i++) {\
-		if (!Name##_insert_ref(&x, CSTL_LIST_END(&x), data)) {\
-			Name##_clear(&x);\
+		if (!Name##_insert_ref(&x.node, CSTL_LIST_END(&x.node), data)) {\
+			Name##_clear(&x.node);\
 			return 0;\
 		}\
 	}\
-	Name##_splice(self, pos, &x, CSTL_LIST_BEGIN(&x), CSTL_LIST_END(&x));\
+	Name##_splice(self, pos, &x.node, CSTL_LIST_BEGIN(&x.node), CSTL_LIST_END(&x.node));\
 	return 1;\
 }\
 \
 int Name##_insert_array(Name *self, Name##Iterator pos, Type const *data, size_t n)\
 {\
-	Name x;\
+	Name##Head x;\
 	register size_t i;\
 	CSTL_ASSERT(self && "List_insert_array");\
 	CSTL_ASSERT(self->magic == self && "List_insert_array");\
 	CSTL_ASSERT(pos && "List_insert_array");\
 	CSTL_ASSERT((pos->magic == CSTL_MAGIC_LIST(Name) || pos->magic == self) && "List_insert_array");\
 	CSTL_ASSERT(data && "List_insert_array");\
-	x.next = &x;\
-	x.prev = &x;\
-	CSTL_MAGIC(x.magic = &x);\
+	Name##_init_temp(&x, self);\
 	for (i = 0; i < n; i++) {\
-		if (!Name##_insert_ref(&x, CSTL_LIST_END(&x), &data[i])) {\
-			Name##_clear(&x);\
+		if (!Name##_insert_ref(&x.node, CSTL_LIST_END(&x.node), &data[i])) {\
+			Name##_clear(&x.node);\
 			return 0;\
 		}\
 	}\
-	Name##_splice(self, pos, &x, CSTL_LIST_BEGIN(&x), CSTL_LIST_END(&x));\
+	Name##_splice(self, pos, &x.node, CSTL_LIST_BEGIN(&x.node), CSTL_LIST_END(&x.node));\
 	return 1;\
 }\
 \
 int Name##_insert_range(Name *self, Name##Iterator pos, Name##Iterator first, Name##Iterator last)\
 {\
-	Name x;\
+	Name##Head x;\
 	register Name##Iterator i;\
 	CSTL_ASSERT(self && "List_insert_range");\
 	CSTL_ASSERT(self->magic == self && "List_insert_range");\
@@ -370,17 +438,15 @@ int Name##_insert_range(Name *self, Name##Iterator pos, Name##Iterator first, Na
 	CSTL_ASSERT(last && "List_insert_range");\
 	CSTL_ASSERT(first->magic && "List_insert_range");\
 	CSTL_ASSERT(last->magic && "List_insert_range");\
-	x.next = &x;\
-	x.prev = &x;\
-	CSTL_MAGIC(x.magic = &x);\
+	Name##_init_temp(&x, self);\
 	for (i = first; i != last; i = i->next) {\
 		CSTL_ASSERT(i->magic && "List_insert_range");\
-		if (!Name##_insert_ref(&x, CSTL_LIST_END(&x), &i->data)) {\
-			Name##_clear(&x);\
+		if (!Name##_insert_ref(&x.node, CSTL_LIST_END(&x.node), &i->data)) {\
+			Name##_clear(&x.node);\
 			return 0;\
 		}\
 	}\
-	Name##_splice(self, pos, &x, CSTL_LIST_BEGIN(&x), CSTL_LIST_END(&x));\
+	Name##_splice(self, pos, &x.node, CSTL_LIST_BEGIN(&x.node), CSTL_LIST_END(&x.node));\
 	return 1;\
 }\
 \
@@ -393,12 +459,15 @@ Name##Iterator Name##_erase(Name *self, Name##Iterator pos)\
 	CSTL_ASSERT(pos != self && "List_erase");\
 	CSTL_ASSERT(pos->magic == CSTL_MAGIC_LIST(Name) && "List_erase");\
 	CSTL_ASSERT(!Name##_empty(self) && "List_erase");\
-	CSTL_UNUSED_PARAM(self);\
 	node = pos->next;\
 	pos->prev->next = pos->next;\
 	pos->next->prev = pos->prev;\
 	CSTL_MAGIC(pos->magic = 0);\
-	free(pos);\
+	if (Pooled) {\
+		Name##NodePool_free(Name##_pool(self), pos);\
+	} else {\
+		CSTL_DEALLOCATE(Allocator, pos);\
+	}\
 	return node;\
 }\
 \
@@ -431,17 +500,15 @@ int Name##_resize(Name *self, size_t n, Type data)\
 			Name##_erase(self, CSTL_LIST_RBEGIN(self));\
 		}\
 	} else {\
-		Name x;\
-		x.next = &x;\
-		x.prev = &x;\
-		CSTL_MAGIC(x.magic = &x);\
+		Name##Head x;\
+		Name##_init_temp(&x, self);\
 		for (i = 0; i < n - size; i++) {\
-			if (!Name##_insert_ref(&x, CSTL_LIST_END(&x), &data)) {\
-				Name##_clear(&x);\
+			if (!Name##_insert_ref(&x.node, CSTL_LIST_END(&x.node), &data)) {\
+				Name##_clear(&x.node);\
 				return 0;\
 			}\
 		}\
-		Name##_splice(self, CSTL_LIST_END(self), &x, CSTL_LIST_BEGIN(&x), CSTL_LIST_END(&x));\
+		Name##_splice(self, CSTL_LIST_END(self), &x.node, CSTL_LIST_BEGIN(&x.node), CSTL_LIST_END(&x.node));\
 	}\
 	return 1;\
 }\
@@ -464,6 +531,11 @@ void Name##_swap(Name *self, Name *x)\
 	self->prev = x->prev;\
 	x->next = tmp_next;\
 	x->prev = tmp_prev;\
+	if (Pooled) {\
+		Name##NodePool tmp_pool = *Name##_pool(self);\
+		*Name##_pool(self) = *Name##_pool(x);\
+		*Name##_pool(x) = tmp_pool;\
+	}\
 }\
 \
 void Name##_splice(Name *self, Name##Iterator pos, Name *x, Name##Iterator first, Name##Iterator last)\
@@ -479,6 +551,7 @@ void Name##_splice(Name *self, Name##Iterator pos, Name *x, Name##Iterator first
 	CSTL_ASSERT(last && "List_splice");\
 	CSTL_ASSERT((first->magic == CSTL_MAGIC_LIST(Name) || first->magic == x) && "List_splice");\
 	CSTL_ASSERT((last->magic == CSTL_MAGIC_LIST(Name) || last->magic == x) && "List_splice");\
+	CSTL_ASSERT((!Pooled || Name##_pool(self) == Name##_pool(x)) && "List_splice");\
 	CSTL_UNUSED_PARAM(self);\
 	CSTL_UNUSED_PARAM(x);\
 	if (first == last || pos == last) return;\
@@ -588,6 +661,7 @@ void Name##_merge(Name *self, Name *x, int (*comp)(const void *, const void *))\
 	CSTL_ASSERT(x && "List_merge");\
 	CSTL_ASSERT(x->magic == x && "List_merge");\
 	CSTL_ASSERT(comp && "List_merge");\
+	CSTL_ASSERT((!Pooled || Name##_pool(self) == Name##_pool(x)) && "List_merge");\
 	if (self == x || Name##_empty(x)) return;\
 	if (Name##_empty(self)) {\
 		Name##_splice(self, CSTL_LIST_END(self), x, CSTL_LIST_BEGIN(x), CSTL_LIST_END(x));\
@@ -38,7 +38,7 @@
 #include "rbtree.h"
 
 
-#define CSTL_COMMON_MAP_IMPLEMENT(Name, KeyType, ValueType, Compare)	\
+#define CSTL_COMMON_MAP_IMPLEMENT(Name, KeyType, ValueType, Compare, Pooled, Allocator)	\
 /*! \
  * \brief map赤黒木構造体\
  */\
@@ -52,12 +52,12 @@ struct Name##RBTree {\
 	CSTL_MAGIC(struct Name##RBTree *magic;)\
 };\
 \
-CSTL_RBTREE_WRAPPER_IMPLEMENT(Name, KeyType, ValueType, Compare)\
+CSTL_RBTREE_WRAPPER_IMPLEMENT(Name, KeyType, ValueType, Compare, Pooled, Allocator)\
 \
-static Name##RBTree *Name##RBTree_new_node(KeyType key, ValueType const *value, int color)\
+static Name##RBTree *Name##RBTree_new_node(Name *self, KeyType key, ValueType const *value, int color)\
 {\
 	Name##RBTree *node;\
-	node = (Name##RBTree *) malloc(sizeof(Name##RBTree));\
+	node = Name##_alloc_node(self);\
 	if (!node) return 0;\
 	node->key = key;\
 	node->value = *value;\
@@ -112,9 +112,38 @@ CSTL_EXTERN_C_END()\
  * \param Compare 要素の比較ルーチン
  */
 #define CSTL_MAP_IMPLEMENT(Name, KeyType, ValueType, Compare)	\
-\
-CSTL_COMMON_MAP_IMPLEMENT(Name, KeyType, ValueType, Compare)	\
-\
+CSTL_COMMON_MAP_IMPLEMENT(Name, KeyType, ValueType, Compare, 0, CSTL_DEFAULT_ALLOCATOR)\
+CSTL_MAP_IMPLEMENT_INSERT(Name, KeyType, ValueType, Compare)\
+
+/*! 
+ * \brief ノードプールを使う実装マクロ
+ *
+ * CSTL_MAP_IMPLEMENT() と同じだが、ノードをコンテナごとのノードプールから確保する。
+ * ノードはチャンク単位でまとめて確保し、clear()/delete()でまとめて解放する。
+ * 
+ * \param Name コンテナ名
+ * \param KeyType 要素のキーの型
+ * \param ValueType 要素の値の型
+ * \param Compare 要素の比較ルーチン
+ */
+#define CSTL_MAP_IMPLEMENT_POOL(Name, KeyType, ValueType, Compare)	\
+CSTL_COMMON_MAP_IMPLEMENT(Name, KeyType, ValueType, Compare, 1, CSTL_DEFAULT_ALLOCATOR)\
+CSTL_MAP_IMPLEMENT_INSERT(Name, KeyType, ValueType, Compare)\
+
+/*! 
+ * \brief アロケータを指定する実装マクロ
+ * 
+ * \param Name コンテナ名
+ * \param KeyType 要素のキーの型
+ * \param ValueType 要素の値の型
+ * \param Compare 要素の比較ルーチン
+ * \param Allocator アロケータ(CstlAllocator const *)の式
+ */
+#define CSTL_MAP_IMPLEMENT_ALLOCATOR(Name, KeyType, ValueType, Compare, Allocator)	\
+CSTL_COMMON_MAP_IMPLEMENT(Name, KeyType, ValueType, Compare, 0, Allocator)\
+CSTL_MAP_IMPLEMENT_INSERT(Name, KeyType, ValueType, Compare)\
+
+#define CSTL_MAP_IMPLEMENT_INSERT(Name, KeyType, ValueType, Compare)	\
 Name##Iterator Name##_insert(Name *self, KeyType key, ValueType value, int *success)\
 {\
 	CSTL_ASSERT(self && "Map_insert");\
@@ -130,7 +159,7 @@ Name##Iterator Name##_insert_ref(Name *self, KeyType key, ValueType const *value
 	CSTL_ASSERT(value && "Map_insert_ref");\
 	pos = Name##RBTree_find(self->tree, key);\
 	if (pos == Name##RBTree_end(self->tree)) {\
-		pos = Name##RBTree_new_node(key, value, Name##_COLOR_RED);\
+		pos = Name##RBTree_new_node(self, key, value, Name##_COLOR_RED);\
 		if (pos) {\
 			Name##RBTree_insert(self->tree, pos);\
 			if (success) *success = 1;\
@@ -160,11 +189,11 @@ int Name##_insert_range(Name *self, Name##Iterator first, Name##Iterator last)\
 	tmp = &head;\
 	for (pos = first; pos != last; pos = Name##_next(pos)) {\
 		if (Name##RBTree_find(self->tree, pos->key) == Name##RBTree_end(self->tree)) {\
-			tmp->right = Name##RBTree_new_node(pos->key, &pos->value, Name##_COLOR_RED);\
+			tmp->right = Name##RBTree_new_node(self, pos->key, &pos->value, Name##_COLOR_RED);\
 			if (!tmp->right) {\
 				for (pos = head.right; pos != 0; pos = tmp) {\
 					tmp = pos->right;\
-					free(pos);\
+					Name##_free_node(self, pos);\
 				}\
 				return 0;\
 			}\
@@ -189,7 +218,7 @@ ValueType *Name##_at(Name *self, KeyType key)\
 	pos = Name##RBTree_find(self->tree, key);\
 	if (pos == Name##RBTree_end(self->tree)) {\
 		/* 新しい要素の値にはnilの値を使用 */\
-		pos = Name##RBTree_new_node(key, &Name##RBTree_nil.value, Name##_COLOR_RED);\
+		pos = Name##RBTree_new_node(self, key, &Name##RBTree_nil.value, Name##_COLOR_RED);\
 		if (pos) {\
 			Name##RBTree_insert(self->tree, pos);\
 			self->size++;\
@@ -228,9 +257,38 @@ CSTL_EXTERN_C_END()\
  * \param Compare 要素の比較ルーチン
  */
 #define CSTL_MULTIMAP_IMPLEMENT(Name, KeyType, ValueType, Compare)	\
-\
-CSTL_COMMON_MAP_IMPLEMENT(Name, KeyType, ValueType, Compare)	\
-\
+CSTL_COMMON_MAP_IMPLEMENT(Name, KeyType, ValueType, Compare, 0, CSTL_DEFAULT_ALLOCATOR)\
+CSTL_MULTIMAP_IMPLEMENT_INSERT(Name, KeyType, ValueType, Compare)\
+
+/*! 
+ * \brief ノードプールを使う実装マクロ
+ *
+ * CSTL_MULTIMAP_IMPLEMENT() と同じだが、ノードをコンテナごとのノードプールから確保する。
+ * ノードはチャンク単位でまとめて確保し、clear()/delete()でまとめて解放する。
+ * 
+ * \param Name コンテナ名
+ * \param KeyType 要素のキーの型
+ * \param ValueType 要素の値の型
+ * \param Compare 要素の比較ルーチン
+ */
+#define CSTL_MULTIMAP_IMPLEMENT_POOL(Name, KeyType, ValueType, Compare)	\
+CSTL_COMMON_MAP_IMPLEMENT(Name, KeyType, ValueType, Compare, 1, CSTL_DEFAULT_ALLOCATOR)\
+CSTL_MULTIMAP_IMPLEMENT_INSERT(Name, KeyType, ValueType, Compare)\
+
+/*! 
+ * \brief アロケータを指定する実装マクロ
+ * 
+ * \param Name コンテナ名
+ * \param KeyType 要素のキーの型
+ * \param ValueType 要素の値の型
+ * \param Compare 要素の比較ルーチン
+ * \param Allocator アロケータ(CstlAllocator const *)の式
+ */
+#define CSTL_MULTIMAP_IMPLEMENT_ALLOCATOR(Name, KeyType, ValueType, Compare, Allocator)	\
+CSTL_COMMON_MAP_IMPLEMENT(Name, KeyType, ValueType, Compare, 0, Allocator)\
+CSTL_MULTIMAP_IMPLEMENT_INSERT(Name, KeyType, ValueType, Compare)\
+
+#define CSTL_MULTIMAP_IMPLEMENT_INSERT(Name, KeyType, ValueType, Compare)	\
 Name##Iterator Name##_insert(Name *self, KeyType key, ValueType value)\
 {\
 	CSTL_ASSERT(self && "MultiMap_insert");\
@@ -244,7 +302,7 @@ Name##Iterator Name##_insert_ref(Name *self, KeyType key, ValueType const *value
 	CSTL_ASSERT(self && "MultiMap_insert_ref");\
 	CSTL_ASSERT(self->magic == self && "MultiMap_insert_ref");\
 	CSTL_ASSERT(value && "MultiMap_insert_ref");\
-	pos = Name##RBTree_new_node(key, value, Name##_COLOR_RED);\
+	pos = Name##RBTree_new_node(self, key, value, Name##_COLOR_RED);\
 	if (pos) {\
 		Name##RBTree_insert(self->tree, pos);\
 		self->size++;\
@@ -267,11 +325,11 @@ int Name##_insert_range(Name *self, Name##Iterator first, Name##Iterator last)\
 	head.right = (Name##RBTree *) &Name##RBTree_nil;\
 	tmp = &head;\
 	for (pos = first; pos != last; pos = Name##_next(pos)) {\
-		tmp->right = Name##RBTree_new_node(pos->key, &pos->value, Name##_COLOR_RED);\
+		tmp->right = Name##RBTree_new_node(self, pos->key, &pos->value, Name##_COLOR_RED);\
 		if (!tmp->right) {\
 			for (pos = head.right; pos != 0; pos = tmp) {\
 				tmp = pos->right;\
-				free(pos);\
+				Name##_free_node(self, pos);\
 			}\
 			return 0;\
 		}\
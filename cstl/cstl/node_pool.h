@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2006-2010, KATO Noriaki
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/*!
+ * \file node_pool.h
+ * \brief ノード用のスラブアロケータ(list/set/map/unordered_set/unordered_map共通部)
+ *
+ * 同じ大きさのノードをチャンク単位でまとめて確保し、解放されたノードは
+ * ノード自身の先頭をリンクにした空きリストにつなぐ。
+ * チャンクはコンテナのclear/deleteでまとめて解放する。
+ *
+ * このファイルを直接インクルードしないこと
+ */
+#ifndef CSTL_NODE_POOL_H_INCLUDED
+#define CSTL_NODE_POOL_H_INCLUDED
+
+#include <stdlib.h>
+#include "common.h"
+
+/* 最初のチャンクのスロット数。チャンクを確保するたびに倍にする */
+#define CSTL_NODE_POOL_MIN_CHUNK	16
+/* チャンクのスロット数の上限 */
+#define CSTL_NODE_POOL_MAX_CHUNK	4096
+
+
+#define CSTL_NODE_POOL_IMPLEMENT(Name, NodeType, Allocator)	\
+\
+/*! \
+ * \brief ノードプール構造体\
+ *\
+ * チャンクはNodeTypeの配列で、先頭のスロットは次のチャンクへのリンクに使う\
+ */\
+typedef struct Name##NodePool {\
+	NodeType *free_list;\
+	NodeType *chunks;\
+	NodeType *cur;\
+	NodeType *end;\
+	size_t chunk_size;\
+} Name##NodePool;\
+\
+static void Name##NodePool_init(Name##NodePool *self)\
+{\
+	self->free_list = 0;\
+	self->chunks = 0;\
+	self->cur = 0;\
+	self->end = 0;\
+	self->chunk_size = CSTL_NODE_POOL_MIN_CHUNK;\
+}\
+\
+static NodeType *Name##NodePool_alloc(Name##NodePool *self)\
+{\
+	NodeType *node;\
+	NodeType *chunk;\
+	if (self->free_list) {\
+		node = self->free_list;\
+		self->free_list = *(NodeType **) node;\
+		return node;\
+	}\
+	if (self->cur == self->end) {\
+		chunk = (NodeType *) CSTL_ALLOCATE(Allocator, sizeof(NodeType) * self->chunk_size);\
+		if (!chunk) return 0;\
+		*(NodeType **) chunk = self->chunks;\
+		self->chunks = chunk;\
+		self->cur = chunk + 1;\
+		self->end = chunk + self->chunk_size;\
+		if (self->chunk_size < CSTL_NODE_POOL_MAX_CHUNK) {\
+			self->chunk_size *= 2;\
+		}\
+	}\
+	return self->cur++;\
+}\
+\
+static void Name##NodePool_free(Name##NodePool *self, NodeType *node)\
+{\
+	*(NodeType **) node = self->free_list;\
+	self->free_list = node;\
+}\
+\
+/* 全てのチャンクを解放する。確保したノードは全て無効になる */\
+static void Name##NodePool_clear(Name##NodePool *self)\
+{\
+	NodeType *chunk;\
+	while (self->chunks) {\
+		chunk = self->chunks;\
+		self->chunks = *(NodeType **) chunk;\
+		CSTL_DEALLOCATE(Allocator, chunk);\
+	}\
+	Name##NodePool_init(self);\
+}\
+\
+
+
+#endif /* CSTL_NODE_POOL_H_INCLUDED */
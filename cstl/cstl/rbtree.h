@@ -37,6 +37,7 @@
 
 #include <stdlib.h>
 #include "common.h"
+#include "node_pool.h"
 
 
 #define CSTL_LESS(x, y)		((x) == (y) ? 0 : (x) < (y) ? -1 : 1)
@@ -48,7 +49,7 @@
 #define CSTL_RBTREE_IS_NIL(node, Name)		((node) == (Name##RBTree *) &Name##RBTree_nil)
 
 
-#define CSTL_RBTREE_IMPLEMENT(Name, KeyType, ValueType, Compare)	\
+#define CSTL_RBTREE_IMPLEMENT(Name, KeyType, ValueType, Compare, Allocator)	\
 \
 /*! \
  * \brief 赤黒木の色\
@@ -135,7 +136,7 @@ static void Name##RBTree_set_root(Name##RBTree *self, Name##RBTree *t)\
 static Name##RBTree *Name##RBTree_new(void)\
 {\
 	Name##RBTree *self;\
-	self = (Name##RBTree *) malloc(sizeof(Name##RBTree));\
+	self = (Name##RBTree *) CSTL_ALLOCATE(Allocator, sizeof(Name##RBTree));\
 	if (!self) return 0;\
 	self->left = (Name##RBTree *) &Name##RBTree_nil;\
 	self->right = (Name##RBTree *) &Name##RBTree_nil;\
@@ -168,7 +169,7 @@ static void Name##RBTree_clear(Name##RBTree *self)\
 		}\
 		tmp = t->parent;\
 		CSTL_MAGIC(t->magic = 0);\
-		free(t);\
+		CSTL_DEALLOCATE(Allocator, t);\
 		t = tmp;\
 		if (CSTL_RBTREE_IS_HEAD(t, Name)) break;\
 	}\
@@ -179,7 +180,7 @@ static void Name##RBTree_delete(Name##RBTree *self)\
 	CSTL_ASSERT(CSTL_RBTREE_IS_HEAD(self, Name) && "RBTree_delete");\
 	Name##RBTree_clear(self);\
 	CSTL_MAGIC(self->magic = 0);\
-	free(self);\
+	CSTL_DEALLOCATE(Allocator, self);\
 }\
 \
 static int Name##RBTree_empty(Name##RBTree *self)\
@@ -625,7 +626,6 @@ static void Name##RBTree_erase(Name##RBTree *self, Name##Iterator pos)\
 	}\
 end:\
 	CSTL_MAGIC(n->magic = 0);\
-	free(n);\
 }\
 \
 static Name##Iterator Name##RBTree_begin(Name##RBTree *self)\
@@ -739,31 +739,52 @@ Name##Iterator Name##_prev(Name##Iterator pos);\
 void Name##_swap(Name *self, Name *x);\
 
 
-#define CSTL_RBTREE_WRAPPER_IMPLEMENT(Name, KeyType, ValueType, Compare)	\
+#define CSTL_RBTREE_WRAPPER_IMPLEMENT(Name, KeyType, ValueType, Compare, Pooled, Allocator)	\
 \
 typedef struct Name##RBTree Name##RBTree;\
+CSTL_NODE_POOL_IMPLEMENT(Name, Name##RBTree, Allocator)\
 /*! \
  * \brief set/map構造体\
  */\
 struct Name {\
 	Name##RBTree *tree;\
 	size_t size;\
+	Name##NodePool pool; /* Pooledの場合のノードの確保先 */\
 	CSTL_MAGIC(Name *magic;)\
 };\
 \
-CSTL_RBTREE_IMPLEMENT(Name, KeyType, ValueType, Compare)\
+CSTL_RBTREE_IMPLEMENT(Name, KeyType, ValueType, Compare, Allocator)\
+\
+/* ノードを確保する。Pooledならselfのノードプールから確保する */\
+static Name##RBTree *Name##_alloc_node(Name *self)\
+{\
+	if (Pooled) {\
+		return Name##NodePool_alloc(&self->pool);\
+	}\
+	return (Name##RBTree *) CSTL_ALLOCATE(Allocator, sizeof(Name##RBTree));\
+}\
+\
+static void Name##_free_node(Name *self, Name##RBTree *node)\
+{\
+	if (Pooled) {\
+		Name##NodePool_free(&self->pool, node);\
+	} else {\
+		CSTL_DEALLOCATE(Allocator, node);\
+	}\
+}\
 \
 Name *Name##_new(void)\
 {\
 	Name *self;\
-	self = (Name *) malloc(sizeof(Name));\
+	self = (Name *) CSTL_ALLOCATE(Allocator, sizeof(Name));\
 	if (!self) return 0;\
 	self->tree = Name##RBTree_new();\
 	if (!self->tree) {\
-		free(self);\
+		CSTL_DEALLOCATE(Allocator, self);\
 		return 0;\
 	}\
 	self->size = 0;\
+	Name##NodePool_init(&self->pool);\
 	CSTL_MAGIC(self->magic = self);\
 	return self;\
 }\
@@ -772,16 +793,23 @@ void Name##_delete(Name *self)\
 {\
 	if (!self) return;\
 	CSTL_ASSERT(self->magic == self && "(Set|Map)_delete");\
+	Name##_clear(self);\
 	Name##RBTree_delete(self->tree);\
 	CSTL_MAGIC(self->magic = 0);\
-	free(self);\
+	CSTL_DEALLOCATE(Allocator, self);\
 }\
 \
 void Name##_clear(Name *self)\
 {\
 	CSTL_ASSERT(self && "(Set|Map)_clear");\
 	CSTL_ASSERT(self->magic == self && "(Set|Map)_clear");\
-	Name##RBTree_clear(self->tree);\
+	if (Pooled) {\
+		/* ノードはチャンクごとまとめて解放する */\
+		Name##RBTree_set_root(self->tree, (Name##RBTree *) &Name##RBTree_nil);\
+		Name##NodePool_clear(&self->pool);\
+	} else {\
+		Name##RBTree_clear(self->tree);\
+	}\
 	self->size = 0;\
 }\
 \
@@ -809,6 +837,7 @@ Name##Iterator Name##_erase(Name *self, Name##Iterator pos)\
 	CSTL_ASSERT(pos->magic == self->tree && "(Set|Map)_erase");\
 	tmp = Name##_next(pos);\
 	Name##RBTree_erase(self->tree, pos);\
+	Name##_free_node(self, pos);\
 	self->size--;\
 	return tmp;\
 }\
@@ -931,6 +960,7 @@ void Name##_swap(Name *self, Name *x)\
 {\
 	Name##RBTree *tmp_tree;\
 	size_t tmp_size;\
+	Name##NodePool tmp_pool;\
 	CSTL_ASSERT(self && "(Set|Map)_swap");\
 	CSTL_ASSERT(x && "(Set|Map)_swap");\
 	CSTL_ASSERT(self->magic == self && "(Set|Map)_swap");\
@@ -941,6 +971,9 @@ void Name##_swap(Name *self, Name *x)\
 	self->size = x->size;\
 	x->tree = tmp_tree;\
 	x->size = tmp_size;\
+	tmp_pool = self->pool;\
+	self->pool = x->pool;\
+	x->pool = tmp_pool;\
 }\
 \
 
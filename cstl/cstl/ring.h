@@ -99,7 +99,7 @@ void Name##_swap(Name *self, Name *x);\
 CSTL_EXTERN_C_END()\
 
 
-#define CSTL_RING_IMPLEMENT_FOR_DEQUE(Name, Type)	\
+#define CSTL_RING_IMPLEMENT_FOR_DEQUE(Name, Type, Allocator)	\
 \
 Name *Name##_new(size_t n)\
 {\
@@ -107,11 +107,11 @@ Name *Name##_new(size_t n)\
 	Type *buf;\
 	/* NOTE: nは必ず2の冪乗でなければならない */\
 	CSTL_ASSERT(n > 0 && (n & (n - 1)) == 0 && "Ring_new");\
-	self = (Name *) malloc(sizeof(Name));\
+	self = (Name *) CSTL_ALLOCATE(Allocator, sizeof(Name));\
 	if (!self) return 0;\
-	buf = (Type *) malloc(sizeof(Type) * n);\
+	buf = (Type *) CSTL_ALLOCATE(Allocator, sizeof(Type) * n);\
 	if (!buf) {\
-		free(self);\
+		CSTL_DEALLOCATE(Allocator, self);\
 		return 0;\
 	}\
 	Name##_init(self, buf, n);\
@@ -123,8 +123,8 @@ void Name##_delete(Name *self)\
 	if (!self) return;\
 	CSTL_ASSERT(self->magic == self && "Ring_delete");\
 	CSTL_MAGIC(self->magic = 0);\
-	free(self->buf);\
-	free(self);\
+	CSTL_DEALLOCATE(Allocator, self->buf);\
+	CSTL_DEALLOCATE(Allocator, self);\
 }\
 \
 void Name##_init(Name *self, Type *buf, size_t n)\
@@ -231,8 +231,18 @@ void Name##_erase(Name *self, size_t idx, size_t n)\
  * \param Type 要素の型
  */
 #define CSTL_RING_IMPLEMENT(Name, Type)	\
+CSTL_RING_IMPLEMENT_ALLOCATOR(Name, Type, CSTL_DEFAULT_ALLOCATOR)\
+
+/*! 
+ * \brief アロケータを指定する実装マクロ
+ * 
+ * \param Name コンテナ名
+ * \param Type 要素の型
+ * \param Allocator アロケータ(CstlAllocator const *)の式
+ */
+#define CSTL_RING_IMPLEMENT_ALLOCATOR(Name, Type, Allocator)	\
 \
-CSTL_RING_IMPLEMENT_FOR_DEQUE(Name, Type)\
+CSTL_RING_IMPLEMENT_FOR_DEQUE(Name, Type, Allocator)\
 \
 int Name##_push_back(Name *self, Type data)\
 {\
@@ -0,0 +1,826 @@
+/*
+ * Copyright (c) 2006-2010, KATO Noriaki
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/*!
+ * \file rope.h
+ * \brief ropeコンテナ
+ *
+ * 文字列を最大CSTL_ROPE_CHUNK_SIZE(Type)文字のチャンクに分け、チャンクを位置順に並べたAVL木で持つ。
+ * 各ノードが1個のチャンクを持ち、部分木の文字数で位置からチャンクを探す。
+ * 挿入・削除はチャンクの中で済めばその場で詰め直し、済まなければ木を位置で分割・連結する。
+ * 連結の継ぎ目で隣り合うチャンクが1個に収まる場合はまとめ、細かいチャンクが増えないようにする。
+ */
+#ifndef CSTL_ROPE_H_INCLUDED
+#define CSTL_ROPE_H_INCLUDED
+
+#include <stdlib.h>
+#include <string.h>
+#include "common.h"
+
+
+/* チャンクの大きさの目安(バイト) */
+#define CSTL_ROPE_CHUNK_BYTES	1024
+/* 1個のチャンクに入る文字数 */
+#define CSTL_ROPE_CHUNK_SIZE(Type)	\
+	(CSTL_ROPE_CHUNK_BYTES / sizeof(Type) > 16 ? CSTL_ROPE_CHUNK_BYTES / sizeof(Type) : 16)
+
+#define CSTL_ROPE_SIZE(t)	((t) ? (t)->size : 0)
+#define CSTL_ROPE_HEIGHT(t)	((t) ? (t)->height : 0)
+
+
+/*!
+ * \brief インターフェイスマクロ
+ *
+ * \param Name コンテナ名
+ * \param Type 要素の型
+ */
+#define CSTL_ROPE_INTERFACE(Name, Type)	\
+typedef struct Name Name;\
+/*! \
+ * \brief イテレータ。1個のチャンクを指す\
+ */\
+typedef struct Name##RopeNode *Name##Iterator;\
+\
+CSTL_EXTERN_C_BEGIN()\
+Name *Name##_new(void);\
+Name *Name##_new_assign_len(const Type *chars, size_t chars_len);\
+void Name##_delete(Name *self);\
+void Name##_clear(Name *self);\
+size_t Name##_size(Name *self);\
+int Name##_empty(Name *self);\
+Type *Name##_at(Name *self, size_t idx);\
+size_t Name##_copy(Name *self, size_t idx, size_t len, Type *buf);\
+Name *Name##_append_len(Name *self, const Type *chars, size_t chars_len);\
+Name *Name##_push_back(Name *self, Type c);\
+Name *Name##_insert_len(Name *self, size_t idx, const Type *chars, size_t chars_len);\
+Name *Name##_erase(Name *self, size_t idx, size_t len);\
+Name *Name##_substr(Name *self, size_t idx, size_t len);\
+Name *Name##_split(Name *self, size_t idx);\
+void Name##_concat(Name *self, Name *x);\
+void Name##_swap(Name *self, Name *x);\
+Name##Iterator Name##_begin(Name *self);\
+Name##Iterator Name##_end(Name *self);\
+Name##Iterator Name##_rbegin(Name *self);\
+Name##Iterator Name##_rend(Name *self);\
+Name##Iterator Name##_next(Name##Iterator pos);\
+Name##Iterator Name##_prev(Name##Iterator pos);\
+Name##Iterator Name##_chunk_find(Name *self, size_t idx, size_t *offset);\
+const Type *Name##_chunk_data(Name##Iterator pos);\
+size_t Name##_chunk_size(Name##Iterator pos);\
+CSTL_EXTERN_C_END()\
+
+
+/*!
+ * \brief 実装マクロ
+ *
+ * \param Name コンテナ名
+ * \param Type 要素の型
+ */
+#define CSTL_ROPE_IMPLEMENT(Name, Type)	\
+CSTL_ROPE_IMPLEMENT_ALLOCATOR(Name, Type, CSTL_DEFAULT_ALLOCATOR)\
+
+/*!
+ * \brief アロケータを指定する実装マクロ
+ *
+ * \param Name コンテナ名
+ * \param Type 要素の型
+ * \param Allocator アロケータ(CstlAllocator const *)の式
+ */
+#define CSTL_ROPE_IMPLEMENT_ALLOCATOR(Name, Type, Allocator)	\
+\
+typedef struct Name##RopeNode Name##RopeNode;\
+\
+enum {\
+	Name##_CHUNK_MAX = CSTL_ROPE_CHUNK_SIZE(Type)\
+};\
+\
+/*! \
+ * \brief ノード構造体\
+ *\
+ * leftの部分木の文字、chars、rightの部分木の文字の順に並ぶ\
+ */\
+struct Name##RopeNode {\
+	Name##RopeNode *left;\
+	Name##RopeNode *right;\
+	Name##RopeNode *parent; /* 根ならばNULL */\
+	size_t size; /* 部分木の文字数 */\
+	size_t len; /* charsの文字数。1以上 */\
+	int height;\
+	Type chars[Name##_CHUNK_MAX];\
+};\
+\
+/*! \
+ * \brief rope構造体\
+ */\
+struct Name {\
+	Name##RopeNode *root; /* 空ならばNULL */\
+	CSTL_MAGIC(Name *magic;)\
+};\
+\
+/* 子が変わったtの高さと文字数を計算し直し、子の親をtにする */\
+static void Name##Rope_update(Name##RopeNode *t)\
+{\
+	int hl = CSTL_ROPE_HEIGHT(t->left);\
+	int hr = CSTL_ROPE_HEIGHT(t->right);\
+	t->height = (hl > hr ? hl : hr) + 1;\
+	t->size = CSTL_ROPE_SIZE(t->left) + t->len + CSTL_ROPE_SIZE(t->right);\
+	if (t->left) t->left->parent = t;\
+	if (t->right) t->right->parent = t;\
+}\
+\
+static Name##RopeNode *Name##Rope_rotate_left(Name##RopeNode *t)\
+{\
+	Name##RopeNode *r = t->right;\
+	t->right = r->left;\
+	Name##Rope_update(t);\
+	r->left = t;\
+	Name##Rope_update(r);\
+	return r;\
+}\
+\
+static Name##RopeNode *Name##Rope_rotate_right(Name##RopeNode *t)\
+{\
+	Name##RopeNode *l = t->left;\
+	t->left = l->right;\
+	Name##Rope_update(t);\
+	l->right = t;\
+	Name##Rope_update(l);\
+	return l;\
+}\
+\
+/* 左右の高さの差が2以内のtを回転で釣り合わせ、新しい部分木の根を返す */\
+static Name##RopeNode *Name##Rope_balance(Name##RopeNode *t)\
+{\
+	int d;\
+	Name##Rope_update(t);\
+	d = CSTL_ROPE_HEIGHT(t->left) - CSTL_ROPE_HEIGHT(t->right);\
+	if (d > 1) {\
+		if (CSTL_ROPE_HEIGHT(t->left->left) < CSTL_ROPE_HEIGHT(t->left->right)) {\
+			t->left = Name##Rope_rotate_left(t->left);\
+		}\
+		return Name##Rope_rotate_right(t);\
+	}\
+	if (d < -1) {\
+		if (CSTL_ROPE_HEIGHT(t->right->right) < CSTL_ROPE_HEIGHT(t->right->left)) {\
+			t->right = Name##Rope_rotate_right(t->right);\
+		}\
+		return Name##Rope_rotate_left(t);\
+	}\
+	return t;\
+}\
+\
+/* l, m, rの順に並べた木を返す。mは1個のノードで、その子は無視する */\
+static Name##RopeNode *Name##Rope_join(Name##RopeNode *l, Name##RopeNode *m, Name##RopeNode *r)\
+{\
+	int hl = CSTL_ROPE_HEIGHT(l);\
+	int hr = CSTL_ROPE_HEIGHT(r);\
+	if (hl > hr + 1) {\
+		l->right = Name##Rope_join(l->right, m, r);\
+		return Name##Rope_balance(l);\
+	}\
+	if (hr > hl + 1) {\
+		r->left = Name##Rope_join(l, m, r->left);\
+		return Name##Rope_balance(r);\
+	}\
+	m->left = l;\
+	m->right = r;\
+	Name##Rope_update(m);\
+	return m;\
+}\
+\
+/* tから先頭のノードを外して*firstに格納し、残りの木を返す */\
+static Name##RopeNode *Name##Rope_remove_first(Name##RopeNode *t, Name##RopeNode **first)\
+{\
+	if (!t->left) {\
+		*first = t;\
+		return t->right;\
+	}\
+	t->left = Name##Rope_remove_first(t->left, first);\
+	return Name##Rope_balance(t);\
+}\
+\
+/* tから末尾のノードを外して*lastに格納し、残りの木を返す */\
+static Name##RopeNode *Name##Rope_remove_last(Name##RopeNode *t, Name##RopeNode **last)\
+{\
+	if (!t->right) {\
+		*last = t;\
+		return t->left;\
+	}\
+	t->right = Name##Rope_remove_last(t->right, last);\
+	return Name##Rope_balance(t);\
+}\
+\
+/* \
+ * lの後ろにrを連結した木を返す。\
+ * lの末尾とrの先頭のチャンクが1個に収まる場合はまとめる\
+ */\
+static Name##RopeNode *Name##Rope_merge(Name##RopeNode *l, Name##RopeNode *r)\
+{\
+	Name##RopeNode *last;\
+	Name##RopeNode *first;\
+	if (!l) return r;\
+	if (!r) return l;\
+	for (last = l; last->right; last = last->right) ;\
+	r = Name##Rope_remove_first(r, &first);\
+	if (last->len + first->len > Name##_CHUNK_MAX) {\
+		return Name##Rope_join(l, first, r);\
+	}\
+	memcpy(&last->chars[last->len], first->chars, sizeof(Type) * first->len);\
+	last->len += first->len;\
+	CSTL_DEALLOCATE(Allocator, first);\
+	l = Name##Rope_remove_last(l, &last);\
+	return Name##Rope_join(l, last, r);\
+}\
+\
+/* tをidx文字目の前で[0, idx)の*lと[idx, size)の*rに分ける。idxはチャンクの境目であること */\
+static void Name##Rope_split(Name##RopeNode *t, size_t idx, Name##RopeNode **l, Name##RopeNode **r)\
+{\
+	Name##RopeNode *x;\
+	size_t ls;\
+	if (!t) {\
+		*l = 0;\
+		*r = 0;\
+		return;\
+	}\
+	ls = CSTL_ROPE_SIZE(t->left);\
+	if (idx <= ls) {\
+		Name##Rope_split(t->left, idx, l, &x);\
+		*r = Name##Rope_join(x, t, t->right);\
+	} else {\
+		CSTL_ASSERT(idx >= ls + t->len && "Rope_split");\
+		Name##Rope_split(t->right, idx - ls - t->len, &x, r);\
+		*l = Name##Rope_join(t->left, t, x);\
+	}\
+}\
+\
+/* チャンクの途中のidx文字目から後ろをspareに移し、idxをチャンクの境目にした木を返す */\
+static Name##RopeNode *Name##Rope_cut(Name##RopeNode *t, size_t idx, Name##RopeNode *spare)\
+{\
+	size_t ls = CSTL_ROPE_SIZE(t->left);\
+	if (idx <= ls) {\
+		t->left = Name##Rope_cut(t->left, idx, spare);\
+	} else if (idx >= ls + t->len) {\
+		t->right = Name##Rope_cut(t->right, idx - ls - t->len, spare);\
+	} else {\
+		spare->len = ls + t->len - idx;\
+		memcpy(spare->chars, &t->chars[idx - ls], sizeof(Type) * spare->len);\
+		t->len = idx - ls;\
+		t->right = Name##Rope_join(0, spare, t->right);\
+	}\
+	return Name##Rope_balance(t);\
+}\
+\
+/* idx文字目を含むノードを返し、*offsetにノードの中での位置を格納する。idxはtの文字数未満であること */\
+static Name##RopeNode *Name##Rope_find(Name##RopeNode *t, size_t idx, size_t *offset)\
+{\
+	size_t ls;\
+	while (t) {\
+		ls = CSTL_ROPE_SIZE(t->left);\
+		if (idx < ls) {\
+			t = t->left;\
+		} else if (idx < ls + t->len) {\
+			*offset = idx - ls;\
+			break;\
+		} else {\
+			idx -= ls + t->len;\
+			t = t->right;\
+		}\
+	}\
+	return t;\
+}\
+\
+/* チャンクの文字数がn増えたtから根までの部分木の文字数を直す */\
+static void Name##Rope_add_size(Name##RopeNode *t, size_t n)\
+{\
+	for (; t; t = t->parent) {\
+		t->size += n;\
+	}\
+}\
+\
+/* チャンクの文字数がn減ったtから根までの部分木の文字数を直す */\
+static void Name##Rope_sub_size(Name##RopeNode *t, size_t n)\
+{\
+	for (; t; t = t->parent) {\
+		t->size -= n;\
+	}\
+}\
+\
+static void Name##Rope_delete_tree(Name##RopeNode *t)\
+{\
+	if (!t) return;\
+	Name##Rope_delete_tree(t->left);\
+	Name##Rope_delete_tree(t->right);\
+	CSTL_DEALLOCATE(Allocator, t);\
+}\
+\
+/* rightでつないだn個のノードを確保する。メモリ不足の場合、確保したものを解放してNULLを返す */\
+static Name##RopeNode *Name##Rope_new_nodes(size_t n)\
+{\
+	Name##RopeNode *list = 0;\
+	Name##RopeNode *t;\
+	while (n--) {\
+		t = (Name##RopeNode *) CSTL_ALLOCATE(Allocator, sizeof(Name##RopeNode));\
+		if (!t) {\
+			while (list) {\
+				t = list;\
+				list = list->right;\
+				CSTL_DEALLOCATE(Allocator, t);\
+			}\
+			return 0;\
+		}\
+		t->right = list;\
+		list = t;\
+	}\
+	return list;\
+}\
+\
+/* *listからn個のノードを取り出し、高さの揃った木を作る。文字は入っていること */\
+static Name##RopeNode *Name##Rope_build(Name##RopeNode **list, size_t n)\
+{\
+	Name##RopeNode *l;\
+	Name##RopeNode *m;\
+	if (!n) return 0;\
+	l = Name##Rope_build(list, n / 2);\
+	m = *list;\
+	*list = m->right;\
+	m->left = l;\
+	m->right = Name##Rope_build(list, n - n / 2 - 1);\
+	Name##Rope_update(m);\
+	return m;\
+}\
+\
+/* 文字数がそろうようにlen文字をn個のチャンクに分けた時の、i番目のチャンクの文字数 */\
+static size_t Name##Rope_chunk_len(size_t len, size_t n, size_t i)\
+{\
+	return len / n + (i < len % n);\
+}\
+\
+/* idx文字目の前後のチャンクが小さくなっていれば、収まる限り隣のチャンクとまとめる */\
+static void Name##Rope_settle(Name *self, size_t idx)\
+{\
+	Name##RopeNode *t;\
+	Name##RopeNode *l;\
+	Name##RopeNode *r;\
+	size_t offset = 0;\
+	size_t i;\
+	for (i = idx ? idx - 1 : 0; i <= idx && i < CSTL_ROPE_SIZE(self->root); i++) {\
+		t = Name##Rope_find(self->root, i, &offset);\
+		if (t->len > Name##_CHUNK_MAX / 2) continue;\
+		Name##Rope_split(self->root, i - offset, &l, &r);\
+		Name##Rope_split(r, t->len, &t, &r);\
+		self->root = Name##Rope_merge(Name##Rope_merge(l, t), r);\
+		self->root->parent = 0;\
+	}\
+}\
+\
+Name *Name##_new(void)\
+{\
+	Name *self;\
+	self = (Name *) CSTL_ALLOCATE(Allocator, sizeof(Name));\
+	if (!self) return 0;\
+	self->root = 0;\
+	CSTL_MAGIC(self->magic = self);\
+	return self;\
+}\
+\
+Name *Name##_new_assign_len(const Type *chars, size_t chars_len)\
+{\
+	Name *self;\
+	CSTL_ASSERT(chars && "Rope_new_assign_len");\
+	self = Name##_new();\
+	if (!self) return 0;\
+	if (!Name##_insert_len(self, 0, chars, chars_len)) {\
+		Name##_delete(self);\
+		return 0;\
+	}\
+	return self;\
+}\
+\
+void Name##_delete(Name *self)\
+{\
+	if (!self) return;\
+	CSTL_ASSERT(self->magic == self && "Rope_delete");\
+	Name##Rope_delete_tree(self->root);\
+	CSTL_MAGIC(self->magic = 0);\
+	CSTL_DEALLOCATE(Allocator, self);\
+}\
+\
+void Name##_clear(Name *self)\
+{\
+	CSTL_ASSERT(self && "Rope_clear");\
+	CSTL_ASSERT(self->magic == self && "Rope_clear");\
+	Name##Rope_delete_tree(self->root);\
+	self->root = 0;\
+}\
+\
+size_t Name##_size(Name *self)\
+{\
+	CSTL_ASSERT(self && "Rope_size");\
+	CSTL_ASSERT(self->magic == self && "Rope_size");\
+	return CSTL_ROPE_SIZE(self->root);\
+}\
+\
+int Name##_empty(Name *self)\
+{\
+	CSTL_ASSERT(self && "Rope_empty");\
+	CSTL_ASSERT(self->magic == self && "Rope_empty");\
+	return self->root == 0;\
+}\
+\
+Type *Name##_at(Name *self, size_t idx)\
+{\
+	Name##RopeNode *t;\
+	size_t offset = 0;\
+	CSTL_ASSERT(self && "Rope_at");\
+	CSTL_ASSERT(self->magic == self && "Rope_at");\
+	CSTL_ASSERT(Name##_size(self) > idx && "Rope_at");\
+	t = Name##Rope_find(self->root, idx, &offset);\
+	return &t->chars[offset];\
+}\
+\
+size_t Name##_copy(Name *self, size_t idx, size_t len, Type *buf)\
+{\
+	Name##RopeNode *t;\
+	size_t offset = 0;\
+	size_t n;\
+	size_t size;\
+	CSTL_ASSERT(self && "Rope_copy");\
+	CSTL_ASSERT(self->magic == self && "Rope_copy");\
+	CSTL_ASSERT(Name##_size(self) >= idx && "Rope_copy");\
+	CSTL_ASSERT(buf && "Rope_copy");\
+	size = Name##_size(self);\
+	if (len > size - idx) {\
+		len = size - idx;\
+	}\
+	if (!len) return 0;\
+	t = Name##Rope_find(self->root, idx, &offset);\
+	for (size = len; size; size -= n) {\
+		n = t->len - offset;\
+		if (n > size) n = size;\
+		memcpy(buf, &t->chars[offset], sizeof(Type) * n);\
+		buf += n;\
+		offset = 0;\
+		t = Name##_next(t);\
+	}\
+	return len;\
+}\
+\
+Name *Name##_append_len(Name *self, const Type *chars, size_t chars_len)\
+{\
+	CSTL_ASSERT(self && "Rope_append_len");\
+	CSTL_ASSERT(self->magic == self && "Rope_append_len");\
+	CSTL_ASSERT(chars && "Rope_append_len");\
+	return Name##_insert_len(self, Name##_size(self), chars, chars_len);\
+}\
+\
+Name *Name##_push_back(Name *self, Type c)\
+{\
+	CSTL_ASSERT(self && "Rope_push_back");\
+	CSTL_ASSERT(self->magic == self && "Rope_push_back");\
+	return Name##_insert_len(self, Name##_size(self), &c, 1);\
+}\
+\
+Name *Name##_insert_len(Name *self, size_t idx, const Type *chars, size_t chars_len)\
+{\
+	Name##RopeNode *t = 0;\
+	Name##RopeNode *list;\
+	Name##RopeNode *spare = 0;\
+	Name##RopeNode *l;\
+	Name##RopeNode *r;\
+	size_t offset = 0;\
+	size_t n;\
+	size_t i;\
+	CSTL_ASSERT(self && "Rope_insert_len");\
+	CSTL_ASSERT(self->magic == self && "Rope_insert_len");\
+	CSTL_ASSERT(Name##_size(self) >= idx && "Rope_insert_len");\
+	CSTL_ASSERT(chars && "Rope_insert_len");\
+	if (!chars_len) return self;\
+	if (idx) {\
+		/* 境目ならば前のチャンクの末尾に追加する */\
+		t = Name##Rope_find(self->root, idx - 1, &offset);\
+		offset++;\
+	} else if (self->root) {\
+		t = Name##Rope_find(self->root, 0, &offset);\
+	}\
+	if (t && t->len + chars_len <= Name##_CHUNK_MAX) {\
+		/* チャンクの中で済む */\
+		memmove(&t->chars[offset + chars_len], &t->chars[offset], sizeof(Type) * (t->len - offset));\
+		memcpy(&t->chars[offset], chars, sizeof(Type) * chars_len);\
+		t->len += chars_len;\
+		Name##Rope_add_size(t, chars_len);\
+		return self;\
+	}\
+	/* 挿入する文字のチャンクと、idxがチャンクの途中ならば分割用のノードを先に確保する */\
+	n = (chars_len + Name##_CHUNK_MAX - 1) / Name##_CHUNK_MAX;\
+	list = Name##Rope_new_nodes(n + (offset && offset < t->len));\
+	if (!list) return 0;\
+	if (offset && offset < t->len) {\
+		spare = list;\
+		list = list->right;\
+	}\
+	for (l = list, i = 0; i < n; l = l->right, i++) {\
+		l->len = Name##Rope_chunk_len(chars_len, n, i);\
+		memcpy(l->chars, chars, sizeof(Type) * l->len);\
+		chars += l->len;\
+	}\
+	if (spare) {\
+		self->root = Name##Rope_cut(self->root, idx, spare);\
+	}\
+	Name##Rope_split(self->root, idx, &l, &r);\
+	self->root = Name##Rope_merge(Name##Rope_merge(l, Name##Rope_build(&list, n)), r);\
+	self->root->parent = 0;\
+	return self;\
+}\
+\
+Name *Name##_erase(Name *self, size_t idx, size_t len)\
+{\
+	Name##RopeNode *t;\
+	Name##RopeNode *l;\
+	Name##RopeNode *m;\
+	Name##RopeNode *r;\
+	size_t offset = 0;\
+	size_t n;\
+	size_t size;\
+	CSTL_ASSERT(self && "Rope_erase");\
+	CSTL_ASSERT(self->magic == self && "Rope_erase");\
+	CSTL_ASSERT(Name##_size(self) >= idx && "Rope_erase");\
+	size = Name##_size(self);\
+	if (len > size - idx) {\
+		len = size - idx;\
+	}\
+	if (!len) return self;\
+	/* 先頭と末尾のチャンクの途中の部分はその場で詰め、残りはチャンク単位で外す */\
+	t = Name##Rope_find(self->root, idx, &offset);\
+	if (offset) {\
+		n = t->len - offset;\
+		if (n > len) n = len;\
+		memmove(&t->chars[offset], &t->chars[offset + n], sizeof(Type) * (t->len - offset - n));\
+		t->len -= n;\
+		Name##Rope_sub_size(t, n);\
+		len -= n;\
+	}\
+	if (len && idx + len < Name##_size(self)) {\
+		t = Name##Rope_find(self->root, idx + len, &offset);\
+		if (offset) {\
+			memmove(t->chars, &t->chars[offset], sizeof(Type) * (t->len - offset));\
+			t->len -= offset;\
+			Name##Rope_sub_size(t, offset);\
+			len -= offset;\
+		}\
+	}\
+	if (len) {\
+		Name##Rope_split(self->root, idx, &l, &r);\
+		Name##Rope_split(r, len, &m, &r);\
+		Name##Rope_delete_tree(m);\
+		self->root = Name##Rope_merge(l, r);\
+		if (self->root) {\
+			self->root->parent = 0;\
+		}\
+	}\
+	Name##Rope_settle(self, idx);\
+	return self;\
+}\
+\
+Name *Name##_substr(Name *self, size_t idx, size_t len)\
+{\
+	Name *x;\
+	Name##RopeNode *list;\
+	Name##RopeNode *t;\
+	size_t size;\
+	size_t n;\
+	size_t i;\
+	CSTL_ASSERT(self && "Rope_substr");\
+	CSTL_ASSERT(self->magic == self && "Rope_substr");\
+	CSTL_ASSERT(Name##_size(self) >= idx && "Rope_substr");\
+	size = Name##_size(self);\
+	if (len > size - idx) {\
+		len = size - idx;\
+	}\
+	x = Name##_new();\
+	if (!x) return 0;\
+	if (!len) return x;\
+	n = (len + Name##_CHUNK_MAX - 1) / Name##_CHUNK_MAX;\
+	list = Name##Rope_new_nodes(n);\
+	if (!list) {\
+		Name##_delete(x);\
+		return 0;\
+	}\
+	for (t = list, i = 0; i < n; t = t->right, i++) {\
+		t->len = Name##_copy(self, idx, Name##Rope_chunk_len(len, n, i), t->chars);\
+		idx += t->len;\
+	}\
+	x->root = Name##Rope_build(&list, n);\
+	x->root->parent = 0;\
+	return x;\
+}\
+\
+Name *Name##_split(Name *self, size_t idx)\
+{\
+	Name *x;\
+	Name##RopeNode *spare;\
+	size_t offset = 0;\
+	CSTL_ASSERT(self && "Rope_split");\
+	CSTL_ASSERT(self->magic == self && "Rope_split");\
+	CSTL_ASSERT(Name##_size(self) >= idx && "Rope_split");\
+	if (idx < Name##_size(self)) {\
+		Name##Rope_find(self->root, idx, &offset);\
+	}\
+	x = Name##_new();\
+	if (!x) return 0;\
+	if (offset) {\
+		/* idxがチャンクの途中ならば分割する */\
+		spare = Name##Rope_new_nodes(1);\
+		if (!spare) {\
+			Name##_delete(x);\
+			return 0;\
+		}\
+		self->root = Name##Rope_cut(self->root, idx, spare);\
+	}\
+	Name##Rope_split(self->root, idx, &self->root, &x->root);\
+	if (self->root) self->root->parent = 0;\
+	if (x->root) x->root->parent = 0;\
+	return x;\
+}\
+\
+void Name##_concat(Name *self, Name *x)\
+{\
+	CSTL_ASSERT(self && "Rope_concat");\
+	CSTL_ASSERT(self->magic == self && "Rope_concat");\
+	CSTL_ASSERT(x && "Rope_concat");\
+	CSTL_ASSERT(x->magic == x && "Rope_concat");\
+	CSTL_ASSERT(self != x && "Rope_concat");\
+	self->root = Name##Rope_merge(self->root, x->root);\
+	if (self->root) {\
+		self->root->parent = 0;\
+	}\
+	x->root = 0;\
+}\
+\
+void Name##_swap(Name *self, Name *x)\
+{\
+	Name##RopeNode *tmp;\
+	CSTL_ASSERT(self && "Rope_swap");\
+	CSTL_ASSERT(self->magic == self && "Rope_swap");\
+	CSTL_ASSERT(x && "Rope_swap");\
+	CSTL_ASSERT(x->magic == x && "Rope_swap");\
+	tmp = self->root;\
+	self->root = x->root;\
+	x->root = tmp;\
+}\
+\
+Name##Iterator Name##_begin(Name *self)\
+{\
+	Name##RopeNode *t;\
+	CSTL_ASSERT(self && "Rope_begin");\
+	CSTL_ASSERT(self->magic == self && "Rope_begin");\
+	t = self->root;\
+	if (t) {\
+		while (t->left) t = t->left;\
+	}\
+	return t;\
+}\
+\
+Name##Iterator Name##_end(Name *self)\
+{\
+	CSTL_ASSERT(self && "Rope_end");\
+	CSTL_ASSERT(self->magic == self && "Rope_end");\
+	CSTL_UNUSED_PARAM(self);\
+	return 0;\
+}\
+\
+Name##Iterator Name##_rbegin(Name *self)\
+{\
+	Name##RopeNode *t;\
+	CSTL_ASSERT(self && "Rope_rbegin");\
+	CSTL_ASSERT(self->magic == self && "Rope_rbegin");\
+	t = self->root;\
+	if (t) {\
+		while (t->right) t = t->right;\
+	}\
+	return t;\
+}\
+\
+Name##Iterator Name##_rend(Name *self)\
+{\
+	CSTL_ASSERT(self && "Rope_rend");\
+	CSTL_ASSERT(self->magic == self && "Rope_rend");\
+	CSTL_UNUSED_PARAM(self);\
+	return 0;\
+}\
+\
+Name##Iterator Name##_next(Name##Iterator pos)\
+{\
+	CSTL_ASSERT(pos && "Rope_next");\
+	if (pos->right) {\
+		pos = pos->right;\
+		while (pos->left) pos = pos->left;\
+		return pos;\
+	}\
+	while (pos->parent && pos->parent->right == pos) {\
+		pos = pos->parent;\
+	}\
+	return pos->parent;\
+}\
+\
+Name##Iterator Name##_prev(Name##Iterator pos)\
+{\
+	CSTL_ASSERT(pos && "Rope_prev");\
+	if (pos->left) {\
+		pos = pos->left;\
+		while (pos->right) pos = pos->right;\
+		return pos;\
+	}\
+	while (pos->parent && pos->parent->left == pos) {\
+		pos = pos->parent;\
+	}\
+	return pos->parent;\
+}\
+\
+Name##Iterator Name##_chunk_find(Name *self, size_t idx, size_t *offset)\
+{\
+	CSTL_ASSERT(self && "Rope_chunk_find");\
+	CSTL_ASSERT(self->magic == self && "Rope_chunk_find");\
+	CSTL_ASSERT(Name##_size(self) > idx && "Rope_chunk_find");\
+	CSTL_ASSERT(offset && "Rope_chunk_find");\
+	return Name##Rope_find(self->root, idx, offset);\
+}\
+\
+const Type *Name##_chunk_data(Name##Iterator pos)\
+{\
+	CSTL_ASSERT(pos && "Rope_chunk_data");\
+	return pos->chars;\
+}\
+\
+size_t Name##_chunk_size(Name##Iterator pos)\
+{\
+	CSTL_ASSERT(pos && "Rope_chunk_size");\
+	return pos->len;\
+}\
+\
+
+
+/*!
+ * \brief stringとの変換のインターフェイスマクロ
+ *
+ * \param Name ropeのコンテナ名
+ * \param StringName 同じ文字の型のstringのコンテナ名
+ */
+#define CSTL_ROPE_STRING_INTERFACE(Name, StringName)	\
+CSTL_EXTERN_C_BEGIN()\
+Name *Name##_new_string(StringName *s);\
+StringName *Name##_to_string(Name *self, StringName *s);\
+CSTL_EXTERN_C_END()\
+
+
+/*!
+ * \brief stringとの変換の実装マクロ
+ *
+ * \param Name ropeのコンテナ名
+ * \param StringName 同じ文字の型のstringのコンテナ名
+ */
+#define CSTL_ROPE_STRING_IMPLEMENT(Name, StringName)	\
+\
+Name *Name##_new_string(StringName *s)\
+{\
+	CSTL_ASSERT(s && "Rope_new_string");\
+	return Name##_new_assign_len(StringName##_c_str(s), StringName##_size(s));\
+}\
+\
+StringName *Name##_to_string(Name *self, StringName *s)\
+{\
+	Name##Iterator pos;\
+	CSTL_ASSERT(self && "Rope_to_string");\
+	CSTL_ASSERT(self->magic == self && "Rope_to_string");\
+	CSTL_ASSERT(s && "Rope_to_string");\
+	if (!StringName##_reserve(s, Name##_size(self))) return 0;\
+	StringName##_clear(s);\
+	for (pos = Name##_begin(self); pos != Name##_end(self); pos = Name##_next(pos)) {\
+		StringName##_append_len(s, Name##_chunk_data(pos), Name##_chunk_size(pos));\
+	}\
+	return s;\
+}\
+\
+
+
+#endif /* CSTL_ROPE_H_INCLUDED */
@@ -38,7 +38,7 @@
 #include "rbtree.h"
 
 
-#define CSTL_COMMON_SET_IMPLEMENT(Name, Type, Compare)	\
+#define CSTL_COMMON_SET_IMPLEMENT(Name, Type, Compare, Pooled, Allocator)	\
 /*! \
  * \brief set赤黒木構造体\
  */\
@@ -51,12 +51,12 @@ struct Name##RBTree {\
 	CSTL_MAGIC(struct Name##RBTree *magic;)\
 };\
 \
-CSTL_RBTREE_WRAPPER_IMPLEMENT(Name, Type, Type, Compare)\
+CSTL_RBTREE_WRAPPER_IMPLEMENT(Name, Type, Type, Compare, Pooled, Allocator)\
 \
-static Name##RBTree *Name##RBTree_new_node(Type data, int color)\
+static Name##RBTree *Name##RBTree_new_node(Name *self, Type data, int color)\
 {\
 	Name##RBTree *node;\
-	node = (Name##RBTree *) malloc(sizeof(Name##RBTree));\
+	node = Name##_alloc_node(self);\
 	if (!node) return 0;\
 	node->key = data;\
 	node->left = (Name##RBTree *) &Name##RBTree_nil;\
@@ -98,8 +98,36 @@ CSTL_EXTERN_C_END()\
  * \param Compare 要素の比較ルーチン
  */
 #define CSTL_SET_IMPLEMENT(Name, Type, Compare)	\
-CSTL_COMMON_SET_IMPLEMENT(Name, Type, Compare)\
-\
+CSTL_COMMON_SET_IMPLEMENT(Name, Type, Compare, 0, CSTL_DEFAULT_ALLOCATOR)\
+CSTL_SET_IMPLEMENT_INSERT(Name, Type, Compare)\
+
+/*! 
+ * \brief ノードプールを使う実装マクロ
+ *
+ * CSTL_SET_IMPLEMENT() と同じだが、ノードをコンテナごとのノードプールから確保する。
+ * ノードはチャンク単位でまとめて確保し、clear()/delete()でまとめて解放する。
+ * 
+ * \param Name コンテナ名
+ * \param Type 要素の型
+ * \param Compare 要素の比較ルーチン
+ */
+#define CSTL_SET_IMPLEMENT_POOL(Name, Type, Compare)	\
+CSTL_COMMON_SET_IMPLEMENT(Name, Type, Compare, 1, CSTL_DEFAULT_ALLOCATOR)\
+CSTL_SET_IMPLEMENT_INSERT(Name, Type, Compare)\
+
+/*! 
+ * \brief アロケータを指定する実装マクロ
+ * 
+ * \param Name コンテナ名
+ * \param Type 要素の型
+ * \param Compare 要素の比較ルーチン
+ * \param Allocator アロケータ(CstlAllocator const *)の式
+ */
+#define CSTL_SET_IMPLEMENT_ALLOCATOR(Name, Type, Compare, Allocator)	\
+CSTL_COMMON_SET_IMPLEMENT(Name, Type, Compare, 0, Allocator)\
+CSTL_SET_IMPLEMENT_INSERT(Name, Type, Compare)\
+
+#define CSTL_SET_IMPLEMENT_INSERT(Name, Type, Compare)	\
 Name##Iterator Name##_insert(Name *self, Type data, int *success)\
 {\
 	Name##Iterator pos;\
@@ -107,7 +135,7 @@ Name##Iterator Name##_insert(Name *self, Type data, int *success)\
 	CSTL_ASSERT(self->magic == self && "Set_insert");\
 	pos = Name##RBTree_find(self->tree, data);\
 	if (pos == Name##RBTree_end(self->tree)) {\
-		pos = Name##RBTree_new_node(data, Name##_COLOR_RED);\
+		pos = Name##RBTree_new_node(self, data, Name##_COLOR_RED);\
 		if (pos) {\
 			Name##RBTree_insert(self->tree, pos);\
 			if (success) *success = 1;\
@@ -137,11 +165,11 @@ int Name##_insert_range(Name *self, Name##Iterator first, Name##Iterator last)\
 	tmp = &head;\
 	for (pos = first; pos != last; pos = Name##_next(pos)) {\
 		if (Name##RBTree_find(self->tree, pos->key) == Name##RBTree_end(self->tree)) {\
-			tmp->right = Name##RBTree_new_node(pos->key, Name##_COLOR_RED);\
+			tmp->right = Name##RBTree_new_node(self, pos->key, Name##_COLOR_RED);\
 			if (!tmp->right) {\
 				for (pos = head.right; pos != 0; pos = tmp) {\
 					tmp = pos->right;\
-					free(pos);\
+					Name##_free_node(self, pos);\
 				}\
 				return 0;\
 			}\
@@ -182,14 +210,42 @@ CSTL_EXTERN_C_END()\
  * \param Compare 要素の比較ルーチン
  */
 #define CSTL_MULTISET_IMPLEMENT(Name, Type, Compare)	\
-CSTL_COMMON_SET_IMPLEMENT(Name, Type, Compare)\
-\
+CSTL_COMMON_SET_IMPLEMENT(Name, Type, Compare, 0, CSTL_DEFAULT_ALLOCATOR)\
+CSTL_MULTISET_IMPLEMENT_INSERT(Name, Type, Compare)\
+
+/*! 
+ * \brief ノードプールを使う実装マクロ
+ *
+ * CSTL_MULTISET_IMPLEMENT() と同じだが、ノードをコンテナごとのノードプールから確保する。
+ * ノードはチャンク単位でまとめて確保し、clear()/delete()でまとめて解放する。
+ * 
+ * \param Name コンテナ名
+ * \param Type 要素の型
+ * \param Compare 要素の比較ルーチン
+ */
+#define CSTL_MULTISET_IMPLEMENT_POOL(Name, Type, Compare)	\
+CSTL_COMMON_SET_IMPLEMENT(Name, Type, Compare, 1, CSTL_DEFAULT_ALLOCATOR)\
+CSTL_MULTISET_IMPLEMENT_INSERT(Name, Type, Compare)\
+
+/*! 
+ * \brief アロケータを指定する実装マクロ
+ * 
+ * \param Name コンテナ名
+ * \param Type 要素の型
+ * \param Compare 要素の比較ルーチン
+ * \param Allocator アロケータ(CstlAllocator const *)の式
+ */
+#define CSTL_MULTISET_IMPLEMENT_ALLOCATOR(Name, Type, Compare, Allocator)	\
+CSTL_COMMON_SET_IMPLEMENT(Name, Type, Compare, 0, Allocator)\
+CSTL_MULTISET_IMPLEMENT_INSERT(Name, Type, Compare)\
+
+#define CSTL_MULTISET_IMPLEMENT_INSERT(Name, Type, Compare)	\
 Name##Iterator Name##_insert(Name *self, Type data)\
 {\
 	Name##Iterator pos;\
 	CSTL_ASSERT(self && "MultiSet_insert");\
 	CSTL_ASSERT(self->magic == self && "MultiSet_insert");\
-	pos = Name##RBTree_new_node(data, Name##_COLOR_RED);\
+	pos = Name##RBTree_new_node(self, data, Name##_COLOR_RED);\
 	if (pos) {\
 		Name##RBTree_insert(self->tree, pos);\
 		self->size++;\
@@ -212,11 +268,11 @@ int Name##_insert_range(Name *self, Name##Iterator first, Name##Iterator last)\
 	head.right = (Name##RBTree *) &Name##RBTree_nil;\
 	tmp = &head;\
 	for (pos = first; pos != last; pos = Name##_next(pos)) {\
-		tmp->right = Name##RBTree_new_node(pos->key, Name##_COLOR_RED);\
+		tmp->right = Name##RBTree_new_node(self, pos->key, Name##_COLOR_RED);\
 		if (!tmp->right) {\
 			for (pos = head.right; pos != 0; pos = tmp) {\
 				tmp = pos->right;\
-				free(pos);\
+				Name##_free_node(self, pos);\
 			}\
 			return 0;\
 		}\
@@ -53,6 +53,356 @@
  */
 #define CSTL_NPOS	((size_t)-1)
 
+/* 終端文字を含めてこのバイト数に収まる文字列は、string構造体の内部に格納する */
+#define CSTL_STRING_SSO_BYTES	24
+/* 内部に格納できる要素数(終端文字を含む) */
+#define CSTL_STRING_SSO_SIZE(Type)	\
+	(CSTL_STRING_SSO_BYTES / sizeof(Type) > 1 ? CSTL_STRING_SSO_BYTES / sizeof(Type) : 2)
+
+/* 
+ * 1バイト文字の検索・比較のSIMD化。
+ * GCC/ClangでSSE2が使える場合はSSE2で16バイトずつ処理する。
+ * x86ではさらにAVX2版の関数も作り、実行時にCPUがAVX2に対応していればそちらを使う。
+ * CSTL_STRING_NO_SIMDを定義するとSIMDを使わない。
+ */
+#if !defined(CSTL_STRING_NO_SIMD) && defined(__SSE2__) && (defined(__GNUC__) || defined(__clang__))
+#include <emmintrin.h>
+#define CSTL_STRING_CTZ(x)	__builtin_ctz(x)
+#define CSTL_STRING_BSR(x)	(31 - __builtin_clz(x))
+
+/* s[i]からの16バイトにcがあればその位置を返す */
+#define CSTL_STRING_SSE2_CHR(s, n, c, i)	\
+	do {\
+		__m128i c_ = _mm_set1_epi8((char) (c));\
+		for (; (i) + 16 <= (n); (i) += 16) {\
+			int m_ = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *) ((s) + (i))), c_));\
+			if (m_) return (i) + CSTL_STRING_CTZ(m_);\
+		}\
+	} while (0)
+
+/* s[i-16]からの16バイトにcがあれば最後の位置を返す */
+#define CSTL_STRING_SSE2_RCHR(s, c, i)	\
+	do {\
+		__m128i c_ = _mm_set1_epi8((char) (c));\
+		for (; (i) >= 16; (i) -= 16) {\
+			int m_ = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *) ((s) + (i) - 16)), c_));\
+			if (m_) return (i) - 16 + CSTL_STRING_BSR(m_);\
+		}\
+	} while (0)
+
+/* x[i]とy[i]からの16バイトが異なればその位置を返す */
+#define CSTL_STRING_SSE2_MISMATCH(x, y, n, i)	\
+	do {\
+		for (; (i) + 16 <= (n); (i) += 16) {\
+			int m_ = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *) ((x) + (i))),\
+						_mm_loadu_si128((const __m128i *) ((y) + (i))))) ^ 0xffff;\
+			if (m_) return (i) + CSTL_STRING_CTZ(m_);\
+		}\
+	} while (0)
+
+/* 
+ * 開始位置s[i]からの16個の候補を、パターンの先頭と末尾の文字で絞り込んでから照合する。
+ * パターンの長さmは2以上。
+ */
+#define CSTL_STRING_SSE2_SEARCH(Name, s, n, p, m, i)	\
+	do {\
+		__m128i f_ = _mm_set1_epi8((char) (p)[0]);\
+		__m128i l_ = _mm_set1_epi8((char) (p)[(m) - 1]);\
+		for (; (i) + (m) + 15 <= (n); (i) += 16) {\
+			int m_ = _mm_movemask_epi8(_mm_and_si128(\
+						_mm_cmpeq_epi8(f_, _mm_loadu_si128((const __m128i *) ((s) + (i)))),\
+						_mm_cmpeq_epi8(l_, _mm_loadu_si128((const __m128i *) ((s) + (i) + (m) - 1)))));\
+			while (m_) {\
+				int b_ = CSTL_STRING_CTZ(m_);\
+				if (Name##_byte_mismatch((s) + (i) + b_ + 1, (p) + 1, (m) - 2) == (m) - 2) return (i) + b_;\
+				m_ &= m_ - 1;\
+			}\
+		}\
+	} while (0)
+
+/* 開始位置s[i-16]からの16個の候補のうち、最後に一致する位置を返す */
+#define CSTL_STRING_SSE2_RSEARCH(Name, s, p, m, i)	\
+	do {\
+		__m128i f_ = _mm_set1_epi8((char) (p)[0]);\
+		__m128i l_ = _mm_set1_epi8((char) (p)[(m) - 1]);\
+		for (; (i) >= 16; (i) -= 16) {\
+			int m_ = _mm_movemask_epi8(_mm_and_si128(\
+						_mm_cmpeq_epi8(f_, _mm_loadu_si128((const __m128i *) ((s) + (i) - 16))),\
+						_mm_cmpeq_epi8(l_, _mm_loadu_si128((const __m128i *) ((s) + (i) - 16 + (m) - 1)))));\
+			while (m_) {\
+				int b_ = CSTL_STRING_BSR(m_);\
+				if (Name##_byte_mismatch((s) + (i) - 16 + b_ + 1, (p) + 1, (m) - 2) == (m) - 2) return (i) - 16 + b_;\
+				m_ &= ~(1 << b_);\
+			}\
+		}\
+	} while (0)
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+/* n(長さ)が32以上でCPUがAVX2に対応していれば、AVX2版の関数の結果を返す */
+#define CSTL_STRING_AVX2_RETURN(n, call)	\
+	if ((n) >= 32 && __builtin_cpu_supports("avx2")) return call;
+#define CSTL_STRING_AVX2_IMPLEMENT(Name)	\
+static __attribute__((target("avx2"))) size_t Name##_avx2_chr(const unsigned char *s, size_t n, unsigned char c)\
+{\
+	size_t i = 0;\
+	__m256i c_ = _mm256_set1_epi8((char) c);\
+	for (; i + 32 <= n; i += 32) {\
+		unsigned int m_ = (unsigned int) _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *) (s + i)), c_));\
+		if (m_) return i + CSTL_STRING_CTZ(m_);\
+	}\
+	for (; i < n; i++) {\
+		if (s[i] == c) return i;\
+	}\
+	return CSTL_NPOS;\
+}\
+\
+static __attribute__((target("avx2"))) size_t Name##_avx2_rchr(const unsigned char *s, size_t n, unsigned char c)\
+{\
+	size_t i = n;\
+	__m256i c_ = _mm256_set1_epi8((char) c);\
+	for (; i >= 32; i -= 32) {\
+		unsigned int m_ = (unsigned int) _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *) (s + i - 32)), c_));\
+		if (m_) return i - 32 + CSTL_STRING_BSR(m_);\
+	}\
+	while (i > 0) {\
+		i--;\
+		if (s[i] == c) return i;\
+	}\
+	return CSTL_NPOS;\
+}\
+\
+static __attribute__((target("avx2"))) size_t Name##_avx2_mismatch(const unsigned char *x, const unsigned char *y, size_t n)\
+{\
+	size_t i = 0;\
+	for (; i + 32 <= n; i += 32) {\
+		unsigned int m_ = ~(unsigned int) _mm256_movemask_epi8(_mm256_cmpeq_epi8(\
+					_mm256_loadu_si256((const __m256i *) (x + i)), _mm256_loadu_si256((const __m256i *) (y + i))));\
+		if (m_) return i + CSTL_STRING_CTZ(m_);\
+	}\
+	for (; i < n; i++) {\
+		if (x[i] != y[i]) return i;\
+	}\
+	return n;\
+}\
+\
+/* 32バイトの各バイトがtblの集合に含まれるかのマスクを返す */\
+static __attribute__((target("avx2"))) unsigned int Name##_avx2_classify(const unsigned char *s, const unsigned char *tbl)\
+{\
+	__m256i v = _mm256_loadu_si256((const __m256i *) s);\
+	__m256i lo = _mm256_and_si256(v, _mm256_set1_epi8(0x0f));\
+	__m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), _mm256_set1_epi8(0x0f));\
+	__m256i rows0 = _mm256_shuffle_epi8(_mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *) tbl)), lo);\
+	__m256i rows1 = _mm256_shuffle_epi8(_mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *) (tbl + 16))), lo);\
+	__m256i row = _mm256_blendv_epi8(rows0, rows1, _mm256_cmpgt_epi8(hi, _mm256_set1_epi8(7)));\
+	__m256i bit = _mm256_shuffle_epi8(_mm256_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128,\
+				1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128), hi);\
+	return (unsigned int) _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_and_si256(row, bit), bit));\
+}\
+\
+static __attribute__((target("avx2"))) size_t Name##_avx2_of(const unsigned char *s, size_t n, const unsigned char *tbl, int neg)\
+{\
+	size_t i = 0;\
+	unsigned int flip = neg ? 0xffffffffU : 0;\
+	for (; i + 32 <= n; i += 32) {\
+		unsigned int m_ = Name##_avx2_classify(s + i, tbl) ^ flip;\
+		if (m_) return i + CSTL_STRING_CTZ(m_);\
+	}\
+	for (; i < n; i++) {\
+		if ((CSTL_STRING_BYTE_IN(tbl, s[i]) != 0) != neg) return i;\
+	}\
+	return CSTL_NPOS;\
+}\
+\
+static __attribute__((target("avx2"))) size_t Name##_avx2_rof(const unsigned char *s, size_t n, const unsigned char *tbl, int neg)\
+{\
+	size_t i = n;\
+	unsigned int flip = neg ? 0xffffffffU : 0;\
+	for (; i >= 32; i -= 32) {\
+		unsigned int m_ = Name##_avx2_classify(s + i - 32, tbl) ^ flip;\
+		if (m_) return i - 32 + CSTL_STRING_BSR(m_);\
+	}\
+	while (i > 0) {\
+		i--;\
+		if ((CSTL_STRING_BYTE_IN(tbl, s[i]) != 0) != neg) return i;\
+	}\
+	return CSTL_NPOS;\
+}\
+\
+static __attribute__((target("avx2"))) size_t Name##_avx2_search(const unsigned char *s, size_t n, const unsigned char *p, size_t m)\
+{\
+	size_t i = 0;\
+	__m256i f_ = _mm256_set1_epi8((char) p[0]);\
+	__m256i l_ = _mm256_set1_epi8((char) p[m - 1]);\
+	for (; i + m + 31 <= n; i += 32) {\
+		unsigned int m_ = (unsigned int) _mm256_movemask_epi8(_mm256_and_si256(\
+					_mm256_cmpeq_epi8(f_, _mm256_loadu_si256((const __m256i *) (s + i))),\
+					_mm256_cmpeq_epi8(l_, _mm256_loadu_si256((const __m256i *) (s + i + m - 1)))));\
+		while (m_) {\
+			int b_ = CSTL_STRING_CTZ(m_);\
+			if (Name##_avx2_mismatch(s + i + b_ + 1, p + 1, m - 2) == m - 2) return i + b_;\
+			m_ &= m_ - 1;\
+		}\
+	}\
+	for (; i + m <= n; i++) {\
+		if (s[i] == p[0] && s[i + m - 1] == p[m - 1] && Name##_avx2_mismatch(s + i + 1, p + 1, m - 2) == m - 2) return i;\
+	}\
+	return CSTL_NPOS;\
+}\
+\
+static __attribute__((target("avx2"))) size_t Name##_avx2_rsearch(const unsigned char *s, size_t n, const unsigned char *p, size_t m)\
+{\
+	size_t i = n - m + 1;\
+	__m256i f_ = _mm256_set1_epi8((char) p[0]);\
+	__m256i l_ = _mm256_set1_epi8((char) p[m - 1]);\
+	for (; i >= 32; i -= 32) {\
+		unsigned int m_ = (unsigned int) _mm256_movemask_epi8(_mm256_and_si256(\
+					_mm256_cmpeq_epi8(f_, _mm256_loadu_si256((const __m256i *) (s + i - 32))),\
+					_mm256_cmpeq_epi8(l_, _mm256_loadu_si256((const __m256i *) (s + i - 32 + m - 1)))));\
+		while (m_) {\
+			int b_ = CSTL_STRING_BSR(m_);\
+			if (Name##_avx2_mismatch(s + i - 32 + b_ + 1, p + 1, m - 2) == m - 2) return i - 32 + b_;\
+			m_ &= ~(1U << b_);\
+		}\
+	}\
+	while (i > 0) {\
+		i--;\
+		if (s[i] == p[0] && s[i + m - 1] == p[m - 1] && Name##_avx2_mismatch(s + i + 1, p + 1, m - 2) == m - 2) return i;\
+	}\
+	return CSTL_NPOS;\
+}\
+
+#endif
+#endif
+
+#ifndef CSTL_STRING_SSE2_CHR
+#define CSTL_STRING_SSE2_CHR(s, n, c, i)
+#define CSTL_STRING_SSE2_RCHR(s, c, i)
+#define CSTL_STRING_SSE2_MISMATCH(x, y, n, i)
+#define CSTL_STRING_SSE2_SEARCH(Name, s, n, p, m, i)
+#define CSTL_STRING_SSE2_RSEARCH(Name, s, p, m, i)
+#endif
+#ifndef CSTL_STRING_AVX2_IMPLEMENT
+#define CSTL_STRING_AVX2_RETURN(n, call)
+#define CSTL_STRING_AVX2_IMPLEMENT(Name)
+#endif
+
+/* 
+ * 1バイト文字の集合を表す256ビットのビットマップ。
+ * 文字bの上位4ビットをh、下位4ビットをlとして、tbl[(h & 8) * 2 + l]のビット(h & 7)が集合に含まれるかを表す。
+ * SIMDでは下位4ビットによる表引きでまとめて判定できる。
+ */
+#define CSTL_STRING_BYTE_IN(tbl, b)	\
+	((tbl)[(((b) >> 7) << 4) | ((b) & 0x0f)] & (1 << (((b) >> 4) & 7)))
+
+/* 
+ * 1バイト文字の検索・比較。戻り値はsからの位置で、見つからない場合はCSTL_NPOS
+ */
+#define CSTL_STRING_BYTE_IMPLEMENT(Name)	\
+CSTL_STRING_AVX2_IMPLEMENT(Name)\
+\
+static size_t Name##_byte_mismatch(const unsigned char *x, const unsigned char *y, size_t n)\
+{\
+	size_t i = 0;\
+	CSTL_STRING_AVX2_RETURN(n, Name##_avx2_mismatch(x, y, n))\
+	CSTL_STRING_SSE2_MISMATCH(x, y, n, i);\
+	for (; i < n; i++) {\
+		if (x[i] != y[i]) return i;\
+	}\
+	return n;\
+}\
+\
+static size_t Name##_byte_chr(const unsigned char *s, size_t n, unsigned char c)\
+{\
+	size_t i = 0;\
+	CSTL_STRING_AVX2_RETURN(n, Name##_avx2_chr(s, n, c))\
+	CSTL_STRING_SSE2_CHR(s, n, c, i);\
+	for (; i < n; i++) {\
+		if (s[i] == c) return i;\
+	}\
+	return CSTL_NPOS;\
+}\
+\
+static size_t Name##_byte_rchr(const unsigned char *s, size_t n, unsigned char c)\
+{\
+	size_t i = n;\
+	CSTL_STRING_AVX2_RETURN(n, Name##_avx2_rchr(s, n, c))\
+	CSTL_STRING_SSE2_RCHR(s, c, i);\
+	while (i > 0) {\
+		i--;\
+		if (s[i] == c) return i;\
+	}\
+	return CSTL_NPOS;\
+}\
+\
+static void Name##_byte_set(unsigned char *tbl, const unsigned char *set, size_t set_len)\
+{\
+	size_t i;\
+	memset(tbl, 0, 32);\
+	for (i = 0; i < set_len; i++) {\
+		tbl[((set[i] >> 7) << 4) | (set[i] & 0x0f)] |= (unsigned char) (1 << ((set[i] >> 4) & 7));\
+	}\
+}\
+\
+/* negが0ならsetに含まれる、非0なら含まれない最初の文字の位置 */\
+static size_t Name##_byte_of(const unsigned char *s, size_t n, const unsigned char *set, size_t set_len, int neg)\
+{\
+	size_t i;\
+	unsigned char tbl[32];\
+	Name##_byte_set(tbl, set, set_len);\
+	CSTL_STRING_AVX2_RETURN(n, Name##_avx2_of(s, n, tbl, neg))\
+	for (i = 0; i < n; i++) {\
+		if ((CSTL_STRING_BYTE_IN(tbl, s[i]) != 0) != neg) return i;\
+	}\
+	return CSTL_NPOS;\
+}\
+\
+static size_t Name##_byte_rof(const unsigned char *s, size_t n, const unsigned char *set, size_t set_len, int neg)\
+{\
+	size_t i = n;\
+	unsigned char tbl[32];\
+	Name##_byte_set(tbl, set, set_len);\
+	CSTL_STRING_AVX2_RETURN(n, Name##_avx2_rof(s, n, tbl, neg))\
+	while (i > 0) {\
+		i--;\
+		if ((CSTL_STRING_BYTE_IN(tbl, s[i]) != 0) != neg) return i;\
+	}\
+	return CSTL_NPOS;\
+}\
+\
+/* パターンの先頭と末尾の文字で候補を絞り込む。mは1以上 */\
+static size_t Name##_byte_search(const unsigned char *s, size_t n, const unsigned char *p, size_t m)\
+{\
+	size_t i = 0;\
+	if (n < m) return CSTL_NPOS;\
+	if (m == 1) return Name##_byte_chr(s, n, p[0]);\
+	CSTL_STRING_AVX2_RETURN(n, Name##_avx2_search(s, n, p, m))\
+	CSTL_STRING_SSE2_SEARCH(Name, s, n, p, m, i);\
+	for (; i + m <= n; i++) {\
+		if (s[i] == p[0] && s[i + m - 1] == p[m - 1] &&\
+				Name##_byte_mismatch(s + i + 1, p + 1, m - 2) == m - 2) return i;\
+	}\
+	return CSTL_NPOS;\
+}\
+\
+static size_t Name##_byte_rsearch(const unsigned char *s, size_t n, const unsigned char *p, size_t m)\
+{\
+	size_t i;\
+	if (n < m) return CSTL_NPOS;\
+	if (m == 1) return Name##_byte_rchr(s, n, p[0]);\
+	CSTL_STRING_AVX2_RETURN(n, Name##_avx2_rsearch(s, n, p, m))\
+	/* 開始位置の候補は[0, i) */\
+	i = n - m + 1;\
+	CSTL_STRING_SSE2_RSEARCH(Name, s, p, m, i);\
+	while (i > 0) {\
+		i--;\
+		if (s[i] == p[0] && s[i + m - 1] == p[m - 1] &&\
+				Name##_byte_mismatch(s + i + 1, p + 1, m - 2) == m - 2) return i;\
+	}\
+	return CSTL_NPOS;\
+}\
+
+
 
 /*! 
  * \brief インターフェイスマクロ
@@ -127,9 +477,25 @@ CSTL_EXTERN_C_END()\
  * \param Type 要素の型
  */
 #define CSTL_STRING_IMPLEMENT(Name, Type)	\
+CSTL_STRING_IMPLEMENT_ALLOCATOR(Name, Type, CSTL_DEFAULT_ALLOCATOR)\
+
+/*! 
+ * \brief アロケータを指定する実装マクロ
+ * 
+ * \param Name コンテナ名
+ * \param Type 要素の型
+ * \param Allocator アロケータ(CstlAllocator const *)の式
+ */
+#define CSTL_STRING_IMPLEMENT_ALLOCATOR(Name, Type, Allocator)	\
+\
+CSTL_STRING_BYTE_IMPLEMENT(Name)\
 \
 static int Name##_mymemcmp(const Type *x, const Type *y, size_t size)\
 {\
+	if (sizeof(Type) == 1) {\
+		size_t i = Name##_byte_mismatch((const unsigned char *) x, (const unsigned char *) y, size);\
+		return (i == size) ? 0 : x[i] - y[i];\
+	}\
 	if (size) {\
 		do {\
 			if (*x != *y) {\
@@ -146,6 +512,9 @@ static int Name##_mymemcmp(const Type *x, const Type *y, size_t size)\
 static size_t Name##_mystrlen(const Type *cstr)\
 {\
 	register size_t i = 0;\
+	if (sizeof(Type) == 1) {\
+		return strlen((const char *) cstr);\
+	}\
 	while (*cstr != '\0') {\
 		cstr++;\
 		i++;\
@@ -154,31 +523,29 @@ static size_t Name##_mystrlen(const Type *cstr)\
 }\
 \
 CSTL_VECTOR_INTERFACE(Name##_CharVector, Type)\
-CSTL_VECTOR_IMPLEMENT_BASE(Name##_CharVector, Type)\
-CSTL_VECTOR_IMPLEMENT_RESERVE(Name##_CharVector, Type)\
+CSTL_VECTOR_IMPLEMENT_SMALL_BASE(Name##_CharVector, Type, CSTL_STRING_SSO_SIZE(Type), Allocator)\
+CSTL_VECTOR_IMPLEMENT_SMALL_RESERVE(Name##_CharVector, Type, CSTL_STRING_SSO_SIZE(Type), Allocator)\
 CSTL_VECTOR_IMPLEMENT_MOVE_FORWARD(Name##_CharVector, Type)\
 CSTL_VECTOR_IMPLEMENT_MOVE_BACKWARD(Name##_CharVector, Type)\
 CSTL_VECTOR_IMPLEMENT_INSERT_N_NO_DATA(Name##_CharVector, Type)\
 CSTL_VECTOR_IMPLEMENT_PUSH_BACK(Name##_CharVector, Type)\
-CSTL_VECTOR_IMPLEMENT_SHRINK(Name##_CharVector, Type)\
+CSTL_VECTOR_IMPLEMENT_SMALL_SHRINK(Name##_CharVector, Type, CSTL_STRING_SSO_SIZE(Type), Allocator)\
 CSTL_VECTOR_IMPLEMENT_RESIZE(Name##_CharVector, Type)\
 CSTL_VECTOR_IMPLEMENT_INSERT_ARRAY(Name##_CharVector, Type)\
 CSTL_VECTOR_IMPLEMENT_ERASE(Name##_CharVector, Type)\
-CSTL_VECTOR_IMPLEMENT_SWAP(Name##_CharVector, Type)\
-\
-enum {\
-	Name##_DEFAULT_CAPACITY = 31\
-};\
+CSTL_VECTOR_IMPLEMENT_SMALL_SWAP(Name##_CharVector, Type, CSTL_STRING_SSO_SIZE(Type))\
 \
 /*! \
  * \brief string構造体\
  * \
- * vectorと同じメンバ\
+ * Name##_CharVectorと同じメンバ。\
+ * 短い文字列はsmallに格納し、bufはsmallを指す。\
  */\
 struct Name {\
 	size_t size;\
 	size_t capacity;\
 	Type *buf;\
+	Type small[CSTL_STRING_SSO_SIZE(Type)];\
 	CSTL_MAGIC(Name *magic;)\
 };\
 \
@@ -189,7 +556,7 @@ static int Name##_expand(Name *self, size_t n)\
 \
 Name *Name##_new(void)\
 {\
-	return Name##_new_reserve(Name##_DEFAULT_CAPACITY);\
+	return Name##_new_reserve(0);\
 }\
 \
 Name *Name##_new_reserve(size_t n)\
@@ -478,15 +845,15 @@ Name *Name##_insert_len(Name *self, size_t idx, const Type *chars, size_t chars_
 		if (Name##_capacity(self) < size + chars_len) {\
 			/* NOTE: charsがself内の文字列の場合、許容量拡張で内部バッファのアドレスが変わって\
 			 * charsが読めなくなる可能性があるためtmpにコピーする。 */\
-			Type *tmp = (Type *) malloc(sizeof(Type) * chars_len);\
+			Type *tmp = (Type *) CSTL_ALLOCATE(Allocator, sizeof(Type) * chars_len);\
 			if (!tmp) return 0;\
 			memcpy(tmp, chars, sizeof(Type) * chars_len);\
 			if (!Name##_insert_n_no_data(self, idx, chars_len)) {\
-				free(tmp);\
+				CSTL_DEALLOCATE(Allocator, tmp);\
 				return 0;\
 			}\
 			memcpy(&CSTL_VECTOR_AT(self, idx), tmp, sizeof(Type) * chars_len);\
-			free(tmp);\
+			CSTL_DEALLOCATE(Allocator, tmp);\
 		} else {\
 			/* charsがself内の文字列だが、許容量拡張はされない */\
 			/* insert_n_no_data()は必ず真を返す */\
@@ -561,16 +928,16 @@ Name *Name##_replace_len(Name *self, size_t idx, size_t len, const Type *chars,
 				/* 拡張必要あり */\
 				/* NOTE: charsがself内の文字列の場合、許容量拡張で内部バッファのアドレスが変わって\
 				 * charsが読めなくなる可能性があるためtmpにコピーする。 */\
-				Type *tmp = (Type *) malloc(sizeof(Type) * chars_len);\
+				Type *tmp = (Type *) CSTL_ALLOCATE(Allocator, sizeof(Type) * chars_len);\
 				if (!tmp) return 0;\
 				memcpy(tmp, chars, sizeof(Type) * chars_len);\
 				if (!Name##_expand(self, size + (chars_len - len))) {\
-					free(tmp);\
+					CSTL_DEALLOCATE(Allocator, tmp);\
 					return 0;\
 				}\
 				memcpy(&CSTL_VECTOR_AT(self, idx), tmp, sizeof(Type) * len);\
 				Name##_insert_len(self, idx + len, &tmp[len], chars_len - len);\
-				free(tmp);\
+				CSTL_DEALLOCATE(Allocator, tmp);\
 			} else {\
 				/* charsがself内の文字列だが、許容量拡張はされない */\
 				if (&CSTL_VECTOR_AT(self, idx) <= chars) {\
@@ -689,7 +1056,12 @@ size_t Name##_find_len(Name *self, const Type *chars, size_t idx, size_t chars_l
 	}\
 	size = Name##_size(self);\
 	if (size <= idx) return CSTL_NPOS;\
-	i = Name##_brute_force_search(&Name##_c_str(self)[idx], size - idx, chars, chars_len);\
+	if (sizeof(Type) == 1) {\
+		i = Name##_byte_search((const unsigned char *) &Name##_c_str(self)[idx], size - idx,\
+				(const unsigned char *) chars, chars_len);\
+	} else {\
+		i = Name##_brute_force_search(&Name##_c_str(self)[idx], size - idx, chars, chars_len);\
+	}\
 	if (i == CSTL_NPOS) return i;\
 	return i + idx;\
 }\
@@ -725,6 +1097,10 @@ size_t Name##_rfind_len(Name *self, const Type *chars, size_t idx, size_t chars_
 	if (size - chars_len < idx) {\
 		idx = size - chars_len;\
 	}\
+	if (sizeof(Type) == 1 && chars_len) {\
+		return Name##_byte_rsearch((const unsigned char *) Name##_c_str(self), idx + chars_len,\
+				(const unsigned char *) chars, chars_len);\
+	}\
 	return Name##_brute_force_search_r(Name##_c_str(self), idx + chars_len, chars, chars_len);\
 }\
 \
@@ -757,6 +1133,12 @@ size_t Name##_find_first_of_len(Name *self, const Type *chars, size_t idx, size_
 		chars_len = Name##_mystrlen(chars);\
 	}\
 	p = Name##_c_str(self);\
+	if (sizeof(Type) == 1 && chars_len) {\
+		i = (chars_len == 1) ?\
+			Name##_byte_chr((const unsigned char *) &p[idx], size - idx, (unsigned char) chars[0]) :\
+			Name##_byte_of((const unsigned char *) &p[idx], size - idx, (const unsigned char *) chars, chars_len, 0);\
+		return (i == CSTL_NPOS) ? i : i + idx;\
+	}\
 	for (i = idx; i < size; i++) {\
 		for (j = 0; j < chars_len; j++) {\
 			if (p[i] == chars[j]) {\
@@ -801,6 +1183,11 @@ size_t Name##_find_last_of_len(Name *self, const Type *chars, size_t idx, size_t
 		chars_len = Name##_mystrlen(chars);\
 	}\
 	p = Name##_c_str(self);\
+	if (sizeof(Type) == 1 && chars_len) {\
+		return (chars_len == 1) ?\
+			Name##_byte_rchr((const unsigned char *) p, idx + 1, (unsigned char) chars[0]) :\
+			Name##_byte_rof((const unsigned char *) p, idx + 1, (const unsigned char *) chars, chars_len, 0);\
+	}\
 	for (i = idx + 1; i > 0; i--) {\
 		for (j = 0; j < chars_len; j++) {\
 			if (p[i - 1] == chars[j]) {\
@@ -843,6 +1230,10 @@ size_t Name##_find_first_not_of_len(Name *self, const Type *chars, size_t idx, s
 		return idx;\
 	}\
 	p = Name##_c_str(self);\
+	if (sizeof(Type) == 1) {\
+		i = Name##_byte_of((const unsigned char *) &p[idx], size - idx, (const unsigned char *) chars, chars_len, 1);\
+		return (i == CSTL_NPOS) ? i : i + idx;\
+	}\
 	for (i = idx; i < size; i++) {\
 		for (j = 0; j < chars_len; j++) {\
 			if (p[i] != chars[j]) {\
@@ -892,6 +1283,9 @@ size_t Name##_find_last_not_of_len(Name *self, const Type *chars, size_t idx, si
 		return idx;\
 	}\
 	p = Name##_c_str(self);\
+	if (sizeof(Type) == 1) {\
+		return Name##_byte_rof((const unsigned char *) p, idx + 1, (const unsigned char *) chars, chars_len, 1);\
+	}\
 	for (i = idx + 1; i > 0; i--) {\
 		for (j = 0; j < chars_len; j++) {\
 			if (p[i - 1] != chars[j]) {\
@@ -0,0 +1,164 @@
+/*
+ * Copyright (c) 2006-2010, KATO Noriaki
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/*!
+ * \file unordered_flat_map.h
+ * \brief unordered_flat_mapコンテナ
+ *
+ * unordered_mapと同じ関数を持つ、オープンアドレス法のハッシュテーブル。
+ * 要素ごとのメモリ確保がなく、検索はキャッシュミス1〜2回で済む。
+ * unordered_mapとの違いは以下の通り。
+ * - 挿入で作り直しが起きると、全てのイテレータと要素へのポインタが無効になる
+ * - 削除では削除した要素を指すイテレータだけが無効になる
+ * - バケット数(スロット数)は常に2のべき乗で、1バケットに入る要素は高々1個
+ * - 最大負荷率の上限は0.875
+ * - multimap版はない
+ */
+#ifndef CSTL_UNORDERED_FLAT_MAP_H_INCLUDED
+#define CSTL_UNORDERED_FLAT_MAP_H_INCLUDED
+
+#include <stdlib.h>
+#include "common.h"
+#include "flat_hashtable.h"
+
+
+/*! 
+ * \brief インターフェイスマクロ
+ * 
+ * \param Name コンテナ名
+ * \param KeyType 要素のキーの型
+ * \param ValueType 要素の値の型
+ */
+#define CSTL_UNORDERED_FLAT_MAP_INTERFACE(Name, KeyType, ValueType)	\
+CSTL_EXTERN_C_BEGIN()\
+CSTL_FLAT_HASHTABLE_INTERFACE(Name, KeyType, ValueType)\
+Name##Iterator Name##_insert(Name *self, KeyType key, ValueType value, int *success);\
+Name##Iterator Name##_insert_ref(Name *self, KeyType key, ValueType const *value, int *success);\
+KeyType const *Name##_key(Name##Iterator pos);\
+ValueType *Name##_value(Name##Iterator pos);\
+ValueType *Name##_at(Name *self, KeyType key);\
+CSTL_EXTERN_C_END()\
+
+/*! 
+ * \brief 実装マクロ
+ * 
+ * \param Name コンテナ名
+ * \param KeyType 要素のキーの型
+ * \param ValueType 要素の値の型
+ * \param Hasher ハッシュ関数
+ * \param Compare 要素の比較ルーチン
+ */
+#define CSTL_UNORDERED_FLAT_MAP_IMPLEMENT(Name, KeyType, ValueType, Hasher, Compare)	\
+\
+typedef struct Name##Node Name##Node;\
+/*! \
+ * \brief unordered_flat_mapスロット構造体\
+ */\
+struct Name##Node {\
+	KeyType key;\
+	ValueType value;\
+	unsigned char used;\
+};\
+\
+CSTL_FLAT_HASHTABLE_IMPLEMENT(Name, KeyType, ValueType, Hasher, Compare)\
+\
+Name##Iterator Name##_insert(Name *self, KeyType key, ValueType value, int *success)\
+{\
+	CSTL_ASSERT(self && "UnorderedFlatMap_insert");\
+	CSTL_ASSERT(self->magic == self && "UnorderedFlatMap_insert");\
+	return Name##_insert_ref(self, key, &value, success);\
+}\
+\
+Name##Iterator Name##_insert_ref(Name *self, KeyType key, ValueType const *value, int *success)\
+{\
+	Name##Node *node;\
+	int inserted;\
+	CSTL_ASSERT(self && "UnorderedFlatMap_insert_ref");\
+	CSTL_ASSERT(self->magic == self && "UnorderedFlatMap_insert_ref");\
+	CSTL_ASSERT(value && "UnorderedFlatMap_insert_ref");\
+	node = Name##_insert_key(self, key, &inserted);\
+	if (inserted) {\
+		node->value = *value;\
+	}\
+	if (success) *success = inserted;\
+	return node;\
+}\
+\
+int Name##_insert_range(Name *self, Name##Iterator first, Name##Iterator last)\
+{\
+	Name##Node *pos;\
+	size_t count = 0;\
+	CSTL_ASSERT(self && "UnorderedFlatMap_insert_range");\
+	CSTL_ASSERT(self->magic == self && "UnorderedFlatMap_insert_range");\
+	CSTL_ASSERT(first && "UnorderedFlatMap_insert_range");\
+	CSTL_ASSERT(last && "UnorderedFlatMap_insert_range");\
+	for (pos = first; pos != last; pos = Name##_next(pos)) {\
+		if (Name##_find(self, pos->key) == Name##_end(self)) {\
+			count++;\
+		}\
+	}\
+	/* 先に作り直しておけば、以降の挿入は失敗しない */\
+	if (!Name##_reserve(self, self->size + count)) {\
+		return 0;\
+	}\
+	for (pos = first; pos != last; pos = Name##_next(pos)) {\
+		Name##_insert_ref(self, pos->key, &pos->value, 0);\
+	}\
+	return 1;\
+}\
+\
+KeyType const *Name##_key(Name##Iterator pos)\
+{\
+	CSTL_ASSERT(pos && "UnorderedFlatMap_key");\
+	CSTL_ASSERT(pos->used == 1 && "UnorderedFlatMap_key"); /* pos != end() */\
+	return &pos->key;\
+}\
+\
+ValueType *Name##_value(Name##Iterator pos)\
+{\
+	CSTL_ASSERT(pos && "UnorderedFlatMap_value");\
+	CSTL_ASSERT(pos->used == 1 && "UnorderedFlatMap_value"); /* pos != end() */\
+	return &pos->value;\
+}\
+\
+ValueType *Name##_at(Name *self, KeyType key)\
+{\
+	Name##Node *node;\
+	int inserted;\
+	CSTL_ASSERT(self && "UnorderedFlatMap_at");\
+	CSTL_ASSERT(self->magic == self && "UnorderedFlatMap_at");\
+	node = Name##_insert_key(self, key, &inserted);\
+	if (!node) {\
+		/* メモリ不足 */\
+		return 0;\
+	}\
+	if (inserted) {\
+		/* 新しい要素の値にはend()の値(0で初期化済み)を使用 */\
+		node->value = self->slots[self->capacity].value;\
+	}\
+	return &node->value;\
+}\
+\
+
+#endif /* CSTL_UNORDERED_FLAT_MAP_H_INCLUDED */
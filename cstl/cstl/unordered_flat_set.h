@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2006-2010, KATO Noriaki
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/*!
+ * \file unordered_flat_set.h
+ * \brief unordered_flat_setコンテナ
+ *
+ * unordered_setと同じ関数を持つ、オープンアドレス法のハッシュテーブル。
+ * unordered_setとの違いはunordered_flat_map.hを参照。
+ */
+#ifndef CSTL_UNORDERED_FLAT_SET_H_INCLUDED
+#define CSTL_UNORDERED_FLAT_SET_H_INCLUDED
+
+#include <stdlib.h>
+#include "common.h"
+#include "flat_hashtable.h"
+
+
+/*! 
+ * \brief インターフェイスマクロ
+ * 
+ * \param Name コンテナ名
+ * \param Type 要素の型
+ */
+#define CSTL_UNORDERED_FLAT_SET_INTERFACE(Name, Type)	\
+CSTL_EXTERN_C_BEGIN()\
+CSTL_FLAT_HASHTABLE_INTERFACE(Name, Type, Type)\
+Name##Iterator Name##_insert(Name *self, Type data, int *success);\
+Type const *Name##_data(Name##Iterator pos);\
+CSTL_EXTERN_C_END()\
+
+/*! 
+ * \brief 実装マクロ
+ * 
+ * \param Name コンテナ名
+ * \param Type 要素の型
+ * \param Hasher ハッシュ関数
+ * \param Compare 要素の比較ルーチン
+ */
+#define CSTL_UNORDERED_FLAT_SET_IMPLEMENT(Name, Type, Hasher, Compare)	\
+\
+typedef struct Name##Node Name##Node;\
+/*! \
+ * \brief unordered_flat_setスロット構造体\
+ */\
+struct Name##Node {\
+	Type key;\
+	unsigned char used;\
+};\
+\
+CSTL_FLAT_HASHTABLE_IMPLEMENT(Name, Type, Type, Hasher, Compare)\
+\
+Name##Iterator Name##_insert(Name *self, Type data, int *success)\
+{\
+	Name##Node *node;\
+	int inserted;\
+	CSTL_ASSERT(self && "UnorderedFlatSet_insert");\
+	CSTL_ASSERT(self->magic == self && "UnorderedFlatSet_insert");\
+	node = Name##_insert_key(self, data, &inserted);\
+	if (success) *success = inserted;\
+	return node;\
+}\
+\
+int Name##_insert_range(Name *self, Name##Iterator first, Name##Iterator last)\
+{\
+	Name##Node *pos;\
+	size_t count = 0;\
+	CSTL_ASSERT(self && "UnorderedFlatSet_insert_range");\
+	CSTL_ASSERT(self->magic == self && "UnorderedFlatSet_insert_range");\
+	CSTL_ASSERT(first && "UnorderedFlatSet_insert_range");\
+	CSTL_ASSERT(last && "UnorderedFlatSet_insert_range");\
+	for (pos = first; pos != last; pos = Name##_next(pos)) {\
+		if (Name##_find(self, pos->key) == Name##_end(self)) {\
+			count++;\
+		}\
+	}\
+	/* 先に作り直しておけば、以降の挿入は失敗しない */\
+	if (!Name##_reserve(self, self->size + count)) {\
+		return 0;\
+	}\
+	for (pos = first; pos != last; pos = Name##_next(pos)) {\
+		Name##_insert(self, pos->key, 0);\
+	}\
+	return 1;\
+}\
+\
+Type const *Name##_data(Name##Iterator pos)\
+{\
+	CSTL_ASSERT(pos && "UnorderedFlatSet_data");\
+	CSTL_ASSERT(pos->used == 1 && "UnorderedFlatSet_data"); /* pos != end() */\
+	return &pos->key;\
+}\
+\
+
+#endif /* CSTL_UNORDERED_FLAT_SET_H_INCLUDED */
@@ -38,7 +38,7 @@
 #include "hashtable.h"
 
 
-#define CSTL_COMMON_UNORDERED_MAP_IMPLEMENT(Name, KeyType, ValueType, Hasher, Compare)	\
+#define CSTL_COMMON_UNORDERED_MAP_IMPLEMENT(Name, KeyType, ValueType, Hasher, Compare, Pooled, Allocator)	\
 \
 typedef struct Name##Node Name##Node;\
 /*! \
@@ -52,10 +52,12 @@ struct Name##Node {\
 	CSTL_MAGIC(struct Name##Node_Vector *magic;)\
 };\
 \
-static Name##Node *Name##Node_new(KeyType key, ValueType const *value)\
+CSTL_HASHTABLE_IMPLEMENT(Name, KeyType, ValueType, Hasher, Compare, Pooled, Allocator)\
+\
+static Name##Node *Name##Node_new(Name *self, KeyType key, ValueType const *value)\
 {\
 	Name##Node *node;\
-	node = (Name##Node *) malloc(sizeof(Name##Node));\
+	node = Name##_alloc_node(self);\
 	if (!node) return 0;\
 	node->key = key;\
 	node->value = *value;\
@@ -63,8 +65,6 @@ static Name##Node *Name##Node_new(KeyType key, ValueType const *value)\
 	return node;\
 }\
 \
-CSTL_HASHTABLE_IMPLEMENT(Name, KeyType, ValueType, Hasher, Compare)\
-\
 KeyType const *Name##_key(Name##Iterator pos)\
 {\
 	CSTL_ASSERT(pos && "UnorderedMap_key");\
@@ -110,9 +110,43 @@ CSTL_EXTERN_C_END()\
  * \param Compare 要素の比較ルーチン
  */
 #define CSTL_UNORDERED_MAP_IMPLEMENT(Name, KeyType, ValueType, Hasher, Compare)	\
-CSTL_COMMON_UNORDERED_MAP_IMPLEMENT(Name, KeyType, ValueType, Hasher, Compare)\
+CSTL_COMMON_UNORDERED_MAP_IMPLEMENT(Name, KeyType, ValueType, Hasher, Compare, 0, CSTL_DEFAULT_ALLOCATOR)\
 CSTL_HASHTABLE_IMPLEMENT_REHASH(Name, KeyType, ValueType, Hasher, Compare)\
-\
+CSTL_UNORDERED_MAP_IMPLEMENT_INSERT(Name, KeyType, ValueType, Hasher, Compare)\
+
+/*! 
+ * \brief ノードプールを使う実装マクロ
+ *
+ * CSTL_UNORDERED_MAP_IMPLEMENT() と同じだが、ノードをコンテナごとのノードプールから確保する。
+ * ノードはチャンク単位でまとめて確保し、clear()/delete()でまとめて解放する。
+ * 
+ * \param Name コンテナ名
+ * \param KeyType 要素のキーの型
+ * \param ValueType 要素の値の型
+ * \param Hasher ハッシュ関数
+ * \param Compare 要素の比較ルーチン
+ */
+#define CSTL_UNORDERED_MAP_IMPLEMENT_POOL(Name, KeyType, ValueType, Hasher, Compare)	\
+CSTL_COMMON_UNORDERED_MAP_IMPLEMENT(Name, KeyType, ValueType, Hasher, Compare, 1, CSTL_DEFAULT_ALLOCATOR)\
+CSTL_HASHTABLE_IMPLEMENT_REHASH(Name, KeyType, ValueType, Hasher, Compare)\
+CSTL_UNORDERED_MAP_IMPLEMENT_INSERT(Name, KeyType, ValueType, Hasher, Compare)\
+
+/*! 
+ * \brief アロケータを指定する実装マクロ
+ * 
+ * \param Name コンテナ名
+ * \param KeyType 要素のキーの型
+ * \param ValueType 要素の値の型
+ * \param Hasher ハッシュ関数
+ * \param Compare 要素の比較ルーチン
+ * \param Allocator アロケータ(CstlAllocator const *)の式
+ */
+#define CSTL_UNORDERED_MAP_IMPLEMENT_ALLOCATOR(Name, KeyType, ValueType, Hasher, Compare, Allocator)	\
+CSTL_COMMON_UNORDERED_MAP_IMPLEMENT(Name, KeyType, ValueType, Hasher, Compare, 0, Allocator)\
+CSTL_HASHTABLE_IMPLEMENT_REHASH(Name, KeyType, ValueType, Hasher, Compare)\
+CSTL_UNORDERED_MAP_IMPLEMENT_INSERT(Name, KeyType, ValueType, Hasher, Compare)\
+
+#define CSTL_UNORDERED_MAP_IMPLEMENT_INSERT(Name, KeyType, ValueType, Hasher, Compare)	\
 Name##Iterator Name##_insert(Name *self, KeyType key, ValueType value, int *success)\
 {\
 	CSTL_ASSERT(self && "UnorderedMap_insert");\
@@ -131,13 +165,13 @@ Name##Iterator Name##_insert_ref(Name *self, KeyType key, ValueType const *value
 	CSTL_ASSERT(self->magic == self && "UnorderedMap_insert_ref");\
 	CSTL_ASSERT(value && "UnorderedMap_insert_ref");\
 	hash_val = Hasher(key);\
-	idx = hash_val % Name##_bucket_count(self);\
+	idx = Name##_index(self, hash_val);\
 	pos = Name##_find_node(self, key, idx);\
 	if (pos != Name##_end(self)) {\
 		if (success) *success = 0;\
 		return pos;\
 	}\
-	node = Name##Node_new(key, value);\
+	node = Name##Node_new(self, key, value);\
 	if (!node) {\
 		if (success) *success = 0;\
 		return node;\
@@ -146,11 +180,11 @@ Name##Iterator Name##_insert_ref(Name *self, KeyType key, ValueType const *value
 	if (self->size + 1 > self->max_load_factor * Name##_bucket_count(self)) {\
 		size_t s = (size_t) ((self->size + 1) / self->max_load_factor) + 1;\
 		if (!Name##_rehash(self, s)) {\
-			Name##Node_erase(node);\
+			Name##Node_erase(self, node);\
 			if (success) *success = 0;\
 			return 0;\
 		}\
-		idx = hash_val % Name##_bucket_count(self);\
+		idx = Name##_index(self, hash_val);\
 	}\
 	alias = Name##Node_Vector_at(self->buckets, idx);\
 	*alias = Name##Node_insert(*alias, node, alias);\
@@ -174,9 +208,9 @@ int Name##_insert_range(Name *self, Name##Iterator first, Name##Iterator last)\
 	for (pos = first; pos != last; pos = Name##_next(pos)) {\
 		if (Name##_find(self, pos->key) == Name##_end(self)) {\
 			Name##Node *node;\
-			node = Name##Node_new(pos->key, &pos->value);\
+			node = Name##Node_new(self, pos->key, &pos->value);\
 			if (!node) {\
-				Name##Node_clear(list);\
+				Name##Node_clear(self, list);\
 				return 0;\
 			}\
 			list = Name##Node_insert(list, node, 0);\
@@ -187,7 +221,7 @@ int Name##_insert_range(Name *self, Name##Iterator first, Name##Iterator last)\
 	if (self->size + count > self->max_load_factor * Name##_bucket_count(self)) {\
 		size_t s = (size_t) ((self->size + count) / self->max_load_factor) + 1;\
 		if (!Name##_rehash(self, s)) {\
-			Name##Node_clear(list);\
+			Name##Node_clear(self, list);\
 			return 0;\
 		}\
 		CSTL_ASSERT(self->size + count <= self->max_load_factor * Name##_bucket_count(self) && "UnorderedMap_insert_range");\
@@ -199,7 +233,7 @@ int Name##_insert_range(Name *self, Name##Iterator first, Name##Iterator last)\
 		list = pos->next;\
 		pos->next = 0;\
 \
-		idx = Hasher(pos->key) % Name##_bucket_count(self);\
+		idx = Name##_index(self, Hasher(pos->key));\
 		alias = Name##Node_Vector_at(self->buckets, idx);\
 		*alias = Name##Node_insert(*alias, pos, alias);\
 		CSTL_MAGIC(pos->magic = self->buckets);\
@@ -216,22 +250,22 @@ ValueType *Name##_at(Name *self, KeyType key)\
 	CSTL_ASSERT(self && "UnorderedMap_at");\
 	CSTL_ASSERT(self->magic == self && "UnorderedMap_at");\
 	hash_val = Hasher(key);\
-	idx = hash_val % Name##_bucket_count(self);\
+	idx = Name##_index(self, hash_val);\
 	pos = Name##_find_node(self, key, idx);\
 	if (pos == Name##_end(self)) {\
 		/* 新しい要素の値にはend_nodeの値を使用 */\
-		pos = Name##Node_new(key, &self->end_node.value);\
+		pos = Name##Node_new(self, key, &self->end_node.value);\
 		if (pos) {\
 			Name##Node **alias;\
 			/* rehash */\
 			if (self->size + 1 > self->max_load_factor * Name##_bucket_count(self)) {\
 				size_t s = (size_t) ((self->size + 1) / self->max_load_factor) + 1;\
 				if (!Name##_rehash(self, s)) {\
-					Name##Node_erase(pos);\
+					Name##Node_erase(self, pos);\
 					/* メモリ不足 */\
 					return 0;\
 				}\
-				idx = hash_val % Name##_bucket_count(self);\
+				idx = Name##_index(self, hash_val);\
 			}\
 			alias = Name##Node_Vector_at(self->buckets, idx);\
 			*alias = Name##Node_insert(*alias, pos, alias);\
@@ -273,9 +307,43 @@ CSTL_EXTERN_C_END()\
  * \param Compare 要素の比較ルーチン
  */
 #define CSTL_UNORDERED_MULTIMAP_IMPLEMENT(Name, KeyType, ValueType, Hasher, Compare)	\
-CSTL_COMMON_UNORDERED_MAP_IMPLEMENT(Name, KeyType, ValueType, Hasher, Compare)\
+CSTL_COMMON_UNORDERED_MAP_IMPLEMENT(Name, KeyType, ValueType, Hasher, Compare, 0, CSTL_DEFAULT_ALLOCATOR)\
 CSTL_HASHTABLE_IMPLEMENT_REHASH_MULTI(Name, KeyType, ValueType, Hasher, Compare)\
-\
+CSTL_UNORDERED_MULTIMAP_IMPLEMENT_INSERT(Name, KeyType, ValueType, Hasher, Compare)\
+
+/*! 
+ * \brief ノードプールを使う実装マクロ
+ *
+ * CSTL_UNORDERED_MULTIMAP_IMPLEMENT() と同じだが、ノードをコンテナごとのノードプールから確保する。
+ * ノードはチャンク単位でまとめて確保し、clear()/delete()でまとめて解放する。
+ * 
+ * \param Name コンテナ名
+ * \param KeyType 要素のキーの型
+ * \param ValueType 要素の値の型
+ * \param Hasher ハッシュ関数
+ * \param Compare 要素の比較ルーチン
+ */
+#define CSTL_UNORDERED_MULTIMAP_IMPLEMENT_POOL(Name, KeyType, ValueType, Hasher, Compare)	\
+CSTL_COMMON_UNORDERED_MAP_IMPLEMENT(Name, KeyType, ValueType, Hasher, Compare, 1, CSTL_DEFAULT_ALLOCATOR)\
+CSTL_HASHTABLE_IMPLEMENT_REHASH_MULTI(Name, KeyType, ValueType, Hasher, Compare)\
+CSTL_UNORDERED_MULTIMAP_IMPLEMENT_INSERT(Name, KeyType, ValueType, Hasher, Compare)\
+
+/*! 
+ * \brief アロケータを指定する実装マクロ
+ * 
+ * \param Name コンテナ名
+ * \param KeyType 要素のキーの型
+ * \param ValueType 要素の値の型
+ * \param Hasher ハッシュ関数
+ * \param Compare 要素の比較ルーチン
+ * \param Allocator アロケータ(CstlAllocator const *)の式
+ */
+#define CSTL_UNORDERED_MULTIMAP_IMPLEMENT_ALLOCATOR(Name, KeyType, ValueType, Hasher, Compare, Allocator)	\
+CSTL_COMMON_UNORDERED_MAP_IMPLEMENT(Name, KeyType, ValueType, Hasher, Compare, 0, Allocator)\
+CSTL_HASHTABLE_IMPLEMENT_REHASH_MULTI(Name, KeyType, ValueType, Hasher, Compare)\
+CSTL_UNORDERED_MULTIMAP_IMPLEMENT_INSERT(Name, KeyType, ValueType, Hasher, Compare)\
+
+#define CSTL_UNORDERED_MULTIMAP_IMPLEMENT_INSERT(Name, KeyType, ValueType, Hasher, Compare)	\
 Name##Iterator Name##_insert(Name *self, KeyType key, ValueType value)\
 {\
 	CSTL_ASSERT(self && "UnorderedMultiMap_insert");\
@@ -295,8 +363,8 @@ Name##Iterator Name##_insert_ref(Name *self, KeyType key, ValueType const *value
 	CSTL_ASSERT(self->magic == self && "UnorderedMultiMap_insert_ref");\
 	CSTL_ASSERT(value && "UnorderedMultiMap_insert_ref");\
 	hash_val = Hasher(key);\
-	idx = hash_val % Name##_bucket_count(self);\
-	node = Name##Node_new(key, value);\
+	idx = Name##_index(self, hash_val);\
+	node = Name##Node_new(self, key, value);\
 	if (!node) {\
 		return node;\
 	}\
@@ -304,10 +372,10 @@ Name##Iterator Name##_insert_ref(Name *self, KeyType key, ValueType const *value
 	if (self->size + 1 > self->max_load_factor * Name##_bucket_count(self)) {\
 		size_t s = (size_t) ((self->size + 1) / self->max_load_factor) + 1;\
 		if (!Name##_rehash(self, s)) {\
-			Name##Node_erase(node);\
+			Name##Node_erase(self, node);\
 			return 0;\
 		}\
-		idx = hash_val % Name##_bucket_count(self);\
+		idx = Name##_index(self, hash_val);\
 	}\
 	alias = Name##Node_Vector_at(self->buckets, idx);\
 	/* 同じキーを並べるため、バケットの各要素のキーをチェック */\
@@ -343,9 +411,9 @@ int Name##_insert_range(Name *self, Name##Iterator first, Name##Iterator last)\
 	CSTL_ASSERT(last->magic && "UnorderedMultiMap_insert_range");\
 	for (pos = first; pos != last; pos = Name##_next(pos)) {\
 		Name##Node *node;\
-		node = Name##Node_new(pos->key, &pos->value);\
+		node = Name##Node_new(self, pos->key, &pos->value);\
 		if (!node) {\
-			Name##Node_clear(list);\
+			Name##Node_clear(self, list);\
 			return 0;\
 		}\
 		list = Name##Node_insert(list, node, 0);\
@@ -355,7 +423,7 @@ int Name##_insert_range(Name *self, Name##Iterator first, Name##Iterator last)\
 	if (self->size + count > self->max_load_factor * Name##_bucket_count(self)) {\
 		size_t s = (size_t) ((self->size + count) / self->max_load_factor) + 1;\
 		if (!Name##_rehash(self, s)) {\
-			Name##Node_clear(list);\
+			Name##Node_clear(self, list);\
 			return 0;\
 		}\
 		CSTL_ASSERT(self->size + count <= self->max_load_factor * Name##_bucket_count(self) && "UnorderedMultiMap_insert_range");\
@@ -369,7 +437,7 @@ int Name##_insert_range(Name *self, Name##Iterator first, Name##Iterator last)\
 		list = pos->next;\
 		pos->next = 0;\
 \
-		idx = Hasher(pos->key) % Name##_bucket_count(self);\
+		idx = Name##_index(self, Hasher(pos->key));\
 		alias = Name##Node_Vector_at(self->buckets, idx);\
 		/* 同じキーを並べるため、バケットの各要素のキーをチェック */\
 		for (i = *alias, prev = 0; i != 0; prev = i, i = i->next) {\
@@ -38,7 +38,7 @@
 #include "hashtable.h"
 
 
-#define CSTL_COMMON_UNORDERED_SET_IMPLEMENT(Name, Type, Hasher, Compare)	\
+#define CSTL_COMMON_UNORDERED_SET_IMPLEMENT(Name, Type, Hasher, Compare, Pooled, Allocator)	\
 \
 typedef struct Name##Node Name##Node;\
 /*! \
@@ -51,18 +51,18 @@ struct Name##Node {\
 	CSTL_MAGIC(struct Name##Node_Vector *magic;)\
 };\
 \
-static Name##Node *Name##Node_new(Type data)\
+CSTL_HASHTABLE_IMPLEMENT(Name, Type, Type, Hasher, Compare, Pooled, Allocator)\
+\
+static Name##Node *Name##Node_new(Name *self, Type data)\
 {\
 	Name##Node *node;\
-	node = (Name##Node *) malloc(sizeof(Name##Node));\
+	node = Name##_alloc_node(self);\
 	if (!node) return 0;\
 	node->key = data;\
 	node->next = 0;\
 	return node;\
 }\
 \
-CSTL_HASHTABLE_IMPLEMENT(Name, Type, Type, Hasher, Compare)\
-\
 Type const *Name##_data(Name##Iterator pos)\
 {\
 	CSTL_ASSERT(pos && "UnorderedSet_data");\
@@ -95,9 +95,41 @@ CSTL_EXTERN_C_END()\
  * \param Compare 要素の比較ルーチン
  */
 #define CSTL_UNORDERED_SET_IMPLEMENT(Name, Type, Hasher, Compare)	\
-CSTL_COMMON_UNORDERED_SET_IMPLEMENT(Name, Type, Hasher, Compare)\
+CSTL_COMMON_UNORDERED_SET_IMPLEMENT(Name, Type, Hasher, Compare, 0, CSTL_DEFAULT_ALLOCATOR)\
 CSTL_HASHTABLE_IMPLEMENT_REHASH(Name, Type, Type, Hasher, Compare)\
-\
+CSTL_UNORDERED_SET_IMPLEMENT_INSERT(Name, Type, Hasher, Compare)\
+
+/*! 
+ * \brief ノードプールを使う実装マクロ
+ *
+ * CSTL_UNORDERED_SET_IMPLEMENT() と同じだが、ノードをコンテナごとのノードプールから確保する。
+ * ノードはチャンク単位でまとめて確保し、clear()/delete()でまとめて解放する。
+ * 
+ * \param Name コンテナ名
+ * \param Type 要素の型
+ * \param Hasher ハッシュ関数
+ * \param Compare 要素の比較ルーチン
+ */
+#define CSTL_UNORDERED_SET_IMPLEMENT_POOL(Name, Type, Hasher, Compare)	\
+CSTL_COMMON_UNORDERED_SET_IMPLEMENT(Name, Type, Hasher, Compare, 1, CSTL_DEFAULT_ALLOCATOR)\
+CSTL_HASHTABLE_IMPLEMENT_REHASH(Name, Type, Type, Hasher, Compare)\
+CSTL_UNORDERED_SET_IMPLEMENT_INSERT(Name, Type, Hasher, Compare)\
+
+/*! 
+ * \brief アロケータを指定する実装マクロ
+ * 
+ * \param Name コンテナ名
+ * \param Type 要素の型
+ * \param Hasher ハッシュ関数
+ * \param Compare 要素の比較ルーチン
+ * \param Allocator アロケータ(CstlAllocator const *)の式
+ */
+#define CSTL_UNORDERED_SET_IMPLEMENT_ALLOCATOR(Name, Type, Hasher, Compare, Allocator)	\
+CSTL_COMMON_UNORDERED_SET_IMPLEMENT(Name, Type, Hasher, Compare, 0, Allocator)\
+CSTL_HASHTABLE_IMPLEMENT_REHASH(Name, Type, Type, Hasher, Compare)\
+CSTL_UNORDERED_SET_IMPLEMENT_INSERT(Name, Type, Hasher, Compare)\
+
+#define CSTL_UNORDERED_SET_IMPLEMENT_INSERT(Name, Type, Hasher, Compare)	\
 Name##Iterator Name##_insert(Name *self, Type data, int *success)\
 {\
 	Name##Node **alias;\
@@ -108,13 +140,13 @@ Name##Iterator Name##_insert(Name *self, Type data, int *success)\
 	CSTL_ASSERT(self && "UnorderedSet_insert");\
 	CSTL_ASSERT(self->magic == self && "UnorderedSet_insert");\
 	hash_val = Hasher(data);\
-	idx = hash_val % Name##_bucket_count(self);\
+	idx = Name##_index(self, hash_val);\
 	pos = Name##_find_node(self, data, idx);\
 	if (pos != Name##_end(self)) {\
 		if (success) *success = 0;\
 		return pos;\
 	}\
-	node = Name##Node_new(data);\
+	node = Name##Node_new(self, data);\
 	if (!node) {\
 		if (success) *success = 0;\
 		return node;\
@@ -123,11 +155,11 @@ Name##Iterator Name##_insert(Name *self, Type data, int *success)\
 	if (self->size + 1 > self->max_load_factor * Name##_bucket_count(self)) {\
 		size_t s = (size_t) ((self->size + 1) / self->max_load_factor) + 1;\
 		if (!Name##_rehash(self, s)) {\
-			Name##Node_erase(node);\
+			Name##Node_erase(self, node);\
 			if (success) *success = 0;\
 			return 0;\
 		}\
-		idx = hash_val % Name##_bucket_count(self);\
+		idx = Name##_index(self, hash_val);\
 	}\
 	alias = Name##Node_Vector_at(self->buckets, idx);\
 	*alias = Name##Node_insert(*alias, node, alias);\
@@ -151,9 +183,9 @@ int Name##_insert_range(Name *self, Name##Iterator first, Name##Iterator last)\
 	for (pos = first; pos != last; pos = Name##_next(pos)) {\
 		if (Name##_find(self, pos->key) == Name##_end(self)) {\
 			Name##Node *node;\
-			node = Name##Node_new(pos->key);\
+			node = Name##Node_new(self, pos->key);\
 			if (!node) {\
-				Name##Node_clear(list);\
+				Name##Node_clear(self, list);\
 				return 0;\
 			}\
 			list = Name##Node_insert(list, node, 0);\
@@ -164,7 +196,7 @@ int Name##_insert_range(Name *self, Name##Iterator first, Name##Iterator last)\
 	if (self->size + count > self->max_load_factor * Name##_bucket_count(self)) {\
 		size_t s = (size_t) ((self->size + count) / self->max_load_factor) + 1;\
 		if (!Name##_rehash(self, s)) {\
-			Name##Node_clear(list);\
+			Name##Node_clear(self, list);\
 			return 0;\
 		}\
 		CSTL_ASSERT(self->size + count <= self->max_load_factor * Name##_bucket_count(self) && "UnorderedSet_insert_range");\
@@ -176,7 +208,7 @@ int Name##_insert_range(Name *self, Name##Iterator first, Name##Iterator last)\
 		list = pos->next;\
 		pos->next = 0;\
 \
-		idx = Hasher(pos->key) % Name##_bucket_count(self);\
+		idx = Name##_index(self, Hasher(pos->key));\
 		alias = Name##Node_Vector_at(self->buckets, idx);\
 		*alias = Name##Node_insert(*alias, pos, alias);\
 		CSTL_MAGIC(pos->magic = self->buckets);\
@@ -209,9 +241,41 @@ CSTL_EXTERN_C_END()\
  * \param Compare 要素の比較ルーチン
  */
 #define CSTL_UNORDERED_MULTISET_IMPLEMENT(Name, Type, Hasher, Compare)	\
-CSTL_COMMON_UNORDERED_SET_IMPLEMENT(Name, Type, Hasher, Compare)\
+CSTL_COMMON_UNORDERED_SET_IMPLEMENT(Name, Type, Hasher, Compare, 0, CSTL_DEFAULT_ALLOCATOR)\
 CSTL_HASHTABLE_IMPLEMENT_REHASH_MULTI(Name, Type, Type, Hasher, Compare)\
-\
+CSTL_UNORDERED_MULTISET_IMPLEMENT_INSERT(Name, Type, Hasher, Compare)\
+
+/*! 
+ * \brief ノードプールを使う実装マクロ
+ *
+ * CSTL_UNORDERED_MULTISET_IMPLEMENT() と同じだが、ノードをコンテナごとのノードプールから確保する。
+ * ノードはチャンク単位でまとめて確保し、clear()/delete()でまとめて解放する。
+ * 
+ * \param Name コンテナ名
+ * \param Type 要素の型
+ * \param Hasher ハッシュ関数
+ * \param Compare 要素の比較ルーチン
+ */
+#define CSTL_UNORDERED_MULTISET_IMPLEMENT_POOL(Name, Type, Hasher, Compare)	\
+CSTL_COMMON_UNORDERED_SET_IMPLEMENT(Name, Type, Hasher, Compare, 1, CSTL_DEFAULT_ALLOCATOR)\
+CSTL_HASHTABLE_IMPLEMENT_REHASH_MULTI(Name, Type, Type, Hasher, Compare)\
+CSTL_UNORDERED_MULTISET_IMPLEMENT_INSERT(Name, Type, Hasher, Compare)\
+
+/*! 
+ * \brief アロケータを指定する実装マクロ
+ * 
+ * \param Name コンテナ名
+ * \param Type 要素の型
+ * \param Hasher ハッシュ関数
+ * \param Compare 要素の比較ルーチン
+ * \param Allocator アロケータ(CstlAllocator const *)の式
+ */
+#define CSTL_UNORDERED_MULTISET_IMPLEMENT_ALLOCATOR(Name, Type, Hasher, Compare, Allocator)	\
+CSTL_COMMON_UNORDERED_SET_IMPLEMENT(Name, Type, Hasher, Compare, 0, Allocator)\
+CSTL_HASHTABLE_IMPLEMENT_REHASH_MULTI(Name, Type, Type, Hasher, Compare)\
+CSTL_UNORDERED_MULTISET_IMPLEMENT_INSERT(Name, Type, Hasher, Compare)\
+
+#define CSTL_UNORDERED_MULTISET_IMPLEMENT_INSERT(Name, Type, Hasher, Compare)	\
 Name##Iterator Name##_insert(Name *self, Type data)\
 {\
 	Name##Node **alias;\
@@ -223,8 +287,8 @@ Name##Iterator Name##_insert(Name *self, Type data)\
 	CSTL_ASSERT(self && "UnorderedMultiSet_insert");\
 	CSTL_ASSERT(self->magic == self && "UnorderedMultiSet_insert");\
 	hash_val = Hasher(data);\
-	idx = hash_val % Name##_bucket_count(self);\
-	node = Name##Node_new(data);\
+	idx = Name##_index(self, hash_val);\
+	node = Name##Node_new(self, data);\
 	if (!node) {\
 		return node;\
 	}\
@@ -232,10 +296,10 @@ Name##Iterator Name##_insert(Name *self, Type data)\
 	if (self->size + 1 > self->max_load_factor * Name##_bucket_count(self)) {\
 		size_t s = (size_t) ((self->size + 1) / self->max_load_factor) + 1;\
 		if (!Name##_rehash(self, s)) {\
-			Name##Node_erase(node);\
+			Name##Node_erase(self, node);\
 			return 0;\
 		}\
-		idx = hash_val % Name##_bucket_count(self);\
+		idx = Name##_index(self, hash_val);\
 	}\
 	alias = Name##Node_Vector_at(self->buckets, idx);\
 	/* 同じキーを並べるため、バケットの各要素のキーをチェック */\
@@ -271,9 +335,9 @@ int Name##_insert_range(Name *self, Name##Iterator first, Name##Iterator last)\
 	CSTL_ASSERT(last->magic && "UnorderedMultiSet_insert_range");\
 	for (pos = first; pos != last; pos = Name##_next(pos)) {\
 		Name##Node *node;\
-		node = Name##Node_new(pos->key);\
+		node = Name##Node_new(self, pos->key);\
 		if (!node) {\
-			Name##Node_clear(list);\
+			Name##Node_clear(self, list);\
 			return 0;\
 		}\
 		list = Name##Node_insert(list, node, 0);\
@@ -283,7 +347,7 @@ int Name##_insert_range(Name *self, Name##Iterator first, Name##Iterator last)\
 	if (self->size + count > self->max_load_factor * Name##_bucket_count(self)) {\
 		size_t s = (size_t) ((self->size + count) / self->max_load_factor) + 1;\
 		if (!Name##_rehash(self, s)) {\
-			Name##Node_clear(list);\
+			Name##Node_clear(self, list);\
 			return 0;\
 		}\
 		CSTL_ASSERT(self->size + count <= self->max_load_factor * Name##_bucket_count(self) && "UnorderedMultiSet_insert_range");\
@@ -297,7 +361,7 @@ int Name##_insert_range(Name *self, Name##Iterator first, Name##Iterator last)\
 		list = pos->next;\
 		pos->next = 0;\
 \
-		idx = Hasher(pos->key) % Name##_bucket_count(self);\
+		idx = Name##_index(self, Hasher(pos->key));\
 		alias = Name##Node_Vector_at(self->buckets, idx);\
 		/* 同じキーを並べるため、バケットの各要素のキーをチェック */\
 		for (i = *alias, prev = 0; i != 0; prev = i, i = i->next) {\
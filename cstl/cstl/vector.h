@@ -94,7 +94,7 @@ CSTL_EXTERN_C_END()\
 
 
 
-#define CSTL_VECTOR_IMPLEMENT_BASE(Name, Type)	\
+#define CSTL_VECTOR_IMPLEMENT_BASE(Name, Type, Allocator)	\
 /*! \
  * \brief vector構造体\
  */\
@@ -108,7 +108,7 @@ struct Name {\
 Name *Name##_new(void)\
 {\
 	Name *self;\
-	self = (Name *) malloc(sizeof(Name));\
+	self = (Name *) CSTL_ALLOCATE(Allocator, sizeof(Name));\
 	if (!self) return 0;\
 	self->capacity = 0;\
 	self->size = 0;\
@@ -134,8 +134,8 @@ void Name##_delete(Name *self)\
 	if (!self) return;\
 	CSTL_ASSERT(self->magic == self && "Vector_delete");\
 	CSTL_MAGIC(self->magic = 0);\
-	free(self->buf);\
-	free(self);\
+	CSTL_DEALLOCATE(Allocator, self->buf);\
+	CSTL_DEALLOCATE(Allocator, self);\
 }\
 \
 
@@ -206,7 +206,7 @@ void Name##_clear(Name *self)\
 }\
 \
 
-#define CSTL_VECTOR_IMPLEMENT_RESERVE(Name, Type)	\
+#define CSTL_VECTOR_IMPLEMENT_RESERVE(Name, Type, Allocator)	\
 static int Name##_expand(Name *self, size_t size)\
 {\
 	size_t n;\
@@ -225,7 +225,7 @@ int Name##_reserve(Name *self, size_t n)\
 		/* sizeof(Type)*n がオーバーフローする */\
 		return 0;\
 	}\
-	newbuf = (Type *) realloc(self->buf, sizeof(Type) * n);\
+	newbuf = (Type *) CSTL_REALLOCATE(Allocator, self->buf, sizeof(Type) * n);\
 	if (!newbuf) return 0;\
 	self->buf = newbuf;\
 	self->capacity = n;\
@@ -233,7 +233,7 @@ int Name##_reserve(Name *self, size_t n)\
 }\
 \
 
-#define CSTL_VECTOR_IMPLEMENT_SHRINK(Name, Type)	\
+#define CSTL_VECTOR_IMPLEMENT_SHRINK(Name, Type, Allocator)	\
 void Name##_shrink(Name *self, size_t n)\
 {\
 	Type *newbuf;\
@@ -245,11 +245,11 @@ void Name##_shrink(Name *self, size_t n)\
 	}\
 	self->capacity = n;\
 	if (!n) {\
-		free(self->buf);\
+		CSTL_DEALLOCATE(Allocator, self->buf);\
 		self->buf = 0;\
 		return;\
 	}\
-	newbuf = (Type *) realloc(self->buf, sizeof(Type) * n);\
+	newbuf = (Type *) CSTL_REALLOCATE(Allocator, self->buf, sizeof(Type) * n);\
 	if (newbuf) {\
 		self->buf = newbuf;\
 	}\
@@ -465,8 +465,18 @@ void Name##_swap(Name *self, Name *x)\
  * \param Type 要素の型
  */
 #define CSTL_VECTOR_IMPLEMENT(Name, Type)	\
-CSTL_VECTOR_IMPLEMENT_BASE(Name, Type)\
-CSTL_VECTOR_IMPLEMENT_RESERVE(Name, Type)\
+CSTL_VECTOR_IMPLEMENT_ALLOCATOR(Name, Type, CSTL_DEFAULT_ALLOCATOR)\
+
+/*! 
+ * \brief アロケータを指定する実装マクロ
+ * 
+ * \param Name コンテナ名
+ * \param Type 要素の型
+ * \param Allocator アロケータ(CstlAllocator const *)の式
+ */
+#define CSTL_VECTOR_IMPLEMENT_ALLOCATOR(Name, Type, Allocator)	\
+CSTL_VECTOR_IMPLEMENT_BASE(Name, Type, Allocator)\
+CSTL_VECTOR_IMPLEMENT_RESERVE(Name, Type, Allocator)\
 CSTL_VECTOR_IMPLEMENT_MOVE_FORWARD(Name, Type)\
 CSTL_VECTOR_IMPLEMENT_MOVE_BACKWARD(Name, Type)\
 CSTL_VECTOR_IMPLEMENT_INSERT_N_NO_DATA(Name, Type)\
@@ -476,7 +486,7 @@ CSTL_VECTOR_IMPLEMENT_SIZE(Name, Type)\
 CSTL_VECTOR_IMPLEMENT_CAPACITY(Name, Type)\
 CSTL_VECTOR_IMPLEMENT_EMPTY(Name, Type)\
 CSTL_VECTOR_IMPLEMENT_CLEAR(Name, Type)\
-CSTL_VECTOR_IMPLEMENT_SHRINK(Name, Type)\
+CSTL_VECTOR_IMPLEMENT_SHRINK(Name, Type, Allocator)\
 CSTL_VECTOR_IMPLEMENT_RESIZE(Name, Type)\
 CSTL_VECTOR_IMPLEMENT_AT(Name, Type)\
 CSTL_VECTOR_IMPLEMENT_FRONT(Name, Type)\
@@ -490,4 +500,181 @@ CSTL_VECTOR_IMPLEMENT_SWAP(Name, Type)\
 CSTL_ALGORITHM_IMPLEMENT(Name, Type, CSTL_VECTOR_AT)\
 
 
+#define CSTL_VECTOR_IMPLEMENT_SMALL_BASE(Name, Type, N, Allocator)	\
+/*! \
+ * \brief 要素をN個まで内部に持つvector構造体\
+ */\
+struct Name {\
+	size_t size;\
+	size_t capacity;\
+	Type *buf;\
+	Type small[N];\
+	CSTL_MAGIC(Name *magic;)\
+};\
+\
+Name *Name##_new(void)\
+{\
+	Name *self;\
+	self = (Name *) CSTL_ALLOCATE(Allocator, sizeof(Name));\
+	if (!self) return 0;\
+	self->capacity = N;\
+	self->size = 0;\
+	self->buf = self->small;\
+	CSTL_MAGIC(self->magic = self);\
+	return self;\
+}\
+\
+Name *Name##_new_reserve(size_t n)\
+{\
+	Name *self;\
+	self = Name##_new();\
+	if (!self) return 0;\
+	if (!Name##_reserve(self, n)) {\
+		Name##_delete(self);\
+		return 0;\
+	}\
+	return self;\
+}\
+\
+void Name##_delete(Name *self)\
+{\
+	if (!self) return;\
+	CSTL_ASSERT(self->magic == self && "Vector_delete");\
+	CSTL_MAGIC(self->magic = 0);\
+	if (self->buf != self->small) {\
+		CSTL_DEALLOCATE(Allocator, self->buf);\
+	}\
+	CSTL_DEALLOCATE(Allocator, self);\
+}\
+\
+
+#define CSTL_VECTOR_IMPLEMENT_SMALL_RESERVE(Name, Type, N, Allocator)	\
+static int Name##_expand(Name *self, size_t size)\
+{\
+	size_t n;\
+	if (size <= CSTL_VECTOR_CAPACITY(self)) return 1;\
+	n = (size > CSTL_VECTOR_CAPACITY(self) * 2) ? size : CSTL_VECTOR_CAPACITY(self) * 2;\
+	return Name##_reserve(self, n);\
+}\
+\
+int Name##_reserve(Name *self, size_t n)\
+{\
+	Type *newbuf;\
+	CSTL_ASSERT(self && "Vector_reserve");\
+	CSTL_ASSERT(self->magic == self && "Vector_reserve");\
+	if (n <= CSTL_VECTOR_CAPACITY(self)) return 1;\
+	if (n > ((size_t) -1) / sizeof(Type)) {\
+		/* sizeof(Type)*n がオーバーフローする */\
+		return 0;\
+	}\
+	if (self->buf == self->small) {\
+		/* 内部の配列からヒープに移す */\
+		newbuf = (Type *) CSTL_ALLOCATE(Allocator, sizeof(Type) * n);\
+		if (!newbuf) return 0;\
+		memcpy(newbuf, self->small, sizeof(Type) * CSTL_VECTOR_SIZE(self));\
+	} else {\
+		newbuf = (Type *) CSTL_REALLOCATE(Allocator, self->buf, sizeof(Type) * n);\
+		if (!newbuf) return 0;\
+	}\
+	self->buf = newbuf;\
+	self->capacity = n;\
+	return 1;\
+}\
+\
+
+#define CSTL_VECTOR_IMPLEMENT_SMALL_SHRINK(Name, Type, N, Allocator)	\
+void Name##_shrink(Name *self, size_t n)\
+{\
+	Type *newbuf;\
+	CSTL_ASSERT(self && "Vector_shrink");\
+	CSTL_ASSERT(self->magic == self && "Vector_shrink");\
+	if (n >= CSTL_VECTOR_CAPACITY(self)) return;\
+	if (self->buf == self->small) return;\
+	if (n < CSTL_VECTOR_SIZE(self)) {\
+		n = CSTL_VECTOR_SIZE(self);\
+	}\
+	if (n <= N) {\
+		/* 内部の配列に戻す */\
+		memcpy(self->small, self->buf, sizeof(Type) * CSTL_VECTOR_SIZE(self));\
+		CSTL_DEALLOCATE(Allocator, self->buf);\
+		self->buf = self->small;\
+		self->capacity = N;\
+		return;\
+	}\
+	self->capacity = n;\
+	newbuf = (Type *) CSTL_REALLOCATE(Allocator, self->buf, sizeof(Type) * n);\
+	if (newbuf) {\
+		self->buf = newbuf;\
+	}\
+}\
+\
+
+#define CSTL_VECTOR_IMPLEMENT_SMALL_SWAP(Name, Type, N)	\
+void Name##_swap(Name *self, Name *x)\
+{\
+	Name tmp;\
+	CSTL_ASSERT(self && "Vector_swap");\
+	CSTL_ASSERT(x && "Vector_swap");\
+	CSTL_ASSERT(self->magic == self && "Vector_swap");\
+	CSTL_ASSERT(x->magic == x && "Vector_swap");\
+	tmp = *self;\
+	*self = *x;\
+	*x = tmp;\
+	/* 内部の配列を使っていた場合は、コピー先の配列を指し直す */\
+	if (self->buf == x->small) {\
+		self->buf = self->small;\
+	}\
+	if (x->buf == self->small) {\
+		x->buf = x->small;\
+	}\
+	CSTL_MAGIC(self->magic = self);\
+	CSTL_MAGIC(x->magic = x);\
+}\
+\
+
+
+/*! 
+ * \brief 要素をN個まで内部に持つ実装マクロ
+ * 
+ * \param Name コンテナ名
+ * \param Type 要素の型
+ * \param N 構造体の内部に持つ要素数(1以上)
+ */
+#define CSTL_VECTOR_IMPLEMENT_SMALL(Name, Type, N)	\
+CSTL_VECTOR_IMPLEMENT_SMALL_ALLOCATOR(Name, Type, N, CSTL_DEFAULT_ALLOCATOR)\
+
+/*! 
+ * \brief 要素をN個まで内部に持ち、アロケータを指定する実装マクロ
+ * 
+ * \param Name コンテナ名
+ * \param Type 要素の型
+ * \param N 構造体の内部に持つ要素数(1以上)
+ * \param Allocator アロケータ(CstlAllocator const *)の式
+ */
+#define CSTL_VECTOR_IMPLEMENT_SMALL_ALLOCATOR(Name, Type, N, Allocator)	\
+CSTL_VECTOR_IMPLEMENT_SMALL_BASE(Name, Type, N, Allocator)\
+CSTL_VECTOR_IMPLEMENT_SMALL_RESERVE(Name, Type, N, Allocator)\
+CSTL_VECTOR_IMPLEMENT_MOVE_FORWARD(Name, Type)\
+CSTL_VECTOR_IMPLEMENT_MOVE_BACKWARD(Name, Type)\
+CSTL_VECTOR_IMPLEMENT_INSERT_N_NO_DATA(Name, Type)\
+CSTL_VECTOR_IMPLEMENT_PUSH_BACK(Name, Type)\
+CSTL_VECTOR_IMPLEMENT_POP_BACK(Name, Type)\
+CSTL_VECTOR_IMPLEMENT_SIZE(Name, Type)\
+CSTL_VECTOR_IMPLEMENT_CAPACITY(Name, Type)\
+CSTL_VECTOR_IMPLEMENT_EMPTY(Name, Type)\
+CSTL_VECTOR_IMPLEMENT_CLEAR(Name, Type)\
+CSTL_VECTOR_IMPLEMENT_SMALL_SHRINK(Name, Type, N, Allocator)\
+CSTL_VECTOR_IMPLEMENT_RESIZE(Name, Type)\
+CSTL_VECTOR_IMPLEMENT_AT(Name, Type)\
+CSTL_VECTOR_IMPLEMENT_FRONT(Name, Type)\
+CSTL_VECTOR_IMPLEMENT_BACK(Name, Type)\
+CSTL_VECTOR_IMPLEMENT_INSERT(Name, Type)\
+CSTL_VECTOR_IMPLEMENT_INSERT_N(Name, Type)\
+CSTL_VECTOR_IMPLEMENT_INSERT_ARRAY(Name, Type)\
+CSTL_VECTOR_IMPLEMENT_INSERT_RANGE(Name, Type)\
+CSTL_VECTOR_IMPLEMENT_ERASE(Name, Type)\
+CSTL_VECTOR_IMPLEMENT_SMALL_SWAP(Name, Type, N)\
+CSTL_ALGORITHM_IMPLEMENT(Name, Type, CSTL_VECTOR_AT)\
+
+
 #endif /* CSTL_VECTOR_H_INCLUDED */
@@ -0,0 +1,141 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/time.h>
+#endif
+#include <cstl/unordered_map.h>
+#include <cstl/concurrent_unordered_map.h>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+CSTL_UNORDERED_MAP_INTERFACE(UMap, unsigned int, int)
+CSTL_UNORDERED_MAP_IMPLEMENT(UMap, unsigned int, int, UMap_hash_mix, CSTL_EQUAL_TO)
+
+CSTL_CONCURRENT_UNORDERED_MAP_INTERFACE(CMap, unsigned int, int)
+CSTL_CONCURRENT_UNORDERED_MAP_IMPLEMENT(CMap, unsigned int, int, CMap_hash_mix, CSTL_EQUAL_TO)
+
+using namespace std;
+
+
+double get_msec(void)
+{
+#ifdef _WIN32
+	return (double) GetTickCount();
+#else
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+#endif
+}
+
+#define KEYS			(1 << 17)
+#define OPS				(1000000)
+
+// the percentage of finds; the rest is split evenly between inserts and erases
+static int find_percent;
+
+// the global-mutex baseline the multi-threaded tools use today
+static UMap *umap;
+static mutex umap_lock;
+static CMap *cmap;
+
+static unsigned int xorshift(unsigned int *s)
+{
+	*s ^= *s << 13;
+	*s ^= *s >> 17;
+	*s ^= *s << 5;
+	return *s;
+}
+
+static void run_locked(unsigned int seed, long *found)
+{
+	int i;
+	for (i = 0; i < OPS; i++) {
+		unsigned int r = xorshift(&seed);
+		unsigned int key = (r >> 8) % KEYS;
+		int op = (int) (r & 0xff) % 100;
+		lock_guard<mutex> guard(umap_lock);
+		if (op < find_percent) {
+			*found += UMap_find(umap, key) != UMap_end(umap);
+		} else if (op & 1) {
+			UMap_insert(umap, key, (int) key, NULL);
+		} else {
+			UMap_erase_key(umap, key);
+		}
+	}
+}
+
+static void run_concurrent(unsigned int seed, long *found)
+{
+	int i;
+	for (i = 0; i < OPS; i++) {
+		unsigned int r = xorshift(&seed);
+		unsigned int key = (r >> 8) % KEYS;
+		int op = (int) (r & 0xff) % 100;
+		if (op < find_percent) {
+			*found += CMap_find(cmap, key, NULL);
+		} else if (op & 1) {
+			CMap_insert(cmap, key, (int) key, NULL);
+		} else {
+			CMap_erase_key(cmap, key);
+		}
+	}
+}
+
+// runs OPS operations on each of n threads and prints the total throughput
+static void bench(const char *label, void (*run)(unsigned int, long *), int n)
+{
+	vector<thread> th;
+	vector<long> found(n);
+	int i;
+	double t = get_msec();
+	for (i = 0; i < n; i++) {
+		th.push_back(thread(run, 2463534242u + i * 7919u, &found[i]));
+	}
+	for (i = 0; i < n; i++) {
+		th[i].join();
+	}
+	t = get_msec() - t;
+	printf("cstl: %-32s %2d threads %8.2f ms, %7.2f Mops/s\n", label, n, t, n * (double) OPS / t / 1000.0);
+}
+
+static void bench_mix(int percent, int max_threads)
+{
+	int n, i;
+	find_percent = percent;
+	printf("*** benchmark concurrent: %d%% find, %d%% insert, %d%% erase, %d ops per thread ***\n",
+			percent, (100 - percent) / 2, (100 - percent) / 2, OPS);
+	// 1, 2, 4, ... and max_threads itself
+	for (n = 1; n <= max_threads; n = (n < max_threads && n * 2 > max_threads) ? max_threads : n * 2) {
+		umap = UMap_new_pow2(KEYS);
+		cmap = CMap_new();
+		for (i = 0; i < KEYS; i += 2) {
+			UMap_insert(umap, i, i, NULL);
+			CMap_insert(cmap, i, i, NULL);
+		}
+		bench("unordered_map + global mutex", run_locked, n);
+		bench("concurrent_unordered_map", run_concurrent, n);
+		UMap_delete(umap);
+		CMap_delete(cmap);
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	int max_threads = (int) thread::hardware_concurrency();
+	if (argc > 1) {
+		max_threads = atoi(argv[1]);
+	}
+	if (max_threads < 1) {
+		max_threads = 1;
+	}
+	printf("*** benchmark concurrent: up to %d threads ***\n", max_threads);
+	bench_mix(90, max_threads);
+	bench_mix(20, max_threads);
+	return 0;
+}
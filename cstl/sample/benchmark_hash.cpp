@@ -0,0 +1,195 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/time.h>
+#endif
+#include <cstl/unordered_map.h>
+#include <cstl/unordered_flat_map.h>
+#include <string>
+#include <unordered_map>
+
+// hash functions before wyhash/fmix64 (the string hash in unsigned arithmetic)
+static size_t old_hash_string(const char *str)
+{
+	unsigned int c;
+	unsigned int val = 0;
+	while ((c = (unsigned char) *str++) != '\0') {
+		val = val * 997 + c;
+	}
+	return (size_t) (val + (val >> 5));
+}
+
+CSTL_UNORDERED_MAP_INTERFACE(StrIntMap, const char *, int)
+CSTL_UNORDERED_MAP_IMPLEMENT(StrIntMap, const char *, int, StrIntMap_hash_string, strcmp)
+
+CSTL_UNORDERED_MAP_INTERFACE(OldStrIntMap, const char *, int)
+CSTL_UNORDERED_MAP_IMPLEMENT(OldStrIntMap, const char *, int, old_hash_string, strcmp)
+
+CSTL_UNORDERED_MAP_INTERFACE(IntIntMap, unsigned int, int)
+CSTL_UNORDERED_MAP_IMPLEMENT(IntIntMap, unsigned int, int, IntIntMap_hash_uint, CSTL_EQUAL_TO)
+
+CSTL_UNORDERED_MAP_INTERFACE(MixIntIntMap, unsigned int, int)
+CSTL_UNORDERED_MAP_IMPLEMENT(MixIntIntMap, unsigned int, int, MixIntIntMap_hash_mix, CSTL_EQUAL_TO)
+
+CSTL_UNORDERED_FLAT_MAP_INTERFACE(FlatStrIntMap, const char *, int)
+CSTL_UNORDERED_FLAT_MAP_IMPLEMENT(FlatStrIntMap, const char *, int, FlatStrIntMap_hash_string, strcmp)
+
+CSTL_UNORDERED_FLAT_MAP_INTERFACE(FlatIntIntMap, unsigned int, int)
+CSTL_UNORDERED_FLAT_MAP_IMPLEMENT(FlatIntIntMap, unsigned int, int, FlatIntIntMap_hash_uint, CSTL_EQUAL_TO)
+
+using namespace std;
+
+
+double get_msec(void)
+{
+#ifdef _WIN32
+	return (double) GetTickCount();
+#else
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+#endif
+}
+
+#define COUNT			(500000)
+#define FIND_ROUNDS		(4)
+
+static char keys[COUNT][32];
+static unsigned int ikeys[COUNT];
+static unsigned int pkeys[COUNT];
+
+// prints time for COUNT inserts, COUNT*FIND_ROUNDS finds and COUNT erases, and the longest chain
+#define BENCH(Name, label, create, key)	BENCH_BODY(Name, label, create, key, 1)
+// the same for unordered_flat_map, which has no chains
+#define BENCH_FLAT(Name, label, create, key)	BENCH_BODY(Name, label, create, key, 0)
+#define BENCH_BODY(Name, label, create, key, chains)	\
+do {\
+	Name *map = create;\
+	int i, r;\
+	size_t b, longest = 0;\
+	long sum = 0;\
+	double t = get_msec();\
+	for (i = 0; i < COUNT; i++) {\
+		Name##_insert(map, key[i], i, NULL);\
+	}\
+	double ti = get_msec() - t;\
+	t = get_msec();\
+	for (r = 0; r < FIND_ROUNDS; r++) {\
+		for (i = 0; i < COUNT; i++) {\
+			sum += *Name##_value(Name##_find(map, key[i]));\
+		}\
+	}\
+	double tf = get_msec() - t;\
+	for (b = 0; chains && b < Name##_bucket_count(map); b++) {\
+		size_t n = Name##_bucket_size(map, b);\
+		if (n > longest) longest = n;\
+	}\
+	t = get_msec();\
+	for (i = 0; i < COUNT; i++) {\
+		Name##_erase_key(map, key[i]);\
+	}\
+	double te = get_msec() - t;\
+	if (chains) {\
+		printf("cstl: %-30s insert %8.2f ms, find %8.2f ms, erase %8.2f ms, longest chain %lu\n",\
+				label, ti, tf, te, (unsigned long) longest);\
+	} else {\
+		printf("cstl: %-30s insert %8.2f ms, find %8.2f ms, erase %8.2f ms\n", label, ti, tf, te);\
+	}\
+	if (sum != (long) FIND_ROUNDS * ((long) COUNT * (COUNT - 1) / 2) || !Name##_empty(map)) {\
+		printf("!!!NG!!!\n");\
+	}\
+	Name##_delete(map);\
+} while (0)
+
+template <class Map, class Key>
+static void bench_stl(const char *label, Map &map, Key *key)
+{
+	int i, r;
+	long sum = 0;
+	double t = get_msec();
+	for (i = 0; i < COUNT; i++) {
+		map.insert(make_pair(key[i], i));
+	}
+	double ti = get_msec() - t;
+	t = get_msec();
+	for (r = 0; r < FIND_ROUNDS; r++) {
+		for (i = 0; i < COUNT; i++) {
+			sum += map.find(key[i])->second;
+		}
+	}
+	double tf = get_msec() - t;
+	t = get_msec();
+	for (i = 0; i < COUNT; i++) {
+		map.erase(key[i]);
+	}
+	double te = get_msec() - t;
+	printf("stl : %-30s insert %8.2f ms, find %8.2f ms, erase %8.2f ms\n", label, ti, tf, te);
+	if (sum != (long) FIND_ROUNDS * ((long) COUNT * (COUNT - 1) / 2) || !map.empty()) {
+		printf("!!!NG!!!\n");
+	}
+}
+
+int main(void)
+{
+	int i;
+	const char *skeys[COUNT];
+	for (i = 0; i < COUNT; i++) {
+		// similar identifiers: a shared prefix and a counter
+		sprintf(keys[i], "identifier_%07d", i);
+		skeys[i] = keys[i];
+		// keys sharing their low 12 bits
+		ikeys[i] = (unsigned int) i << 12;
+		// multiples of the prime bucket count the table ends with (2^19 + 21)
+		pkeys[i] = (unsigned int) (i % 64) * 524309u + (unsigned int) (i / 64);
+	}
+	// visit the keys in random order, so that neighbouring keys do not share cache lines
+	srand(1);
+	for (i = COUNT - 1; i > 0; i--) {
+		int j = rand() % (i + 1);
+		const char *s = skeys[i]; skeys[i] = skeys[j]; skeys[j] = s;
+		unsigned int k = ikeys[i]; ikeys[i] = ikeys[j]; ikeys[j] = k;
+		k = pkeys[i]; pkeys[i] = pkeys[j]; pkeys[j] = k;
+	}
+
+	printf("*** benchmark hash: %d similar identifiers ***\n", COUNT);
+	BENCH(OldStrIntMap, "old hash, prime", OldStrIntMap_new(), skeys);
+	BENCH(StrIntMap, "wyhash, prime", StrIntMap_new(), skeys);
+	BENCH(StrIntMap, "wyhash, pow2", StrIntMap_new_pow2(0), skeys);
+	BENCH_FLAT(FlatStrIntMap, "wyhash, flat (SIMD probing)", FlatStrIntMap_new(), skeys);
+	{
+		unordered_map<string, int> y;
+		string *s = new string[COUNT];
+		for (i = 0; i < COUNT; i++) {
+			s[i] = skeys[i];
+		}
+		bench_stl("std::hash<string>", y, s);
+		delete [] s;
+	}
+
+	printf("*** benchmark hash: %d keys i << 12 ***\n", COUNT);
+	BENCH(IntIntMap, "identity, prime", IntIntMap_new(), ikeys);
+	BENCH(IntIntMap, "identity, pow2 (Fibonacci)", IntIntMap_new_pow2(0), ikeys);
+	BENCH(MixIntIntMap, "fmix64, prime", MixIntIntMap_new(), ikeys);
+	BENCH(MixIntIntMap, "fmix64, pow2 (Fibonacci)", MixIntIntMap_new_pow2(0), ikeys);
+	BENCH_FLAT(FlatIntIntMap, "identity, flat (SIMD probing)", FlatIntIntMap_new(), ikeys);
+	{
+		unordered_map<unsigned int, int> y;
+		bench_stl("std::hash<unsigned int>", y, ikeys);
+	}
+
+	printf("*** benchmark hash: %d keys clustered on multiples of the bucket count ***\n", COUNT);
+	BENCH(IntIntMap, "identity, prime", IntIntMap_new(), pkeys);
+	BENCH(IntIntMap, "identity, pow2 (Fibonacci)", IntIntMap_new_pow2(0), pkeys);
+	BENCH(MixIntIntMap, "fmix64, prime", MixIntIntMap_new(), pkeys);
+	BENCH(MixIntIntMap, "fmix64, pow2 (Fibonacci)", MixIntIntMap_new_pow2(0), pkeys);
+	BENCH_FLAT(FlatIntIntMap, "identity, flat (SIMD probing)", FlatIntIntMap_new(), pkeys);
+	{
+		unordered_map<unsigned int, int> y;
+		bench_stl("std::hash<unsigned int>", y, pkeys);
+	}
+	return 0;
+}
@@ -8,18 +8,22 @@
 #include <sys/time.h>
 #endif
 #include <cstl/map.h>
+#include <cstl/btree_map.h>
 #include <cstl/unordered_map.h>
 #include <map>
 
 //#define malloc(s) ::operator new(s)
 //#define free(p) ::operator delete(p)
 
-#ifndef UNORDERED
-CSTL_MAP_INTERFACE(IntIntMap, int, int)
-CSTL_MAP_IMPLEMENT(IntIntMap, int, int, CSTL_LESS)
-#else
+#if defined(UNORDERED)
 CSTL_UNORDERED_MAP_INTERFACE(IntIntMap, int, int)
 CSTL_UNORDERED_MAP_IMPLEMENT(IntIntMap, int, int, IntIntMap_hash_int, CSTL_EQUAL_TO)
+#elif defined(BTREE)
+CSTL_BTREE_MAP_INTERFACE(IntIntMap, int, int)
+CSTL_BTREE_MAP_IMPLEMENT(IntIntMap, int, int, CSTL_LESS)
+#else
+CSTL_MAP_INTERFACE(IntIntMap, int, int)
+CSTL_MAP_IMPLEMENT(IntIntMap, int, int, CSTL_LESS)
 #endif
 
 using namespace std;
@@ -40,16 +44,37 @@ double get_msec(void)
 #define INSERT_COUNT	(10000)
 #define SORT_COUNT		(1000000)
 
+// 0からCOUNT-1までのキーをランダムな順に並べたもの
+static int keys[COUNT];
+
+static void shuffle_keys(void)
+{
+	int i, j, tmp;
+	for (i = COUNT - 1; i > 0; i--) {
+		j = (int) (((unsigned long) rand() * ((unsigned long) RAND_MAX + 1) + rand()) % (i + 1));
+		tmp = keys[i];
+		keys[i] = keys[j];
+		keys[j] = tmp;
+	}
+}
+
 
 int main(void)
 {
 	int i;
+	int n;
+	long long sum;
 	double t;
 	IntIntMap *x;
 	map<int, int> y;
 	IntIntMapIterator xpos;
 	map<int, int>::iterator ypos;
 
+	for (i = 0; i < COUNT; i++) {
+		keys[i] = i;
+	}
+	srand(1);
+	shuffle_keys();
 	x = IntIntMap_new();
 
 	printf("*** benchmark map<int, int> ***\n");
@@ -115,6 +140,44 @@ int main(void)
 		}
 	}
 
+	// find (random order)
+	t = get_msec();
+	for (i = 0, n = 0; i < COUNT; i++) {
+		n += IntIntMap_find(x, keys[i]) != IntIntMap_end(x);
+	}
+	printf("cstl: find[%d]: %g ms\n", COUNT, get_msec() - t);
+	if (n != COUNT) {
+		printf("!!!NG!!!\n");
+	}
+
+	t = get_msec();
+	for (i = 0, n = 0; i < COUNT; i++) {
+		n += y.find(keys[i]) != y.end();
+	}
+	printf("stl : find[%d]: %g ms\n", COUNT, get_msec() - t);
+	if (n != COUNT) {
+		printf("!!!NG!!!\n");
+	}
+
+	// iterate
+	t = get_msec();
+	for (xpos = IntIntMap_begin(x), sum = 0; xpos != IntIntMap_end(x); xpos = IntIntMap_next(xpos)) {
+		sum += *IntIntMap_value(xpos);
+	}
+	printf("cstl: iterate[%d]: %g ms\n", COUNT, get_msec() - t);
+	if (sum != (long long) COUNT * (COUNT + 1) / 2) {
+		printf("!!!NG!!!\n");
+	}
+
+	t = get_msec();
+	for (ypos = y.begin(), sum = 0; ypos != y.end(); ++ypos) {
+		sum += ypos->second;
+	}
+	printf("stl : iterate[%d]: %g ms\n", COUNT, get_msec() - t);
+	if (sum != (long long) COUNT * (COUNT + 1) / 2) {
+		printf("!!!NG!!!\n");
+	}
+
 	// erase key
 	t = get_msec();
 	for (i = 0; i < COUNT; i++) {
@@ -0,0 +1,173 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/time.h>
+#endif
+#include <cstl/list.h>
+#include <cstl/map.h>
+#include <cstl/unordered_map.h>
+#include <list>
+#include <map>
+#include <unordered_map>
+
+CSTL_UNORDERED_MAP_INTERFACE(UMap, unsigned int, int)
+CSTL_UNORDERED_MAP_IMPLEMENT(UMap, unsigned int, int, UMap_hash_mix, CSTL_EQUAL_TO)
+
+CSTL_UNORDERED_MAP_INTERFACE(PoolUMap, unsigned int, int)
+CSTL_UNORDERED_MAP_IMPLEMENT_POOL(PoolUMap, unsigned int, int, PoolUMap_hash_mix, CSTL_EQUAL_TO)
+
+CSTL_MAP_INTERFACE(Map, unsigned int, int)
+CSTL_MAP_IMPLEMENT(Map, unsigned int, int, CSTL_LESS)
+
+CSTL_MAP_INTERFACE(PoolMap, unsigned int, int)
+CSTL_MAP_IMPLEMENT_POOL(PoolMap, unsigned int, int, CSTL_LESS)
+
+CSTL_LIST_INTERFACE(List, int)
+CSTL_LIST_IMPLEMENT(List, int)
+
+CSTL_LIST_INTERFACE(PoolList, int)
+CSTL_LIST_IMPLEMENT_POOL(PoolList, int)
+
+using namespace std;
+
+
+double get_msec(void)
+{
+#ifdef _WIN32
+	return (double) GetTickCount();
+#else
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+#endif
+}
+
+#define LIVE			(100000)
+#define CHURN			(4000000)
+
+static unsigned int keys[LIVE + CHURN];
+
+// fills LIVE keys, then erases the oldest key and inserts a new one CHURN times, then deletes the table
+#define BENCH_MAP(Name, label, create)	\
+do {\
+	Name *map;\
+	int i;\
+	double t = get_msec();\
+	map = create;\
+	for (i = 0; i < LIVE; i++) {\
+		Name##_insert(map, keys[i], i, NULL);\
+	}\
+	double tf = get_msec() - t;\
+	t = get_msec();\
+	for (i = 0; i < CHURN; i++) {\
+		Name##_erase_key(map, keys[i]);\
+		Name##_insert(map, keys[LIVE + i], i, NULL);\
+	}\
+	double tc = get_msec() - t;\
+	if (Name##_size(map) != LIVE || *Name##_value(Name##_find(map, keys[CHURN])) != CHURN - LIVE) {\
+		printf("!!!NG!!!\n");\
+	}\
+	t = get_msec();\
+	Name##_delete(map);\
+	double td = get_msec() - t;\
+	printf("cstl: %-26s fill %8.2f ms, churn %8.2f ms, delete %8.2f ms\n", label, tf, tc, td);\
+} while (0)
+
+// the list keeps LIVE elements; pops the front and pushes a new element at the back CHURN times
+#define BENCH_LIST(Name, label)	\
+do {\
+	Name *list;\
+	int i;\
+	double t = get_msec();\
+	list = Name##_new();\
+	for (i = 0; i < LIVE; i++) {\
+		Name##_push_back(list, i);\
+	}\
+	double tf = get_msec() - t;\
+	t = get_msec();\
+	for (i = 0; i < CHURN; i++) {\
+		Name##_pop_front(list);\
+		Name##_push_back(list, LIVE + i);\
+	}\
+	double tc = get_msec() - t;\
+	if (Name##_size(list) != LIVE || *Name##_front(list) != CHURN) {\
+		printf("!!!NG!!!\n");\
+	}\
+	t = get_msec();\
+	Name##_delete(list);\
+	double td = get_msec() - t;\
+	printf("cstl: %-26s fill %8.2f ms, churn %8.2f ms, delete %8.2f ms\n", label, tf, tc, td);\
+} while (0)
+
+template <class Map>
+static void bench_stl_map(const char *label)
+{
+	int i;
+	double t = get_msec();
+	Map *map = new Map;
+	for (i = 0; i < LIVE; i++) {
+		map->insert(make_pair(keys[i], i));
+	}
+	double tf = get_msec() - t;
+	t = get_msec();
+	for (i = 0; i < CHURN; i++) {
+		map->erase(keys[i]);
+		map->insert(make_pair(keys[LIVE + i], i));
+	}
+	double tc = get_msec() - t;
+	if (map->size() != LIVE || map->find(keys[CHURN])->second != CHURN - LIVE) {
+		printf("!!!NG!!!\n");
+	}
+	t = get_msec();
+	delete map;
+	double td = get_msec() - t;
+	printf("stl : %-26s fill %8.2f ms, churn %8.2f ms, delete %8.2f ms\n", label, tf, tc, td);
+}
+
+static void bench_stl_list(const char *label)
+{
+	int i;
+	double t = get_msec();
+	list<int> *l = new list<int>;
+	for (i = 0; i < LIVE; i++) {
+		l->push_back(i);
+	}
+	double tf = get_msec() - t;
+	t = get_msec();
+	for (i = 0; i < CHURN; i++) {
+		l->pop_front();
+		l->push_back(LIVE + i);
+	}
+	double tc = get_msec() - t;
+	if (l->size() != LIVE || l->front() != CHURN) {
+		printf("!!!NG!!!\n");
+	}
+	t = get_msec();
+	delete l;
+	double td = get_msec() - t;
+	printf("stl : %-26s fill %8.2f ms, churn %8.2f ms, delete %8.2f ms\n", label, tf, tc, td);
+}
+
+int main(void)
+{
+	int i;
+	for (i = 0; i < LIVE + CHURN; i++) {
+		keys[i] = (unsigned int) i * 2654435761u;
+	}
+
+	printf("*** benchmark pool: %d live elements, %d erase+insert ***\n", LIVE, CHURN);
+	BENCH_MAP(UMap, "unordered_map, malloc", UMap_new());
+	BENCH_MAP(PoolUMap, "unordered_map, node pool", PoolUMap_new());
+	bench_stl_map<unordered_map<unsigned int, int> >("std::unordered_map");
+	BENCH_MAP(Map, "map, malloc", Map_new());
+	BENCH_MAP(PoolMap, "map, node pool", PoolMap_new());
+	bench_stl_map<map<unsigned int, int> >("std::map");
+	BENCH_LIST(List, "list, malloc");
+	BENCH_LIST(PoolList, "list, node pool");
+	bench_stl_list("std::list");
+	return 0;
+}
@@ -0,0 +1,143 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/time.h>
+#endif
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+#include <cstl/unordered_map.h>
+#include <unordered_map>
+
+CSTL_UNORDERED_MAP_INTERFACE(IntIntMap, unsigned int, int)
+CSTL_UNORDERED_MAP_IMPLEMENT(IntIntMap, unsigned int, int, IntIntMap_hash_mix, CSTL_EQUAL_TO)
+
+using namespace std;
+
+
+double get_msec(void)
+{
+#ifdef _WIN32
+	return (double) GetTickCount();
+#else
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+#endif
+}
+
+// clock for a single insert; get_msec() is too coarse
+static long get_nsec(void)
+{
+#ifdef _WIN32
+	LARGE_INTEGER c, f;
+	QueryPerformanceCounter(&c);
+	QueryPerformanceFrequency(&f);
+	return (long) (c.QuadPart * 1000000000.0 / f.QuadPart);
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000L + ts.tv_nsec;
+#endif
+}
+
+#define COUNT			(2000000)
+#define HIST			(40)
+
+static unsigned int keys[COUNT];
+static long lat[COUNT];
+
+static int cmp_long(const void *a, const void *b)
+{
+	long x = *(const long *) a;
+	long y = *(const long *) b;
+	return x < y ? -1 : x > y;
+}
+
+// prints the total time, percentiles and a power-of-two histogram of lat[]
+static void report(const char *label, double total)
+{
+	size_t hist[HIST];
+	int i, b, last = 0;
+	memset(hist, 0, sizeof hist);
+	for (i = 0; i < COUNT; i++) {
+		for (b = 0; b < HIST - 1 && (1L << (b + 1)) <= lat[i]; b++) ;
+		hist[b]++;
+		if (b > last) last = b;
+	}
+	qsort(lat, COUNT, sizeof lat[0], cmp_long);
+	printf("%-32s total %8.2f ms, p50 %6ld ns, p99 %6ld ns, p99.9 %8ld ns, max %10ld ns\n",
+			label, total, lat[COUNT / 2], lat[COUNT / 100 * 99], lat[COUNT / 1000 * 999], lat[COUNT - 1]);
+	for (b = 0; b <= last; b++) {
+		if (hist[b]) {
+			printf("      < %10ld ns: %8lu\n", 1L << (b + 1), (unsigned long) hist[b]);
+		}
+	}
+}
+
+// glibc merges the nodes freed by the previous run on a later free(); do it now, not during the timed inserts
+static void settle_malloc(void)
+{
+#ifdef __GLIBC__
+	malloc_trim(0);
+#endif
+}
+
+// inserts COUNT keys into a table created by create, timing every insert
+#define BENCH(label, create, step)	\
+do {\
+	IntIntMap *map = create;\
+	int i;\
+	IntIntMap_set_incremental_rehash(map, step);\
+	settle_malloc();\
+	double t = get_msec();\
+	for (i = 0; i < COUNT; i++) {\
+		long s = get_nsec();\
+		IntIntMap_insert(map, keys[i], i, NULL);\
+		lat[i] = get_nsec() - s;\
+	}\
+	t = get_msec() - t;\
+	printf("cstl: ");\
+	report(label, t);\
+	for (i = 0; i < COUNT; i += 997) {\
+		if (*IntIntMap_value(IntIntMap_find(map, keys[i])) != i) {\
+			printf("!!!NG!!!\n");\
+			break;\
+		}\
+	}\
+	IntIntMap_delete(map);\
+} while (0)
+
+int main(void)
+{
+	int i;
+	for (i = 0; i < COUNT; i++) {
+		keys[i] = (unsigned int) i * 2654435761u;
+	}
+
+	printf("*** benchmark rehash: latency of %d inserts ***\n", COUNT);
+	BENCH("prime, stop-the-world", IntIntMap_new(), 0);
+	BENCH("prime, incremental step 1", IntIntMap_new(), 1);
+	BENCH("prime, incremental step 4", IntIntMap_new(), 4);
+	BENCH("pow2, stop-the-world", IntIntMap_new_pow2(0), 0);
+	BENCH("pow2, incremental step 1", IntIntMap_new_pow2(0), 1);
+	BENCH("pow2, incremental step 4", IntIntMap_new_pow2(0), 4);
+	{
+		unordered_map<unsigned int, int> y;
+		settle_malloc();
+		double t = get_msec();
+		for (i = 0; i < COUNT; i++) {
+			long s = get_nsec();
+			y.insert(make_pair(keys[i], i));
+			lat[i] = get_nsec() - s;
+		}
+		t = get_msec() - t;
+		printf("stl : ");
+		report("std::unordered_map", t);
+	}
+	return 0;
+}
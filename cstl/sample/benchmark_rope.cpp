@@ -0,0 +1,174 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/time.h>
+#endif
+#include <cstl/string.h>
+#include <cstl/rope.h>
+
+CSTL_STRING_INTERFACE(String, char)
+CSTL_STRING_IMPLEMENT(String, char)
+
+CSTL_ROPE_INTERFACE(Rope, char)
+CSTL_ROPE_IMPLEMENT(Rope, char)
+
+CSTL_ROPE_STRING_INTERFACE(Rope, String)
+CSTL_ROPE_STRING_IMPLEMENT(Rope, String)
+
+
+double get_msec(void)
+{
+#ifdef _WIN32
+	return (double) GetTickCount();
+#else
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+#endif
+}
+
+#define EDITS		(4000)
+#define CLIP_SIZE	(4096)
+
+enum { TYPE, BACKSPACE, PASTE, CUT };
+
+// one edit of the trace: what to do at which position
+typedef struct {
+	int op;
+	size_t idx;
+	size_t len;
+} Edit;
+
+static Edit edits[EDITS];
+static char *doc;
+static char clip[CLIP_SIZE];
+
+static unsigned int xorshift(unsigned int *s)
+{
+	*s ^= *s << 13;
+	*s ^= *s >> 17;
+	*s ^= *s << 5;
+	return *s;
+}
+
+// an editing session: typing and backspacing around a cursor that now and then jumps, with some paste and cut
+static void make_trace(size_t size)
+{
+	int i;
+	size_t cursor = size / 2;
+	unsigned int r = 2463534242u;
+	doc = (char *) malloc(size);
+	for (i = 0; i < (int) size; i++) {
+		doc[i] = (i % 64 == 63) ? '\n' : (char) ('a' + xorshift(&r) % 26);
+	}
+	for (i = 0; i < CLIP_SIZE; i++) {
+		clip[i] = (char) ('A' + i % 26);
+	}
+	for (i = 0; i < EDITS; i++) {
+		unsigned int x = xorshift(&r) % 100;
+		if (x < 5) {
+			cursor = xorshift(&r) % size;
+		}
+		if (x < 60) {
+			edits[i].op = TYPE;
+			edits[i].len = 1 + xorshift(&r) % 8;
+		} else if (x < 90) {
+			edits[i].op = BACKSPACE;
+			edits[i].len = 1 + xorshift(&r) % 4;
+			if (edits[i].len > cursor) edits[i].len = cursor;
+		} else if (x < 95) {
+			edits[i].op = PASTE;
+			edits[i].len = CLIP_SIZE;
+		} else {
+			edits[i].op = CUT;
+			edits[i].len = CLIP_SIZE;
+			if (cursor + CLIP_SIZE > size) edits[i].len = size - cursor;
+		}
+		edits[i].idx = cursor;
+		switch (edits[i].op) {
+		case TYPE:
+		case PASTE:
+			cursor += edits[i].len;
+			size += edits[i].len;
+			break;
+		case BACKSPACE:
+			cursor -= edits[i].len;
+			edits[i].idx = cursor;
+			size -= edits[i].len;
+			break;
+		default:
+			size -= edits[i].len;
+			break;
+		}
+	}
+}
+
+// replays the trace, then reads the document once from beginning to end
+#define BENCH_EDIT(Name, label)	\
+do {\
+	int i;\
+	double t = get_msec();\
+	for (i = 0; i < EDITS; i++) {\
+		if (edits[i].op == TYPE || edits[i].op == PASTE) {\
+			Name##_insert_len(x, edits[i].idx, clip, edits[i].len);\
+		} else {\
+			Name##_erase(x, edits[i].idx, edits[i].len);\
+		}\
+	}\
+	double te = get_msec() - t;\
+	printf("cstl: %-8s %d edits %9.2f ms, %9.0f edits/s, ", label, EDITS, te, EDITS / te * 1000.0);\
+} while (0)
+
+static void bench(size_t size)
+{
+	String *s = String_new_assign_len(doc, size);
+	Rope *x = Rope_new_assign_len(doc, size);
+	String *y = String_new();
+	RopeIterator pos;
+	size_t sum = 0;
+	double t;
+	printf("*** benchmark rope: %d edits on %d KB document ***\n", EDITS, (int) (size / 1024));
+	{
+		String *x = s;
+		BENCH_EDIT(String, "string");
+		t = get_msec();
+		for (size_t i = 0; i < String_size(s); i++) {
+			sum += String_c_str(s)[i] == '\n';
+		}
+		printf("scan %7.2f ms\n", get_msec() - t);
+	}
+	BENCH_EDIT(Rope, "rope");
+	t = get_msec();
+	for (pos = Rope_begin(x); pos != Rope_end(x); pos = Rope_next(pos)) {
+		const char *p = Rope_chunk_data(pos);
+		for (size_t i = 0; i < Rope_chunk_size(pos); i++) {
+			sum -= p[i] == '\n';
+		}
+	}
+	printf("scan %7.2f ms\n", get_msec() - t);
+	t = get_msec();
+	Rope_to_string(x, y);
+	printf("cstl: rope     to_string %7.2f ms\n", get_msec() - t);
+	if (sum != 0 || String_size(s) != String_size(y) || memcmp(String_c_str(s), String_c_str(y), String_size(s)) != 0) {
+		printf("!!!NG!!!\n");
+	}
+	String_delete(s);
+	String_delete(y);
+	Rope_delete(x);
+}
+
+int main(void)
+{
+	size_t size[] = {256 * 1024, 4 * 1024 * 1024, 16 * 1024 * 1024};
+	size_t i;
+	for (i = 0; i < sizeof size / sizeof size[0]; i++) {
+		make_trace(size[i]);
+		bench(size[i]);
+		free(doc);
+	}
+	return 0;
+}
@@ -8,18 +8,22 @@
 #include <sys/time.h>
 #endif
 #include <cstl/set.h>
+#include <cstl/btree_set.h>
 #include <cstl/unordered_set.h>
 #include <set>
 
 //#define malloc(s) ::operator new(s)
 //#define free(p) ::operator delete(p)
 
-#ifndef UNORDERED
-CSTL_SET_INTERFACE(IntSet, int)
-CSTL_SET_IMPLEMENT(IntSet, int, CSTL_LESS)
-#else
+#if defined(UNORDERED)
 CSTL_UNORDERED_SET_INTERFACE(IntSet, int)
 CSTL_UNORDERED_SET_IMPLEMENT(IntSet, int, IntSet_hash_int, CSTL_EQUAL_TO)
+#elif defined(BTREE)
+CSTL_BTREE_SET_INTERFACE(IntSet, int)
+CSTL_BTREE_SET_IMPLEMENT(IntSet, int, CSTL_LESS)
+#else
+CSTL_SET_INTERFACE(IntSet, int)
+CSTL_SET_IMPLEMENT(IntSet, int, CSTL_LESS)
 #endif
 
 using namespace std;
@@ -40,16 +44,37 @@ double get_msec(void)
 #define INSERT_COUNT	(10000)
 #define SORT_COUNT		(1000000)
 
+// 0からCOUNT-1までのキーをランダムな順に並べたもの
+static int keys[COUNT];
+
+static void shuffle_keys(void)
+{
+	int i, j, tmp;
+	for (i = COUNT - 1; i > 0; i--) {
+		j = (int) (((unsigned long) rand() * ((unsigned long) RAND_MAX + 1) + rand()) % (i + 1));
+		tmp = keys[i];
+		keys[i] = keys[j];
+		keys[j] = tmp;
+	}
+}
+
 
 int main(void)
 {
 	int i;
+	int n;
+	long long sum;
 	double t;
 	IntSet *x;
 	set<int> y;
 	IntSetIterator xpos;
 	set<int>::iterator ypos;
 
+	for (i = 0; i < COUNT; i++) {
+		keys[i] = i;
+	}
+	srand(1);
+	shuffle_keys();
 	x = IntSet_new();
 
 	printf("*** benchmark set<int> ***\n");
@@ -91,6 +116,61 @@ int main(void)
 		printf("!!!NG!!!\n");
 	}
 
+	// insert (random order)
+	t = get_msec();
+	for (i = 0; i < COUNT; i++) {
+		IntSet_insert(x, keys[i], NULL);
+	}
+	printf("cstl: insert random[%d]: %g ms\n", COUNT, get_msec() - t);
+
+	t = get_msec();
+	for (i = 0; i < COUNT; i++) {
+		y.insert(keys[i]);
+	}
+	printf("stl : insert random[%d]: %g ms\n", COUNT, get_msec() - t);
+	if (y.size() != IntSet_size(x)) {
+		printf("!!!NG!!!\n");
+	}
+
+	// find (random order)
+	shuffle_keys();
+	t = get_msec();
+	for (i = 0, n = 0; i < COUNT; i++) {
+		n += IntSet_find(x, keys[i]) != IntSet_end(x);
+	}
+	printf("cstl: find[%d]: %g ms\n", COUNT, get_msec() - t);
+	if (n != COUNT) {
+		printf("!!!NG!!!\n");
+	}
+
+	t = get_msec();
+	for (i = 0, n = 0; i < COUNT; i++) {
+		n += y.find(keys[i]) != y.end();
+	}
+	printf("stl : find[%d]: %g ms\n", COUNT, get_msec() - t);
+	if (n != COUNT) {
+		printf("!!!NG!!!\n");
+	}
+
+	// iterate
+	t = get_msec();
+	for (xpos = IntSet_begin(x), sum = 0; xpos != IntSet_end(x); xpos = IntSet_next(xpos)) {
+		sum += *IntSet_data(xpos);
+	}
+	printf("cstl: iterate[%d]: %g ms\n", COUNT, get_msec() - t);
+	if (sum != (long long) COUNT * (COUNT - 1) / 2) {
+		printf("!!!NG!!!\n");
+	}
+
+	t = get_msec();
+	for (ypos = y.begin(), sum = 0; ypos != y.end(); ++ypos) {
+		sum += *ypos;
+	}
+	printf("stl : iterate[%d]: %g ms\n", COUNT, get_msec() - t);
+	if (sum != (long long) COUNT * (COUNT - 1) / 2) {
+		printf("!!!NG!!!\n");
+	}
+
 	IntSet_delete(x);
 
 	return 0;
@@ -0,0 +1,310 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/time.h>
+#endif
+#include <cstl/string.h>
+#include <string>
+#include <new>
+
+
+// counts the allocations made by the containers
+static long alloc_count;
+
+static void *count_malloc(size_t n)
+{
+	alloc_count++;
+	return malloc(n);
+}
+
+static void *count_realloc(void *p, size_t n)
+{
+	alloc_count++;
+	return realloc(p, n);
+}
+
+void *operator new(size_t n)
+{
+	void *p;
+	alloc_count++;
+	p = malloc(n);
+	if (!p) throw std::bad_alloc();
+	return p;
+}
+
+void operator delete(void *p) throw()
+{
+	free(p);
+}
+
+void operator delete(void *p, size_t) throw()
+{
+	free(p);
+}
+
+#define malloc(s)		count_malloc(s)
+#define realloc(p, s)	count_realloc(p, s)
+
+CSTL_STRING_INTERFACE(String, char)
+CSTL_STRING_IMPLEMENT(String, char)
+
+#undef malloc
+#undef realloc
+
+
+using namespace std;
+
+
+double get_msec(void)
+{
+#ifdef _WIN32
+	return (double) GetTickCount();
+#else
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+#endif
+}
+
+#define SHORT_COUNT		(1000000)
+
+// identifiers and tokens of 1 to max_len characters
+static char short_src[SHORT_COUNT][40];
+static size_t short_len[SHORT_COUNT];
+static void *strings[SHORT_COUNT];
+static void *copies[SHORT_COUNT];
+
+static void make_short(int max_len)
+{
+	int i;
+	size_t j;
+	unsigned int r = 2463534242u;
+	for (i = 0; i < SHORT_COUNT; i++) {
+		r ^= r << 13;
+		r ^= r >> 17;
+		r ^= r << 5;
+		short_len[i] = 1 + r % max_len;
+		// a common prefix makes compare look past the first few characters
+		for (j = 0; j < short_len[i]; j++) {
+			short_src[i][j] = (j < short_len[i] / 2) ? 'k' : (char) ('a' + (r >> (j % 24)) % 26);
+		}
+		short_src[i][j] = '\0';
+	}
+}
+
+// creates SHORT_COUNT strings, copies them, compares the neighbours and deletes them all
+#define BENCH_SHORT(Name, label)	\
+do {\
+	int i;\
+	long cmp = 0;\
+	long count;\
+	double t = get_msec();\
+	alloc_count = 0;\
+	for (i = 0; i < SHORT_COUNT; i++) {\
+		strings[i] = Name##_new_assign_len(short_src[i], short_len[i]);\
+	}\
+	double tn = get_msec() - t;\
+	t = get_msec();\
+	for (i = 0; i < SHORT_COUNT; i++) {\
+		Name *s = (Name *) strings[i];\
+		copies[i] = Name##_new_assign_len(Name##_c_str(s), Name##_size(s));\
+	}\
+	double tc = get_msec() - t;\
+	count = alloc_count;\
+	t = get_msec();\
+	for (i = 0; i < SHORT_COUNT - 1; i++) {\
+		cmp += Name##_compare((Name *) strings[i], (Name *) copies[i + 1]) < 0;\
+		cmp += Name##_compare((Name *) strings[i], (Name *) copies[i]) == 0;\
+	}\
+	double tm = get_msec() - t;\
+	t = get_msec();\
+	for (i = 0; i < SHORT_COUNT; i++) {\
+		Name##_delete((Name *) strings[i]);\
+		Name##_delete((Name *) copies[i]);\
+	}\
+	double td = get_msec() - t;\
+	if (cmp != short_cmp()) {\
+		printf("!!!NG!!!\n");\
+	}\
+	printf("cstl: %-14s new %7.2f ms, copy %7.2f ms, compare %7.2f ms, delete %7.2f ms, %8ld allocs\n",\
+			label, tn, tc, tm, td, count);\
+} while (0)
+
+static long short_cmp(void)
+{
+	int i;
+	long cmp = 0;
+	for (i = 0; i < SHORT_COUNT - 1; i++) {
+		cmp += strcmp(short_src[i], short_src[i + 1]) < 0;
+		cmp += 1;
+	}
+	return cmp;
+}
+
+static void bench_stl_short(const char *label)
+{
+	int i;
+	long cmp = 0;
+	long count;
+	double t = get_msec();
+	alloc_count = 0;
+	for (i = 0; i < SHORT_COUNT; i++) {
+		strings[i] = new string(short_src[i], short_len[i]);
+	}
+	double tn = get_msec() - t;
+	t = get_msec();
+	for (i = 0; i < SHORT_COUNT; i++) {
+		copies[i] = new string(*(string *) strings[i]);
+	}
+	double tc = get_msec() - t;
+	count = alloc_count;
+	t = get_msec();
+	for (i = 0; i < SHORT_COUNT - 1; i++) {
+		cmp += ((string *) strings[i])->compare(*(string *) copies[i + 1]) < 0;
+		cmp += ((string *) strings[i])->compare(*(string *) copies[i]) == 0;
+	}
+	double tm = get_msec() - t;
+	t = get_msec();
+	for (i = 0; i < SHORT_COUNT; i++) {
+		delete (string *) strings[i];
+		delete (string *) copies[i];
+	}
+	double td = get_msec() - t;
+	if (cmp != short_cmp()) {
+		printf("!!!NG!!!\n");
+	}
+	printf("stl : %-14s new %7.2f ms, copy %7.2f ms, compare %7.2f ms, delete %7.2f ms, %8ld allocs\n",
+			label, tn, tc, tm, td, count);
+}
+
+#define LOG_SIZE		(16 * 1024 * 1024)
+#define LOG_REPEAT		(10)
+
+// log-like text: lines of lowercase words, digits and punctuation
+static char *log_src;
+
+static void make_log(void)
+{
+	static const char *words[] = {
+		"request", "served", "in", "ms", "user", "session", "cache", "miss", "hit", "GET", "POST",
+		"status", "ok", "upstream", "timeout", "retry", "bytes", "sent", "from", "to",
+	};
+	size_t i = 0;
+	unsigned int r = 2463534242u;
+	log_src = (char *) malloc(LOG_SIZE + 1);
+	while (i < LOG_SIZE) {
+		const char *w;
+		r ^= r << 13;
+		r ^= r >> 17;
+		r ^= r << 5;
+		w = (r % 8 == 0) ? "\n" : (r % 8 == 1) ? "=42 " : words[(r >> 8) % (sizeof words / sizeof words[0])];
+		while (*w && i < LOG_SIZE) {
+			log_src[i++] = *w++;
+		}
+		if (i < LOG_SIZE && w[-1] != '\n' && w[-1] != ' ') {
+			log_src[i++] = ' ';
+		}
+	}
+	log_src[LOG_SIZE] = '\0';
+	// every search below looks through the whole buffer before it hits
+	log_src[LOG_SIZE - 40] = '#';
+	memcpy(&log_src[LOG_SIZE - 30], "needle:7", 8);
+	log_src[10] = '~';
+	log_src[20] = '{';
+}
+
+// rewrites the first character of both buffers so that the compiler cannot hoist a search out of the loop
+#define TOUCH(a, b)	((a) = (b) = (char) ('a' + i % 2))
+
+// finds things near the end of a large buffer and compares two equal copies of it
+#define BENCH_SEARCH(Name, label)	\
+do {\
+	int i;\
+	size_t sum = 0;\
+	Name *x = Name##_new_assign_len(log_src, LOG_SIZE);\
+	Name *y = Name##_new_assign_len(log_src, LOG_SIZE);\
+	double t = get_msec();\
+	for (i = 0; i < LOG_REPEAT; i++, TOUCH(*Name##_at(x, 0), *Name##_at(y, 0))) sum += Name##_find_c(x, '#', 0);\
+	double tc = get_msec() - t;\
+	t = get_msec();\
+	for (i = 0; i < LOG_REPEAT; i++, TOUCH(*Name##_at(x, 0), *Name##_at(y, 0))) sum += Name##_find(x, "needle:7", 0);\
+	double tf = get_msec() - t;\
+	t = get_msec();\
+	for (i = 0; i < LOG_REPEAT; i++, TOUCH(*Name##_at(x, 0), *Name##_at(y, 0))) sum += Name##_rfind(x, "~", CSTL_NPOS) + Name##_rfind(x, "[x]", CSTL_NPOS);\
+	double tr = get_msec() - t;\
+	t = get_msec();\
+	for (i = 0; i < LOG_REPEAT; i++, TOUCH(*Name##_at(x, 0), *Name##_at(y, 0))) sum += Name##_find_first_of(x, "#$%&", 0);\
+	double to = get_msec() - t;\
+	t = get_msec();\
+	for (i = 0; i < LOG_REPEAT; i++, TOUCH(*Name##_at(x, 0), *Name##_at(y, 0))) sum += Name##_find_last_not_of(x, "abcdefghijklmnopqrstuvwxyz =\n0123456789GETPOS#:", CSTL_NPOS);\
+	double tn = get_msec() - t;\
+	t = get_msec();\
+	for (i = 0; i < LOG_REPEAT; i++, TOUCH(*Name##_at(x, 0), *Name##_at(y, 0))) sum += Name##_compare(x, y);\
+	double tm = get_msec() - t;\
+	if (sum != search_sum()) {\
+		printf("!!!NG!!!\n");\
+	}\
+	printf("cstl: %-14s find_c %7.2f ms, find %7.2f ms, rfind %7.2f ms, find_first_of %7.2f ms, find_last_not_of %7.2f ms, compare %7.2f ms\n",\
+			label, tc, tf, tr, to, tn, tm);\
+	Name##_delete(x);\
+	Name##_delete(y);\
+} while (0)
+
+static size_t search_sum(void)
+{
+	return LOG_REPEAT * ((size_t) (LOG_SIZE - 40) + (LOG_SIZE - 30) + 10 + CSTL_NPOS + (LOG_SIZE - 40) + 20);
+}
+
+static void bench_stl_search(const char *label)
+{
+	int i;
+	size_t sum = 0;
+	string x(log_src, LOG_SIZE);
+	string y(log_src, LOG_SIZE);
+	double t = get_msec();
+	for (i = 0; i < LOG_REPEAT; i++, TOUCH(x[0], y[0])) sum += x.find('#', 0);
+	double tc = get_msec() - t;
+	t = get_msec();
+	for (i = 0; i < LOG_REPEAT; i++, TOUCH(x[0], y[0])) sum += x.find("needle:7", 0);
+	double tf = get_msec() - t;
+	t = get_msec();
+	for (i = 0; i < LOG_REPEAT; i++, TOUCH(x[0], y[0])) sum += x.rfind("~") + x.rfind("[x]");
+	double tr = get_msec() - t;
+	t = get_msec();
+	for (i = 0; i < LOG_REPEAT; i++, TOUCH(x[0], y[0])) sum += x.find_first_of("#$%&", 0);
+	double to = get_msec() - t;
+	t = get_msec();
+	for (i = 0; i < LOG_REPEAT; i++, TOUCH(x[0], y[0])) sum += x.find_last_not_of("abcdefghijklmnopqrstuvwxyz =\n0123456789GETPOS#:");
+	double tn = get_msec() - t;
+	t = get_msec();
+	for (i = 0; i < LOG_REPEAT; i++, TOUCH(x[0], y[0])) sum += x.compare(y);
+	double tm = get_msec() - t;
+	if (sum != search_sum()) {
+		printf("!!!NG!!!\n");
+	}
+	printf("stl : %-14s find_c %7.2f ms, find %7.2f ms, rfind %7.2f ms, find_first_of %7.2f ms, find_last_not_of %7.2f ms, compare %7.2f ms\n",
+			label, tc, tf, tr, to, tn, tm);
+}
+
+int main(void)
+{
+	int max_len[] = {8, 22, 32};
+	size_t k;
+	for (k = 0; k < sizeof max_len / sizeof max_len[0]; k++) {
+		make_short(max_len[k]);
+		printf("*** benchmark short string: %d strings of 1-%d characters ***\n", SHORT_COUNT, max_len[k]);
+		BENCH_SHORT(String, "string");
+		bench_stl_short("std::string");
+	}
+	make_log();
+	printf("*** benchmark search: %d MB log text, %d times each ***\n", LOG_SIZE / (1024 * 1024), LOG_REPEAT);
+	BENCH_SEARCH(String, "string");
+	bench_stl_search("std::string");
+	free(log_src);
+	return 0;
+}
+
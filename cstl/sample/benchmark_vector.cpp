@@ -11,11 +11,55 @@
 #include <vector>
 #include <algorithm>
 #include <functional>
+#include <new>
 
 
+// counts the allocations made by the containers
+static long alloc_count;
+
+static void *count_malloc(size_t n)
+{
+	alloc_count++;
+	return malloc(n);
+}
+
+static void *count_realloc(void *p, size_t n)
+{
+	alloc_count++;
+	return realloc(p, n);
+}
+
+void *operator new(size_t n)
+{
+	void *p;
+	alloc_count++;
+	p = malloc(n);
+	if (!p) throw std::bad_alloc();
+	return p;
+}
+
+void operator delete(void *p) throw()
+{
+	free(p);
+}
+
+void operator delete(void *p, size_t) throw()
+{
+	free(p);
+}
+
+#define malloc(s)		count_malloc(s)
+#define realloc(p, s)	count_realloc(p, s)
+
 CSTL_VECTOR_INTERFACE(IntVector, int)
 CSTL_VECTOR_IMPLEMENT(IntVector, int)
 
+CSTL_VECTOR_INTERFACE(SmallIntVector, int)
+CSTL_VECTOR_IMPLEMENT_SMALL(SmallIntVector, int, 4)
+
+#undef malloc
+#undef realloc
+
 
 using namespace std;
 
@@ -34,6 +78,88 @@ double get_msec(void)
 #define COUNT			(1000000)
 #define INSERT_COUNT	(10000)
 #define SORT_COUNT		(1000000)
+#define SMALL_COUNT		(1000000)
+
+static void *small_vectors[SMALL_COUNT];
+
+// creates SMALL_COUNT vectors holding 0 to max_len-1 elements, reads them back and deletes them
+#define BENCH_SMALL(Name, label, max_len)	\
+do {\
+	int i, j;\
+	long sum = 0;\
+	long count = alloc_count;\
+	double t = get_msec();\
+	for (i = 0; i < SMALL_COUNT; i++) {\
+		Name *v = Name##_new();\
+		for (j = 0; j < i % (max_len); j++) {\
+			Name##_push_back(v, j);\
+		}\
+		small_vectors[i] = v;\
+	}\
+	double tc = get_msec() - t;\
+	count = alloc_count - count;\
+	t = get_msec();\
+	for (i = 0; i < SMALL_COUNT; i++) {\
+		Name *v = (Name *) small_vectors[i];\
+		for (j = 0; j < (int) Name##_size(v); j++) {\
+			sum += *Name##_at(v, j);\
+		}\
+	}\
+	double tr = get_msec() - t;\
+	t = get_msec();\
+	for (i = 0; i < SMALL_COUNT; i++) {\
+		Name##_delete((Name *) small_vectors[i]);\
+	}\
+	double td = get_msec() - t;\
+	if (sum != small_sum(max_len)) {\
+		printf("!!!NG!!!\n");\
+	}\
+	printf("cstl: %-24s build %8.2f ms, read %6.2f ms, delete %6.2f ms, %8ld allocs\n", label, tc, tr, td, count);\
+} while (0)
+
+static long small_sum(int max_len)
+{
+	long sum = 0;
+	int i;
+	for (i = 0; i < SMALL_COUNT; i++) {
+		sum += (long) (i % max_len) * (i % max_len - 1) / 2;
+	}
+	return sum;
+}
+
+static void bench_stl_small(const char *label, int max_len)
+{
+	int i, j;
+	long sum = 0;
+	long count = alloc_count;
+	double t = get_msec();
+	for (i = 0; i < SMALL_COUNT; i++) {
+		vector<int> *v = new vector<int>;
+		for (j = 0; j < i % max_len; j++) {
+			v->push_back(j);
+		}
+		small_vectors[i] = v;
+	}
+	double tc = get_msec() - t;
+	count = alloc_count - count;
+	t = get_msec();
+	for (i = 0; i < SMALL_COUNT; i++) {
+		vector<int> *v = (vector<int> *) small_vectors[i];
+		for (j = 0; j < (int) v->size(); j++) {
+			sum += (*v)[j];
+		}
+	}
+	double tr = get_msec() - t;
+	t = get_msec();
+	for (i = 0; i < SMALL_COUNT; i++) {
+		delete (vector<int> *) small_vectors[i];
+	}
+	double td = get_msec() - t;
+	if (sum != small_sum(max_len)) {
+		printf("!!!NG!!!\n");
+	}
+	printf("stl : %-24s build %8.2f ms, read %6.2f ms, delete %6.2f ms, %8ld allocs\n", label, tc, tr, td, count);
+}
 
 int comp(const void *x, const void *y)
 {
@@ -373,6 +499,17 @@ int main(void)
 		}
 	}
 
+
+	// many short vectors, like argument lists
+	printf("*** benchmark small vector: %d vectors of 0-4 elements ***\n", SMALL_COUNT);
+	BENCH_SMALL(IntVector, "vector", 5);
+	BENCH_SMALL(SmallIntVector, "small vector<4>", 5);
+	bench_stl_small("std::vector", 5);
+	printf("*** benchmark small vector: %d vectors of 0-15 elements ***\n", SMALL_COUNT);
+	BENCH_SMALL(IntVector, "vector", 16);
+	BENCH_SMALL(SmallIntVector, "small vector<4>", 16);
+	bench_stl_small("std::vector", 16);
+
 	IntVector_delete(x);
 	return 0;
 }
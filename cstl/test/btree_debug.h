@@ -0,0 +1,100 @@
+/* 
+ * Copyright (c) 2006, KATO Noriaki
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/*! 
+ * \file btree_debug.h
+ * \brief btree_set/btree_mapデバッグ用
+ *
+ * B+木のベリファイ
+ */
+#ifndef CSTL_BTREE_DEBUG_H_INCLUDED
+#define CSTL_BTREE_DEBUG_H_INCLUDED
+
+#include <stdio.h>
+
+
+#define CSTL_BTREE_DEBUG_INTERFACE(Name)	\
+int Name##_verify(Name *self);\
+
+#define CSTL_BTREE_DEBUG_IMPLEMENT(Name, KeyType, Compare)	\
+\
+static Name##BTreeLeaf *Name##_verify_leaf; /* 次に辿るべき葉 */\
+static size_t Name##_verify_size;\
+\
+/* nodeの要素が[*lo, *hi)に入っているか。lo, hiがNULLなら下限・上限なし */\
+static int Name##_verify_node(Name *self, void *node, int level, Name##BTreeNode *parent, KeyType *lo, KeyType *hi)\
+{\
+	int i;\
+	if (level == 0) {\
+		Name##BTreeLeaf *leaf = (Name##BTreeLeaf *) node;\
+		if (leaf != Name##_verify_leaf || leaf->parent != parent) return 0;\
+		if (leaf->count < 1 || leaf->count > Name##_LEAF_MAX) return 0;\
+		/* 根と末尾の葉以外は半分以上埋まっている */\
+		if (parent && leaf->next != self->head && leaf->count < Name##_LEAF_MIN) return 0;\
+		for (i = 0; i < leaf->count; i++) {\
+			if (leaf->slots[i].index != i) return 0;\
+			if (i > 0 && Compare(leaf->elems[i - 1].key, leaf->elems[i].key) >= 0) return 0;\
+			if (lo && Compare(leaf->elems[i].key, *lo) < 0) return 0;\
+			if (hi && Compare(leaf->elems[i].key, *hi) >= 0) return 0;\
+		}\
+		if (leaf->next->prev != leaf) return 0;\
+		Name##_verify_leaf = leaf->next;\
+		Name##_verify_size += leaf->count;\
+	} else {\
+		Name##BTreeNode *n = (Name##BTreeNode *) node;\
+		if (n->parent != parent) return 0;\
+		if (n->count < (parent ? Name##_NODE_MIN : 1) || n->count > Name##_NODE_MAX) return 0;\
+		for (i = 0; i < n->count; i++) {\
+			if (i > 0 && Compare(n->keys[i - 1], n->keys[i]) >= 0) return 0;\
+			if (lo && Compare(n->keys[i], *lo) < 0) return 0;\
+			if (hi && Compare(n->keys[i], *hi) >= 0) return 0;\
+		}\
+		for (i = 0; i <= n->count; i++) {\
+			if (!Name##_verify_node(self, n->children[i], level - 1, n,\
+						i > 0 ? &n->keys[i - 1] : lo, i < n->count ? &n->keys[i] : hi)) {\
+				return 0;\
+			}\
+		}\
+	}\
+	return 1;\
+}\
+\
+int Name##_verify(Name *self)\
+{\
+	if (self->head->count != 0 || self->head->prev->next != self->head) {\
+		return 0;\
+	}\
+	if (!self->root) {\
+		return self->size == 0 && self->height == 0 && self->head->next == self->head;\
+	}\
+	Name##_verify_leaf = self->head->next;\
+	Name##_verify_size = 0;\
+	if (!Name##_verify_node(self, self->root, self->height, 0, 0, 0)) {\
+		return 0;\
+	}\
+	return Name##_verify_leaf == self->head && Name##_verify_size == self->size;\
+}\
+\
+
+#endif /* CSTL_BTREE_DEBUG_H_INCLUDED */
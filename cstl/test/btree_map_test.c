@@ -0,0 +1,418 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "../cstl/btree_map.h"
+#include "btree_debug.h"
+#include "Pool.h"
+#ifdef MY_MALLOC
+double buf[1024*1024/sizeof(double)];
+Pool pool;
+#define malloc(s)		Pool_malloc(&pool, s)
+#define realloc(p, s)	Pool_realloc(&pool, p, s)
+#define free(p)			Pool_free(&pool, p)
+#endif
+
+
+/* 葉・内部ノードに最小の要素数しか入らない大きなキー */
+typedef struct BigKey {
+	int k;
+	char pad[60];
+} BigKey;
+#define BIGKEY_COMP(x, y)	CSTL_LESS((x).k, (y).k)
+
+/* btree_map */
+CSTL_BTREE_MAP_INTERFACE(IntIntBMap, int, int)
+CSTL_BTREE_DEBUG_INTERFACE(IntIntBMap)
+
+CSTL_BTREE_MAP_INTERFACE(BigIntBMap, BigKey, int)
+CSTL_BTREE_DEBUG_INTERFACE(BigIntBMap)
+
+CSTL_BTREE_MAP_INTERFACE(StrIntBMap, const char*, int)
+CSTL_BTREE_DEBUG_INTERFACE(StrIntBMap)
+
+CSTL_BTREE_MAP_IMPLEMENT(IntIntBMap, int, int, CSTL_LESS)
+CSTL_BTREE_DEBUG_IMPLEMENT(IntIntBMap, int, CSTL_LESS)
+
+CSTL_BTREE_MAP_IMPLEMENT(BigIntBMap, BigKey, int, BIGKEY_COMP)
+CSTL_BTREE_DEBUG_IMPLEMENT(BigIntBMap, BigKey, BIGKEY_COMP)
+
+CSTL_BTREE_MAP_IMPLEMENT(StrIntBMap, const char*, int, strcmp)
+CSTL_BTREE_DEBUG_IMPLEMENT(StrIntBMap, const char*, strcmp)
+
+static IntIntBMap *ia;
+static StrIntBMap *sa;
+
+
+
+#define SIZE	4096
+#define CHURN	20000
+static char str[SIZE][24];
+static int present[SIZE];
+
+static BigKey big(int k)
+{
+	BigKey b;
+	b.k = k;
+	memset(b.pad, 0, sizeof b.pad);
+	return b;
+}
+
+/* 昇順・降順に全要素を走査して要素数とキーの総和を確認する */
+static void check_contents(IntIntBMap *x, size_t size, long sum)
+{
+	IntIntBMapIterator p;
+	size_t count = 0;
+	long s = 0;
+	int prev = -1;
+	for (p = IntIntBMap_begin(x); p != IntIntBMap_end(x); p = IntIntBMap_next(p)) {
+		count++;
+		assert(*IntIntBMap_key(p) > prev);
+		prev = *IntIntBMap_key(p);
+		s += *IntIntBMap_key(p);
+		assert(*IntIntBMap_value(p) == *IntIntBMap_key(p) * 2);
+	}
+	assert(count == size);
+	assert(s == sum);
+	for (p = IntIntBMap_rbegin(x); p != IntIntBMap_rend(x); p = IntIntBMap_prev(p)) {
+		count--;
+		assert(*IntIntBMap_key(p) == prev);
+		prev--;
+		while (count > 0 && IntIntBMap_find(x, prev) == IntIntBMap_end(x)) {
+			prev--;
+		}
+	}
+	assert(count == 0);
+	assert(IntIntBMap_size(x) == size);
+	assert(IntIntBMap_verify(x));
+}
+
+void BMapTest_test_1_1(void)
+{
+	int i;
+	int success;
+	long sum = 0;
+	IntIntBMapIterator p, q;
+	IntIntBMap *x;
+	printf("***** test_1_1 *****\n");
+	ia = IntIntBMap_new();
+	assert(IntIntBMap_empty(ia));
+	assert(IntIntBMap_begin(ia) == IntIntBMap_end(ia));
+	assert(IntIntBMap_rbegin(ia) == IntIntBMap_rend(ia));
+	assert(IntIntBMap_find(ia, 0) == IntIntBMap_end(ia));
+	assert(IntIntBMap_lower_bound(ia, 0) == IntIntBMap_end(ia));
+	assert(IntIntBMap_verify(ia));
+	/* insert */
+	for (i = 0; i < SIZE; i++) {
+		p = IntIntBMap_insert(ia, i, i * 2, &success);
+		assert(success);
+		assert(p != IntIntBMap_end(ia));
+		assert(*IntIntBMap_key(p) == i);
+		sum += i;
+	}
+	check_contents(ia, SIZE, sum);
+	/* 重複は挿入されない */
+	p = IntIntBMap_insert(ia, 10, 0, &success);
+	assert(!success);
+	assert(*IntIntBMap_key(p) == 10);
+	assert(*IntIntBMap_value(p) == 20);
+	/* find, count, lower_bound, upper_bound, equal_range */
+	for (i = 0; i < SIZE; i++) {
+		p = IntIntBMap_find(ia, i);
+		assert(p != IntIntBMap_end(ia) && *IntIntBMap_key(p) == i);
+		assert(IntIntBMap_count(ia, i) == 1);
+		assert(IntIntBMap_lower_bound(ia, i) == p);
+		q = IntIntBMap_upper_bound(ia, i);
+		assert(q == IntIntBMap_next(p));
+		IntIntBMap_equal_range(ia, i, &p, &q);
+		assert(*IntIntBMap_key(p) == i && q == IntIntBMap_next(p));
+	}
+	assert(IntIntBMap_find(ia, SIZE) == IntIntBMap_end(ia));
+	assert(IntIntBMap_count(ia, -1) == 0);
+	assert(IntIntBMap_lower_bound(ia, -1) == IntIntBMap_begin(ia));
+	assert(IntIntBMap_upper_bound(ia, SIZE - 1) == IntIntBMap_end(ia));
+	assert(*IntIntBMap_key(IntIntBMap_rbegin(ia)) == SIZE - 1);
+	IntIntBMap_equal_range(ia, SIZE, &p, &q);
+	assert(p == IntIntBMap_end(ia) && q == IntIntBMap_end(ia));
+	/* at */
+	*IntIntBMap_at(ia, 5) = 100;
+	assert(*IntIntBMap_value(IntIntBMap_find(ia, 5)) == 100);
+	assert(*IntIntBMap_at(ia, SIZE) == 0);
+	assert(IntIntBMap_size(ia) == SIZE + 1);
+	*IntIntBMap_at(ia, 5) = 10;
+	assert(IntIntBMap_erase_key(ia, SIZE) == 1);
+	/* erase_key: 奇数を削除 */
+	for (i = 1; i < SIZE; i += 2) {
+		assert(IntIntBMap_erase_key(ia, i) == 1);
+		assert(IntIntBMap_erase_key(ia, i) == 0);
+		sum -= i;
+	}
+	check_contents(ia, SIZE / 2, sum);
+	/* 奇数のキーの上下限は隣の偶数 */
+	for (i = 1; i < SIZE - 1; i += 2) {
+		assert(*IntIntBMap_key(IntIntBMap_lower_bound(ia, i)) == i + 1);
+		assert(*IntIntBMap_key(IntIntBMap_upper_bound(ia, i)) == i + 1);
+	}
+	/* eraseは次の要素を返す */
+	p = IntIntBMap_find(ia, 100);
+	p = IntIntBMap_erase(ia, p);
+	assert(*IntIntBMap_key(p) == 102);
+	sum -= 100;
+	/* erase_range */
+	p = IntIntBMap_lower_bound(ia, 1000);
+	q = IntIntBMap_lower_bound(ia, 2000);
+	p = IntIntBMap_erase_range(ia, p, q);
+	assert(*IntIntBMap_key(p) == 2000);
+	for (i = 1000; i < 2000; i += 2) {
+		sum -= i;
+	}
+	check_contents(ia, SIZE / 2 - 1 - 500, sum);
+	/* insert_range */
+	x = IntIntBMap_new();
+	for (i = 0; i < SIZE; i++) {
+		assert(IntIntBMap_insert(x, i, i * 2, NULL));
+	}
+	assert(IntIntBMap_insert_range(ia, IntIntBMap_begin(x), IntIntBMap_end(x)));
+	check_contents(ia, SIZE, (long) SIZE * (SIZE - 1) / 2);
+	assert(IntIntBMap_insert_range(ia, IntIntBMap_begin(ia), IntIntBMap_end(ia)));
+	assert(IntIntBMap_size(ia) == SIZE);
+	/* swap */
+	IntIntBMap_erase_range(ia, IntIntBMap_begin(ia), IntIntBMap_find(ia, SIZE / 2));
+	assert(IntIntBMap_size(ia) == SIZE / 2);
+	IntIntBMap_swap(ia, x);
+	assert(IntIntBMap_size(ia) == SIZE);
+	assert(IntIntBMap_size(x) == SIZE / 2);
+	assert(*IntIntBMap_key(IntIntBMap_begin(x)) == SIZE / 2);
+	assert(IntIntBMap_verify(ia));
+	assert(IntIntBMap_verify(x));
+	/* 後ろから全て削除 */
+	while (!IntIntBMap_empty(x)) {
+		p = IntIntBMap_erase(x, IntIntBMap_rbegin(x));
+		assert(p == IntIntBMap_end(x));
+	}
+	assert(IntIntBMap_verify(x));
+	IntIntBMap_delete(x);
+	/* 前から全て削除 */
+	p = IntIntBMap_begin(ia);
+	for (i = 0; i < SIZE; i++) {
+		assert(*IntIntBMap_key(p) == i);
+		p = IntIntBMap_erase(ia, p);
+		if (i % 256 == 0) {
+			assert(IntIntBMap_verify(ia));
+		}
+	}
+	assert(p == IntIntBMap_end(ia));
+	assert(IntIntBMap_empty(ia));
+	assert(IntIntBMap_verify(ia));
+	/* clear */
+	for (i = SIZE - 1; i >= 0; i--) {
+		assert(IntIntBMap_insert(ia, i, i * 2, NULL));
+	}
+	check_contents(ia, SIZE, (long) SIZE * (SIZE - 1) / 2);
+	IntIntBMap_clear(ia);
+	assert(IntIntBMap_empty(ia));
+	assert(IntIntBMap_begin(ia) == IntIntBMap_end(ia));
+	assert(IntIntBMap_verify(ia));
+	assert(IntIntBMap_insert(ia, 1, 2, NULL));
+	assert(IntIntBMap_size(ia) == 1);
+
+	POOL_DUMP_OVERFLOW(&pool);
+	IntIntBMap_delete(ia);
+}
+
+void BMapTest_test_1_2(void)
+{
+	int i;
+	int k;
+	int success;
+	size_t size = 0;
+	unsigned int seed = 12345;
+	BigIntBMap *b;
+	BigIntBMapIterator p;
+	printf("***** test_1_2 *****\n");
+	/* 挿入と削除をランダムに繰り返し、高さ3以上の木で分割・併合・借用を確認する */
+	b = BigIntBMap_new();
+	assert(BigIntBMap_LEAF_MAX == CSTL_BTREE_MIN_ORDER);
+	assert(BigIntBMap_NODE_MAX == CSTL_BTREE_MIN_ORDER);
+	memset(present, 0, sizeof present);
+	for (i = 0; i < CHURN; i++) {
+		seed = seed * 1103515245 + 12345;
+		k = (int) ((seed >> 8) % (SIZE / 2));
+		if ((seed >> 4) % 3) {
+			p = BigIntBMap_insert(b, big(k), k, &success);
+			assert(p && BigIntBMap_key(p)->k == k);
+			assert(success == !present[k]);
+			if (success) size++;
+			present[k] = 1;
+		} else {
+			assert(BigIntBMap_erase_key(b, big(k)) == (size_t) present[k]);
+			if (present[k]) size--;
+			present[k] = 0;
+		}
+		assert(BigIntBMap_size(b) == size);
+		if (i % 1000 == 0) {
+			assert(BigIntBMap_verify(b));
+		}
+	}
+	assert(BigIntBMap_verify(b));
+	assert(b->height >= 3);
+	for (k = 0; k < SIZE / 2; k++) {
+		assert((BigIntBMap_find(b, big(k)) != BigIntBMap_end(b)) == present[k]);
+	}
+	/* 走査しながら3の倍数を削除 */
+	for (p = BigIntBMap_begin(b); p != BigIntBMap_end(b); ) {
+		k = BigIntBMap_key(p)->k;
+		assert(present[k]);
+		if (k % 3 == 0) {
+			p = BigIntBMap_erase(b, p);
+			assert(p == BigIntBMap_end(b) || BigIntBMap_key(p)->k > k);
+			present[k] = 0;
+			size--;
+		} else {
+			p = BigIntBMap_next(p);
+		}
+	}
+	assert(BigIntBMap_size(b) == size);
+	assert(BigIntBMap_verify(b));
+	for (k = 0; k < SIZE / 2; k++) {
+		assert((BigIntBMap_find(b, big(k)) != BigIntBMap_end(b)) == present[k]);
+	}
+	/* 中ほどの範囲を削除 */
+	BigIntBMap_erase_range(b, BigIntBMap_lower_bound(b, big(SIZE / 8)), BigIntBMap_lower_bound(b, big(SIZE / 4)));
+	assert(BigIntBMap_verify(b));
+	for (k = 0; k < SIZE / 2; k++) {
+		assert((BigIntBMap_find(b, big(k)) != BigIntBMap_end(b)) == (present[k] && (k < SIZE / 8 || k >= SIZE / 4)));
+	}
+	/* 全て削除すると、根が縮んで高さが0に戻る */
+	for (k = 0; k < SIZE / 2; k++) {
+		BigIntBMap_erase_key(b, big(k * 7 % (SIZE / 2)));
+		if (k % 100 == 0) {
+			assert(BigIntBMap_verify(b));
+		}
+	}
+	assert(BigIntBMap_empty(b));
+	assert(BigIntBMap_verify(b));
+	assert(b->height == 0);
+
+	POOL_DUMP_OVERFLOW(&pool);
+	BigIntBMap_delete(b);
+}
+
+#ifdef MY_MALLOC
+void BMapTest_test_1_3(void)
+{
+	int i;
+	int n;
+	int success;
+	int fails = 0;
+	BigIntBMap *b;
+	BigIntBMap *x;
+	BigIntBMapIterator p;
+	printf("***** test_1_3 *****\n");
+	b = BigIntBMap_new();
+	x = BigIntBMap_new();
+	for (i = 0; i < 200; i++) {
+		assert(BigIntBMap_insert(b, big(i * 2), i, NULL));
+	}
+	for (i = 0; i < 400; i++) {
+		assert(BigIntBMap_insert(x, big(i), i, NULL));
+	}
+	/* メモリ不足の場合は失敗し、中身は変わらない */
+	for (i = 1; i < 400; i += 2) {
+		POOL_SET_FAIL_COUNT(&pool, 0);
+		p = BigIntBMap_insert(b, big(i), i, &success);
+		if (p) {
+			/* 葉に空きがあればメモリを確保しない */
+			POOL_RESET_FAIL_COUNT(&pool);
+			assert(success);
+			assert(BigIntBMap_erase_key(b, big(i)) == 1);
+		} else {
+			assert(!success);
+			assert(!BigIntBMap_at(b, big(i)));
+			POOL_RESET_FAIL_COUNT(&pool);
+			fails++;
+		}
+		assert(BigIntBMap_size(b) == 200);
+		assert(BigIntBMap_verify(b));
+	}
+	assert(fails > 0);
+	/* insert_rangeは途中で失敗したら挿入した要素を削除する */
+	for (n = 0; n < 16; n++) {
+		POOL_SET_FAIL_COUNT(&pool, n);
+		assert(!BigIntBMap_insert_range(b, BigIntBMap_begin(x), BigIntBMap_end(x)));
+		POOL_RESET_FAIL_COUNT(&pool);
+		assert(BigIntBMap_size(b) == 200);
+		assert(BigIntBMap_verify(b));
+		for (i = 0; i < 400; i++) {
+			assert((BigIntBMap_find(b, big(i)) != BigIntBMap_end(b)) == (i % 2 == 0));
+		}
+	}
+	assert(BigIntBMap_insert_range(b, BigIntBMap_begin(x), BigIntBMap_end(x)));
+	assert(BigIntBMap_verify(b));
+	assert(BigIntBMap_size(b) == 400);
+	POOL_SET_FAIL_COUNT(&pool, 0);
+	assert(!BigIntBMap_new());
+	POOL_RESET_FAIL_COUNT(&pool);
+
+	POOL_DUMP_OVERFLOW(&pool);
+	BigIntBMap_delete(b);
+	BigIntBMap_delete(x);
+}
+#endif
+
+void BMapTest_test_2_1(void)
+{
+	int i;
+	StrIntBMapIterator p;
+	char key[24];
+	printf("***** test_2_1 *****\n");
+	sa = StrIntBMap_new();
+	for (i = 0; i < SIZE; i++) {
+		sprintf(str[i], "identifier_%04d", SIZE - 1 - i);
+		assert(StrIntBMap_insert(sa, str[i], SIZE - 1 - i, NULL));
+	}
+	assert(StrIntBMap_size(sa) == SIZE);
+	assert(StrIntBMap_verify(sa));
+	/* 文字列の順に並ぶ */
+	for (i = 0, p = StrIntBMap_begin(sa); p != StrIntBMap_end(sa); p = StrIntBMap_next(p), i++) {
+		sprintf(key, "identifier_%04d", i);
+		assert(strcmp(*StrIntBMap_key(p), key) == 0);
+		assert(*StrIntBMap_value(p) == i);
+	}
+	assert(StrIntBMap_find(sa, "identifier_") == StrIntBMap_end(sa));
+	assert(*StrIntBMap_value(StrIntBMap_lower_bound(sa, "identifier_")) == 0);
+	assert(StrIntBMap_erase_key(sa, "identifier_0000") == 1);
+	assert(StrIntBMap_find(sa, "identifier_0000") == StrIntBMap_end(sa));
+	assert(StrIntBMap_size(sa) == SIZE - 1);
+
+	POOL_DUMP_OVERFLOW(&pool);
+	StrIntBMap_delete(sa);
+}
+
+
+
+void BMapTest_run(void)
+{
+	printf("\n===== btree_map test =====\n");
+
+	BMapTest_test_1_1();
+	BMapTest_test_1_2();
+#ifdef MY_MALLOC
+	BMapTest_test_1_3();
+#endif
+	BMapTest_test_2_1();
+}
+
+
+int main(void)
+{
+#ifdef MY_MALLOC
+	Pool_init(&pool, buf, sizeof buf, sizeof buf[0]);
+#endif
+	BMapTest_run();
+#ifdef MY_MALLOC
+	POOL_DUMP_LEAK(&pool, 0);
+#endif
+	return 0;
+}
+
@@ -0,0 +1,147 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "../cstl/btree_set.h"
+#include "btree_debug.h"
+#include "Pool.h"
+#ifdef MY_MALLOC
+double buf[1024*1024/sizeof(double)];
+Pool pool;
+#define malloc(s)		Pool_malloc(&pool, s)
+#define realloc(p, s)	Pool_realloc(&pool, p, s)
+#define free(p)			Pool_free(&pool, p)
+#endif
+
+
+/* btree_set */
+CSTL_BTREE_SET_INTERFACE(UIntBSet, unsigned int)
+CSTL_BTREE_DEBUG_INTERFACE(UIntBSet)
+
+CSTL_BTREE_SET_INTERFACE(DoubleBSet, double)
+CSTL_BTREE_DEBUG_INTERFACE(DoubleBSet)
+
+CSTL_BTREE_SET_IMPLEMENT(UIntBSet, unsigned int, CSTL_LESS)
+CSTL_BTREE_DEBUG_IMPLEMENT(UIntBSet, unsigned int, CSTL_LESS)
+
+CSTL_BTREE_SET_IMPLEMENT(DoubleBSet, double, CSTL_GREATER)
+CSTL_BTREE_DEBUG_IMPLEMENT(DoubleBSet, double, CSTL_GREATER)
+
+static UIntBSet *ua;
+static DoubleBSet *da;
+
+
+
+#define SIZE	4096
+
+void BSetTest_test_1_1(void)
+{
+	unsigned int i;
+	int success;
+	size_t count;
+	UIntBSet *x;
+	UIntBSetIterator p, q;
+	printf("***** test_1_1 *****\n");
+	ua = UIntBSet_new();
+	/* 大きい値から挿入 */
+	for (i = SIZE; i > 0; i--) {
+		p = UIntBSet_insert(ua, i * 3, &success);
+		assert(success);
+		assert(*UIntBSet_data(p) == i * 3);
+	}
+	assert(UIntBSet_size(ua) == SIZE);
+	assert(UIntBSet_verify(ua));
+	p = UIntBSet_insert(ua, 3, &success);
+	assert(!success && *UIntBSet_data(p) == 3);
+	for (i = 1; i <= SIZE; i++) {
+		assert(UIntBSet_count(ua, i * 3) == 1);
+		assert(UIntBSet_count(ua, i * 3 + 1) == 0);
+		assert(*UIntBSet_data(UIntBSet_lower_bound(ua, i * 3 - 2)) == i * 3);
+		assert(*UIntBSet_data(UIntBSet_upper_bound(ua, i * 3 - 1)) == i * 3);
+	}
+	count = 0;
+	for (p = UIntBSet_begin(ua); p != UIntBSet_end(ua); p = UIntBSet_next(p)) {
+		count++;
+		assert(*UIntBSet_data(p) == count * 3);
+	}
+	assert(count == SIZE);
+	/* insert_range, erase_key */
+	x = UIntBSet_new();
+	for (i = 1; i <= SIZE; i++) {
+		assert(UIntBSet_insert(x, i * 2, NULL));
+	}
+	assert(UIntBSet_insert_range(ua, UIntBSet_begin(x), UIntBSet_end(x)));
+	assert(UIntBSet_verify(ua));
+	/* 2の倍数と3の倍数 */
+	assert(UIntBSet_size(ua) == SIZE + SIZE - SIZE * 2 / 6);
+	for (i = 1; i <= SIZE; i++) {
+		assert(UIntBSet_erase_key(ua, i * 2) == 1);
+	}
+	assert(UIntBSet_verify(ua));
+	assert(UIntBSet_size(ua) == SIZE - SIZE * 2 / 6);
+	/* erase_range */
+	p = UIntBSet_lower_bound(ua, SIZE);
+	q = UIntBSet_upper_bound(ua, SIZE * 2);
+	p = UIntBSet_erase_range(ua, p, q);
+	assert(*UIntBSet_data(p) > SIZE * 2);
+	assert(*UIntBSet_data(UIntBSet_prev(p)) < SIZE);
+	assert(UIntBSet_verify(ua));
+	p = UIntBSet_erase_range(ua, UIntBSet_begin(ua), UIntBSet_end(ua));
+	assert(p == UIntBSet_end(ua));
+	assert(UIntBSet_empty(ua));
+	assert(UIntBSet_verify(ua));
+	UIntBSet_delete(x);
+
+	POOL_DUMP_OVERFLOW(&pool);
+	UIntBSet_delete(ua);
+}
+
+void BSetTest_test_2_1(void)
+{
+	int i;
+	DoubleBSetIterator p;
+	double prev;
+	printf("***** test_2_1 *****\n");
+	/* CSTL_GREATERなので降順に並ぶ */
+	da = DoubleBSet_new();
+	for (i = 0; i < SIZE; i++) {
+		assert(DoubleBSet_insert(da, (i * 37 % SIZE) * 0.5, NULL));
+	}
+	assert(DoubleBSet_size(da) == SIZE);
+	assert(DoubleBSet_verify(da));
+	prev = SIZE;
+	for (p = DoubleBSet_begin(da); p != DoubleBSet_end(da); p = DoubleBSet_next(p)) {
+		assert(*DoubleBSet_data(p) < prev);
+		prev = *DoubleBSet_data(p);
+	}
+	assert(prev == 0.0);
+	assert(*DoubleBSet_data(DoubleBSet_rbegin(da)) == 0.0);
+	assert(*DoubleBSet_data(DoubleBSet_lower_bound(da, 10.25)) == 10.0);
+
+	POOL_DUMP_OVERFLOW(&pool);
+	DoubleBSet_delete(da);
+}
+
+
+
+void BSetTest_run(void)
+{
+	printf("\n===== btree_set test =====\n");
+
+	BSetTest_test_1_1();
+	BSetTest_test_2_1();
+}
+
+
+int main(void)
+{
+#ifdef MY_MALLOC
+	Pool_init(&pool, buf, sizeof buf, sizeof buf[0]);
+#endif
+	BSetTest_run();
+#ifdef MY_MALLOC
+	POOL_DUMP_LEAK(&pool, 0);
+#endif
+	return 0;
+}
+
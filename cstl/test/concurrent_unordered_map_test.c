@@ -0,0 +1,259 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "../cstl/concurrent_unordered_map.h"
+#include "Pool.h"
+#ifdef MY_MALLOC
+double buf[1024*1024/sizeof(double)];
+Pool pool;
+#define malloc(s)		Pool_malloc(&pool, s)
+#define realloc(p, s)	Pool_realloc(&pool, p, s)
+#define free(p)			Pool_free(&pool, p)
+#endif
+
+
+/* concurrent_unordered_map */
+CSTL_CONCURRENT_UNORDERED_MAP_INTERFACE(IntIntCMap, int, int)
+CSTL_CONCURRENT_UNORDERED_MAP_IMPLEMENT(IntIntCMap, int, int, IntIntCMap_hash_int, CSTL_EQUAL_TO)
+
+CSTL_CONCURRENT_UNORDERED_MAP_INTERFACE(StrIntCMap, const char*, int)
+CSTL_CONCURRENT_UNORDERED_MAP_IMPLEMENT(StrIntCMap, const char*, int, StrIntCMap_hash_string, strcmp)
+
+static IntIntCMap *ia;
+static StrIntCMap *sa;
+
+
+
+#define SIZE	4096
+#define THREADS	4
+static char str[SIZE][16];
+
+static void add(int *value, void *arg)
+{
+	*value += *(int *) arg;
+}
+
+static void sum_keys(int const *key, int const *value, void *arg)
+{
+	assert(*value == *key * 2);
+	*(long *) arg += *key;
+}
+
+void CMapTest_test_1_1(void)
+{
+	int i;
+	int v;
+	int success;
+	long sum = 0;
+	IntIntCMap *x;
+	printf("***** test_1_1 *****\n");
+	ia = IntIntCMap_new();
+	assert(ia);
+	assert(IntIntCMap_empty(ia));
+	assert(IntIntCMap_segment_count(ia) == CSTL_CONCURRENT_SEGMENTS);
+	/* insert */
+	for (i = 0; i < SIZE; i++) {
+		assert(IntIntCMap_insert(ia, i, i * 2, &success));
+		assert(success);
+		sum += i;
+	}
+	assert(IntIntCMap_size(ia) == SIZE);
+	/* 重複は挿入されない */
+	assert(IntIntCMap_insert(ia, 10, 0, &success));
+	assert(!success);
+	/* find */
+	for (i = 0; i < SIZE; i++) {
+		v = -1;
+		assert(IntIntCMap_find(ia, i, &v));
+		assert(v == i * 2);
+		assert(!IntIntCMap_find(ia, i + SIZE, &v));
+	}
+	assert(IntIntCMap_find(ia, 10, NULL));
+	/* foreach */
+	{
+		long s = 0;
+		IntIntCMap_foreach(ia, sum_keys, &s);
+		assert(s == sum);
+	}
+	/* assign, update */
+	assert(IntIntCMap_assign(ia, 5, 100));
+	assert(IntIntCMap_find(ia, 5, &v) && v == 100);
+	assert(IntIntCMap_assign(ia, SIZE, 0));
+	assert(IntIntCMap_size(ia) == SIZE + 1);
+	v = 3;
+	assert(IntIntCMap_update(ia, 5, add, &v));
+	assert(IntIntCMap_find(ia, 5, &v) && v == 103);
+	assert(!IntIntCMap_update(ia, -1, add, &v));
+	assert(IntIntCMap_assign(ia, 5, 10));
+	assert(IntIntCMap_erase_key(ia, SIZE) == 1);
+	/* erase_key */
+	for (i = 0; i < SIZE; i += 2) {
+		assert(IntIntCMap_erase_key(ia, i) == 1);
+		assert(IntIntCMap_erase_key(ia, i) == 0);
+	}
+	assert(IntIntCMap_size(ia) == SIZE / 2);
+	for (i = 0; i < SIZE; i++) {
+		assert(IntIntCMap_find(ia, i, NULL) == (i & 1));
+	}
+	/* clear */
+	IntIntCMap_clear(ia);
+	assert(IntIntCMap_empty(ia));
+	assert(!IntIntCMap_find(ia, 1, NULL));
+	assert(IntIntCMap_insert(ia, 1, 2, NULL));
+	assert(IntIntCMap_size(ia) == 1);
+	/* セグメント数は2のべき乗に切り上げる */
+	x = IntIntCMap_new_segments(3);
+	assert(IntIntCMap_segment_count(x) == 4);
+	IntIntCMap_delete(x);
+	x = IntIntCMap_new_segments(0);
+	assert(IntIntCMap_segment_count(x) == 1);
+	for (i = 0; i < SIZE; i++) {
+		assert(IntIntCMap_insert(x, i << 12, i, NULL));
+	}
+	for (i = 0; i < SIZE; i++) {
+		assert(IntIntCMap_find(x, i << 12, &v) && v == i);
+	}
+	IntIntCMap_delete(x);
+#ifdef MY_MALLOC
+	/* メモリ不足の場合は失敗し、中身は変わらない */
+	POOL_SET_FAIL_COUNT(&pool, 0);
+	assert(!IntIntCMap_insert(ia, 2, 4, &success));
+	assert(!success);
+	assert(!IntIntCMap_assign(ia, 2, 4));
+	POOL_RESET_FAIL_COUNT(&pool);
+	assert(IntIntCMap_size(ia) == 1);
+	assert(!IntIntCMap_find(ia, 2, NULL));
+	POOL_SET_FAIL_COUNT(&pool, 5);
+	assert(!IntIntCMap_new());
+	POOL_RESET_FAIL_COUNT(&pool);
+	/* バケットを増やせなくても挿入はできる */
+	x = IntIntCMap_new_segments(1);
+	for (i = 0; i < CSTL_CONCURRENT_MIN_BUCKETS; i++) {
+		assert(IntIntCMap_insert(x, i, i * 2, NULL));
+	}
+	POOL_SET_FAIL_COUNT(&pool, 1);
+	assert(IntIntCMap_insert(x, i, i * 2, NULL));
+	POOL_RESET_FAIL_COUNT(&pool);
+	for (i = 0; i <= CSTL_CONCURRENT_MIN_BUCKETS; i++) {
+		assert(IntIntCMap_find(x, i, &v) && v == i * 2);
+	}
+	IntIntCMap_delete(x);
+#endif
+
+	POOL_DUMP_OVERFLOW(&pool);
+	IntIntCMap_delete(ia);
+}
+
+#ifndef MY_MALLOC
+/* Poolはスレッドセーフではないので、MY_MALLOCのときはスレッドを使わない */
+typedef struct {
+	int id;
+	long found;
+} Worker;
+
+/* 各スレッドは自分の範囲のキーを挿入・検索・削除し、共通のカウンタを増やす */
+static void *worker(void *arg)
+{
+	Worker *w = (Worker *) arg;
+	int i, r;
+	int one = 1;
+	int v;
+	int base = w->id * SIZE;
+	for (r = 0; r < 4; r++) {
+		for (i = 0; i < SIZE; i++) {
+			assert(IntIntCMap_insert(ia, base + i, base + i, NULL));
+			assert(IntIntCMap_update(ia, -1, add, &one));
+		}
+		for (i = 0; i < THREADS * SIZE; i++) {
+			if (IntIntCMap_find(ia, i, &v)) {
+				assert(v == i);
+				w->found++;
+			}
+		}
+		for (i = 0; i < SIZE; i++) {
+			assert(IntIntCMap_find(ia, base + i, &v) && v == base + i);
+			assert(IntIntCMap_erase_key(ia, base + i) == 1);
+		}
+	}
+	return 0;
+}
+
+void CMapTest_test_1_2(void)
+{
+	pthread_t th[THREADS];
+	Worker w[THREADS];
+	int i;
+	int v;
+	printf("***** test_1_2 *****\n");
+	ia = IntIntCMap_new_segments(16);
+	assert(IntIntCMap_insert(ia, -1, 0, NULL));
+	for (i = 0; i < THREADS; i++) {
+		w[i].id = i;
+		w[i].found = 0;
+		assert(pthread_create(&th[i], 0, worker, &w[i]) == 0);
+	}
+	for (i = 0; i < THREADS; i++) {
+		assert(pthread_join(th[i], 0) == 0);
+		/* 少なくとも自分の挿入したキーは見つかる */
+		assert(w[i].found >= 4 * SIZE);
+	}
+	assert(IntIntCMap_size(ia) == 1);
+	assert(IntIntCMap_find(ia, -1, &v));
+	assert(v == THREADS * 4 * SIZE);
+	IntIntCMap_delete(ia);
+}
+#endif
+
+void CMapTest_test_2_1(void)
+{
+	int i;
+	int v;
+	printf("***** test_2_1 *****\n");
+	sa = StrIntCMap_new();
+	for (i = 0; i < SIZE; i++) {
+		sprintf(str[i], "identifier_%d", i);
+		assert(StrIntCMap_insert(sa, str[i], i, NULL));
+	}
+	assert(StrIntCMap_size(sa) == SIZE);
+	for (i = 0; i < SIZE; i++) {
+		char key[16];
+		sprintf(key, "identifier_%d", i);
+		assert(StrIntCMap_find(sa, key, &v));
+		assert(v == i);
+	}
+	assert(!StrIntCMap_find(sa, "identifier_", NULL));
+	assert(StrIntCMap_erase_key(sa, "identifier_0") == 1);
+	assert(!StrIntCMap_find(sa, "identifier_0", NULL));
+	assert(StrIntCMap_size(sa) == SIZE - 1);
+
+	POOL_DUMP_OVERFLOW(&pool);
+	StrIntCMap_delete(sa);
+}
+
+
+
+void CMapTest_run(void)
+{
+	printf("\n===== concurrent_unordered_map test =====\n");
+
+	CMapTest_test_1_1();
+#ifndef MY_MALLOC
+	CMapTest_test_1_2();
+#endif
+	CMapTest_test_2_1();
+}
+
+
+int main(void)
+{
+#ifdef MY_MALLOC
+	Pool_init(&pool, buf, sizeof buf, sizeof buf[0]);
+#endif
+	CMapTest_run();
+#ifdef MY_MALLOC
+	POOL_DUMP_LEAK(&pool, 0);
+#endif
+	return 0;
+}
+
@@ -0,0 +1,73 @@
+/* 
+ * Copyright (c) 2006, KATO Noriaki
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/*! 
+ * \file count_allocator.h
+ * \brief *_IMPLEMENT_ALLOCATOR()のテスト用アロケータ
+ *
+ * malloc/realloc/freeに委譲し、確保中のブロック数と呼び出し回数を数える。
+ * MY_MALLOCの場合はPoolに委譲するので、mallocの#defineの後でインクルードすること。
+ */
+#ifndef CSTL_COUNT_ALLOCATOR_H_INCLUDED
+#define CSTL_COUNT_ALLOCATOR_H_INCLUDED
+
+#include <stdlib.h>
+#include "../cstl/common.h"
+
+
+typedef struct CountAllocator {
+	long live; /* 解放されていないブロック数 */
+	long calls; /* allocate/reallocateの呼び出し回数 */
+} CountAllocator;
+
+static void *CountAllocator_allocate(void *ctx, size_t size)
+{
+	CountAllocator *self = (CountAllocator *) ctx;
+	void *p = malloc(size);
+	self->calls++;
+	if (p) self->live++;
+	return p;
+}
+
+static void *CountAllocator_reallocate(void *ctx, void *ptr, size_t size)
+{
+	CountAllocator *self = (CountAllocator *) ctx;
+	void *p = realloc(ptr, size);
+	self->calls++;
+	if (p && !ptr) self->live++;
+	return p;
+}
+
+static void CountAllocator_deallocate(void *ctx, void *ptr)
+{
+	CountAllocator *self = (CountAllocator *) ctx;
+	if (ptr) self->live--;
+	free(ptr);
+}
+
+#define COUNT_ALLOCATOR_INIT(count)	\
+	{ &(count), CountAllocator_allocate, CountAllocator_reallocate, CountAllocator_deallocate }
+
+
+#endif /* CSTL_COUNT_ALLOCATOR_H_INCLUDED */
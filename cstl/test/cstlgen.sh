@@ -6,6 +6,7 @@ usage()
 	echo "   or: cstlgen.sh {map | multimap} name keytype valuetype comp [include] [debug1] [debug2] [path]"
 	echo "   or: cstlgen.sh {unordered_set | unordered_multiset} name type hash comp [include] [debug1] [path]"
 	echo "   or: cstlgen.sh {unordered_map | unordered_multimap} name keytype valuetype hash comp [include] [debug1] [debug2] [path]"
+	echo "   [alloc] after [path]: gc, a Pool variable name, or allocator=name for an extern CstlAllocator name"
 }
 
 container=$1
@@ -221,6 +222,16 @@ if [ "$debug" != "" ]; then
 	list_debug="#include \"./list_debug.h\""
 	deque_debug="#include \"./deque_debug.h\""
 fi
+allocator=`echo "$alloc" | sed -n -e "s/^allocator=//p"`
+if [ "$allocator" != "" ]; then
+	alloc=""
+	impl="IMPLEMENT_ALLOCATOR"
+	alloc_arg=", &$allocator"
+else
+	impl="IMPLEMENT"
+	alloc_arg=""
+fi
+
 if [ "$debug1" != "" ]; then
 	rbtree_debug="#include \"./rbtree_debug.h\""
 	hashtable_debug="#include \"./hashtable_debug.h\""
@@ -283,15 +294,15 @@ if [ "$algo" != "false" ]; then
 	"
 fi
 if [ $container = "set" -o $container = "multiset" ]; then
-	src=${src}"CSTL_${upper}_IMPLEMENT($name, $type, $comp)"
+	src=${src}"CSTL_${upper}_${impl}($name, $type, $comp${alloc_arg})"
 elif [ $container = "map" -o $container = "multimap" ]; then
-	src=${src}"CSTL_${upper}_IMPLEMENT($name, $type, $value, $comp)"
+	src=${src}"CSTL_${upper}_${impl}($name, $type, $value, $comp${alloc_arg})"
 elif [ $container = "unordered_set" -o $container = "unordered_multiset" ]; then
-	src=${src}"CSTL_${upper}_IMPLEMENT($name, $type, $hash, $comp)"
+	src=${src}"CSTL_${upper}_${impl}($name, $type, $hash, $comp${alloc_arg})"
 elif [ $container = "unordered_map" -o $container = "unordered_multimap" ]; then
-	src=${src}"CSTL_${upper}_IMPLEMENT($name, $type, $value, $hash, $comp)"
+	src=${src}"CSTL_${upper}_${impl}($name, $type, $value, $hash, $comp${alloc_arg})"
 else
-	src=${src}"CSTL_${upper}_IMPLEMENT($name, $type)"
+	src=${src}"CSTL_${upper}_${impl}($name, $type${alloc_arg})"
 fi
 if [ "$rbdebug" != "" ]; then
 	format=`echo "$debug2" | grep '%[#+-]*[0-9]*[dioxXucsfeEgGp]'`
@@ -394,7 +405,7 @@ echo "\
 #ifdef __cplusplus
 extern \"C\" {
 #endif" >> "$path"".h"
-echo "$hdr" | cpp -CC -I.. | grep "${name}_new" \
+echo "$hdr" | cpp -CC -P -I.. | grep "${name}_new" \
 | sed -e 's:/\*\([ !]\):\
 /\*\1:g' \
 | sed -e 's/\t* \* /\
@@ -461,6 +472,11 @@ if [ "$comp" = "strcmp" -o\
 		$lower = "unordered_map" -o $lower = "unordered_multimap" ]; then
 	echo "#include <string.h>" >> "$path"".c"
 fi
+if [ $lower = "unordered_set" -o $lower = "unordered_multiset" -o\
+		$lower = "unordered_map" -o $lower = "unordered_multimap" ]; then
+	echo "#include <wchar.h>" >> "$path"".c"
+	echo "#include <limits.h>" >> "$path"".c"
+fi
 if [ "$rbdebug" != "" -o "$hashdebug" != "" -o "$debug" != "" ]; then
 	echo "#include <stdio.h>" >> "$path"".c"
 	if [ "$hashdebug" != "" ]; then
@@ -495,6 +511,14 @@ echo "\
 #define CSTL_UNUSED_PARAM(x)	(void) x
 " >> "$path"".c"
 fi
+# 実装はCSTL_ALLOCATE()等でメモリを確保するので、common.hからアロケータの定義をコピーする
+sed -n -e '/^typedef struct CstlAllocator/,/(Allocator)->deallocate(/p' "../cstl/common.h" | sed -e "s/\r//" >> "$path"".c"
+echo "" >> "$path"".c"
+if [ "$allocator" != "" ]; then
+echo "\
+extern CstlAllocator $allocator;
+" >> "$path"".c"
+fi
 if [ "$alloc" != "" ]; then
 if [ "$alloc" = "gc" ]; then
 echo "\
@@ -523,18 +547,24 @@ elif [ $lower = "deque" ]; then
 	grep '#define CSTL_DEQUE_\(.*self\|RINGBUF_SIZE\|INITIAL_MAP_SIZE\)' "../cstl/deque.h" | sed -e "s/\r//" >> "$path"".c"
 elif [ $lower = "list" ]; then
 	grep '#define CSTL_LIST_.*\(self\|pos\)' "../cstl/list.h" | sed -e "s/\r//" >> "$path"".c"
+	grep '#define CSTL_NODE_POOL_.*_CHUNK' "../cstl/node_pool.h" | sed -e "s/\r//" >> "$path"".c"
 elif [ $lower = "string" ]; then
 	grep '#define CSTL_VECTOR_.*self' "../cstl/vector.h" | sed -e "s/\r//" >> "$path"".c"
-	grep '#define CSTL_STRING_\(.*self\|DEFAULT_CAPACITY\)' "../cstl/string.h" | sed -e "s/\r//" >> "$path"".c"
+	grep '#define CSTL_STRING_.*self' "../cstl/string.h" | sed -e "s/\r//" >> "$path"".c"
+	sed -n -e '/^#define CSTL_STRING_SSO_BYTES/,/: 2)$/p' "../cstl/string.h" | sed -e "s/\r//" >> "$path"".c"
+	sed -n -e '/^#if !defined(CSTL_STRING_NO_SIMD)/,/((b) >> 4) & 7)))$/p' "../cstl/string.h" | sed -e "s/\r//" >> "$path"".c"
 elif [ $lower = "set" -o $lower = "multiset" -o\
 	   $lower = "map" -o $lower = "multimap" ]; then
 	grep '#define CSTL_RBTREE_.*node' "../cstl/rbtree.h" | sed -e "s/\r//" >> "$path"".c"
+	grep '#define CSTL_NODE_POOL_.*_CHUNK' "../cstl/node_pool.h" | sed -e "s/\r//" >> "$path"".c"
 elif [ $lower = "unordered_set" -o $lower = "unordered_multiset" -o\
 	   $lower = "unordered_map" -o $lower = "unordered_multimap" ]; then
 	grep '#define CSTL_VECTOR_.*self' "../cstl/vector.h" | sed -e "s/\r//" >> "$path"".c"
+	grep '#define CSTL_NODE_POOL_.*_CHUNK' "../cstl/node_pool.h" | sed -e "s/\r//" >> "$path"".c"
+	sed -n -e '/^#if defined(ULLONG_MAX)/,/^#endif \/\* CSTL_HASH_WORD \*\//p' "../cstl/hashtable.h" | sed -e "s/\r//" >> "$path"".c"
 fi
 echo "" >> "$path"".c"
-echo "$src" | cpp -CC -I.. | grep "${name}_new" \
+echo "$src" | cpp -CC -P -I.. | grep "${name}_new" \
 | sed -e 's:/\*\([ !]\):\
 /\*\1:g' \
 | sed -e 's/\t* \* /\
@@ -33,6 +33,19 @@ CSTL_DEQUE_DEBUG_IMPLEMENT(UCharDeque, unsigned char, %d)
 CSTL_DEQUE_DEBUG_IMPLEMENT(IntDeque, int, %d)
 #endif
 
+#include "count_allocator.h"
+static CountAllocator count;
+#ifdef CSTLGEN
+/* allocator=count_allocatorで生成したソースはextern宣言で参照する */
+#include "IntADeque.h"
+CstlAllocator count_allocator = COUNT_ALLOCATOR_INIT(count);
+#else
+static CstlAllocator const count_allocator = COUNT_ALLOCATOR_INIT(count);
+
+CSTL_DEQUE_INTERFACE(IntADeque, int)
+CSTL_DEQUE_IMPLEMENT_ALLOCATOR(IntADeque, int, &count_allocator)
+#endif
+
 static UCharDeque *ud;
 static IntDeque *id;
 
@@ -1028,6 +1041,31 @@ void DequeTest_test_2_5(void)
 
 
 
+void DequeTest_test_3_1(void)
+{
+	int i;
+	IntADeque *x;
+	printf("***** test_3_1 *****\n");
+	/* すべての確保と解放がアロケータを通る */
+	x = IntADeque_new();
+	assert(count.live > 0);
+	for (i = 0; i < MAX; i++) {
+		assert(IntADeque_push_back(x, i));
+		assert(IntADeque_push_front(x, -i));
+	}
+	for (i = 0; i < MAX; i++) {
+		assert(*IntADeque_at(x, MAX + i) == i);
+		assert(*IntADeque_at(x, MAX - 1 - i) == -i);
+	}
+	IntADeque_clear(x);
+	assert(IntADeque_empty(x));
+	IntADeque_delete(x);
+	assert(count.live == 0);
+
+	POOL_DUMP_OVERFLOW(&pool);
+}
+
+
 
 void DequeTest_run(void)
 {
@@ -1047,6 +1085,7 @@ void DequeTest_run(void)
 	DequeTest_test_2_3();
 	DequeTest_test_2_4();
 	DequeTest_test_2_5();
+	DequeTest_test_3_1();
 }
 
 
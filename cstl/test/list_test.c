@@ -37,6 +37,25 @@ CSTL_LIST_DEBUG_IMPLEMENT(IntList, int, %d)
 CSTL_LIST_DEBUG_IMPLEMENT(HogeList, Hoge, )
 #endif
 
+/* cstlgen.shはノードプールの実装を生成しないので、生成したソースを使う場合もマクロで展開する */
+CSTL_LIST_INTERFACE(IntPList, int)
+CSTL_LIST_DEBUG_INTERFACE(IntPList, int)
+CSTL_LIST_IMPLEMENT_POOL(IntPList, int)
+CSTL_LIST_DEBUG_IMPLEMENT(IntPList, int, %d)
+
+#include "count_allocator.h"
+static CountAllocator count;
+#ifdef CSTLGEN
+/* allocator=count_allocatorで生成したソースはextern宣言で参照する */
+#include "IntAList.h"
+CstlAllocator count_allocator = COUNT_ALLOCATOR_INIT(count);
+#else
+static CstlAllocator const count_allocator = COUNT_ALLOCATOR_INIT(count);
+
+CSTL_LIST_INTERFACE(IntAList, int)
+CSTL_LIST_IMPLEMENT_ALLOCATOR(IntAList, int, &count_allocator)
+#endif
+
 
 static HogeList *hl;
 
@@ -653,6 +672,130 @@ void ListTest_test_2_1(void)
 
 
 
+int int_less(const void *p1, const void *p2)
+{
+	return *(int *) p1 - *(int *) p2;
+}
+
+void ListTest_test_3_1(void)
+{
+	int i;
+	int buf[64];
+	IntPList *pl;
+	IntPList *x;
+	IntPListIterator pos;
+	IntPListIterator freed;
+	printf("***** test_3_1 *****\n");
+	/* ノードプール */
+	pl = IntPList_new();
+	assert(pl);
+	x = IntPList_new();
+	assert(x);
+	for (i = 0; i < 64; i++) {
+		buf[i] = i;
+		assert(IntPList_push_back(pl, i));
+	}
+	assert(IntPList_size(pl) == 64);
+	assert(IntPList_verify(pl));
+	/* 削除したノードは次の挿入で再利用される */
+	freed = IntPList_next(IntPList_begin(pl));
+	IntPList_erase(pl, freed);
+	pos = IntPList_insert(pl, IntPList_begin(pl), 100);
+	assert(pos == freed);
+	assert(*IntPList_front(pl) == 100);
+	IntPList_pop_front(pl);
+	/* 挿入と削除の繰り返し */
+	for (i = 0; i < 1000; i++) {
+		assert(IntPList_push_front(pl, i));
+		assert(IntPList_push_back(pl, i));
+		IntPList_pop_back(pl);
+		if (i & 1) IntPList_pop_front(pl);
+	}
+	assert(IntPList_size(pl) == 63 + 500);
+	assert(IntPList_verify(pl));
+	/* insert_array, resize */
+	IntPList_clear(pl);
+	assert(IntPList_empty(pl));
+	assert(IntPList_insert_array(pl, IntPList_end(pl), buf, 64));
+	assert(IntPList_resize(pl, 100, -1));
+	assert(IntPList_size(pl) == 100);
+	assert(*IntPList_back(pl) == -1);
+	assert(IntPList_resize(pl, 64, 0));
+	for (pos = IntPList_begin(pl), i = 0; pos != IntPList_end(pl); pos = IntPList_next(pos), i++) {
+		assert(*IntPList_data(pos) == i);
+	}
+	/* 同じリストの中のsplice, sort */
+	IntPList_splice(pl, IntPList_begin(pl), pl, IntPList_next(IntPList_begin(pl)), IntPList_end(pl));
+	assert(*IntPList_front(pl) == 1);
+	assert(*IntPList_back(pl) == 0);
+	IntPList_sort(pl, int_less);
+	for (pos = IntPList_begin(pl), i = 0; pos != IntPList_end(pl); pos = IntPList_next(pos), i++) {
+		assert(*IntPList_data(pos) == i);
+	}
+	assert(IntPList_verify(pl));
+	/* swapするとノードプールも入れ替わる */
+	assert(IntPList_insert_n(x, IntPList_end(x), 10, 7));
+	IntPList_swap(pl, x);
+	assert(IntPList_size(pl) == 10);
+	assert(IntPList_size(x) == 64);
+	IntPList_clear(pl);
+	assert(IntPList_empty(pl));
+	assert(*IntPList_back(x) == 63);
+	assert(IntPList_verify(x));
+#ifdef MY_MALLOC
+	/* メモリ不足の場合は失敗し、中身は変わらない */
+	IntPList_delete(pl);
+	pl = IntPList_new();
+	POOL_SET_FAIL_COUNT(&pool, 2);
+	assert(!IntPList_insert_range(pl, IntPList_begin(pl), IntPList_begin(x), IntPList_end(x)));
+	POOL_RESET_FAIL_COUNT(&pool);
+	assert(IntPList_empty(pl));
+	assert(IntPList_verify(pl));
+	assert(IntPList_insert_range(pl, IntPList_begin(pl), IntPList_begin(x), IntPList_end(x)));
+	assert(IntPList_size(pl) == 64);
+#endif
+
+	POOL_DUMP_OVERFLOW(&pool);
+	IntPList_delete(pl);
+	IntPList_delete(x);
+}
+
+
+
+void ListTest_test_4_1(void)
+{
+	int i;
+	IntAList *x;
+	IntAListIterator pos;
+	printf("***** test_4_1 *****\n");
+	/* すべての確保と解放がアロケータを通る */
+	x = IntAList_new();
+	assert(count.live == 1);
+	for (i = 0; i < 100; i++) {
+		assert(IntAList_push_back(x, i));
+	}
+	assert(count.live == 101);
+	for (i = 0, pos = IntAList_begin(x); pos != IntAList_end(x); i++) {
+		if (i & 1) {
+			pos = IntAList_erase(x, pos);
+		} else {
+			pos = IntAList_next(pos);
+		}
+	}
+	assert(IntAList_size(x) == 50);
+	assert(count.live == 51);
+	assert(IntAList_insert_n(x, IntAList_begin(x), 10, -1));
+	assert(count.live == 61);
+	IntAList_clear(x);
+	assert(count.live == 1);
+	IntAList_delete(x);
+	assert(count.live == 0);
+
+	POOL_DUMP_OVERFLOW(&pool);
+}
+
+
+
 void ListTest_run(void)
 {
 	printf("\n===== list test =====\n");
@@ -669,6 +812,8 @@ void ListTest_run(void)
 	ListTest_test_1_7();
 	ListTest_test_1_8();
 	ListTest_test_2_1();
+	ListTest_test_3_1();
+	ListTest_test_4_1();
 
 	POOL_DUMP_OVERFLOW(&pool);
 	HogeList_delete(hl);
@@ -38,6 +38,26 @@ CSTL_MAP_DEBUG_IMPLEMENT(IntIntMapA, int, int, CSTL_LESS, %d, %d, VISUAL)
 CSTL_MULTIMAP_IMPLEMENT(IntIntMMapA, int, int, CSTL_LESS)
 CSTL_MAP_DEBUG_IMPLEMENT(IntIntMMapA, int, int, CSTL_LESS, %d, %d, VISUAL)
 #endif
+
+/* cstlgen.shはノードプールの実装を生成しないので、生成したソースを使う場合もマクロで展開する */
+CSTL_MULTIMAP_INTERFACE(IntIntMMapP, int, int)
+CSTL_MAP_DEBUG_INTERFACE(IntIntMMapP)
+
+CSTL_MULTIMAP_IMPLEMENT_POOL(IntIntMMapP, int, int, CSTL_LESS)
+CSTL_MAP_DEBUG_IMPLEMENT(IntIntMMapP, int, int, CSTL_LESS, %d, %d, VISUAL)
+
+#include "count_allocator.h"
+static CountAllocator count;
+#ifdef CSTLGEN
+/* allocator=count_allocatorで生成したソースはextern宣言で参照する */
+#include "IntIntMapAl.h"
+CstlAllocator count_allocator = COUNT_ALLOCATOR_INIT(count);
+#else
+static CstlAllocator const count_allocator = COUNT_ALLOCATOR_INIT(count);
+
+CSTL_MAP_INTERFACE(IntIntMapAl, int, int)
+CSTL_MAP_IMPLEMENT_ALLOCATOR(IntIntMapAl, int, int, CSTL_LESS, &count_allocator)
+#endif
 static IntIntMapA *ia;
 static IntIntMMapA *ima;
 
@@ -378,6 +398,99 @@ void MapTest_test_1_2(void)
 
 
 
+void MapTest_test_1_3(void)
+{
+	int i;
+	IntIntMMapP *x;
+	IntIntMMapP *y;
+	IntIntMMapPIterator pos;
+	IntIntMMapPIterator freed;
+	printf("***** test_1_3 *****\n");
+	/* ノードプール */
+	x = IntIntMMapP_new();
+	y = IntIntMMapP_new();
+	for (i = 0; i < SIZE * 8; i++) {
+		assert(IntIntMMapP_insert(x, i % SIZE, i));
+	}
+	assert(IntIntMMapP_size(x) == SIZE * 8);
+	assert(IntIntMMapP_count(x, 3) == 8);
+	assert(IntIntMMapP_verify(x));
+	/* 削除したノードは次の挿入で再利用される */
+	freed = IntIntMMapP_find(x, 5);
+	IntIntMMapP_erase(x, freed);
+	pos = IntIntMMapP_insert(x, SIZE, 0);
+	assert(pos == freed);
+	assert(*IntIntMMapP_key(pos) == SIZE);
+	/* 挿入と削除の繰り返し */
+	for (i = 0; i < SIZE * 64; i++) {
+		assert(IntIntMMapP_insert(x, i % (SIZE * 2), i));
+		IntIntMMapP_erase_key(x, (i + SIZE) % (SIZE * 2));
+	}
+	assert(IntIntMMapP_verify(x));
+	assert(IntIntMMapP_size(x) == SIZE);
+	for (i = 0; i < SIZE * 2; i++) {
+		assert(IntIntMMapP_count(x, i) == (size_t) (i >= SIZE));
+	}
+	/* swap */
+	assert(IntIntMMapP_insert_range(y, IntIntMMapP_begin(x), IntIntMMapP_end(x)));
+	assert(IntIntMMapP_size(y) == IntIntMMapP_size(x));
+	IntIntMMapP_clear(x);
+	assert(IntIntMMapP_empty(x));
+	assert(IntIntMMapP_verify(x));
+	IntIntMMapP_swap(x, y);
+	assert(IntIntMMapP_empty(y));
+	assert(IntIntMMapP_verify(x));
+	for (i = 0; i < SIZE; i++) {
+		assert(IntIntMMapP_insert(y, i, i));
+	}
+	IntIntMMapP_clear(x);
+	assert(IntIntMMapP_empty(x));
+	assert(IntIntMMapP_size(y) == SIZE);
+	assert(IntIntMMapP_verify(y));
+#ifdef MY_MALLOC
+	/* メモリ不足の場合は失敗し、中身は変わらない */
+	POOL_SET_FAIL_COUNT(&pool, 0);
+	for (i = 0; IntIntMMapP_insert(x, i, i); i++) ;
+	POOL_RESET_FAIL_COUNT(&pool);
+	assert(IntIntMMapP_size(x) == (size_t) i);
+	assert(IntIntMMapP_verify(x));
+#endif
+
+	POOL_DUMP_OVERFLOW(&pool);
+	IntIntMMapP_delete(x);
+	IntIntMMapP_delete(y);
+}
+
+
+
+void MapTest_test_1_4(void)
+{
+	int i;
+	IntIntMapAl *x;
+	printf("***** test_1_4 *****\n");
+	/* すべての確保と解放がアロケータを通る */
+	x = IntIntMapAl_new();
+	assert(count.live == 2);
+	for (i = 0; i < SIZE; i++) {
+		assert(IntIntMapAl_insert(x, i, i, NULL));
+	}
+	assert(count.live == 2 + SIZE);
+	for (i = 0; i < SIZE; i += 2) {
+		assert(IntIntMapAl_erase_key(x, i) == 1);
+	}
+	assert(count.live == 2 + SIZE / 2);
+	assert(IntIntMapAl_at(x, -1));
+	assert(count.live == 3 + SIZE / 2);
+	IntIntMapAl_clear(x);
+	assert(count.live == 2);
+	IntIntMapAl_delete(x);
+	assert(count.live == 0);
+
+	POOL_DUMP_OVERFLOW(&pool);
+}
+
+
+
 void MapTest_run(void)
 {
 	printf("\n===== map test =====\n");
@@ -385,6 +498,8 @@ void MapTest_run(void)
 
 	MapTest_test_1_1();
 	MapTest_test_1_2();
+	MapTest_test_1_3();
+	MapTest_test_1_4();
 }
 
 
@@ -0,0 +1,85 @@
+/* 
+ * Copyright (c) 2006, KATO Noriaki
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/*! 
+ * \file rope_debug.h
+ * \brief ropeデバッグ用
+ *
+ * AVL木のベリファイ
+ */
+#ifndef CSTL_ROPE_DEBUG_H_INCLUDED
+#define CSTL_ROPE_DEBUG_H_INCLUDED
+
+#include <stdio.h>
+
+
+#define CSTL_ROPE_DEBUG_INTERFACE(Name)	\
+int Name##_verify(Name *self);\
+size_t Name##_chunk_count(Name *self);\
+
+#define CSTL_ROPE_DEBUG_IMPLEMENT(Name, Type)	\
+\
+/* tの高さを返す。不正ならば-1 */\
+static int Name##_verify_node(Name##RopeNode *t, Name##RopeNode *parent)\
+{\
+	int hl, hr;\
+	if (!t) return 0;\
+	if (t->parent != parent) return -1;\
+	if (t->len < 1 || t->len > Name##_CHUNK_MAX) return -1;\
+	hl = Name##_verify_node(t->left, t);\
+	hr = Name##_verify_node(t->right, t);\
+	if (hl < 0 || hr < 0) return -1;\
+	if (hl - hr > 1 || hr - hl > 1) return -1;\
+	if (t->height != (hl > hr ? hl : hr) + 1) return -1;\
+	if (t->size != CSTL_ROPE_SIZE(t->left) + t->len + CSTL_ROPE_SIZE(t->right)) return -1;\
+	return t->height;\
+}\
+\
+int Name##_verify(Name *self)\
+{\
+	Name##Iterator pos;\
+	size_t size = 0;\
+	if (Name##_verify_node(self->root, 0) < 0) {\
+		return 0;\
+	}\
+	/* イテレータで全チャンクを前後に辿れる */\
+	for (pos = Name##_begin(self); pos != Name##_end(self); pos = Name##_next(pos)) {\
+		if (Name##_next(pos) != Name##_end(self) && Name##_prev(Name##_next(pos)) != pos) return 0;\
+		size += Name##_chunk_size(pos);\
+	}\
+	return size == Name##_size(self);\
+}\
+\
+size_t Name##_chunk_count(Name *self)\
+{\
+	Name##Iterator pos;\
+	size_t n = 0;\
+	for (pos = Name##_begin(self); pos != Name##_end(self); pos = Name##_next(pos)) {\
+		n++;\
+	}\
+	return n;\
+}\
+\
+
+#endif /* CSTL_ROPE_DEBUG_H_INCLUDED */
@@ -0,0 +1,394 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "../cstl/rope.h"
+#include "../cstl/string.h"
+#include "rope_debug.h"
+#include "Pool.h"
+#ifdef MY_MALLOC
+double buf[1024*1024/sizeof(double)];
+Pool pool;
+#define malloc(s)		Pool_malloc(&pool, s)
+#define realloc(p, s)	Pool_realloc(&pool, p, s)
+#define free(p)			Pool_free(&pool, p)
+#endif
+
+
+/* rope */
+CSTL_ROPE_INTERFACE(Rope, char)
+CSTL_ROPE_DEBUG_INTERFACE(Rope)
+
+CSTL_STRING_INTERFACE(String, char)
+CSTL_ROPE_STRING_INTERFACE(Rope, String)
+
+CSTL_ROPE_IMPLEMENT(Rope, char)
+CSTL_ROPE_DEBUG_IMPLEMENT(Rope, char)
+
+CSTL_STRING_IMPLEMENT(String, char)
+CSTL_ROPE_STRING_IMPLEMENT(Rope, String)
+
+#include "count_allocator.h"
+static CountAllocator count;
+static CstlAllocator const count_allocator = COUNT_ALLOCATOR_INIT(count);
+
+CSTL_ROPE_INTERFACE(ARope, char)
+CSTL_ROPE_IMPLEMENT_ALLOCATOR(ARope, char, &count_allocator)
+
+
+#define SIZE	(16 * 1024)
+#define CHUNK	CSTL_ROPE_CHUNK_SIZE(char)
+
+/* 比較用の平らな文字列 */
+static char ref[SIZE * 2];
+static size_t ref_len;
+static char out[SIZE * 2];
+static char src[SIZE];
+
+static unsigned int xorshift(void)
+{
+	static unsigned int r = 2463534242u;
+	r ^= r << 13;
+	r ^= r >> 17;
+	r ^= r << 5;
+	return r;
+}
+
+static void ref_insert(size_t idx, const char *chars, size_t len)
+{
+	memmove(&ref[idx + len], &ref[idx], ref_len - idx);
+	memcpy(&ref[idx], chars, len);
+	ref_len += len;
+}
+
+static void ref_erase(size_t idx, size_t len)
+{
+	if (len > ref_len - idx) len = ref_len - idx;
+	memmove(&ref[idx], &ref[idx + len], ref_len - idx - len);
+	ref_len -= len;
+}
+
+static void check(Rope *x)
+{
+	assert(Rope_verify(x));
+	assert(Rope_size(x) == ref_len);
+	assert(Rope_empty(x) == (ref_len == 0));
+	assert(Rope_copy(x, 0, ref_len, out) == ref_len);
+	assert(memcmp(out, ref, ref_len) == 0);
+}
+
+void RopeTest_test_1_1(void)
+{
+	Rope *x;
+	size_t i;
+	size_t offset;
+	RopeIterator pos;
+	printf("***** test_1_1 *****\n");
+	x = Rope_new();
+	assert(x);
+	ref_len = 0;
+	check(x);
+	assert(Rope_begin(x) == Rope_end(x));
+	assert(Rope_rbegin(x) == Rope_rend(x));
+	/* push_back, append_len */
+	for (i = 0; i < CHUNK * 3; i++) {
+		assert(Rope_push_back(x, (char) ('a' + i % 26)));
+		ref[ref_len++] = (char) ('a' + i % 26);
+	}
+	check(x);
+	assert(Rope_append_len(x, "hello", 5));
+	ref_insert(ref_len, "hello", 5);
+	check(x);
+	/* at */
+	for (i = 0; i < ref_len; i++) {
+		assert(*Rope_at(x, i) == ref[i]);
+	}
+	*Rope_at(x, 1) = 'B';
+	ref[1] = 'B';
+	check(x);
+	/* insert_len */
+	assert(Rope_insert_len(x, 0, "012", 3));
+	ref_insert(0, "012", 3);
+	check(x);
+	assert(Rope_insert_len(x, CHUNK, "xyz", 3));
+	ref_insert(CHUNK, "xyz", 3);
+	check(x);
+	assert(Rope_insert_len(x, Rope_size(x), "end", 3));
+	ref_insert(ref_len, "end", 3);
+	check(x);
+	assert(Rope_insert_len(x, 5, "", 0));
+	check(x);
+	/* erase */
+	assert(Rope_erase(x, 0, 1));
+	ref_erase(0, 1);
+	check(x);
+	assert(Rope_erase(x, CHUNK - 10, CHUNK + 20));
+	ref_erase(CHUNK - 10, CHUNK + 20);
+	check(x);
+	assert(Rope_erase(x, 10, 0));
+	assert(Rope_erase(x, Rope_size(x), 10));
+	check(x);
+	assert(Rope_erase(x, Rope_size(x) - 3, 100));
+	ref_erase(ref_len - 3, 100);
+	check(x);
+	/* copy */
+	assert(Rope_copy(x, 3, 10, out) == 10);
+	assert(memcmp(out, &ref[3], 10) == 0);
+	assert(Rope_copy(x, ref_len - 2, 10, out) == 2);
+	assert(Rope_copy(x, ref_len, 10, out) == 0);
+	/* chunk_find */
+	for (i = 0; i < ref_len; i++) {
+		pos = Rope_chunk_find(x, i, &offset);
+		assert(offset < Rope_chunk_size(pos));
+		assert(Rope_chunk_data(pos)[offset] == ref[i]);
+	}
+	/* clear */
+	Rope_clear(x);
+	ref_len = 0;
+	check(x);
+	assert(Rope_append_len(x, "abc", 3));
+	ref_insert(0, "abc", 3);
+	check(x);
+	Rope_delete(x);
+
+	POOL_DUMP_OVERFLOW(&pool);
+}
+
+void RopeTest_test_1_2(void)
+{
+	Rope *x;
+	size_t i, j;
+	size_t idx, len;
+	printf("***** test_1_2 *****\n");
+	/* ランダムな編集を平らな文字列と比べる */
+	for (i = 0; i < SIZE; i++) {
+		src[i] = (char) ('A' + xorshift() % 26);
+	}
+	x = Rope_new_assign_len(src, SIZE / 2);
+	ref_len = 0;
+	ref_insert(0, src, SIZE / 2);
+	check(x);
+	for (i = 0; i < 4000; i++) {
+		unsigned int r = xorshift();
+		idx = ref_len ? xorshift() % (ref_len + 1) : 0;
+		switch (r % 8) {
+		case 0: case 1: case 2:
+			/* 入力のような少しの挿入 */
+			len = 1 + xorshift() % 8;
+			assert(Rope_insert_len(x, idx, &src[i % 64], len));
+			ref_insert(idx, &src[i % 64], len);
+			break;
+		case 3:
+			/* 貼り付け */
+			len = xorshift() % (CHUNK * 3);
+			if (ref_len + len > sizeof ref) len = 0;
+			assert(Rope_insert_len(x, idx, src, len));
+			ref_insert(idx, src, len);
+			break;
+		case 4: case 5: case 6:
+			len = 1 + xorshift() % 8;
+			assert(Rope_erase(x, idx, len));
+			ref_erase(idx, len);
+			break;
+		default:
+			/* 切り取り */
+			len = xorshift() % (CHUNK * 3);
+			assert(Rope_erase(x, idx, len));
+			ref_erase(idx, len);
+			break;
+		}
+		check(x);
+	}
+	/* 細かい挿入・削除を繰り返してもチャンクは細かくならない */
+	assert(Rope_chunk_count(x) <= ref_len / (CHUNK / 4) + 2);
+	for (j = 0; j < 2; j++) {
+		/* 1文字ずつ削除して空にする */
+		while (ref_len) {
+			idx = xorshift() % ref_len;
+			assert(Rope_erase(x, idx, 1 + j));
+			ref_erase(idx, 1 + j);
+		}
+		check(x);
+		assert(Rope_begin(x) == Rope_end(x));
+		/* 1文字ずつ挿入する */
+		for (i = 0; i < SIZE / 4; i++) {
+			idx = xorshift() % (ref_len + 1);
+			assert(Rope_insert_len(x, idx, &src[i], 1));
+			ref_insert(idx, &src[i], 1);
+		}
+		check(x);
+		assert(Rope_chunk_count(x) <= ref_len / (CHUNK / 4) + 2);
+	}
+	Rope_delete(x);
+
+	POOL_DUMP_OVERFLOW(&pool);
+}
+
+void RopeTest_test_1_3(void)
+{
+	Rope *x;
+	Rope *y;
+	Rope *z;
+	RopeIterator pos;
+	size_t i;
+	size_t idx;
+	printf("***** test_1_3 *****\n");
+	for (i = 0; i < SIZE; i++) {
+		src[i] = (char) ('a' + i % 26);
+	}
+	x = Rope_new_assign_len(src, CHUNK * 5 + 7);
+	ref_len = 0;
+	ref_insert(0, src, CHUNK * 5 + 7);
+	check(x);
+	/* チャンクを前後に辿る */
+	idx = 0;
+	for (pos = Rope_begin(x); pos != Rope_end(x); pos = Rope_next(pos)) {
+		assert(memcmp(Rope_chunk_data(pos), &ref[idx], Rope_chunk_size(pos)) == 0);
+		idx += Rope_chunk_size(pos);
+	}
+	assert(idx == ref_len);
+	for (pos = Rope_rbegin(x); pos != Rope_rend(x); pos = Rope_prev(pos)) {
+		idx -= Rope_chunk_size(pos);
+		assert(memcmp(Rope_chunk_data(pos), &ref[idx], Rope_chunk_size(pos)) == 0);
+	}
+	assert(idx == 0);
+	/* substr */
+	for (idx = 0; idx <= ref_len; idx += 97) {
+		y = Rope_substr(x, idx, CHUNK * 2 + 3);
+		assert(y);
+		assert(Rope_verify(y));
+		assert(Rope_size(y) == (ref_len - idx < CHUNK * 2 + 3 ? ref_len - idx : CHUNK * 2 + 3));
+		assert(Rope_copy(y, 0, Rope_size(y), out) == Rope_size(y));
+		assert(memcmp(out, &ref[idx], Rope_size(y)) == 0);
+		Rope_delete(y);
+	}
+	y = Rope_substr(x, 0, (size_t) -1);
+	assert(Rope_size(y) == ref_len);
+	Rope_delete(y);
+	check(x);
+	/* split, concat */
+	for (idx = 0; idx <= ref_len; idx += 131) {
+		y = Rope_split(x, idx);
+		assert(y);
+		assert(Rope_verify(x));
+		assert(Rope_verify(y));
+		assert(Rope_size(x) == idx);
+		assert(Rope_size(y) == ref_len - idx);
+		assert(Rope_copy(y, 0, Rope_size(y), out) == Rope_size(y));
+		assert(memcmp(out, &ref[idx], Rope_size(y)) == 0);
+		Rope_concat(x, y);
+		assert(Rope_empty(y));
+		check(x);
+		Rope_delete(y);
+	}
+	/* 分割したものを逆順に連結する */
+	y = Rope_split(x, 100);
+	z = Rope_new();
+	Rope_concat(z, y);
+	Rope_concat(z, x);
+	assert(Rope_verify(z));
+	assert(Rope_copy(z, 0, ref_len, out) == ref_len);
+	assert(memcmp(out, &ref[100], ref_len - 100) == 0);
+	assert(memcmp(&out[ref_len - 100], ref, 100) == 0);
+	/* swap */
+	Rope_swap(x, z);
+	assert(Rope_size(x) == ref_len);
+	assert(Rope_empty(z));
+	Rope_delete(x);
+	Rope_delete(y);
+	Rope_delete(z);
+
+	POOL_DUMP_OVERFLOW(&pool);
+}
+
+void RopeTest_test_2_1(void)
+{
+	Rope *x;
+	String *s;
+	ARope *a;
+	ARope *b;
+	size_t i;
+	printf("***** test_2_1 *****\n");
+	for (i = 0; i < SIZE; i++) {
+		src[i] = (char) ('a' + i % 26);
+	}
+	/* stringとの変換 */
+	s = String_new_assign_len(src, CHUNK * 3 + 1);
+	x = Rope_new_string(s);
+	assert(x);
+	assert(Rope_verify(x));
+	assert(Rope_size(x) == String_size(s));
+	assert(Rope_insert_len(x, 10, "rope", 4));
+	assert(Rope_to_string(x, s) == s);
+	assert(String_size(s) == CHUNK * 3 + 5);
+	assert(memcmp(String_c_str(s), src, 10) == 0);
+	assert(memcmp(String_c_str(s) + 10, "rope", 4) == 0);
+	assert(memcmp(String_c_str(s) + 14, src + 10, CHUNK * 3 - 9) == 0);
+	assert(String_c_str(s)[String_size(s)] == '\0');
+	Rope_clear(x);
+	assert(Rope_to_string(x, s) == s);
+	assert(String_empty(s));
+	Rope_delete(x);
+	String_delete(s);
+	/* すべての確保と解放がアロケータを通る */
+	a = ARope_new_assign_len(src, CHUNK * 4);
+	assert(count.live == 5);
+	b = ARope_split(a, CHUNK * 2 + 1);
+	assert(count.live == 7);
+	ARope_erase(a, 0, CHUNK);
+	ARope_concat(a, b);
+	ARope_delete(b);
+	ARope_delete(a);
+	assert(count.live == 0);
+#ifdef MY_MALLOC
+	/* メモリ不足の場合は失敗し、中身は変わらない */
+	x = Rope_new_assign_len(src, CHUNK * 2);
+	ref_len = 0;
+	ref_insert(0, src, CHUNK * 2);
+	POOL_SET_FAIL_COUNT(&pool, 0);
+	assert(!Rope_insert_len(x, 5, src, CHUNK * 2));
+	assert(!Rope_insert_len(x, 5, src, CHUNK));
+	assert(!Rope_split(x, 5));
+	assert(!Rope_substr(x, 5, 10));
+	assert(!Rope_new());
+	check(x);
+	/* チャンクの中で済む挿入と削除はメモリを確保しない */
+	assert(Rope_erase(x, 5, CHUNK + 10));
+	ref_erase(5, CHUNK + 10);
+	assert(Rope_insert_len(x, 5, "abc", 3));
+	ref_insert(5, "abc", 3);
+	check(x);
+	POOL_SET_FAIL_COUNT(&pool, 1);
+	assert(!Rope_insert_len(x, 5, src, CHUNK * 2));
+	assert(!Rope_split(x, 5));
+	POOL_RESET_FAIL_COUNT(&pool);
+	check(x);
+	Rope_delete(x);
+#endif
+
+	POOL_DUMP_OVERFLOW(&pool);
+}
+
+
+
+void RopeTest_run(void)
+{
+	printf("\n===== rope test =====\n");
+	RopeTest_test_1_1();
+	RopeTest_test_1_2();
+	RopeTest_test_1_3();
+	RopeTest_test_2_1();
+}
+
+
+int main(void)
+{
+#ifdef MY_MALLOC
+	Pool_init(&pool, buf, sizeof buf, sizeof buf[0]);
+#endif
+	RopeTest_run();
+#ifdef MY_MALLOC
+	POOL_DUMP_LEAK(&pool, 0);
+#endif
+	return 0;
+}
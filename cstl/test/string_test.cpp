@@ -21,7 +21,16 @@ CSTL_STRING_INTERFACE(String, char)
 CSTL_STRING_IMPLEMENT(String, char)
 #endif
 
+#include "count_allocator.h"
+static CountAllocator count;
+static CstlAllocator const count_allocator = COUNT_ALLOCATOR_INIT(count);
+
+CSTL_STRING_INTERFACE(AString, char)
+CSTL_STRING_IMPLEMENT_ALLOCATOR(AString, char, &count_allocator)
+
 #define SIZE	16
+/* 内部に格納できる文字数 */
+#define SSO		(CSTL_STRING_SSO_SIZE(char) - 1)
 
 using namespace std;
 
@@ -36,7 +45,7 @@ void StringTest_test_1_1(void)
 	x = String_new_reserve(SIZE);
 	assert(String_empty(x));
 	assert(String_size(x) == 0);
-	assert(String_capacity(x) == SIZE);
+	assert(String_capacity(x) == SSO);
 	/* c_str */
 	String_assign_len(x, "abcdefghijklmn", 7);
 //    printf("%s\n", String_c_str(x));
@@ -63,19 +72,19 @@ void StringTest_test_1_1(void)
 	const char *str = "abcdefghijklmn";
 	x = String_new_assign(str);
 	assert(String_size(x) == strlen(str));
-	assert(String_capacity(x) == strlen(str));
+	assert(String_capacity(x) == SSO);
 	assert(strcmp(String_c_str(x), str) == 0);
 	String_delete(x);
 	/* new_assign_len */
 	x = String_new_assign_len(str, 7);
 	assert(String_size(x) == 7);
-	assert(String_capacity(x) == 7);
+	assert(String_capacity(x) == SSO);
 	assert(strcmp(String_c_str(x), "abcdefg") == 0);
 	String_delete(x);
 	/* new_assign_c */
 	x = String_new_assign_c(10, 'a');
 	assert(String_size(x) == 10);
-	assert(String_capacity(x) == 10);
+	assert(String_capacity(x) == SSO);
 	assert(strcmp(String_c_str(x), "aaaaaaaaaa") == 0);
 	String_delete(x);
 }
@@ -96,12 +105,15 @@ void StringTest_test_1_2(void)
 	String_reserve(x, 101);
 	assert(String_capacity(x) == 101);
 	/* shrink */
-	String_shrink(x, 10);
-	assert(String_capacity(x) == 10);
-	String_shrink(x, 11);
-	assert(String_capacity(x) == 10);
+	String_shrink(x, SSO + 10);
+	assert(String_capacity(x) == SSO + 10);
+	String_shrink(x, SSO + 11);
+	assert(String_capacity(x) == SSO + 10);
+	String_shrink(x, SSO + 9);
+	assert(String_capacity(x) == SSO + 9);
+	/* 内部に収まる場合は内部に戻る */
 	String_shrink(x, 9);
-	assert(String_capacity(x) == 9);
+	assert(String_capacity(x) == SSO);
 	/* resize */
 	String_resize(x, 10, 'a');
 	assert(String_size(x) == 10);
@@ -678,6 +690,167 @@ void StringTest_test_1_5(void)
 }
 
 
+void StringTest_test_2_1(void)
+{
+	AString *x;
+	size_t n;
+	printf("***** test_2_1 *****\n");
+	/* すべての確保と解放がアロケータを通る */
+	x = AString_new();
+	assert(count.live == 1);
+	assert(AString_assign(x, "abcdefghijklmnopqrstuvwxyz"));
+	assert(count.live == 2);
+	/* 自分自身の部分文字列の挿入・置換は一時領域を使う */
+	count.calls = 0;
+	while (AString_size(x) < 1000) {
+		assert(AString_insert_len(x, 1, AString_c_str(x) + 2, 20));
+	}
+	assert(count.calls > 0);
+	n = AString_size(x);
+	assert(AString_replace_len(x, 0, 1, AString_c_str(x), n));
+	assert(count.live == 2);
+	assert(AString_size(x) == n * 2 - 1);
+	assert(memcmp(AString_c_str(x) + 1, AString_c_str(x) + n, n - 1) == 0);
+	AString_clear(x);
+	AString_shrink(x, 0);
+	AString_delete(x);
+	assert(count.live == 0);
+
+	POOL_DUMP_OVERFLOW(&pool);
+}
+
+void StringTest_test_2_2(void)
+{
+	AString *x;
+	AString *y;
+	const char *p;
+	char buf[SSO + 2];
+	printf("***** test_2_2 *****\n");
+	/* SSO文字までは内部に格納し、文字列用の確保をしない */
+	memset(buf, 'a', SSO);
+	buf[SSO] = '\0';
+	x = AString_new_assign(buf);
+	assert(count.live == 1);
+	assert(AString_size(x) == SSO);
+	assert(AString_capacity(x) == SSO);
+	assert(strcmp(AString_c_str(x), buf) == 0);
+	assert(AString_data(x) == AString_c_str(x));
+	/* 1文字増えるとヒープに移る */
+	assert(AString_push_back(x, 'b'));
+	assert(count.live == 2);
+	assert(AString_size(x) == SSO + 1);
+	assert(AString_c_str(x)[SSO] == 'b' && AString_c_str(x)[SSO + 1] == '\0');
+	assert(AString_erase(x, SSO, 1));
+	assert(strcmp(AString_c_str(x), buf) == 0);
+	/* shrinkで内部に戻る */
+	AString_shrink(x, 0);
+	assert(count.live == 1);
+	assert(strcmp(AString_c_str(x), buf) == 0);
+	/* 内部に格納した文字列の部分文字列での置換・追加 */
+	assert(AString_assign(x, "hello"));
+	assert(AString_replace_len(x, 0, 1, AString_c_str(x) + 1, 3));
+	assert(strcmp(AString_c_str(x), "ellello") == 0);
+	assert(AString_append_len(x, AString_c_str(x), 7));
+	assert(strcmp(AString_c_str(x), "ellelloellello") == 0);
+	assert(count.live == 1);
+	assert(AString_append(x, AString_c_str(x)));
+	assert(strcmp(AString_c_str(x), "ellelloellelloellelloellello") == 0);
+	assert(count.live == 2);
+	/* 内部の文字列とヒープの文字列のswap */
+	y = AString_new_assign("short");
+	assert(count.live == 3);
+	p = AString_c_str(x);
+	AString_swap(x, y);
+	assert(strcmp(AString_c_str(x), "short") == 0);
+	assert(strcmp(AString_c_str(y), "ellelloellelloellelloellello") == 0);
+	assert(AString_c_str(y) == p);
+	assert(AString_compare(x, y) > 0);
+	assert(AString_assign(y, "short"));
+	assert(AString_compare(x, y) == 0);
+	AString_shrink(y, 0);
+	AString_swap(x, y);
+	assert(count.live == 2);
+	assert(strcmp(AString_c_str(x), "short") == 0);
+	assert(strcmp(AString_c_str(y), "short") == 0);
+	AString_delete(x);
+	AString_delete(y);
+	assert(count.live == 0);
+#ifdef MY_MALLOC
+	/* 内部に収まる文字列はヒープが足りなくても扱える */
+	x = AString_new();
+	POOL_SET_FAIL_COUNT(&pool, 0);
+	assert(AString_assign(x, "abc"));
+	assert(AString_append_c(x, SSO - 3, 'd'));
+	assert(!AString_push_back(x, 'e'));
+	POOL_RESET_FAIL_COUNT(&pool);
+	assert(AString_size(x) == SSO);
+	AString_delete(x);
+#endif
+
+	POOL_DUMP_OVERFLOW(&pool);
+}
+
+void StringTest_test_3_1(void)
+{
+	String *x;
+	String *y;
+	string s;
+	char text[300];
+	char pat[48];
+	size_t i, idx, len, n;
+	unsigned int r = 2463534242u;
+	const char alpha[] = "abcab\x80\xff ";
+	printf("***** test_3_1 *****\n");
+	/* SIMDの境界をまたぐ長さの文字列で、std::stringと結果を比べる */
+	for (i = 0; i < sizeof text; i++) {
+		r ^= r << 13;
+		r ^= r >> 17;
+		r ^= r << 5;
+		text[i] = alpha[r % (sizeof alpha - 1)];
+	}
+	for (i = 0; i < sizeof pat; i++) {
+		r ^= r << 13;
+		r ^= r >> 17;
+		r ^= r << 5;
+		pat[i] = alpha[r % (sizeof alpha - 1)];
+	}
+	for (n = 31; n <= sizeof text; n += 67) {
+		x = String_new_assign_len(text, n);
+		s.assign(text, n);
+		for (idx = 0; idx < n; idx += 5) {
+			for (len = 1; len <= 40 && len <= n; len++) {
+				/* 文字列中に現れるパターンと現れないかもしれないパターン */
+				find_test(x, s, idx, (idx * 7 + len) % (n - len + 1), len, text);
+				find_test(x, s, idx, 0, len, pat);
+			}
+			find_test(x, s, idx, 0, 0, pat);
+		}
+		find_test(x, s, CSTL_NPOS, 3, 10, text);
+		String_delete(x);
+	}
+	/* compare */
+	memset(text, 'a', sizeof text);
+	x = String_new_assign_len(text, sizeof text);
+	y = String_new_assign_len(text, sizeof text);
+	assert(String_compare(x, y) == 0);
+	for (i = 0; i < sizeof text; i++) {
+		String_at(y, i)[0] = 'b';
+		assert(String_compare(x, y) < 0);
+		assert(String_compare(y, x) > 0);
+		String_at(y, i)[0] = 'a';
+		assert(String_compare(x, y) == 0);
+	}
+	for (i = 0; i < sizeof text; i++) {
+		String_resize(y, i, 'a');
+		assert(String_compare(x, y) > 0);
+		assert(String_compare(y, x) < 0);
+	}
+	String_delete(x);
+	String_delete(y);
+
+	POOL_DUMP_OVERFLOW(&pool);
+}
+
 void StringTest_run(void)
 {
 	printf("\n===== string test =====\n");
@@ -686,6 +859,9 @@ void StringTest_run(void)
 	StringTest_test_1_3();
 	StringTest_test_1_4();
 	StringTest_test_1_5();
+	StringTest_test_2_1();
+	StringTest_test_2_2();
+	StringTest_test_3_1();
 }
 
 
@@ -0,0 +1,279 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "../cstl/unordered_flat_map.h"
+#include "Pool.h"
+#ifdef MY_MALLOC
+double buf[1024*1024/sizeof(double)];
+Pool pool;
+#define malloc(s)		Pool_malloc(&pool, s)
+#define realloc(p, s)	Pool_realloc(&pool, p, s)
+#define free(p)			Pool_free(&pool, p)
+#endif
+
+
+/* unordered_flat_map */
+CSTL_UNORDERED_FLAT_MAP_INTERFACE(IntIntFMap, int, int)
+CSTL_UNORDERED_FLAT_MAP_IMPLEMENT(IntIntFMap, int, int, IntIntFMap_hash_int, CSTL_EQUAL_TO)
+
+CSTL_UNORDERED_FLAT_MAP_INTERFACE(StrIntFMap, const char*, int)
+CSTL_UNORDERED_FLAT_MAP_IMPLEMENT(StrIntFMap, const char*, int, StrIntFMap_hash_string, strcmp)
+
+static IntIntFMap *ia;
+static StrIntFMap *sa;
+
+
+
+#define SIZE	4096
+#define CHURN	20000
+static char str[SIZE][16];
+static int present[SIZE];
+
+/* 全要素を走査して要素数とキーの総和を確認する */
+static void check_contents(IntIntFMap *x, size_t size, long sum)
+{
+	IntIntFMapIterator p;
+	size_t count = 0;
+	long s = 0;
+	size_t i;
+	for (p = IntIntFMap_begin(x); p != IntIntFMap_end(x); p = IntIntFMap_next(p)) {
+		count++;
+		s += *IntIntFMap_key(p);
+		assert(*IntIntFMap_value(p) == *IntIntFMap_key(p) * 2);
+	}
+	assert(count == size);
+	assert(s == sum);
+	assert(IntIntFMap_size(x) == size);
+	count = 0;
+	for (i = 0; i < IntIntFMap_bucket_count(x); i++) {
+		count += IntIntFMap_bucket_size(x, i);
+	}
+	assert(count == size);
+}
+
+void FMapTest_test_1_1(void)
+{
+	int i;
+	int success;
+	long sum = 0;
+	size_t bc;
+	IntIntFMapIterator p, q;
+	printf("***** test_1_1 *****\n");
+	ia = IntIntFMap_new();
+	assert(IntIntFMap_empty(ia));
+	assert(IntIntFMap_begin(ia) == IntIntFMap_end(ia));
+	bc = IntIntFMap_bucket_count(ia);
+	assert(bc >= 16 && (bc & (bc - 1)) == 0);
+	/* insert */
+	for (i = 0; i < SIZE; i++) {
+		p = IntIntFMap_insert(ia, i, i * 2, &success);
+		assert(success);
+		assert(p != IntIntFMap_end(ia));
+		assert(*IntIntFMap_key(p) == i);
+		sum += i;
+	}
+	check_contents(ia, SIZE, sum);
+	assert(IntIntFMap_load_factor(ia) <= IntIntFMap_get_max_load_factor(ia));
+	/* 重複は挿入されない */
+	p = IntIntFMap_insert(ia, 10, 0, &success);
+	assert(!success);
+	assert(*IntIntFMap_value(p) == 20);
+	/* find, count, at */
+	for (i = 0; i < SIZE; i++) {
+		p = IntIntFMap_find(ia, i);
+		assert(p != IntIntFMap_end(ia));
+		assert(*IntIntFMap_value(p) == i * 2);
+		assert(IntIntFMap_count(ia, i) == 1);
+		assert(*IntIntFMap_at(ia, i) == i * 2);
+		assert(IntIntFMap_find(ia, i + SIZE) == IntIntFMap_end(ia));
+	}
+	/* atは値0の要素を挿入する */
+	assert(*IntIntFMap_at(ia, -1) == 0);
+	assert(IntIntFMap_size(ia) == SIZE + 1);
+	*IntIntFMap_at(ia, -1) = -2;
+	sum += -1;
+	check_contents(ia, SIZE + 1, sum);
+	/* equal_range */
+	IntIntFMap_equal_range(ia, 5, &p, &q);
+	assert(p != q && *IntIntFMap_key(p) == 5);
+	IntIntFMap_equal_range(ia, SIZE, &p, &q);
+	assert(p == q && p == IntIntFMap_end(ia));
+	/* bucketは要素の入っているスロット */
+	p = IntIntFMap_bucket_begin(ia, IntIntFMap_bucket(ia, 7));
+	assert(*IntIntFMap_key(p) == 7);
+	assert(IntIntFMap_bucket_next(p) == IntIntFMap_bucket_end(ia, IntIntFMap_bucket(ia, 7)));
+	/* erase_key */
+	for (i = 0; i < SIZE; i += 2) {
+		assert(IntIntFMap_erase_key(ia, i) == 1);
+		assert(IntIntFMap_erase_key(ia, i) == 0);
+		sum -= i;
+	}
+	check_contents(ia, SIZE / 2 + 1, sum);
+	for (i = 0; i < SIZE; i++) {
+		assert(IntIntFMap_count(ia, i) == (size_t) (i & 1));
+	}
+	/* erase */
+	for (p = IntIntFMap_begin(ia); p != IntIntFMap_end(ia);) {
+		p = IntIntFMap_erase(ia, p);
+	}
+	assert(IntIntFMap_empty(ia));
+	assert(IntIntFMap_begin(ia) == IntIntFMap_end(ia));
+	/* clear */
+	for (i = 0; i < SIZE; i++) {
+		assert(IntIntFMap_insert(ia, i, i * 2, NULL) != IntIntFMap_end(ia));
+	}
+	IntIntFMap_clear(ia);
+	assert(IntIntFMap_empty(ia));
+	assert(IntIntFMap_find(ia, 1) == IntIntFMap_end(ia));
+	IntIntFMap_clear(ia);
+	assert(IntIntFMap_empty(ia));
+
+	POOL_DUMP_OVERFLOW(&pool);
+	IntIntFMap_delete(ia);
+}
+
+void FMapTest_test_1_2(void)
+{
+	int i;
+	size_t n = 0;
+	size_t bc;
+	long sum = 0;
+	IntIntFMap *x;
+	printf("***** test_1_2 *****\n");
+	/* 挿入と削除を繰り返しても、墓標で作り直しが際限なく起きないこと */
+	ia = IntIntFMap_new_rehash(SIZE);
+	memset(present, 0, sizeof present);
+	srand(1);
+	for (i = 0; i < CHURN; i++) {
+		int k = rand() % (SIZE / 2);
+		if (present[k]) {
+			assert(IntIntFMap_erase_key(ia, k) == 1);
+			present[k] = 0;
+			n--;
+			sum -= k;
+		} else {
+			assert(IntIntFMap_insert(ia, k, k * 2, NULL) != IntIntFMap_end(ia));
+			present[k] = 1;
+			n++;
+			sum += k;
+		}
+		assert(IntIntFMap_size(ia) == n);
+	}
+	for (i = 0; i < SIZE; i++) {
+		assert(IntIntFMap_count(ia, i) == (size_t) present[i]);
+	}
+	check_contents(ia, n, sum);
+	bc = IntIntFMap_bucket_count(ia);
+	assert(bc <= SIZE * 2);
+	/* rehash */
+	assert(IntIntFMap_rehash(ia, bc * 4));
+	assert(IntIntFMap_bucket_count(ia) == bc * 4);
+	check_contents(ia, n, sum);
+	/* swap */
+	x = IntIntFMap_new();
+	IntIntFMap_swap(ia, x);
+	assert(IntIntFMap_empty(ia));
+	check_contents(x, n, sum);
+	/* insert_range */
+	assert(IntIntFMap_insert_range(ia, IntIntFMap_begin(x), IntIntFMap_end(x)));
+	check_contents(ia, n, sum);
+	assert(IntIntFMap_insert_range(ia, IntIntFMap_begin(ia), IntIntFMap_end(ia)));
+	check_contents(ia, n, sum);
+	/* erase_range */
+	assert(IntIntFMap_erase_range(x, IntIntFMap_begin(x), IntIntFMap_end(x)) == IntIntFMap_end(x));
+	assert(IntIntFMap_empty(x));
+	/* max_load_factor */
+	IntIntFMap_set_max_load_factor(x, 2.0f);
+	assert(IntIntFMap_get_max_load_factor(x) <= 1.0f);
+	IntIntFMap_set_max_load_factor(x, 0.5f);
+	assert(IntIntFMap_get_max_load_factor(x) == 0.5f);
+	for (i = 0; i < SIZE; i++) {
+		assert(IntIntFMap_insert(x, i * 1024, i * 2048, NULL) != IntIntFMap_end(x));
+	}
+	assert(IntIntFMap_load_factor(x) <= 0.5f);
+	for (i = 0; i < SIZE; i++) {
+		assert(*IntIntFMap_at(x, i * 1024) == i * 2048);
+	}
+	IntIntFMap_delete(x);
+#ifdef MY_MALLOC
+	/* メモリ不足の場合は失敗し、中身は変わらない */
+	x = IntIntFMap_new();
+	for (i = 0; IntIntFMap_size(x) < IntIntFMap_bucket_count(x) / 2; i++) {
+		assert(IntIntFMap_insert(x, i, i * 2, NULL) != IntIntFMap_end(x));
+	}
+	n = IntIntFMap_size(x);
+	POOL_SET_FAIL_COUNT(&pool, 0);
+	while (IntIntFMap_insert(x, i, i * 2, NULL)) {
+		i++;
+	}
+	assert(IntIntFMap_at(x, i) == 0);
+	POOL_RESET_FAIL_COUNT(&pool);
+	assert(IntIntFMap_size(x) == (size_t) i);
+	assert(IntIntFMap_size(x) > n);
+	for (n = 0; n < (size_t) i; n++) {
+		assert(*IntIntFMap_at(x, (int) n) == (int) n * 2);
+	}
+	POOL_SET_FAIL_COUNT(&pool, 1);
+	assert(IntIntFMap_rehash(x, IntIntFMap_bucket_count(x) * 2) == 0);
+	POOL_RESET_FAIL_COUNT(&pool);
+	assert(IntIntFMap_size(x) == (size_t) i);
+	IntIntFMap_delete(x);
+#endif
+
+	POOL_DUMP_OVERFLOW(&pool);
+	IntIntFMap_delete(ia);
+}
+
+void FMapTest_test_2_1(void)
+{
+	int i;
+	StrIntFMapIterator p;
+	printf("***** test_2_1 *****\n");
+	sa = StrIntFMap_new_pow2(0);
+	for (i = 0; i < SIZE; i++) {
+		sprintf(str[i], "identifier_%d", i);
+		assert(StrIntFMap_insert(sa, str[i], i, NULL) != StrIntFMap_end(sa));
+	}
+	assert(StrIntFMap_size(sa) == SIZE);
+	for (i = 0; i < SIZE; i++) {
+		char key[16];
+		sprintf(key, "identifier_%d", i);
+		p = StrIntFMap_find(sa, key);
+		assert(p != StrIntFMap_end(sa));
+		assert(*StrIntFMap_value(p) == i);
+		assert(*StrIntFMap_key(p) == str[i]);
+	}
+	assert(StrIntFMap_find(sa, "identifier_") == StrIntFMap_end(sa));
+	assert(StrIntFMap_erase_key(sa, "identifier_0") == 1);
+	assert(StrIntFMap_count(sa, "identifier_0") == 0);
+	assert(StrIntFMap_size(sa) == SIZE - 1);
+
+	POOL_DUMP_OVERFLOW(&pool);
+	StrIntFMap_delete(sa);
+}
+
+
+
+void FMapTest_run(void)
+{
+	printf("\n===== unordered_flat_map test =====\n");
+
+	FMapTest_test_1_1();
+	FMapTest_test_1_2();
+	FMapTest_test_2_1();
+}
+
+
+int main(void)
+{
+#ifdef MY_MALLOC
+	Pool_init(&pool, buf, sizeof buf, sizeof buf[0]);
+#endif
+	FMapTest_run();
+#ifdef MY_MALLOC
+	POOL_DUMP_LEAK(&pool, 0);
+#endif
+	return 0;
+}
+
@@ -0,0 +1,118 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "../cstl/unordered_flat_set.h"
+#include "Pool.h"
+#ifdef MY_MALLOC
+double buf[1024*1024/sizeof(double)];
+Pool pool;
+#define malloc(s)		Pool_malloc(&pool, s)
+#define realloc(p, s)	Pool_realloc(&pool, p, s)
+#define free(p)			Pool_free(&pool, p)
+#endif
+
+
+/* unordered_flat_set */
+CSTL_UNORDERED_FLAT_SET_INTERFACE(UIntFSet, unsigned int)
+CSTL_UNORDERED_FLAT_SET_IMPLEMENT(UIntFSet, unsigned int, UIntFSet_hash_mix, CSTL_EQUAL_TO)
+
+CSTL_UNORDERED_FLAT_SET_INTERFACE(StrFSet, const char*)
+CSTL_UNORDERED_FLAT_SET_IMPLEMENT(StrFSet, const char*, StrFSet_hash_string, strcmp)
+
+static UIntFSet *ua;
+static StrFSet *sa;
+
+
+
+#define SIZE	4096
+static char str[SIZE][16];
+
+void FSetTest_test_1_1(void)
+{
+	unsigned int i;
+	int success;
+	size_t count;
+	UIntFSet *x;
+	UIntFSetIterator p;
+	printf("***** test_1_1 *****\n");
+	ua = UIntFSet_new();
+	/* 下位ビットが全て0のキー */
+	for (i = 0; i < SIZE; i++) {
+		p = UIntFSet_insert(ua, i << 16, &success);
+		assert(success);
+		assert(*UIntFSet_data(p) == i << 16);
+	}
+	assert(UIntFSet_size(ua) == SIZE);
+	p = UIntFSet_insert(ua, 0, &success);
+	assert(!success && *UIntFSet_data(p) == 0);
+	for (i = 0; i < SIZE; i++) {
+		assert(UIntFSet_count(ua, i << 16) == 1);
+		assert(UIntFSet_count(ua, (i << 16) + 1) == 0);
+	}
+	count = 0;
+	for (p = UIntFSet_begin(ua); p != UIntFSet_end(ua); p = UIntFSet_next(p)) {
+		assert((*UIntFSet_data(p) & 0xffff) == 0);
+		count++;
+	}
+	assert(count == SIZE);
+	/* insert_range, erase_key */
+	x = UIntFSet_new();
+	assert(UIntFSet_insert_range(x, UIntFSet_begin(ua), UIntFSet_end(ua)));
+	assert(UIntFSet_size(x) == SIZE);
+	for (i = 0; i < SIZE; i++) {
+		assert(UIntFSet_erase_key(x, i << 16) == 1);
+	}
+	assert(UIntFSet_empty(x));
+	assert(UIntFSet_begin(x) == UIntFSet_end(x));
+	UIntFSet_delete(x);
+
+	POOL_DUMP_OVERFLOW(&pool);
+	UIntFSet_delete(ua);
+}
+
+void FSetTest_test_2_1(void)
+{
+	int i;
+	printf("***** test_2_1 *****\n");
+	sa = StrFSet_new();
+	for (i = 0; i < SIZE; i++) {
+		sprintf(str[i], "%d", i);
+		assert(StrFSet_insert(sa, str[i], NULL) != StrFSet_end(sa));
+	}
+	assert(StrFSet_size(sa) == SIZE);
+	assert(StrFSet_count(sa, "100") == 1);
+	assert(StrFSet_count(sa, "-1") == 0);
+	assert(StrFSet_erase_key(sa, "100") == 1);
+	assert(StrFSet_find(sa, "100") == StrFSet_end(sa));
+	assert(StrFSet_size(sa) == SIZE - 1);
+	StrFSet_clear(sa);
+	assert(StrFSet_size(sa) == 0);
+
+	POOL_DUMP_OVERFLOW(&pool);
+	StrFSet_delete(sa);
+}
+
+
+
+void FSetTest_run(void)
+{
+	printf("\n===== unordered_flat_set test =====\n");
+
+	FSetTest_test_1_1();
+	FSetTest_test_2_1();
+}
+
+
+int main(void)
+{
+#ifdef MY_MALLOC
+	Pool_init(&pool, buf, sizeof buf, sizeof buf[0]);
+#endif
+	FSetTest_run();
+#ifdef MY_MALLOC
+	POOL_DUMP_LEAK(&pool, 0);
+#endif
+	return 0;
+}
+
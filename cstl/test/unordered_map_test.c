@@ -38,6 +38,26 @@ CSTL_UNORDERED_MAP_DEBUG_IMPLEMENT(IntIntUMap, int, int, IntIntUMap_hash_int, CS
 CSTL_UNORDERED_MULTIMAP_IMPLEMENT(IntIntUMMap, int, int, IntIntUMap_hash_int, CSTL_EQUAL_TO)
 CSTL_UNORDERED_MAP_DEBUG_IMPLEMENT(IntIntUMMap, int, int, IntIntUMap_hash_int, CSTL_EQUAL_TO, %d, %d)
 #endif
+
+/* cstlgen.shはノードプールの実装を生成しないので、生成したソースを使う場合もマクロで展開する */
+CSTL_UNORDERED_MAP_INTERFACE(IntIntUMapP, int, int)
+CSTL_UNORDERED_MAP_DEBUG_INTERFACE(IntIntUMapP)
+
+CSTL_UNORDERED_MAP_IMPLEMENT_POOL(IntIntUMapP, int, int, IntIntUMapP_hash_int, CSTL_EQUAL_TO)
+CSTL_UNORDERED_MAP_DEBUG_IMPLEMENT(IntIntUMapP, int, int, IntIntUMapP_hash_int, CSTL_EQUAL_TO, %d, %d)
+
+#include "count_allocator.h"
+static CountAllocator count;
+#ifdef CSTLGEN
+/* allocator=count_allocatorで生成したソースはextern宣言で参照する */
+#include "IntIntUMapA.h"
+CstlAllocator count_allocator = COUNT_ALLOCATOR_INIT(count);
+#else
+static CstlAllocator const count_allocator = COUNT_ALLOCATOR_INIT(count);
+
+CSTL_UNORDERED_MAP_INTERFACE(IntIntUMapA, int, int)
+CSTL_UNORDERED_MAP_IMPLEMENT_ALLOCATOR(IntIntUMapA, int, int, IntIntUMapA_hash_int, CSTL_EQUAL_TO, &count_allocator)
+#endif
 static IntIntUMap *ia;
 static IntIntUMMap *ima;
 
@@ -338,7 +358,247 @@ void UMapTest_test_1_2(void)
 }
 
 
+void UMapTest_test_1_3(void)
+{
+	int i;
+	size_t bc;
+	IntIntUMap *x;
+	IntIntUMapIterator p;
+	printf("***** test_1_3 *****\n");
+	/* 2のべき乗バケット */
+	ia = IntIntUMap_new_pow2(SIZE);
+	bc = IntIntUMap_bucket_count(ia);
+	assert(bc >= SIZE && (bc & (bc - 1)) == 0);
+	/* 等間隔のキー */
+	for (i = 0; i < SIZE * 8; i++) {
+		assert(IntIntUMap_insert(ia, i * 1024, i, NULL) != IntIntUMap_end(ia));
+		assert(IntIntUMap_bucket(ia, i * 1024) < IntIntUMap_bucket_count(ia));
+	}
+	assert(IntIntUMap_size(ia) == SIZE * 8);
+	bc = IntIntUMap_bucket_count(ia);
+	assert(bc >= SIZE * 8 && (bc & (bc - 1)) == 0);
+	for (i = 0; i < SIZE * 8; i++) {
+		p = IntIntUMap_find(ia, i * 1024);
+		assert(p != IntIntUMap_end(ia));
+		assert(*IntIntUMap_value(p) == i);
+		assert(IntIntUMap_find(ia, i * 1024 + 1) == IntIntUMap_end(ia));
+	}
+	/* swapでモードも入れ替わる */
+	x = IntIntUMap_new();
+	IntIntUMap_swap(ia, x);
+	assert(IntIntUMap_size(x) == SIZE * 8);
+	assert(IntIntUMap_bucket_count(x) == bc);
+	assert(IntIntUMap_rehash(x, bc * 2));
+	assert(IntIntUMap_bucket_count(x) == bc * 2);
+	for (i = 0; i < SIZE * 8; i++) {
+		assert(*IntIntUMap_at(x, i * 1024) == i);
+	}
+	for (i = 0; i < SIZE * 8; i++) {
+		assert(IntIntUMap_erase_key(x, i * 1024) == 1);
+	}
+	assert(IntIntUMap_empty(x));
+	IntIntUMap_delete(x);
+	IntIntUMap_delete(ia);
+	/* hash */
+	assert(IntIntUMap_hash_mix(1) != IntIntUMap_hash_mix(2));
+	assert(IntIntUMap_hash_mix(1024) != IntIntUMap_hash_mix(2048));
+	assert(IntIntUMap_hash_string("abc") == IntIntUMap_hash_string("abc"));
+	assert(IntIntUMap_hash_string("abc") != IntIntUMap_hash_string("abd"));
+	assert(IntIntUMap_hash_string("identifier_0") != IntIntUMap_hash_string("identifier_1"));
+	assert(IntIntUMap_hash_string("a long identifier shared by many keys 0") != IntIntUMap_hash_string("a long identifier shared by many keys 1"));
+	POOL_DUMP_OVERFLOW(&pool);
+}
+
+
+void UMapTest_test_1_4(void)
+{
+	int i;
+	size_t count;
+	long sum;
+	IntIntUMap *x;
+	IntIntUMapIterator p, q;
+	printf("***** test_1_4 *****\n");
+	/* 段階的再ハッシュ */
+	ia = IntIntUMap_new();
+	IntIntUMap_set_incremental_rehash(ia, 1);
+	for (i = 0; i < SIZE * 16; i++) {
+		assert(IntIntUMap_insert(ia, i, i, NULL) != IntIntUMap_end(ia));
+		assert(IntIntUMap_size(ia) == (size_t) i + 1);
+		/* 旧バケットと新バケットにまたがっていても全要素を1回ずつ辿る */
+		if (i % 61 == 0) {
+			count = 0;
+			sum = 0;
+			for (p = IntIntUMap_begin(ia); p != IntIntUMap_end(ia); p = IntIntUMap_next(p)) {
+				count++;
+				sum += *IntIntUMap_key(p);
+			}
+			assert(count == (size_t) i + 1);
+			assert(sum == (long) i * (i + 1) / 2);
+			assert(*IntIntUMap_value(IntIntUMap_find(ia, i / 2)) == i / 2);
+		}
+	}
+	for (i = 0; i < SIZE * 16; i++) {
+		assert(*IntIntUMap_at(ia, i) == i);
+	}
+	/* 移動中のイテレータによる削除 */
+	for (i = SIZE * 16; i < SIZE * 32; i++) {
+		assert(IntIntUMap_insert(ia, i, i, NULL) != IntIntUMap_end(ia));
+	}
+	assert(IntIntUMap_size(ia) == SIZE * 32);
+	for (p = IntIntUMap_begin(ia); p != IntIntUMap_end(ia);) {
+		if (*IntIntUMap_key(p) & 1) {
+			p = IntIntUMap_erase(ia, p);
+		} else {
+			p = IntIntUMap_next(p);
+		}
+	}
+	assert(IntIntUMap_size(ia) == SIZE * 16);
+	for (i = 0; i < SIZE * 32; i++) {
+		assert(IntIntUMap_count(ia, i) == (size_t) !(i & 1));
+	}
+	/* swap */
+	for (i = 1; i < SIZE * 64; i += 2) {
+		assert(IntIntUMap_insert(ia, i, i, NULL) != IntIntUMap_end(ia));
+	}
+	assert(IntIntUMap_size(ia) == SIZE * 16 + SIZE * 32);
+	x = IntIntUMap_new();
+	IntIntUMap_swap(ia, x);
+	assert(IntIntUMap_empty(ia));
+	count = 0;
+	for (p = IntIntUMap_begin(x); p != IntIntUMap_end(x); p = IntIntUMap_next(p)) {
+		count++;
+	}
+	assert(count == SIZE * 16 + SIZE * 32);
+	for (i = 0; i < SIZE * 32; i += 2) {
+		assert(IntIntUMap_erase_key(x, i) == 1);
+	}
+	assert(IntIntUMap_size(x) == SIZE * 32);
+	IntIntUMap_equal_range(x, 1, &p, &q);
+	assert(p != q && IntIntUMap_next(p) == q);
+	/* 0に戻すと残りを移し終える */
+	IntIntUMap_set_incremental_rehash(x, 0);
+	assert(IntIntUMap_verify(x));
+	IntIntUMap_clear(x);
+	assert(IntIntUMap_verify(x));
+	IntIntUMap_delete(x);
+	IntIntUMap_delete(ia);
+
+	/* multimapでは同じキーが並んだまま移る */
+	ima = IntIntUMMap_new();
+	IntIntUMMap_set_incremental_rehash(ima, 2);
+	for (i = 0; i < SIZE * 16; i++) {
+		assert(IntIntUMMap_insert(ima, i % (SIZE * 4), i));
+		if (i % 97 == 0) {
+			int k;
+			for (k = 0; k < SIZE * 4 && k <= i; k++) {
+				assert(IntIntUMMap_count(ima, k) == (size_t) ((i - k) / (SIZE * 4) + 1));
+			}
+		}
+	}
+	assert(IntIntUMMap_erase_key(ima, 3) == 4);
+	assert(IntIntUMMap_size(ima) == SIZE * 16 - 4);
+	IntIntUMMap_set_incremental_rehash(ima, 0);
+	assert(IntIntUMMap_verify(ima));
+	IntIntUMMap_delete(ima);
+	POOL_DUMP_OVERFLOW(&pool);
+}
+
+
+
+void UMapTest_test_1_5(void)
+{
+	int i;
+	long sum;
+	IntIntUMapP *x;
+	IntIntUMapP *y;
+	IntIntUMapPIterator p;
+	IntIntUMapPIterator freed;
+	printf("***** test_1_5 *****\n");
+	/* ノードプール */
+	x = IntIntUMapP_new();
+	y = IntIntUMapP_new();
+	for (i = 0; i < SIZE * 16; i++) {
+		assert(IntIntUMapP_insert(x, i, i, NULL) != IntIntUMapP_end(x));
+	}
+	assert(IntIntUMapP_size(x) == SIZE * 16);
+	assert(IntIntUMapP_verify(x));
+	/* 削除したノードは次の挿入で再利用される */
+	freed = IntIntUMapP_find(x, 7);
+	IntIntUMapP_erase(x, freed);
+	p = IntIntUMapP_insert(x, SIZE * 16, 0, NULL);
+	assert(p == freed);
+	assert(*IntIntUMapP_key(p) == SIZE * 16);
+	/* 挿入と削除の繰り返し */
+	for (i = 0; i < SIZE * 64; i++) {
+		assert(IntIntUMapP_erase_key(x, i) == (size_t) ((i != 7 && i <= SIZE * 16) || i >= SIZE * 32));
+		assert(IntIntUMapP_insert(x, i + SIZE * 32, i, NULL) != IntIntUMapP_end(x));
+	}
+	assert(IntIntUMapP_size(x) == SIZE * 32);
+	assert(IntIntUMapP_verify(x));
+	sum = 0;
+	for (p = IntIntUMapP_begin(x); p != IntIntUMapP_end(x); p = IntIntUMapP_next(p)) {
+		sum += *IntIntUMapP_value(p);
+	}
+	assert(sum == (long) SIZE * 32 * (SIZE * 96 - 1) / 2);
+	/* swap */
+	assert(IntIntUMapP_insert_range(y, IntIntUMapP_begin(x), IntIntUMapP_end(x)));
+	IntIntUMapP_clear(x);
+	assert(IntIntUMapP_empty(x));
+	assert(IntIntUMapP_verify(x));
+	IntIntUMapP_swap(x, y);
+	assert(IntIntUMapP_empty(y));
+	assert(IntIntUMapP_size(x) == SIZE * 32);
+	for (i = 0; i < SIZE; i++) {
+		assert(IntIntUMapP_insert(y, i, i, NULL) != IntIntUMapP_end(y));
+	}
+	IntIntUMapP_clear(x);
+	assert(IntIntUMapP_size(y) == SIZE);
+	assert(*IntIntUMapP_at(y, SIZE - 1) == SIZE - 1);
+	assert(IntIntUMapP_verify(y));
+#ifdef MY_MALLOC
+	/* メモリ不足の場合は失敗し、中身は変わらない */
+	POOL_SET_FAIL_COUNT(&pool, 0);
+	for (i = 0; IntIntUMapP_insert(x, i, i, NULL); i++) ;
+	POOL_RESET_FAIL_COUNT(&pool);
+	assert(IntIntUMapP_size(x) == (size_t) i);
+	assert(IntIntUMapP_verify(x));
+#endif
+
+	POOL_DUMP_OVERFLOW(&pool);
+	IntIntUMapP_delete(x);
+	IntIntUMapP_delete(y);
+}
+
+
 
+void UMapTest_test_1_6(void)
+{
+	int i;
+	IntIntUMapA *x;
+	printf("***** test_1_6 *****\n");
+	/* すべての確保と解放がアロケータを通る。3はself、バケットのvectorとその配列 */
+	x = IntIntUMapA_new();
+	assert(count.live == 3);
+	for (i = 0; i < SIZE; i++) {
+		assert(IntIntUMapA_insert(x, i, i, NULL));
+	}
+	assert(count.live == 3 + SIZE);
+	for (i = 0; i < SIZE; i++) {
+		assert(*IntIntUMapA_value(IntIntUMapA_find(x, i)) == i);
+	}
+	/* 段階的再ハッシュの旧バケットもアロケータで解放する */
+	IntIntUMapA_set_incremental_rehash(x, 1);
+	assert(IntIntUMapA_rehash(x, SIZE * 4));
+	for (i = 0; i < SIZE; i += 2) {
+		assert(IntIntUMapA_erase_key(x, i) == 1);
+	}
+	IntIntUMapA_clear(x);
+	assert(count.live == 3);
+	IntIntUMapA_delete(x);
+	assert(count.live == 0);
+
+	POOL_DUMP_OVERFLOW(&pool);
+}
 
 
 
@@ -349,6 +609,10 @@ void UMapTest_run(void)
 
 	UMapTest_test_1_1();
 	UMapTest_test_1_2();
+	UMapTest_test_1_3();
+	UMapTest_test_1_4();
+	UMapTest_test_1_5();
+	UMapTest_test_1_6();
 }
 
 
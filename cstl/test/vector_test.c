@@ -24,8 +24,28 @@ CSTL_VECTOR_IMPLEMENT(UCharVector, unsigned char)
 CSTL_VECTOR_IMPLEMENT(IntVector, int)
 #endif
 
+CSTL_VECTOR_INTERFACE(SmallIntVector, int)
+CSTL_VECTOR_IMPLEMENT_SMALL(SmallIntVector, int, 4)
+
+#include "count_allocator.h"
+static CountAllocator count;
+#ifdef CSTLGEN
+/* allocator=count_allocatorで生成したソースはextern宣言で参照する */
+#include "AllocIntVector.h"
+CstlAllocator count_allocator = COUNT_ALLOCATOR_INIT(count);
+#else
+static CstlAllocator const count_allocator = COUNT_ALLOCATOR_INIT(count);
+
+CSTL_VECTOR_INTERFACE(AllocIntVector, int)
+CSTL_VECTOR_IMPLEMENT_ALLOCATOR(AllocIntVector, int, &count_allocator)
+#endif
+
+CSTL_VECTOR_INTERFACE(AllocSmallIntVector, int)
+CSTL_VECTOR_IMPLEMENT_SMALL_ALLOCATOR(AllocSmallIntVector, int, 4, &count_allocator)
+
 static UCharVector *uv;
 static IntVector *iv;
+static SmallIntVector *sv;
 
 #define SIZE	15
 
@@ -660,8 +680,150 @@ void VectorTest_test_2_5(void)
 	IntVector_delete(iv);
 }
 
+void VectorTest_test_3_1(void)
+{
+	int i;
+	int *p;
+	SmallIntVector *x;
+	printf("***** test_3_1 *****\n");
+	vector_init_piyo();
+	sv = SmallIntVector_new();
+	/* 初期状態 */
+	assert(SmallIntVector_capacity(sv) == 4);
+	assert(SmallIntVector_size(sv) == 0);
+	assert(SmallIntVector_empty(sv));
+#ifdef MY_MALLOC
+	/* 4個までは確保しない */
+	POOL_SET_FAIL_COUNT(&pool, 0);
+#endif
+	for (i = 0; i < 4; i++) {
+		assert(SmallIntVector_push_back(sv, piyo[i]));
+	}
+	assert(SmallIntVector_reserve(sv, 3));
+#ifdef MY_MALLOC
+	/* メモリ不足の場合は失敗し、中身は変わらない */
+	assert(!SmallIntVector_insert(sv, 2, 100));
+	assert(SmallIntVector_size(sv) == 4);
+	assert(memcmp(SmallIntVector_at(sv, 0), piyo, sizeof(int) * 4) == 0);
+	assert(SmallIntVector_capacity(sv) == 4);
+	POOL_RESET_FAIL_COUNT(&pool);
+#endif
+	assert(SmallIntVector_insert(sv, 2, 100));
+	/* ヒープに移る */
+	assert(SmallIntVector_size(sv) == 5);
+	assert(SmallIntVector_capacity(sv) == 8);
+	assert(*SmallIntVector_at(sv, 2) == 100);
+	SmallIntVector_erase(sv, 2, 1);
+	assert(memcmp(SmallIntVector_at(sv, 0), piyo, sizeof(int) * 4) == 0);
+	assert(SmallIntVector_insert_array(sv, 4, &piyo[4], 252));
+	assert(memcmp(SmallIntVector_at(sv, 0), piyo, sizeof(int) * 256) == 0);
+	assert(SmallIntVector_size(sv) == 256);
+	/* shrink */
+	SmallIntVector_erase(sv, 10, 246);
+	SmallIntVector_shrink(sv, 0);
+	assert(SmallIntVector_capacity(sv) == 10);
+	assert(memcmp(SmallIntVector_at(sv, 0), piyo, sizeof(int) * 10) == 0);
+	SmallIntVector_erase(sv, 3, 7);
+	SmallIntVector_shrink(sv, 0);
+	assert(SmallIntVector_capacity(sv) == 4);
+	assert(SmallIntVector_size(sv) == 3);
+	assert(memcmp(SmallIntVector_at(sv, 0), piyo, sizeof(int) * 3) == 0);
+	/* resize, insert_range */
+	assert(SmallIntVector_resize(sv, 4, -1));
+	assert(SmallIntVector_capacity(sv) == 4);
+	assert(*SmallIntVector_back(sv) == -1);
+	assert(SmallIntVector_insert_range(sv, 1, sv, 0, 4));
+	assert(SmallIntVector_size(sv) == 8);
+	assert(*SmallIntVector_at(sv, 0) == 0);
+	assert(memcmp(SmallIntVector_at(sv, 1), piyo, sizeof(int) * 3) == 0);
+	assert(*SmallIntVector_at(sv, 4) == -1);
+	assert(memcmp(SmallIntVector_at(sv, 5), &piyo[1], sizeof(int) * 2) == 0);
+	assert(*SmallIntVector_back(sv) == -1);
+	SmallIntVector_clear(sv);
+	SmallIntVector_shrink(sv, 0);
+	assert(SmallIntVector_capacity(sv) == 4);
+	/* swap */
+	x = SmallIntVector_new_reserve(2);
+	assert(SmallIntVector_capacity(x) == 4);
+	assert(SmallIntVector_push_back(sv, 1));
+	assert(SmallIntVector_push_back(x, 2));
+	assert(SmallIntVector_push_back(x, 3));
+	SmallIntVector_swap(sv, x);
+	assert(SmallIntVector_size(sv) == 2 && *SmallIntVector_front(sv) == 2 && *SmallIntVector_back(sv) == 3);
+	assert(SmallIntVector_size(x) == 1 && *SmallIntVector_front(x) == 1);
+	assert(SmallIntVector_insert_array(x, 1, piyo, 100));
+	p = SmallIntVector_at(x, 0);
+	SmallIntVector_swap(sv, x);
+	assert(SmallIntVector_at(sv, 0) == p);
+	assert(SmallIntVector_size(sv) == 101 && *SmallIntVector_front(sv) == 1);
+	assert(memcmp(SmallIntVector_at(sv, 1), piyo, sizeof(int) * 100) == 0);
+	assert(SmallIntVector_size(x) == 2 && *SmallIntVector_front(x) == 2 && *SmallIntVector_back(x) == 3);
+	assert(SmallIntVector_capacity(x) == 4);
+	SmallIntVector_pop_back(x);
+	SmallIntVector_swap(x, sv);
+	assert(SmallIntVector_size(x) == 101 && SmallIntVector_at(x, 0) == p);
+	assert(SmallIntVector_size(sv) == 1 && *SmallIntVector_front(sv) == 2);
+	SmallIntVector_delete(x);
+	/* new_reserve */
+	x = SmallIntVector_new_reserve(5);
+	assert(SmallIntVector_capacity(x) == 5);
+	SmallIntVector_delete(x);
+
+	POOL_DUMP_OVERFLOW(&pool);
+	SmallIntVector_delete(sv);
+}
+
 
 
+void VectorTest_test_3_2(void)
+{
+	int i;
+	AllocIntVector *x;
+	AllocSmallIntVector *y;
+	printf("***** test_3_2 *****\n");
+	vector_init_piyo();
+	/* すべての確保と解放がアロケータを通る */
+	x = AllocIntVector_new();
+	assert(count.live == 1);
+	for (i = 0; i < 256; i++) {
+		assert(AllocIntVector_push_back(x, piyo[i]));
+	}
+	assert(count.live == 2);
+	assert(memcmp(AllocIntVector_at(x, 0), piyo, sizeof(int) * 256) == 0);
+	AllocIntVector_shrink(x, 0);
+	assert(AllocIntVector_capacity(x) == 256);
+	AllocIntVector_clear(x);
+	AllocIntVector_shrink(x, 0);
+	assert(count.live == 1);
+	AllocIntVector_delete(x);
+	assert(count.live == 0);
+	count.calls = 0;
+	y = AllocSmallIntVector_new();
+	for (i = 0; i < 4; i++) {
+		assert(AllocSmallIntVector_push_back(y, piyo[i]));
+	}
+	assert(count.calls == 1);
+	assert(AllocSmallIntVector_push_back(y, piyo[i]));
+	assert(count.calls == 2 && count.live == 2);
+	AllocSmallIntVector_delete(y);
+	assert(count.live == 0);
+#ifdef MY_MALLOC
+	/* メモリ不足 */
+	POOL_SET_FAIL_COUNT(&pool, 0);
+	assert(!AllocIntVector_new());
+	POOL_RESET_FAIL_COUNT(&pool);
+	x = AllocIntVector_new();
+	POOL_SET_FAIL_COUNT(&pool, 0);
+	assert(!AllocIntVector_push_back(x, 1));
+	POOL_RESET_FAIL_COUNT(&pool);
+	assert(count.live == 1);
+	AllocIntVector_delete(x);
+	assert(count.live == 0);
+#endif
+
+	POOL_DUMP_OVERFLOW(&pool);
+}
+
 
 void VectorTest_run(void)
 {
@@ -677,6 +839,8 @@ void VectorTest_run(void)
 	VectorTest_test_2_3();
 	VectorTest_test_2_4();
 	VectorTest_test_2_5();
+	VectorTest_test_3_1();
+	VectorTest_test_3_2();
 }
 
 
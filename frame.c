@@ -0,0 +1,40 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include "frame.h"
+
+void FrameStack_init(FrameStack *fs, size_t capacity) {
+    fs->base = (int *)malloc(sizeof(int) * capacity);
+    if (!fs->base) {
+        fprintf(stderr, "Cannot allocate memory for FrameStack.\n");
+        exit(EXIT_FAILURE);
+    }
+    fs->top = fs->base;
+    fs->end = fs->base + capacity;
+    fs->fp = fs->base;
+    fs->calls = 0;
+    fs->allocations = 1;
+}
+
+void FrameStack_destroy(FrameStack *fs) {
+    free(fs->base);
+    fs->base = fs->top = fs->end = fs->fp = NULL;
+}
+
+// Doubles the capacity. Pointers into the old block are rebased.
+void FrameStack_grow(FrameStack *fs) {
+    const size_t capacity = (fs->end - fs->base) * 2;
+    const size_t top = fs->top - fs->base;
+    const size_t fp = fs->fp - fs->base;
+    int *base = (int *)realloc(fs->base, sizeof(int) * capacity);
+    if (!base) {
+        fprintf(stderr, "Cannot allocate memory for FrameStack.\n");
+        exit(EXIT_FAILURE);
+    }
+    fs->base = base;
+    fs->top = base + top;
+    fs->end = base + capacity;
+    fs->fp = base + fp;
+    ++fs->allocations;
+}
+
+/* vim: set et ts=4 sts=4 sw=4: */
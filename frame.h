@@ -0,0 +1,47 @@
+#ifndef tinyc_frame_h
+#define tinyc_frame_h
+
+#include <stddef.h>
+
+/*
+ * Call frames of all active calls, laid out in one growable block.
+ * A frame is the run of slots starting at fp; the arguments of the next
+ * call are pushed above it and become the callee's frame on entry, so a
+ * call costs no heap allocation once the block is large enough.
+ */
+typedef struct {
+    int *base;
+    int *top;           /* first unused slot */
+    int *end;
+    int *fp;            /* first slot of the current frame */
+    unsigned long calls;
+    unsigned long allocations;
+} FrameStack;
+
+void FrameStack_init(FrameStack *fs, size_t capacity);
+void FrameStack_destroy(FrameStack *fs);
+void FrameStack_grow(FrameStack *fs);
+
+static inline void FrameStack_push(FrameStack *fs, int value) {
+    if (fs->top == fs->end) {
+        FrameStack_grow(fs);
+    }
+    *fs->top++ = value;
+}
+
+/* Makes the top argc slots the current frame; returns the caller's frame to pass to FrameStack_leave. */
+static inline size_t FrameStack_enter(FrameStack *fs, size_t argc) {
+    size_t caller = fs->fp - fs->base;
+    fs->fp = fs->top - argc;
+    ++fs->calls;
+    return caller;
+}
+
+static inline void FrameStack_leave(FrameStack *fs, size_t caller) {
+    fs->top = fs->fp;
+    fs->fp = fs->base + caller;
+}
+
+#endif
+
+/* vim: set et ts=4 sts=4 sw=4: */
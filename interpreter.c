@@ -1,59 +1,192 @@
 #include <stdbool.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <assert.h>
+#include <unistd.h>
 #include "cstl/vector.h"
-#include "stack.h"
 #include "AST.h"
+#include "frame.h"
+#include "optimizer.h"
+#include "bytecode.h"
+#include "vm.h"
+#include "closure.h"
+#include "jit.h"
+#include "cgen.h"
+#include "purity.h"
+#include "memo.h"
+#include "output.h"
+#include "lexer.h"
 
-typedef struct {
-    SymbolType type;
-    const char *name;
-    union {
-        int value;
-        struct {
-            int *data;
-            size_t size;
-        } array;
-    } un;
-} Environment;
-
-Environment *Environment_new_value(Symbol *symbol, int value);
-Environment *Environment_new_array(Symbol *symbol, size_t n);
-void Environment_delete(Environment *env);
+#define FRAME_STACK_INITIAL (1024)
+
+typedef enum {
+    ENGINE_AST,
+    ENGINE_VM,
+    ENGINE_CLOSURE,
+    ENGINE_JIT
+} Engine;
 
 static int return_value = 0;
-static Stack *Env = NULL;
+/* Parameters of the active calls, indexed by the slots assigned by the resolver. */
+static FrameStack Frames;
+/* Hotness at which a function is compiled to native code; 0 disables tiering. */
+static unsigned long JitThreshold = 0;
+static Symbol *CurrentFunction = NULL;
+/* Callee of a pending tail call; its arguments are on top of the frame stack. */
+static Symbol *TailCallee = NULL;
 
-int yydebug;
+extern int yydebug;
 int yyparse();
-int executeProgram();
-int executeFunction(const AST *body, ASTVector *args, SymbolVector *param);
-int callFunction(const AST *ast, ASTVector *args);
-int callFunction_(const Symbol *sym, ASTVector *args);
-int executeStatements(ASTVector *statements);
-bool executeStatement(AST *ast);
-int executeExpression(AST *expr);
-int executeAssign(AST *ast, AST *expr);
-int executeArrayAssign(AST *ast, AST *idx, AST *expr);
-int resolveSymbol(const Symbol *symbol, const size_t index);
-
-int main() {
+Symbol *lookupMain(void);
+int emitProgram(const char *path);
+int executeProgram(Engine engine, bool dump, bool stats);
+int invokeFunction(Symbol *sym, size_t argc);
+int callFunction(const FlatNode *call);
+int callFunction_(Symbol *sym, const FlatNode *args, size_t argc);
+static int callFromNative(Symbol *sym, const long long *args, int argc);
+static int tailCallFromNative(Symbol *sym, const long long *args, int argc);
+bool executeStatements(const FlatNode *list);
+bool executeStatement(const FlatNode *stmt);
+int executeExpression(const FlatNode *expr);
+int executeAssign(Symbol *symbol, const FlatNode *expr);
+int executeArrayAssign(Symbol *symbol, const FlatNode *idx, const FlatNode *expr);
+int executeLocalAssign(int slot, const FlatNode *expr);
+int resolveGlobal(const Symbol *symbol);
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [options] < program\n", prog);
+    fprintf(stderr, "  --engine=vm      run on the bytecode VM (default)\n");
+    fprintf(stderr, "  --engine=ast     run on the AST walker\n");
+    fprintf(stderr, "  --engine=closure run on the closure-compiled AST\n");
+    fprintf(stderr, "  --engine=jit     run on the AST walker, compiling hot functions to native code\n");
+    fprintf(stderr, "  --jit-threshold=N  calls and loop iterations before a function is compiled (default %d)\n", JIT_DEFAULT_THRESHOLD);
+    fprintf(stderr, "  --jit-perf-map   write compiled code addresses to /tmp/perf-<pid>.map\n");
+    fprintf(stderr, "  --emit-c FILE    translate the program to C and write it to FILE (- for stdout)\n");
+    fprintf(stderr, "  --memoize        cache the results of pure functions and report hits and misses\n");
+    fprintf(stderr, "  --memoize-limit=BYTES  memory for the caches (default %d)\n", MEMO_DEFAULT_LIMIT);
+    fprintf(stderr, "  --output-buffer=BYTES  size of the output buffer (default %d)\n", OUTPUT_DEFAULT_BUFFER);
+    fprintf(stderr, "  --line-buffered  write the output after every line (default when stdout is a terminal)\n");
+    fprintf(stderr, "  --dump-bytecode  print the compiled bytecode to stderr\n");
+    fprintf(stderr, "  --stats          print call and allocation counts to stderr\n");
+    fprintf(stderr, "  --no-optimize    do not fold constants before running\n");
+    fprintf(stderr, "  -v, --verbose    report what the optimizer did to stderr\n");
+}
+
+int main(int argc, char *argv[]) {
+    Engine engine = ENGINE_VM;
+    bool dump = false;
+    bool stats = false;
+    bool optimize = true;
+    bool verbose = false;
+    bool perf_map = false;
+    const char *emit_c = NULL;
+    bool memoize = false;
+    unsigned long output_buffer = OUTPUT_DEFAULT_BUFFER;
+    bool line_buffered = isatty(STDOUT_FILENO);
+    unsigned long memo_limit = MEMO_DEFAULT_LIMIT;
+    unsigned long threshold = JIT_DEFAULT_THRESHOLD;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--engine=vm") == 0) {
+            engine = ENGINE_VM;
+        } else if (strcmp(argv[i], "--engine=ast") == 0) {
+            engine = ENGINE_AST;
+        } else if (strcmp(argv[i], "--engine=closure") == 0) {
+            engine = ENGINE_CLOSURE;
+        } else if (strcmp(argv[i], "--engine=jit") == 0) {
+            engine = ENGINE_JIT;
+        } else if (strncmp(argv[i], "--jit-threshold=", 16) == 0) {
+            char *end;
+            threshold = strtoul(argv[i] + 16, &end, 10);
+            if (*end || threshold == 0) {
+                usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+        } else if (strcmp(argv[i], "--jit-perf-map") == 0) {
+            perf_map = true;
+        } else if (strcmp(argv[i], "--emit-c") == 0 && i + 1 < argc) {
+            emit_c = argv[++i];
+        } else if (strcmp(argv[i], "--memoize") == 0) {
+            memoize = true;
+        } else if (strncmp(argv[i], "--memoize-limit=", 16) == 0) {
+            char *end;
+            memo_limit = strtoul(argv[i] + 16, &end, 10);
+            if (*end) {
+                usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+        } else if (strncmp(argv[i], "--output-buffer=", 16) == 0) {
+            char *end;
+            output_buffer = strtoul(argv[i] + 16, &end, 10);
+            if (*end || output_buffer == 0) {
+                usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+        } else if (strcmp(argv[i], "--line-buffered") == 0) {
+            line_buffered = true;
+        } else if (strcmp(argv[i], "--dump-bytecode") == 0) {
+            dump = true;
+        } else if (strcmp(argv[i], "--stats") == 0) {
+            stats = true;
+        } else if (strcmp(argv[i], "--no-optimize") == 0) {
+            optimize = false;
+        } else if (strcmp(argv[i], "-v") == 0 || strcmp(argv[i], "--verbose") == 0) {
+            verbose = true;
+        } else {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
     yydebug = 0;
-    SymbolTable = StrSymMap_new();
-    Env = Stack_new();
+    Output_init(output_buffer, line_buffered);
+    if (emit_c) {
+        // the initializers of the globals run while parsing; what they print goes into the C program
+        Output_capture();
+    }
+    Lexer_open(STDIN_FILENO);
+    SymbolTable = StrSymMap_new_pow2(0);
+    FrameStack_init(&Frames, FRAME_STACK_INITIAL);
+    if (engine == ENGINE_JIT && Jit_init(&Frames, callFromNative, tailCallFromNative, perf_map)) {
+        JitThreshold = threshold;
+    }
     int result = yyparse();
     if (result != 0) {
         fprintf(stderr, "!!! Errors on parsing\n");
         return EXIT_FAILURE;
     }
-    result = executeProgram();
+    if (optimize) {
+        unsigned long removed = Optimizer_optimizeProgram();
+        if (verbose) {
+            fprintf(stderr, "optimizer: removed %lu AST nodes\n", removed);
+        }
+    }
+    if (memoize && !emit_c) {
+        unsigned long pure = Purity_analyzeProgram();
+        if (verbose) {
+            fprintf(stderr, "purity: %lu pure functions\n", pure);
+        }
+        Memo_attachProgram(memo_limit);
+    }
+    if (emit_c) {
+        result = emitProgram(emit_c);
+    } else {
+        result = executeProgram(engine, dump, stats);
+    }
+    if (memoize && !emit_c) {
+        Memo_printReport(stderr);
+        Memo_detachProgram();
+    }
+    if (stats) {
+        Arena_printStats(&ASTArena, "front-end arena", stderr);
+    }
+    FrameStack_destroy(&Frames);
     StrSymMap_delete(SymbolTable);
     SymbolTable = NULL;
+    Arena_release(&ASTArena);
     return result;
 }
 
-int executeProgram() {
+Symbol *lookupMain(void) {
     Symbol *main = AST_lookupSymbol("main");
     if (!main) {
         fprintf(stderr, "Could not find 'main'\n");
@@ -63,57 +196,186 @@ int executeProgram() {
         fprintf(stderr, "'main' is not a function.\n");
         exit(EXIT_FAILURE);
     }
-    return callFunction_(main, NULL);
+    return main;
 }
 
-// args : List<Expression>
-// params : List<Symbol>
-int bindArgs(ASTVector *args, SymbolVector *params) {
-    unsigned long argc = ASTVector_size(args);
-    if (argc != SymbolVector_size(params)) {
-        fprintf(stderr, "Argument Error (%lu args given, but expects %lu)\n", argc, SymbolVector_size(params));
-        abort();
+int emitProgram(const char *path) {
+    Symbol *main = lookupMain();
+    FILE *out = strcmp(path, "-") == 0 ? stdout : fopen(path, "w");
+    if (!out) {
+        perror(path);
+        return EXIT_FAILURE;
     }
-    for (unsigned long i = 0; i < argc; ++i) {
-        AST *expr = ASTVector_at(args, i);
-        Symbol *symbol = SymbolVector_at(params, i);
-        Environment *e = Environment_new_value(symbol, executeExpression(expr));
-        Stack_push(Env, e);
+    size_t printed_len;
+    const char *printed = Output_captured(&printed_len);
+    CGen_emitProgram(main, printed, printed_len, out);
+    if (out != stdout ? fclose(out) != 0 : fflush(out) != 0) {
+        perror(path);
+        return EXIT_FAILURE;
     }
-    return argc;
+    return EXIT_SUCCESS;
 }
 
-void unbindArgs(const int argc) {
-    for (int i = 0; i < argc; ++i) {
-        Stack_pop(Env);
+int executeProgram(Engine engine, bool dump, bool stats) {
+    Symbol *main = lookupMain();
+    if (engine == ENGINE_VM) {
+        Bytecode *bc = Bytecode_compile(main);
+        if (dump) {
+            Bytecode_dump(bc, stderr);
+        }
+        int result = VM_execute(bc);
+        Bytecode_delete(bc);
+        return result;
     }
+    const unsigned long allocations = Frames.allocations;
+    int result;
+    if (engine == ENGINE_CLOSURE) {
+        result = Closure_execute(main, &Frames);
+    } else {
+        AST_flattenProgram();
+        result = callFunction_(main, NULL, 0);
+    }
+    if (stats) {
+        fprintf(stderr, "calls: %lu, frame allocations: %lu (%.6f per call), frame stack: %lu slots\n",
+                Frames.calls, Frames.allocations - allocations,
+                Frames.calls ? (double)(Frames.allocations - allocations) / Frames.calls : 0.0,
+                (unsigned long)(Frames.end - Frames.base));
+    }
+    if (stats && engine != ENGINE_CLOSURE) {
+        fprintf(stderr, "flat AST: %lu nodes, %lu bytes\n",
+                (unsigned long)AST_flatSize(), (unsigned long)(AST_flatSize() * sizeof(FlatNode)));
+    }
+    if (stats && engine == ENGINE_JIT) {
+        Jit_printStats(stderr);
+    }
+    return result;
 }
 
-int executeFunction(const AST *body, ASTVector *args, SymbolVector *params) {
-    assert(body->code == ETC_LIST);
-    bool isExistParam = !SymbolVector_empty(params);
-    int argc = 0;
-    if (isExistParam) bindArgs(args, params);
-    executeStatements(body->AST_list);
-    if (isExistParam) unbindArgs(argc);
-    return return_value;
-}
-
-int callFunction_(const Symbol *sym, ASTVector *args) {
-    return executeFunction(sym->SYM_body, args, sym->SYM_param);
+static void checkArgs(const Symbol *sym, unsigned long argc) {
+    if (argc != SymbolVector_size(sym->SYM_param)) {
+        fprintf(stderr, "Argument Error (%lu args given, but expects %lu)\n", argc, SymbolVector_size(sym->SYM_param));
+        abort();
+    }
 }
 
-int callFunction(const AST *ast, ASTVector *args) {
-    Symbol *sym = ast->AST_symbol;
+static void checkCallee(const Symbol *sym) {
     if (sym->type == SYM_UNBOUND) {
         fprintf(stderr, "[func] Used an undefined or uninitialized symbol: %s\n", sym->name);
         abort();
     }
-    return callFunction_(sym, args);
+    if (sym->type != SYM_FUNC) {
+        fprintf(stderr, "Error: symbol '%s' found but it has unexpected type (%d).\n", sym->name, sym->type);
+        exit(EXIT_FAILURE);
+    }
+}
+
+// Counts calls and loop iterations towards compiling the function; a failed compile is not retried.
+static void heatUp(Symbol *sym) {
+    if (sym->SYM_hotness < JitThreshold && ++sym->SYM_hotness == JitThreshold) {
+        Jit_compile(sym);
+    }
+}
+
+// Runs the function on the argc values on top of the frame stack.
+// Tail calls made by the body reuse its frame and run in this loop.
+int invokeFunction(Symbol *sym, size_t argc) {
+    Memo *memo = sym->SYM_memo;
+    // the key outlives the frame, which tail calls overwrite
+    int key[memo ? MEMO_KEY_SIZE(argc) : 1];
+    if (memo) {
+        int cached;
+        if (Memo_lookup(memo, Frames.top - argc, key, &cached)) {
+            Frames.top -= argc;
+            return cached;
+        }
+    }
+    size_t caller = FrameStack_enter(&Frames, argc);
+    Symbol *outer = CurrentFunction;
+    int result;
+    for (;;) {
+        assert(FlatNodes[sym->SYM_flat].code == ETC_LIST);
+        if (sym->SYM_native) {
+            result = sym->SYM_native(Frames.fp);
+        } else {
+            CurrentFunction = sym;
+            if (JitThreshold) {
+                heatUp(sym);
+            }
+            if (executeStatements(FlatNodes + sym->SYM_flat)) {
+                return_value = 0;   // reached the end without return
+            }
+            result = return_value;
+        }
+        if (!TailCallee) {
+            break;
+        }
+        sym = TailCallee;
+        TailCallee = NULL;
+        argc = SymbolVector_size(sym->SYM_param);
+        memmove(Frames.fp, Frames.top - argc, argc * sizeof(int));
+        Frames.top = Frames.fp + argc;
+        ++Frames.calls;
+    }
+    CurrentFunction = outer;
+    FrameStack_leave(&Frames, caller);
+    if (memo) {
+        Memo_store(memo, key, result);
+    }
+    return result;
+}
+
+// args : the argc consecutive argument expressions
+// The arguments are evaluated in the frame of the caller and pushed above it.
+int callFunction_(Symbol *sym, const FlatNode *args, size_t argc) {
+    checkArgs(sym, argc);
+    for (size_t i = 0; i < argc; ++i) {
+        FrameStack_push(&Frames, executeExpression(args + i));
+    }
+    return invokeFunction(sym, argc);
 }
 
-int referenceArray(AST *ast, AST *expr) {
-    Symbol *array = ast->AST_symbol;
+// Tail calls made by native code are run by invokeFunction once the caller has returned.
+static int tailCallFromNative(Symbol *sym, const long long *args, int argc) {
+    checkCallee(sym);
+    checkArgs(sym, argc);
+    for (int i = argc - 1; i >= 0; --i) {
+        FrameStack_push(&Frames, (int)args[i]);
+    }
+    TailCallee = sym;
+    return 0;
+}
+
+// return f(...): evaluates the arguments and leaves them for invokeFunction.
+static void prepareTailCall(const FlatNode *call) {
+    const FlatNode *callee = FlatNodes + call->first;
+    Symbol *sym = callee->un.symbol;
+    const size_t argc = call->un.count;
+    checkCallee(sym);
+    checkArgs(sym, argc);
+    for (size_t i = 0; i < argc; ++i) {
+        FrameStack_push(&Frames, executeExpression(callee + 1 + i));
+    }
+    TailCallee = sym;
+}
+
+int callFunction(const FlatNode *call) {
+    const FlatNode *callee = FlatNodes + call->first;
+    Symbol *sym = callee->un.symbol;
+    checkCallee(sym);
+    return callFunction_(sym, callee + 1, call->un.count);
+}
+
+// Entry point for calls made by native code; args are in reverse order.
+static int callFromNative(Symbol *sym, const long long *args, int argc) {
+    checkCallee(sym);
+    checkArgs(sym, argc);
+    for (int i = argc - 1; i >= 0; --i) {
+        FrameStack_push(&Frames, (int)args[i]);
+    }
+    return invokeFunction(sym, argc);
+}
+
+int referenceArray(Symbol *array, const FlatNode *expr) {
     if (array->type == SYM_UNBOUND) {
         fprintf(stderr, "[func] Used an undefined or uninitialized symbol: %s\n", array->name);
         abort();
@@ -126,40 +388,56 @@ int referenceArray(AST *ast, AST *expr) {
     return array->SYM_array_data[idx];
 }
 
-int executeExpression(AST *expr) {
+int executeExpression(const FlatNode *expr) {
+    const FlatNode *kids = FlatNodes + expr->first;
+    int left;
     switch (expr->code) {
         case VAL_NUM:
-            return expr->AST_value;
+            return expr->un.value;
         case VAL_SYMBOL:
-            return resolveSymbol(expr->AST_symbol, 0);
+            return resolveGlobal(expr->un.symbol);
+        case VAL_LOCAL:
+            return Frames.fp[expr->un.slot];
         case OP_ADD:
-            return executeExpression(expr->AST_left) + executeExpression(expr->AST_right);
+            left = executeExpression(kids);
+            return left + executeExpression(kids + 1);
         case OP_SUB:
-            return executeExpression(expr->AST_left) - executeExpression(expr->AST_right);
+            left = executeExpression(kids);
+            return left - executeExpression(kids + 1);
         case OP_MUL:
-            return executeExpression(expr->AST_left) * executeExpression(expr->AST_right);
+            left = executeExpression(kids);
+            return left * executeExpression(kids + 1);
         case OP_DIV:
-            return executeExpression(expr->AST_left) / executeExpression(expr->AST_right);
+            left = executeExpression(kids);
+            return left / executeExpression(kids + 1);
         case OP_COMPARE_EQ:
-            return executeExpression(expr->AST_left) == executeExpression(expr->AST_right);
+            left = executeExpression(kids);
+            return left == executeExpression(kids + 1);
         case OP_COMPARE_NEQ:
-            return executeExpression(expr->AST_left) != executeExpression(expr->AST_right);
+            left = executeExpression(kids);
+            return left != executeExpression(kids + 1);
         case OP_COMPARE_LT:
-            return executeExpression(expr->AST_left) < executeExpression(expr->AST_right);
+            left = executeExpression(kids);
+            return left < executeExpression(kids + 1);
         case OP_COMPARE_GT:
-            return executeExpression(expr->AST_left) > executeExpression(expr->AST_right);
+            left = executeExpression(kids);
+            return left > executeExpression(kids + 1);
         case OP_COMPARE_LE:
-            return executeExpression(expr->AST_left) <= executeExpression(expr->AST_right);
+            left = executeExpression(kids);
+            return left <= executeExpression(kids + 1);
         case OP_COMPARE_GE:
-            return executeExpression(expr->AST_left) >= executeExpression(expr->AST_right);
+            left = executeExpression(kids);
+            return left >= executeExpression(kids + 1);
         case OP_ASSIGN:
-            return executeAssign(expr->AST_left, expr->AST_right);
+            return executeAssign(expr->un.symbol, kids);
+        case OP_ASSIGN_LOCAL:
+            return executeLocalAssign(expr->un.slot, kids);
         case OP_ASSIGN_ARRAY:
-            return executeArrayAssign(expr->AST_first, expr->AST_second, expr->AST_third);
+            return executeArrayAssign(expr->un.symbol, kids, kids + 1);
         case OP_CALL:
-            return callFunction(expr->AST_left, expr->AST_right->AST_list);
+            return callFunction(expr);
         case OP_REF_ARRAY:
-            return referenceArray(expr->AST_left, expr->AST_right);
+            return referenceArray(expr->un.symbol, kids);
         default:
             fprintf(stderr, "unknown expression (type: %d)\n", expr->code);
             abort();
@@ -189,105 +467,101 @@ int arrayAssign(Symbol *symbol, const size_t index, const int value) {
     return value;
 }
 
-int executeAssign(AST *sym, AST *expr) {
-    return assign(sym->AST_symbol, executeExpression(expr));
+int executeAssign(Symbol *symbol, const FlatNode *expr) {
+    return assign(symbol, executeExpression(expr));
 }
 
-int executeArrayAssign(AST *sym, AST *idx, AST *expr) {
-    return arrayAssign(sym->AST_symbol, executeExpression(idx), executeExpression(expr));
+// The frame stack may move while evaluating the expression.
+int executeLocalAssign(int slot, const FlatNode *expr) {
+    const int value = executeExpression(expr);
+    return Frames.fp[slot] = value;
 }
 
-void executePrintln(AST *ast) {
-    const char *format = ast->AST_left->AST_string;
-    if (ast->AST_right) {
-        const int val = executeExpression(ast->AST_right);
-        printf(format, val);
-    } else {
-        printf(format);
-    }
-    printf("\n");
+int executeArrayAssign(Symbol *symbol, const FlatNode *idx, const FlatNode *expr) {
+    const size_t index = executeExpression(idx);
+    return arrayAssign(symbol, index, executeExpression(expr));
 }
 
-int executeStatements(ASTVector *statements) {
-    const size_t n = ASTVector_size(statements);
-    for (size_t i = 0; i < n; ++i) {
-        if (!executeStatement(ASTVector_at(statements, i)))
-            break;
+void executePrintln(const FlatNode *stmt) {
+    Output_println(stmt->un.format, stmt->first != FLAT_NONE ? executeExpression(FlatNodes + stmt->first) : 0);
+}
+
+// Returns false if a return statement was executed.
+bool executeStatements(const FlatNode *list) {
+    const FlatNode *stmt = FlatNodes + list->first;
+    for (const FlatNode *end = stmt + list->un.count; stmt != end; ++stmt) {
+        if (!executeStatement(stmt))
+            return false;
     }
-    return return_value;
+    return true;
 }
 
-void executeFor(AST *ast) {
-    ASTVector *for_stmt = ast->AST_left->AST_list;
-    ASTVector *main = ast->AST_right->AST_list;
-    AST *init = ASTVector_at(for_stmt, 0);
-    AST *cond = ASTVector_at(for_stmt, 1);
-    AST *update = ASTVector_at(for_stmt, 2);
+bool executeFor(const FlatNode *stmt) {
+    const FlatNode *init = FlatNodes + stmt->first;
+    const FlatNode *cond = init + 1;
+    const FlatNode *update = init + 2;
+    const FlatNode *main = init + 3;
     for (executeExpression(init);
          executeExpression(cond);
          executeExpression(update)) {
-        executeStatements(main);
+        if (!executeStatement(main))
+            return false;
+        // loops count towards compiling the function, but the running call stays interpreted
+        if (JitThreshold && CurrentFunction) {
+            heatUp(CurrentFunction);
+        }
     }
+    return true;
 }
 
-bool executeStatement(AST *ast) {
-    switch (ast->code) {
+bool executeStatement(const FlatNode *stmt) {
+    switch (stmt->code) {
         case ETC_LIST:
-            executeStatements(ast->AST_list);
-            break;
+            return executeStatements(stmt);
         case CODE_PRINTLN:
-            executePrintln(ast);
+            executePrintln(stmt);
             break;
         case CODE_RETURN:
-            if (ast->AST_unary) {
-                return_value = executeExpression(ast->AST_unary);
+            if (stmt->first != FLAT_NONE && FlatNodes[stmt->first].code == OP_CALL) {
+                prepareTailCall(FlatNodes + stmt->first);
+            } else if (stmt->first != FLAT_NONE) {
+                return_value = executeExpression(FlatNodes + stmt->first);
+            } else {
+                return_value = 0;
             }
             return false;
         case CODE_FOR:
-            executeFor(ast);
-            break;
+            return executeFor(stmt);
         case OP_ASSIGN:
+        case OP_ASSIGN_LOCAL:
         case OP_ASSIGN_ARRAY:
         case OP_CALL:
-            executeExpression(ast);
+            executeExpression(stmt);
             break;
         case OP_REF_ARRAY:
         case CODE_VAR:
         case VAL_NUM:
         case VAL_SYMBOL:
+        case VAL_LOCAL:
         case OP_ADD:
         case OP_SUB:
         case OP_MUL:
         case OP_DIV:
+        case OP_COMPARE_LT:
+        case OP_COMPARE_GT:
+        case OP_COMPARE_LE:
+        case OP_COMPARE_GE:
+        case OP_COMPARE_EQ:
+        case OP_COMPARE_NEQ:
             break;
         default:
-            fprintf(stderr, "Unknown statement (type: %d)\n", ast->code);
+            fprintf(stderr, "Unknown statement (type: %d)\n", stmt->code);
             abort();
     }
     return true;
 }
 
-int resolveSymbol(const Symbol *symbol, const size_t index) {
-    // find from environment
-    StackIterator *iter = Stack_iterator(Env);
-    while (StackIter_moveNext(iter)) {
-        Environment *e = (Environment *)StackIter_current(iter);
-        if (e->name == symbol->name) {
-            StackIter_delete(iter);
-            switch (e->type) {
-                case SYM_VALUE:
-                    return e->un.value;
-                case SYM_ARRAY:
-                    return e->un.array.data[index];
-                default:
-                    fprintf(stderr, "Error: symbol '%s' found but it has unexpected type (%d).\n", e->name, e->type);
-                    exit(EXIT_FAILURE);
-            }
-        }
-    }
-    StackIter_delete(iter);
-    
-    // from symbol table
+int resolveGlobal(const Symbol *symbol) {
     if (symbol->type == SYM_UNBOUND) {
         fprintf(stderr, "[expr] Used undefined or uninitialized symbol: %s\n", symbol->name);
         abort();
@@ -298,14 +572,18 @@ int resolveSymbol(const Symbol *symbol, const size_t index) {
 void AST_initializeVariable(AST *symbol_ast, AST *expr) {
     Symbol *symbol = symbol_ast->AST_symbol;
     if (expr) {
-        assign(symbol, executeExpression(expr));
+        AST_flattenDefined();
+        FlatIndex root = AST_flatten(expr);
+        assign(symbol, executeExpression(FlatNodes + root));
     } else {
     }
 }
 
 void AST_declareArray(AST *name, AST *expr) {
     Symbol *symbol = name->AST_symbol;
-    int num_elements = executeExpression(expr);
+    AST_flattenDefined();
+    FlatIndex root = AST_flatten(expr);
+    int num_elements = executeExpression(FlatNodes + root);
     if (num_elements < 0) {
         fprintf(stderr, "The number of elements for array '%s' must be greater than 0.\n", symbol->name);
         exit(EXIT_FAILURE);
@@ -320,52 +598,4 @@ void AST_declareArray(AST *name, AST *expr) {
     symbol->SYM_array_size = num_elements;
 }
 
-Environment *Environment_new_value(Symbol *symbol, int value) {
-    Environment *env = (Environment *)malloc(sizeof(Environment));
-    if (!env) {
-        fprintf(stderr, "Cannot allocate memory for Environment.\n");
-        exit(EXIT_FAILURE);
-    }
-    env->name = symbol->name;
-    env->type = SYM_VALUE;
-    env->un.value = value;
-    return env;
-}
-
-Environment *Environment_new_array(Symbol *symbol, const size_t n) {
-    Environment *env = (Environment *)malloc(sizeof(Environment));
-    if (!env) {
-        fprintf(stderr, "Cannot allocate memory for Environment.\n");
-        exit(EXIT_FAILURE);
-    }
-    env->name = symbol->name;
-    env->type = SYM_ARRAY;
-    int *arr = (int *)calloc(n, sizeof(int));
-    if (!arr) {
-        fprintf(stderr, "Cannot allocate memory for Environment (array).\n");
-        exit(EXIT_FAILURE);
-    }
-    env->un.array.data = arr;
-    env->un.array.size = n;
-    return env;
-}
-
-void Environment_delete(Environment *env) {
-    if (env) {
-        switch(env->type) {
-            case SYM_VALUE:
-                env->un.value = 0;
-                break;
-            case SYM_ARRAY:
-                free(env->un.array.data);
-                env->un.array.data = NULL;
-                env->un.array.size = -1;
-                break;
-            default:
-                break;
-        }
-        free(env);
-    }
-}
-
 /* vim: set et ts=4 sts=4 sw=4: */
@@ -0,0 +1,503 @@
+#define _DEFAULT_SOURCE
+#define _DARWIN_C_SOURCE
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "cstl/vector.h"
+#include "jit.h"
+#include "output.h"
+
+/*
+ * Baseline x86-64 code generator.
+ * The body of a hot function is translated in one pass into native code
+ * that keeps the value of the current expression in eax, spills
+ * temporaries with push/pop and addresses parameters relative to rbx,
+ * which holds the frame pointer of the frame stack.  Anything unusual
+ * (errors, global assignment to an unbound symbol, calls, println) goes
+ * through small C helpers.
+ */
+
+static struct {
+    FrameStack *frames;
+    JitCallHandler call;
+    JitCallHandler tail;
+    FILE *perf_map;
+    unsigned long compiled;
+    unsigned long failed;
+    size_t code_bytes;
+} Jit;
+
+void Jit_printStats(FILE *out) {
+    fprintf(out, "jit: %lu functions compiled (%lu bytes), %lu left interpreted\n",
+            Jit.compiled, (unsigned long)Jit.code_bytes, Jit.failed);
+}
+
+#if defined(__x86_64__) && (defined(__unix__) || defined(__APPLE__))
+
+CSTL_VECTOR_INTERFACE(ByteVector, unsigned char)
+CSTL_VECTOR_IMPLEMENT(ByteVector, unsigned char)
+CSTL_VECTOR_INTERFACE(PatchVector, size_t)
+CSTL_VECTOR_IMPLEMENT(PatchVector, size_t)
+
+typedef struct {
+    ByteVector *code;
+    PatchVector *returns;   /* rel32 fields of jumps to the epilogue */
+    int depth;              /* 8-byte slots pushed since the prologue */
+    bool ok;
+} Emitter;
+
+enum { CC_E = 0x4, CC_NE = 0x5, CC_AE = 0x3, CC_L = 0xc, CC_GE = 0xd, CC_LE = 0xe, CC_G = 0xf };
+
+static void emitBytes(Emitter *e, const unsigned char *bytes, size_t n) {
+    if (!ByteVector_insert_array(e->code, ByteVector_size(e->code), bytes, n)) {
+        fprintf(stderr, "Cannot allocate memory for native code.\n");
+        abort();
+    }
+}
+
+#define EMIT(e, ...) do { \
+    static const unsigned char bytes_[] = { __VA_ARGS__ }; \
+    emitBytes(e, bytes_, sizeof(bytes_)); \
+} while (0)
+
+static void emit32(Emitter *e, int32_t v) {
+    unsigned char b[4];
+    memcpy(b, &v, 4);
+    emitBytes(e, b, 4);
+}
+
+static void emit64(Emitter *e, const void *p) {
+    unsigned char b[8];
+    uint64_t v = (uint64_t)(uintptr_t)p;
+    memcpy(b, &v, 8);
+    emitBytes(e, b, 8);
+}
+
+static size_t here(Emitter *e) {
+    return ByteVector_size(e->code);
+}
+
+static void patch(Emitter *e, size_t field, size_t target) {
+    int32_t rel = (int32_t)(target - (field + 4));
+    memcpy(ByteVector_at(e->code, field), &rel, 4);
+}
+
+/* Emits a rel32 jump; returns the position of the field to patch. */
+static size_t emitJump(Emitter *e) {
+    EMIT(e, 0xe9);
+    emit32(e, 0);
+    return here(e) - 4;
+}
+
+static size_t emitJcc(Emitter *e, int cc) {
+    unsigned char op[] = { 0x0f, 0x80 | cc };
+    emitBytes(e, op, 2);
+    emit32(e, 0);
+    return here(e) - 4;
+}
+
+static void emitPush(Emitter *e) {
+    EMIT(e, 0x50);                          // push rax
+    ++e->depth;
+}
+
+static void emitPopRcx(Emitter *e) {
+    EMIT(e, 0x59);                          // pop rcx
+    --e->depth;
+}
+
+/* Calls fn with the arguments already in rdi/rsi/edx; the stack must be aligned. */
+static void emitCallHelper(Emitter *e, const void *fn) {
+    EMIT(e, 0x48, 0xb8);                    // mov rax, fn
+    emit64(e, fn);
+    EMIT(e, 0xff, 0xd0);                    // call rax
+}
+
+/* Same as emitCallHelper, but aligns the stack to 16 bytes around the call. */
+static void emitAlignedCall(Emitter *e, const void *fn) {
+    const bool pad = e->depth % 2 != 0;
+    if (pad) EMIT(e, 0x48, 0x83, 0xec, 0x08);   // sub rsp, 8
+    emitCallHelper(e, fn);
+    if (pad) EMIT(e, 0x48, 0x83, 0xc4, 0x08);   // add rsp, 8
+}
+
+static void emitReloadFrame(Emitter *e) {
+    EMIT(e, 0x48, 0xb9);                    // mov rcx, &frames->fp
+    emit64(e, &Jit.frames->fp);
+    EMIT(e, 0x48, 0x8b, 0x19);              // mov rbx, [rcx]
+}
+
+/* Slow paths, only reached when a global is not an initialized value. */
+static int Jit_loadGlobal(const Symbol *symbol) {
+    if (symbol->type == SYM_UNBOUND) {
+        fprintf(stderr, "[expr] Used undefined or uninitialized symbol: %s\n", symbol->name);
+        abort();
+    }
+    fprintf(stderr, "Error: symbol '%s' found but it has unexpected type (%d).\n", symbol->name, symbol->type);
+    exit(EXIT_FAILURE);
+}
+
+static int Jit_storeGlobal(Symbol *symbol, int value) {
+    if (symbol->type != SYM_UNBOUND && symbol->type != SYM_VALUE) {
+        fprintf(stderr, "Error: Attempt to assign to the unassignable variable %s.\n", symbol->name);
+        abort();
+    }
+    symbol->type = SYM_VALUE;
+    symbol->SYM_value = value;
+    return value;
+}
+
+static void Jit_indexOutOfRange(void) {
+    fprintf(stderr, "Error: Index out of range.\n");
+    exit(EXIT_FAILURE);
+}
+
+static void compileExpression(Emitter *e, AST *expr);
+static void compileStatement(Emitter *e, AST *ast);
+
+// The index addresses the array as a 64-bit register, but only its low half is
+// the value: helpers returning int leave bits 63:32 undefined, so clear them.
+static void emitBoundsCheck(Emitter *e, const Symbol *array, bool index_in_rcx) {
+    if (index_in_rcx) {
+        EMIT(e, 0x89, 0xc9);                // mov ecx, ecx
+        EMIT(e, 0x81, 0xf9);                // cmp ecx, size
+    } else {
+        EMIT(e, 0x89, 0xc0);                // mov eax, eax
+        EMIT(e, 0x3d);                      // cmp eax, size
+    }
+    emit32(e, (int32_t)array->SYM_array_size);
+    const size_t ok = emitJcc(e, CC_AE ^ 1);
+    emitAlignedCall(e, (const void *)Jit_indexOutOfRange);
+    patch(e, ok, here(e));
+}
+
+static bool isArray(Emitter *e, const Symbol *symbol) {
+    // arrays are declared while parsing, so their storage is fixed by now
+    if (symbol->type != SYM_ARRAY || symbol->SYM_array_size > INT32_MAX) {
+        e->ok = false;
+        return false;
+    }
+    return true;
+}
+
+static void compileBinary(Emitter *e, AST *expr) {
+    AST *right = expr->AST_right;
+    compileExpression(e, expr->AST_left);
+    if (right->code == VAL_NUM && expr->code != OP_DIV) {
+        switch (expr->code) {
+            case OP_ADD: EMIT(e, 0x05); break;              // add eax, imm32
+            case OP_SUB: EMIT(e, 0x2d); break;              // sub eax, imm32
+            case OP_MUL: EMIT(e, 0x69, 0xc0); break;        // imul eax, eax, imm32
+            default:     EMIT(e, 0x3d); break;              // cmp eax, imm32
+        }
+        emit32(e, right->AST_value);
+    } else {
+        emitPush(e);
+        compileExpression(e, right);
+        emitPopRcx(e);                                      // ecx = left, eax = right
+        switch (expr->code) {
+            case OP_ADD: EMIT(e, 0x01, 0xc8); break;        // add eax, ecx
+            case OP_SUB: EMIT(e, 0x29, 0xc1, 0x89, 0xc8); break;    // sub ecx, eax; mov eax, ecx
+            case OP_MUL: EMIT(e, 0x0f, 0xaf, 0xc1); break;  // imul eax, ecx
+            case OP_DIV: EMIT(e, 0x91, 0x99, 0xf7, 0xf9); break;    // xchg eax, ecx; cdq; idiv ecx
+            default:     EMIT(e, 0x39, 0xc1); break;        // cmp ecx, eax
+        }
+    }
+    int cc;
+    switch (expr->code) {
+        case OP_COMPARE_LT:  cc = CC_L; break;
+        case OP_COMPARE_GT:  cc = CC_G; break;
+        case OP_COMPARE_LE:  cc = CC_LE; break;
+        case OP_COMPARE_GE:  cc = CC_GE; break;
+        case OP_COMPARE_EQ:  cc = CC_E; break;
+        case OP_COMPARE_NEQ: cc = CC_NE; break;
+        default: return;
+    }
+    unsigned char setcc[] = { 0x0f, 0x90 | cc, 0xc0 };     // setcc al
+    emitBytes(e, setcc, sizeof(setcc));
+    EMIT(e, 0x0f, 0xb6, 0xc0);                              // movzx eax, al
+}
+
+static void compileCall(Emitter *e, Symbol *callee, ASTVector *args, JitCallHandler handler) {
+    const int argc = args ? ASTVector_size(args) : 0;
+    // the arguments must end up right at rsp, so pad below them
+    const bool pad = (e->depth + argc) % 2 != 0;
+    if (pad) {
+        EMIT(e, 0x48, 0x83, 0xec, 0x08);                    // sub rsp, 8
+        ++e->depth;
+    }
+    for (int i = 0; i < argc; ++i) {
+        compileExpression(e, ASTVector_at(args, i));
+        emitPush(e);
+    }
+    EMIT(e, 0x48, 0xbf);                                    // mov rdi, callee
+    emit64(e, callee);
+    EMIT(e, 0x48, 0x89, 0xe6);                              // mov rsi, rsp
+    EMIT(e, 0xba);                                          // mov edx, argc
+    emit32(e, argc);
+    emitCallHelper(e, (const void *)handler);
+    const int slots = argc + pad;
+    if (slots) {
+        EMIT(e, 0x48, 0x81, 0xc4);                          // add rsp, 8 * slots
+        emit32(e, 8 * slots);
+        e->depth -= slots;
+    }
+    emitReloadFrame(e);
+}
+
+static void compileExpression(Emitter *e, AST *expr) {
+    if (!e->ok) return;
+    switch (expr->code) {
+        case VAL_NUM:
+            EMIT(e, 0xb8);                                  // mov eax, imm32
+            emit32(e, expr->AST_value);
+            break;
+        case VAL_LOCAL:
+            EMIT(e, 0x8b, 0x83);                            // mov eax, [rbx + slot * 4]
+            emit32(e, expr->AST_slot * 4);
+            break;
+        case VAL_SYMBOL: {
+            EMIT(e, 0x48, 0xb9);                            // mov rcx, symbol
+            emit64(e, expr->AST_symbol);
+            EMIT(e, 0x81, 0xb9);                            // cmp dword [rcx + type], SYM_VALUE
+            emit32(e, offsetof(Symbol, type));
+            emit32(e, SYM_VALUE);
+            const size_t ok = emitJcc(e, CC_E);
+            EMIT(e, 0x48, 0x89, 0xcf);                      // mov rdi, rcx
+            emitAlignedCall(e, (const void *)Jit_loadGlobal);
+            patch(e, ok, here(e));
+            EMIT(e, 0x8b, 0x81);                            // mov eax, [rcx + value]
+            emit32(e, offsetof(Symbol, SYM_value));
+            break;
+        }
+        case OP_ADD:
+        case OP_SUB:
+        case OP_MUL:
+        case OP_DIV:
+        case OP_COMPARE_LT:
+        case OP_COMPARE_GT:
+        case OP_COMPARE_LE:
+        case OP_COMPARE_GE:
+        case OP_COMPARE_EQ:
+        case OP_COMPARE_NEQ:
+            compileBinary(e, expr);
+            break;
+        case OP_ASSIGN_LOCAL:
+            compileExpression(e, expr->AST_right);
+            EMIT(e, 0x89, 0x83);                            // mov [rbx + slot * 4], eax
+            emit32(e, expr->AST_left->AST_slot * 4);
+            break;
+        case OP_ASSIGN: {
+            compileExpression(e, expr->AST_right);
+            EMIT(e, 0x48, 0xb9);                            // mov rcx, symbol
+            emit64(e, expr->AST_left->AST_symbol);
+            EMIT(e, 0x81, 0xb9);                            // cmp dword [rcx + type], SYM_VALUE
+            emit32(e, offsetof(Symbol, type));
+            emit32(e, SYM_VALUE);
+            const size_t slow = emitJcc(e, CC_NE);
+            EMIT(e, 0x89, 0x81);                            // mov [rcx + value], eax
+            emit32(e, offsetof(Symbol, SYM_value));
+            const size_t done = emitJump(e);
+            patch(e, slow, here(e));
+            EMIT(e, 0x48, 0x89, 0xcf, 0x89, 0xc6);          // mov rdi, rcx; mov esi, eax
+            emitAlignedCall(e, (const void *)Jit_storeGlobal);
+            patch(e, done, here(e));
+            break;
+        }
+        case OP_REF_ARRAY: {
+            const Symbol *array = expr->AST_left->AST_symbol;
+            if (!isArray(e, array)) return;
+            compileExpression(e, expr->AST_right);
+            emitBoundsCheck(e, array, false);
+            EMIT(e, 0x48, 0xb9);                            // mov rcx, data
+            emit64(e, array->SYM_array_data);
+            EMIT(e, 0x8b, 0x04, 0x81);                      // mov eax, [rcx + rax * 4]
+            break;
+        }
+        case OP_ASSIGN_ARRAY: {
+            const Symbol *array = expr->AST_first->AST_symbol;
+            if (!isArray(e, array)) return;
+            compileExpression(e, expr->AST_second);
+            emitPush(e);
+            compileExpression(e, expr->AST_third);
+            emitPopRcx(e);
+            emitBoundsCheck(e, array, true);
+            EMIT(e, 0x48, 0xba);                            // mov rdx, data
+            emit64(e, array->SYM_array_data);
+            EMIT(e, 0x89, 0x04, 0x8a);                      // mov [rdx + rcx * 4], eax
+            break;
+        }
+        case OP_CALL:
+            compileCall(e, expr->AST_left->AST_symbol, expr->AST_right->AST_list, Jit.call);
+            break;
+        default:
+            e->ok = false;
+            break;
+    }
+}
+
+static void compileStatements(Emitter *e, ASTVector *statements) {
+    const size_t n = ASTVector_size(statements);
+    for (size_t i = 0; i < n && e->ok; ++i) {
+        compileStatement(e, ASTVector_at(statements, i));
+    }
+}
+
+static void compileFor(Emitter *e, AST *ast) {
+    ASTVector *for_stmt = ast->AST_left->AST_list;
+    compileExpression(e, ASTVector_at(for_stmt, 0));
+    const size_t to_cond = emitJump(e);
+    const size_t body = here(e);
+    compileStatements(e, ast->AST_right->AST_list);
+    compileExpression(e, ASTVector_at(for_stmt, 2));
+    patch(e, to_cond, here(e));
+    compileExpression(e, ASTVector_at(for_stmt, 1));
+    EMIT(e, 0x85, 0xc0);                                    // test eax, eax
+    patch(e, emitJcc(e, CC_NE), body);
+}
+
+static void compileStatement(Emitter *e, AST *ast) {
+    switch (ast->code) {
+        case ETC_LIST:
+            compileStatements(e, ast->AST_list);
+            break;
+        case CODE_PRINTLN:
+            if (ast->AST_right) {
+                compileExpression(e, ast->AST_right);
+                EMIT(e, 0x89, 0xc6);                        // mov esi, eax
+            } else {
+                EMIT(e, 0x31, 0xf6);                        // xor esi, esi
+            }
+            EMIT(e, 0x48, 0xbf);                            // mov rdi, format
+            emit64(e, ast->AST_left->AST_format);
+            emitAlignedCall(e, (const void *)Output_println);
+            break;
+        case CODE_RETURN:
+            if (ast->AST_unary && ast->AST_unary->code == OP_CALL) {
+                AST *call = ast->AST_unary;
+                compileCall(e, call->AST_left->AST_symbol, call->AST_right->AST_list, Jit.tail);
+            } else if (ast->AST_unary) {
+                compileExpression(e, ast->AST_unary);
+            } else {
+                EMIT(e, 0x31, 0xc0);                        // xor eax, eax
+            }
+            if (!PatchVector_push_back(e->returns, emitJump(e))) {
+                fprintf(stderr, "Cannot allocate memory for native code.\n");
+                abort();
+            }
+            break;
+        case CODE_FOR:
+            compileFor(e, ast);
+            break;
+        case OP_ASSIGN:
+        case OP_ASSIGN_LOCAL:
+        case OP_ASSIGN_ARRAY:
+        case OP_CALL:
+            compileExpression(e, ast);
+            break;
+        // statements without side effects are not evaluated by the tree walker either
+        case OP_REF_ARRAY:
+        case CODE_VAR:
+        case VAL_NUM:
+        case VAL_SYMBOL:
+        case VAL_LOCAL:
+        case OP_ADD:
+        case OP_SUB:
+        case OP_MUL:
+        case OP_DIV:
+        case OP_COMPARE_LT:
+        case OP_COMPARE_GT:
+        case OP_COMPARE_LE:
+        case OP_COMPARE_GE:
+        case OP_COMPARE_EQ:
+        case OP_COMPARE_NEQ:
+            break;
+        default:
+            e->ok = false;
+            break;
+    }
+}
+
+bool Jit_init(FrameStack *frames, JitCallHandler call, JitCallHandler tail, bool perf_map) {
+    Jit.frames = frames;
+    Jit.call = call;
+    Jit.tail = tail;
+    if (perf_map) {
+        char path[64];
+        snprintf(path, sizeof(path), "/tmp/perf-%ld.map", (long)getpid());
+        Jit.perf_map = fopen(path, "a");
+        if (!Jit.perf_map) {
+            perror(path);
+        }
+    }
+    return true;
+}
+
+bool Jit_compile(Symbol *func) {
+    Emitter e = { ByteVector_new(), PatchVector_new(), 0, true };
+    if (!e.code || !e.returns) {
+        fprintf(stderr, "Cannot allocate memory for native code.\n");
+        abort();
+    }
+    EMIT(&e, 0x53);                                         // push rbx
+    EMIT(&e, 0x48, 0x89, 0xfb);                             // mov rbx, rdi
+    compileStatement(&e, func->SYM_body);
+    EMIT(&e, 0x31, 0xc0);                                   // xor eax, eax (fell off the end)
+    const size_t epilogue = here(&e);
+    EMIT(&e, 0x5b, 0xc3);                                   // pop rbx; ret
+    for (size_t i = 0; i < PatchVector_size(e.returns); ++i) {
+        patch(&e, *PatchVector_at(e.returns, i), epilogue);
+    }
+
+    bool ok = e.ok;
+    if (ok) {
+        const size_t size = ByteVector_size(e.code);
+        const size_t page = sysconf(_SC_PAGESIZE);
+        const size_t mapped = (size + page - 1) / page * page;
+        void *mem = mmap(NULL, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1, 0);
+        if (mem == MAP_FAILED) {
+            ok = false;
+        } else {
+            memcpy(mem, ByteVector_at(e.code, 0), size);
+            if (mprotect(mem, mapped, PROT_READ | PROT_EXEC) != 0) {
+                munmap(mem, mapped);
+                ok = false;
+            } else {
+                func->SYM_native = (NativeFunction)mem;
+                Jit.code_bytes += size;
+                if (Jit.perf_map) {
+                    fprintf(Jit.perf_map, "%lx %lx %s\n", (unsigned long)(uintptr_t)mem, (unsigned long)size, func->name);
+                    fflush(Jit.perf_map);
+                }
+            }
+        }
+    }
+    if (ok) {
+        ++Jit.compiled;
+    } else {
+        ++Jit.failed;
+    }
+    ByteVector_delete(e.code);
+    PatchVector_delete(e.returns);
+    return ok;
+}
+
+#else
+
+bool Jit_init(FrameStack *frames, JitCallHandler call, JitCallHandler tail, bool perf_map) {
+    return false;
+}
+
+bool Jit_compile(Symbol *func) {
+    ++Jit.failed;
+    return false;
+}
+
+#endif
+
+/* vim: set et ts=4 sts=4 sw=4: */
@@ -0,0 +1,32 @@
+#ifndef tinyc_jit_h
+#define tinyc_jit_h
+
+#include <stdbool.h>
+#include <stdio.h>
+#include "AST.h"
+#include "frame.h"
+
+#define JIT_DEFAULT_THRESHOLD (1000)
+
+/*
+ * Called by compiled code for every call.
+ * args holds the argument values in reverse order (as pushed on the native stack).
+ * For `return f(...)` the tail handler is called instead and the compiled
+ * function returns right after it, so the caller can run the callee in its frame.
+ */
+typedef int (*JitCallHandler)(Symbol *callee, const long long *args, int argc);
+
+/* Returns false if native code cannot be generated on this platform. */
+bool Jit_init(FrameStack *frames, JitCallHandler call, JitCallHandler tail, bool perf_map);
+
+/*
+ * Compiles the body of the function to native code and stores it in SYM_native.
+ * Returns false if the body cannot be compiled; the function then stays interpreted.
+ */
+bool Jit_compile(Symbol *func);
+
+void Jit_printStats(FILE *out);
+
+#endif
+
+/* vim: set et ts=4 sts=4 sw=4: */
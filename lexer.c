@@ -1,21 +1,179 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "AST.h"
+#include "lexer.h"
 
-#define INITIAL_STR_LEN (128)
+#define READ_CHUNK (64 * 1024)
 
-int take() {
-    int c;
-    while (isspace(c = getc(stdin))) { }
+/*
+ * The whole source is in one writable buffer and tokens are scanned with
+ * a pointer. String literals are terminated in place (the closing quote
+ * becomes '\0'), so neither they nor repeated identifiers allocate.
+ */
+static struct {
+    char *buffer;
+    const char *cur;
+    const char *end;
+} Source;
+
+static void Lexer_readError(void) {
+    fprintf(stderr, "Cannot read the program: %s\n", strerror(errno));
+    exit(EXIT_FAILURE);
+}
+
+void Lexer_open(int fd) {
+    struct stat st;
+    char *buffer = NULL;
+    size_t size = 0;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        // a private writable mapping, so that literals can be terminated in place
+        void *p = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        if (p != MAP_FAILED) {
+            buffer = (char *)p;
+            size = st.st_size;
+        }
+    }
+    if (!buffer) {
+        size_t capacity = 0;
+        for (;;) {
+            if (size == capacity) {
+                capacity = capacity ? capacity * 2 : READ_CHUNK;
+                buffer = (char *)realloc(buffer, capacity);
+                if (!buffer) {
+                    fprintf(stderr, "Cannot allocate memory for the program.\n");
+                    exit(EXIT_FAILURE);
+                }
+            }
+            ssize_t n = read(fd, buffer + size, capacity - size);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                Lexer_readError();
+            }
+            if (n == 0) {
+                break;
+            }
+            size += n;
+        }
+    }
+    Source.buffer = buffer;
+    Source.cur = buffer;
+    Source.end = buffer + size;
+}
+
+/*
+ * Keywords by a minimal perfect hash: (second character + length) mod 4
+ * is distinct for the four of them, so one comparison decides.
+ */
+static const struct {
+    const char *text;
+    size_t len;
+    int token;
+} Keywords[4] = {
+    { "var", 3, VAR },
+    { "println", 7, PRINTLN },
+    { "for", 3, FOR },
+    { "return", 6, RETURN },
+};
+
+static int Lexer_keyword(const char *s, size_t len) {
+    if (len < 3 || len > 7) {
+        return 0;
+    }
+    const unsigned h = ((unsigned char)s[1] + len) & 3;
+    if (Keywords[h].len == len && memcmp(Keywords[h].text, s, len) == 0) {
+        return Keywords[h].token;
+    }
+    return 0;
+}
+
+/*
+ * Identifier intern table: open addressing over spans of the source
+ * buffer.  Each occurrence is hashed once while it is scanned; only the
+ * first occurrence of a name reaches the SymbolTable.
+ */
+typedef struct {
+    unsigned hash;
+    unsigned len;
+    const char *name;
+    Symbol *symbol;
+} Intern;
+
+#define INTERN_INITIAL_CAPACITY (256)
+#define FNV_OFFSET (2166136261u)
+#define FNV_PRIME (16777619u)
+
+static struct {
+    Intern *slots;
+    size_t capacity;
+    size_t size;
+} Interns;
+
+static void Lexer_growInterns(void) {
+    const size_t capacity = Interns.capacity ? Interns.capacity * 2 : INTERN_INITIAL_CAPACITY;
+    Intern *slots = (Intern *)calloc(capacity, sizeof(Intern));
+    if (!slots) {
+        fprintf(stderr, "Cannot allocate memory for symbol.\n");
+        exit(EXIT_FAILURE);
+    }
+    for (size_t i = 0; i < Interns.capacity; ++i) {
+        const Intern *e = &Interns.slots[i];
+        if (e->symbol) {
+            size_t j = e->hash & (capacity - 1);
+            while (slots[j].symbol) {
+                j = (j + 1) & (capacity - 1);
+            }
+            slots[j] = *e;
+        }
+    }
+    free(Interns.slots);
+    Interns.slots = slots;
+    Interns.capacity = capacity;
+}
+
+static Symbol *Lexer_intern(const char *name, size_t len, unsigned hash) {
+    if (Interns.size * 2 >= Interns.capacity) {
+        Lexer_growInterns();
+    }
+    size_t i = hash & (Interns.capacity - 1);
+    for (Intern *e; (e = &Interns.slots[i])->symbol; i = (i + 1) & (Interns.capacity - 1)) {
+        if (e->hash == hash && e->len == len && memcmp(e->name, name, len) == 0) {
+            return e->symbol;
+        }
+    }
+    Symbol *symbol = AST_lookupSymbol(Arena_strndup(&ASTArena, name, len));
+    Interns.slots[i] = (Intern){ hash, (unsigned)len, name, symbol };
+    ++Interns.size;
+    return symbol;
+}
+
+// Matches a two-character operator ending in '='.
+static int Lexer_withEqual(int c, int token) {
+    if (Source.cur < Source.end && *Source.cur == '=') {
+        ++Source.cur;
+        return token;
+    }
     return c;
 }
 
 int yylex() {
-    int c = take();
-    if (c == EOF) {
+    const char *p = Source.cur;
+    while (p < Source.end && isspace((unsigned char)*p)) {
+        ++p;
+    }
+    if (p == Source.end) {
+        Source.cur = p;
         return 0;
     }
+    const int c = (unsigned char)*p++;
+    Source.cur = p;
     switch (c) {
         case '+':
         case '-':
@@ -30,83 +188,50 @@ int yylex() {
         case ';':
         case ',':
             return c;
-    }
-    if (c == '=') {
-        int next = getc(stdin);
-        if (next == '=') {
-            return OP_EQ;
-        }
-        ungetc(next, stdin);
-        return c;
-    }
-    if (c == '<') {
-        int next = getc(stdin);
-        if (next == '=') {
-            return OP_LE;
-        }
-        ungetc(next, stdin);
-        return c;
-    }
-    if (c == '>') {
-        int next = getc(stdin);
-        if (next == '=') {
-            return OP_GE;
-        }
-        ungetc(next, stdin);
-        return c;
-    }
-    if (c == '!') {
-        int next = getc(stdin);
-        if (next == '=') {
-            return OP_NEQ;
-        }
-        ungetc(next, stdin);
-        return c;
+        case '=':
+            return Lexer_withEqual(c, OP_EQ);
+        case '<':
+            return Lexer_withEqual(c, OP_LE);
+        case '>':
+            return Lexer_withEqual(c, OP_GE);
+        case '!':
+            return Lexer_withEqual(c, OP_NEQ);
     }
     if (c == '"') {
-        char *str = (char *)malloc(sizeof(char) * INITIAL_STR_LEN);
-        char *s = str;
-        c = getc(stdin);    // skip current '"'
-        for (; c != '"'; c = getc(stdin), ++s) {
-            *s = c;
+        char *str = Source.buffer + (p - Source.buffer);
+        char *quote = memchr(str, '"', Source.end - p);
+        if (!quote) {
+            fprintf(stderr, "unterminated string\n");
+            exit(EXIT_FAILURE);
         }
-        *s = '\0';
-        yylval.val = AST_makeString(strdup(str));
-        free(str);
+        *quote = '\0';
+        Source.cur = quote + 1;
+        yylval.val = AST_makeString(str);
         return STRING;
     }
     if (isdigit(c)) {
-        int n;
-        for (n = 0; isdigit(c); c = getc(stdin)) {
-            n = n * 10 + (c - '0');
+        int n = c - '0';
+        for (; p < Source.end && isdigit((unsigned char)*p); ++p) {
+            n = n * 10 + (*p - '0');
         }
-        ungetc(c, stdin);
+        Source.cur = p;
         yylval.val = AST_makeValue(n);
         return NUMBER;
     }
     if (isalpha(c)) {
-        char *str = (char *)malloc(sizeof(char) * MAX_SYMBOL_LEN);
-        char *s = str;
-        for (; isalpha(c); c = getc(stdin), ++s) {
-            *s = c;
+        const char *start = p - 1;
+        unsigned hash = (FNV_OFFSET ^ c) * FNV_PRIME;
+        for (; p < Source.end && isalpha((unsigned char)*p); ++p) {
+            hash = (hash ^ (unsigned char)*p) * FNV_PRIME;
         }
-        *s = '\0';
-        ungetc(c, stdin);
-        int retval = 0;
-        if (strcmp(str, "println") == 0) {
-            retval = PRINTLN;
-        } else if (strcmp(str, "var") == 0) {
-            retval = VAR;
-        } else if (strcmp(str, "return") == 0) {
-            retval = RETURN;
-        } else if (strcmp(str, "for") == 0) {
-            retval = FOR;
-        } else {
-            yylval.val = AST_makeSymbol(strdup(str));
-            retval = SYMBOL;
+        Source.cur = p;
+        const size_t len = p - start;
+        const int keyword = Lexer_keyword(start, len);
+        if (keyword) {
+            return keyword;
         }
-        free(str);
-        return retval;
+        yylval.val = AST_wrapSymbol(Lexer_intern(start, len, hash));
+        return SYMBOL;
     }
     fprintf(stderr, "unexpected token %c\n", c);
     abort();
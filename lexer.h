@@ -1,2 +1,4 @@
+/* Reads the whole program from fd; must be called before yyparse. */
+void Lexer_open(int fd);
 int yylex();
 int yyerror(const char *s);
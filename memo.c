@@ -0,0 +1,143 @@
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "cstl/unordered_flat_map.h"
+#include "cstl/vector.h"
+#include "memo.h"
+
+/* A key is the number of arguments followed by the arguments. */
+static size_t MemoMap_hashKey(const int *key) {
+    size_t h = 14695981039346656037ULL;
+    for (int i = 0; i <= key[0]; ++i) {
+        h = (h ^ (unsigned)key[i]) * 1099511628211ULL;
+    }
+    return h ^ (h >> 29);
+}
+
+static int MemoMap_compareKey(const int *a, const int *b) {
+    return memcmp(a, b, (a[0] + 1) * sizeof(int));
+}
+
+CSTL_UNORDERED_FLAT_MAP_INTERFACE(MemoMap, const int *, int)
+CSTL_UNORDERED_FLAT_MAP_IMPLEMENT(MemoMap, const int *, int, MemoMap_hashKey, MemoMap_compareKey)
+
+struct memo_ {
+    Symbol *function;
+    MemoMap *results;
+    int argc;
+    unsigned long hits;
+    unsigned long misses;
+    unsigned long dropped;  /* results not recorded because of the limit */
+};
+
+CSTL_VECTOR_INTERFACE(MemoVector, Memo *)
+CSTL_VECTOR_IMPLEMENT(MemoVector, Memo *)
+
+static MemoVector *Memos = NULL;
+static size_t Limit = 0;
+static size_t Used = 0;
+
+static size_t Memo_entrySize(const Memo *memo) {
+    // the slot and its control byte at the maximum load factor of 7/8, and the key
+    return (sizeof(MemoMapNode) + 1) * 8 / 7 + MEMO_KEY_SIZE(memo->argc) * sizeof(int);
+}
+
+static void *Memo_alloc(size_t size) {
+    void *p = malloc(size);
+    if (!p) {
+        fprintf(stderr, "Cannot allocate memory for memoization.\n");
+        abort();
+    }
+    return p;
+}
+
+void Memo_attachProgram(size_t limit) {
+    Limit = limit;
+    Used = 0;
+    Memos = MemoVector_new();
+    StrSymMapIterator it;
+    for (it = StrSymMap_begin(SymbolTable); it != StrSymMap_end(SymbolTable); it = StrSymMap_next(it)) {
+        Symbol *symbol = StrSymMap_value(it);
+        if (symbol->type != SYM_FUNC || !symbol->SYM_pure) {
+            continue;
+        }
+        Memo *memo = (Memo *)Memo_alloc(sizeof(Memo));
+        memo->function = symbol;
+        memo->results = MemoMap_new();
+        memo->argc = SymbolVector_size(symbol->SYM_param);
+        memo->hits = memo->misses = memo->dropped = 0;
+        if (!memo->results || !MemoVector_push_back(Memos, memo)) {
+            fprintf(stderr, "Cannot allocate memory for memoization.\n");
+            abort();
+        }
+        symbol->SYM_memo = memo;
+    }
+}
+
+bool Memo_lookup(Memo *memo, const int *args, int *key, int *result) {
+    key[0] = memo->argc;
+    memcpy(key + 1, args, memo->argc * sizeof(int));
+    MemoMapIterator pos = MemoMap_find(memo->results, key);
+    if (pos != MemoMap_end(memo->results)) {
+        ++memo->hits;
+        *result = *MemoMap_value(pos);
+        return true;
+    }
+    ++memo->misses;
+    return false;
+}
+
+void Memo_store(Memo *memo, const int *key, int result) {
+    const size_t size = Memo_entrySize(memo);
+    if (Used + size > Limit) {
+        ++memo->dropped;
+        return;
+    }
+    // a recursive call with the same arguments may have stored it first
+    if (MemoMap_find(memo->results, key) != MemoMap_end(memo->results)) {
+        return;
+    }
+    int *copy = (int *)Memo_alloc(MEMO_KEY_SIZE(memo->argc) * sizeof(int));
+    memcpy(copy, key, MEMO_KEY_SIZE(memo->argc) * sizeof(int));
+    int success;
+    MemoMap_insert(memo->results, copy, result, &success);
+    if (!success) {
+        fprintf(stderr, "Cannot allocate memory for memoization.\n");
+        abort();
+    }
+    Used += size;
+}
+
+void Memo_printReport(FILE *out) {
+    for (size_t i = 0; i < MemoVector_size(Memos); ++i) {
+        const Memo *memo = *MemoVector_at(Memos, i);
+        if (memo->hits + memo->misses == 0) {
+            continue;
+        }
+        fprintf(out, "memo: %s: %lu hits, %lu misses, %lu entries",
+                memo->function->name, memo->hits, memo->misses, (unsigned long)MemoMap_size(memo->results));
+        if (memo->dropped) {
+            fprintf(out, ", %lu not recorded (limit reached)", memo->dropped);
+        }
+        fprintf(out, "\n");
+    }
+    fprintf(out, "memo: %lu of %lu bytes used\n", (unsigned long)Used, (unsigned long)Limit);
+}
+
+void Memo_detachProgram(void) {
+    for (size_t i = 0; i < MemoVector_size(Memos); ++i) {
+        Memo *memo = *MemoVector_at(Memos, i);
+        MemoMapIterator pos;
+        for (pos = MemoMap_begin(memo->results); pos != MemoMap_end(memo->results); pos = MemoMap_next(pos)) {
+            free((void *)*MemoMap_key(pos));
+        }
+        MemoMap_delete(memo->results);
+        memo->function->SYM_memo = NULL;
+        free(memo);
+    }
+    MemoVector_delete(Memos);
+    Memos = NULL;
+}
+
+/* vim: set et ts=4 sts=4 sw=4: */
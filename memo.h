@@ -0,0 +1,42 @@
+#ifndef tinyc_memo_h
+#define tinyc_memo_h
+
+#include <stdbool.h>
+#include <stdio.h>
+#include "AST.h"
+
+#define MEMO_DEFAULT_LIMIT (64 * 1024 * 1024)
+
+/*
+ * Result caches of pure functions (see purity.h), keyed by the arguments.
+ * All caches together use at most the given number of bytes; once the
+ * limit is reached, new results are no longer recorded.
+ */
+typedef struct memo_ Memo;
+
+/* Gives every function marked SYM_pure a cache in SYM_memo. */
+void Memo_attachProgram(size_t limit);
+
+/* Number of ints in the key of a call with argc arguments. */
+#define MEMO_KEY_SIZE(argc) ((argc) + 1)
+
+/*
+ * Looks up the arguments of a call (one per parameter of the function),
+ * building its key in the caller's buffer of MEMO_KEY_SIZE(argc) ints.
+ * On a hit, stores the cached value in *result and returns true; on a miss,
+ * returns false and the key is left for Memo_store with the result.
+ */
+bool Memo_lookup(Memo *memo, const int *args, int *key, int *result);
+
+/* Records the result of the call under the key; copies the key only when it is recorded. */
+void Memo_store(Memo *memo, const int *key, int result);
+
+/* Prints hits and misses per function. */
+void Memo_printReport(FILE *out);
+
+/* Releases every cache. */
+void Memo_detachProgram(void);
+
+#endif
+
+/* vim: set et ts=4 sts=4 sw=4: */
@@ -0,0 +1,312 @@
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <limits.h>
+#include <assert.h>
+#include "optimizer.h"
+
+/* Globals assigned by some function; the others keep the value of their initializer. */
+static SymbolSet *Assigned = NULL;
+
+static void Optimizer_optimize(AST *ast);
+
+static unsigned long Optimizer_countNodes(const AST *ast) {
+    if (!ast) {
+        return 0;
+    }
+    switch (ast->code) {
+        case ETC_LIST: {
+            unsigned long n = 1;
+            const size_t size = ASTVector_size(ast->AST_list);
+            for (size_t i = 0; i < size; ++i) {
+                n += Optimizer_countNodes(ASTVector_at(ast->AST_list, i));
+            }
+            return n;
+        }
+        case CODE_RETURN:
+            return 1 + Optimizer_countNodes(ast->AST_unary);
+        case OP_ASSIGN_ARRAY:
+            return 1 + Optimizer_countNodes(ast->AST_first) + Optimizer_countNodes(ast->AST_second)
+                + Optimizer_countNodes(ast->AST_third);
+        case VAL_NUM:
+        case VAL_STRING:
+        case VAL_SYMBOL:
+        case VAL_LOCAL:
+        case CODE_VAR:
+            return 1;
+        default:
+            return 1 + Optimizer_countNodes(ast->AST_left) + Optimizer_countNodes(ast->AST_right);
+    }
+}
+
+static bool isBinaryOperator(CodeType code) {
+    return OP_ADD <= code && code <= OP_COMPARE_NEQ;
+}
+
+static bool isConstant(const AST *ast, int value) {
+    return ast->code == VAL_NUM && ast->AST_value == value;
+}
+
+// Evaluation can neither fail nor change any state, so the expression may be dropped.
+static bool isPure(const AST *ast) {
+    switch (ast->code) {
+        case VAL_NUM:
+        case VAL_LOCAL:
+            return true;
+        case OP_ADD:
+        case OP_SUB:
+        case OP_MUL:
+        case OP_COMPARE_LT:
+        case OP_COMPARE_GT:
+        case OP_COMPARE_LE:
+        case OP_COMPARE_GE:
+        case OP_COMPARE_EQ:
+        case OP_COMPARE_NEQ:
+            return isPure(ast->AST_left) && isPure(ast->AST_right);
+        default:
+            return false;
+    }
+}
+
+static bool isSameLocal(const AST *a, const AST *b) {
+    return a->code == VAL_LOCAL && b->code == VAL_LOCAL && a->AST_slot == b->AST_slot;
+}
+
+// Computes l op r with wrap-around arithmetic. Returns false if it would trap at run time.
+static bool Optimizer_evaluate(CodeType code, int l, int r, int *result) {
+    switch (code) {
+        case OP_ADD:            *result = (int)((unsigned)l + (unsigned)r); return true;
+        case OP_SUB:            *result = (int)((unsigned)l - (unsigned)r); return true;
+        case OP_MUL:            *result = (int)((unsigned)l * (unsigned)r); return true;
+        case OP_DIV:
+            if (r == 0 || (l == INT_MIN && r == -1)) {
+                return false;
+            }
+            *result = l / r;
+            return true;
+        case OP_COMPARE_LT:     *result = l < r; return true;
+        case OP_COMPARE_GT:     *result = l > r; return true;
+        case OP_COMPARE_LE:     *result = l <= r; return true;
+        case OP_COMPARE_GE:     *result = l >= r; return true;
+        case OP_COMPARE_EQ:     *result = l == r; return true;
+        case OP_COMPARE_NEQ:    *result = l != r; return true;
+        default:
+            return false;
+    }
+}
+
+static void Optimizer_replaceWithValue(AST *ast, int value) {
+    ast->code = VAL_NUM;
+    ast->AST_value = value;
+}
+
+static void Optimizer_replaceWith(AST *ast, const AST *node) {
+    *ast = *node;
+}
+
+// Children have already been optimized.
+static void Optimizer_simplifyBinary(AST *ast) {
+    AST *l = ast->AST_left;
+    AST *r = ast->AST_right;
+    int value;
+    if (l->code == VAL_NUM && r->code == VAL_NUM) {
+        if (Optimizer_evaluate(ast->code, l->AST_value, r->AST_value, &value)) {
+            Optimizer_replaceWithValue(ast, value);
+        }
+        return;
+    }
+    // (x + c1) + c2 => x + (c1 + c2), (x * c1) * c2 => x * (c1 * c2)
+    if ((ast->code == OP_ADD || ast->code == OP_MUL) && r->code == VAL_NUM
+            && l->code == ast->code && l->AST_right->code == VAL_NUM) {
+        Optimizer_evaluate(ast->code, l->AST_right->AST_value, r->AST_value, &value);
+        ast->AST_left = l->AST_left;
+        r->AST_value = value;
+        Optimizer_simplifyBinary(ast);
+        return;
+    }
+    switch (ast->code) {
+        case OP_ADD:
+            if (isConstant(r, 0)) {
+                Optimizer_replaceWith(ast, l);
+            } else if (isConstant(l, 0)) {
+                Optimizer_replaceWith(ast, r);
+            }
+            break;
+        case OP_SUB:
+            if (isConstant(r, 0)) {
+                Optimizer_replaceWith(ast, l);
+            } else if (isSameLocal(l, r)) {
+                Optimizer_replaceWithValue(ast, 0);
+            }
+            break;
+        case OP_MUL:
+            if (isConstant(r, 1)) {
+                Optimizer_replaceWith(ast, l);
+            } else if (isConstant(l, 1)) {
+                Optimizer_replaceWith(ast, r);
+            } else if ((isConstant(r, 0) && isPure(l)) || (isConstant(l, 0) && isPure(r))) {
+                Optimizer_replaceWithValue(ast, 0);
+            }
+            break;
+        case OP_DIV:
+            if (isConstant(r, 1)) {
+                Optimizer_replaceWith(ast, l);
+            }
+            break;
+        case OP_COMPARE_LE:
+        case OP_COMPARE_GE:
+        case OP_COMPARE_EQ:
+            if (isSameLocal(l, r)) {
+                Optimizer_replaceWithValue(ast, 1);
+            }
+            break;
+        case OP_COMPARE_LT:
+        case OP_COMPARE_GT:
+        case OP_COMPARE_NEQ:
+            if (isSameLocal(l, r)) {
+                Optimizer_replaceWithValue(ast, 0);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+static void Optimizer_optimizeList(ASTVector *list) {
+    const size_t n = ASTVector_size(list);
+    for (size_t i = 0; i < n; ++i) {
+        Optimizer_optimize(ASTVector_at(list, i));
+    }
+}
+
+static void Optimizer_collectAssigned(const AST *ast) {
+    if (!ast) {
+        return;
+    }
+    switch (ast->code) {
+        case ETC_LIST: {
+            const size_t n = ASTVector_size(ast->AST_list);
+            for (size_t i = 0; i < n; ++i) {
+                Optimizer_collectAssigned(ASTVector_at(ast->AST_list, i));
+            }
+            break;
+        }
+        case CODE_RETURN:
+            Optimizer_collectAssigned(ast->AST_unary);
+            break;
+        case OP_ASSIGN_ARRAY:
+            Optimizer_collectAssigned(ast->AST_second);
+            Optimizer_collectAssigned(ast->AST_third);
+            break;
+        case OP_ASSIGN:
+            SymbolSet_insert(Assigned, ast->AST_left->AST_symbol, NULL);
+            Optimizer_collectAssigned(ast->AST_right);
+            break;
+        case VAL_NUM:
+        case VAL_STRING:
+        case VAL_SYMBOL:
+        case VAL_LOCAL:
+        case CODE_VAR:
+            break;
+        default:
+            Optimizer_collectAssigned(ast->AST_left);
+            Optimizer_collectAssigned(ast->AST_right);
+            break;
+    }
+}
+
+static void Optimizer_optimize(AST *ast) {
+    if (!ast) {
+        return;
+    }
+    switch (ast->code) {
+        case VAL_SYMBOL: {
+            const Symbol *symbol = ast->AST_symbol;
+            if (Assigned && symbol->type == SYM_VALUE
+                    && SymbolSet_find(Assigned, symbol) == SymbolSet_end(Assigned)) {
+                Optimizer_replaceWithValue(ast, symbol->SYM_value);
+            }
+            break;
+        }
+        case ETC_LIST:
+            Optimizer_optimizeList(ast->AST_list);
+            break;
+        case CODE_RETURN:
+            Optimizer_optimize(ast->AST_unary);
+            break;
+        case CODE_PRINTLN:
+        case OP_ASSIGN:
+        case OP_ASSIGN_LOCAL:
+        case OP_CALL:
+        case OP_REF_ARRAY:
+            Optimizer_optimize(ast->AST_right);
+            break;
+        case OP_ASSIGN_ARRAY:
+            Optimizer_optimize(ast->AST_second);
+            Optimizer_optimize(ast->AST_third);
+            break;
+        default:
+            if (isBinaryOperator(ast->code)) {
+                Optimizer_optimize(ast->AST_left);
+                Optimizer_optimize(ast->AST_right);
+                Optimizer_simplifyBinary(ast);
+            }
+            break;
+    }
+}
+
+static void Optimizer_optimizeStatement(AST *ast) {
+    if (!ast) {
+        return;
+    }
+    switch (ast->code) {
+        case ETC_LIST: {
+            const size_t n = ASTVector_size(ast->AST_list);
+            for (size_t i = 0; i < n; ++i) {
+                Optimizer_optimizeStatement(ASTVector_at(ast->AST_list, i));
+            }
+            break;
+        }
+        case CODE_FOR:
+            Optimizer_optimize(ast->AST_left);
+            Optimizer_optimizeStatement(ast->AST_right);
+            break;
+        default:
+            // Every engine skips an operator statement without evaluating it. Simplifying
+            // f() + 0 to f() would turn it into a call that runs, so it is left as written.
+            if (!isBinaryOperator(ast->code)) {
+                Optimizer_optimize(ast);
+            }
+            break;
+    }
+}
+
+unsigned long Optimizer_optimizeFunction(Symbol *func) {
+    assert(func->type == SYM_FUNC);
+    const unsigned long before = Optimizer_countNodes(func->SYM_body);
+    Optimizer_optimizeStatement(func->SYM_body);
+    return before - Optimizer_countNodes(func->SYM_body);
+}
+
+unsigned long Optimizer_optimizeProgram(void) {
+    unsigned long removed = 0;
+    StrSymMapIterator it;
+    Assigned = SymbolSet_new();
+    for (it = StrSymMap_begin(SymbolTable); it != StrSymMap_end(SymbolTable); it = StrSymMap_next(it)) {
+        Symbol *symbol = StrSymMap_value(it);
+        if (symbol->type == SYM_FUNC) {
+            Optimizer_collectAssigned(symbol->SYM_body);
+        }
+    }
+    for (it = StrSymMap_begin(SymbolTable); it != StrSymMap_end(SymbolTable); it = StrSymMap_next(it)) {
+        Symbol *symbol = StrSymMap_value(it);
+        if (symbol->type == SYM_FUNC) {
+            removed += Optimizer_optimizeFunction(symbol);
+        }
+    }
+    SymbolSet_delete(Assigned);
+    Assigned = NULL;
+    return removed;
+}
+
+/* vim: set et ts=4 sts=4 sw=4: */
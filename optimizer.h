@@ -0,0 +1,20 @@
+#ifndef tinyc_optimizer_h
+#define tinyc_optimizer_h
+
+#include "AST.h"
+
+/*
+ * Constant folding and algebraic simplification.
+ * Rewrites the body in place and returns the number of AST nodes removed.
+ */
+unsigned long Optimizer_optimizeFunction(Symbol *func);
+
+/*
+ * Optimizes every function in the SymbolTable. Globals that no function
+ * assigns are also replaced by the value of their initializer.
+ */
+unsigned long Optimizer_optimizeProgram(void);
+
+#endif
+
+/* vim: set et ts=4 sts=4 sw=4: */
@@ -0,0 +1,209 @@
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include "output.h"
+
+static struct {
+    char *buffer;
+    size_t size;
+    size_t used;
+    bool line_buffered;
+    bool capture;
+    char *captured;
+    size_t captured_size;
+    size_t captured_used;
+} Out;
+
+static void *Output_alloc(size_t size) {
+    void *p = malloc(size);
+    if (!p) {
+        fprintf(stderr, "Cannot allocate memory for output.\n");
+        exit(EXIT_FAILURE);
+    }
+    return p;
+}
+
+static void Output_keep(const char *p, size_t n) {
+    if (n == 0) {
+        return;
+    }
+    if (Out.captured_used + n > Out.captured_size) {
+        size_t size = Out.captured_size ? Out.captured_size : Out.size;
+        while (size < Out.captured_used + n) {
+            size *= 2;
+        }
+        char *captured = (char *)realloc(Out.captured, size);
+        if (!captured) {
+            fprintf(stderr, "Cannot allocate memory for output.\n");
+            exit(EXIT_FAILURE);
+        }
+        Out.captured = captured;
+        Out.captured_size = size;
+    }
+    memcpy(Out.captured + Out.captured_used, p, n);
+    Out.captured_used += n;
+}
+
+static void Output_writeAll(const char *p, size_t n) {
+    if (Out.capture) {
+        Output_keep(p, n);
+        return;
+    }
+    while (n > 0) {
+        ssize_t written = write(STDOUT_FILENO, p, n);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;     // like stdio, a failed write of stdout is not fatal
+        }
+        p += written;
+        n -= written;
+    }
+}
+
+void Output_flush(void) {
+    Output_writeAll(Out.buffer, Out.used);
+    Out.used = 0;
+}
+
+void Output_init(size_t buffer_size, bool line_buffered) {
+    Out.size = buffer_size > 0 ? buffer_size : 1;
+    Out.buffer = (char *)Output_alloc(Out.size);
+    Out.used = 0;
+    Out.line_buffered = line_buffered;
+    atexit(Output_flush);
+}
+
+void Output_capture(void) {
+    Output_flush();
+    Out.capture = true;
+}
+
+const char *Output_captured(size_t *len) {
+    Output_flush();
+    *len = Out.captured_used;
+    return Out.captured;
+}
+
+static void Output_append(const char *p, size_t n) {
+    if (Out.used + n > Out.size) {
+        Output_flush();
+        if (n > Out.size) {
+            Output_writeAll(p, n);
+            return;
+        }
+    }
+    memcpy(Out.buffer + Out.used, p, n);
+    Out.used += n;
+}
+
+// Copies text up to the first conversion (or the end), resolving %%; returns where it stopped.
+static const char *Output_literal(const char *text, char *out, size_t *len) {
+    size_t n = 0;
+    for (; *text; ++text) {
+        if (*text == '%') {
+            if (text[1] != '%') {
+                break;
+            }
+            ++text;
+        }
+        out[n++] = *text;
+    }
+    *len = n;
+    return text;
+}
+
+Format *Output_parseFormat(const char *text) {
+    const size_t length = strlen(text);
+    Format *format = (Format *)Output_alloc(sizeof(Format));
+    format->text = text;
+    format->head = (char *)Output_alloc(length + 2);
+    format->tail = (char *)Output_alloc(length + 2);
+    const char *rest = Output_literal(text, format->head, &format->head_len);
+    if (!*rest) {
+        format->kind = FORMAT_LITERAL;
+        format->head[format->head_len++] = '\n';
+        format->tail_len = 0;
+        return format;
+    }
+    format->kind = FORMAT_PRINTF;
+    if (rest[1] == 'd' || rest[1] == 'i') {
+        rest = Output_literal(rest + 2, format->tail, &format->tail_len);
+        if (!*rest) {
+            format->kind = FORMAT_INT;
+            format->tail[format->tail_len++] = '\n';
+        }
+    }
+    return format;
+}
+
+// Renders the value in decimal at the end of buf; returns where the digits start.
+static char *Output_itoa(int value, char *end) {
+    unsigned int n = value < 0 ? 0u - (unsigned int)value : (unsigned int)value;
+    char *p = end;
+    do {
+        *--p = '0' + n % 10;
+        n /= 10;
+    } while (n);
+    if (value < 0) {
+        *--p = '-';
+    }
+    return p;
+}
+
+static void Output_printf(const Format *format, int value) {
+    char small[256];
+    int n = snprintf(small, sizeof(small), format->text, value);
+    if (n < 0) {
+        return;
+    }
+    if ((size_t)n < sizeof(small)) {
+        Output_append(small, n);
+    } else {
+        char *large = (char *)Output_alloc(n + 1);
+        snprintf(large, n + 1, format->text, value);
+        Output_append(large, n);
+        free(large);
+    }
+    Output_append("\n", 1);
+}
+
+void Output_println(const Format *format, int value) {
+    switch (format->kind) {
+        case FORMAT_LITERAL:
+            Output_append(format->head, format->head_len);
+            break;
+        case FORMAT_INT: {
+            char digits[16];
+            char *end = digits + sizeof(digits);
+            char *start = Output_itoa(value, end);
+            const size_t n = format->head_len + (end - start) + format->tail_len;
+            if (Out.used + n <= Out.size) {
+                char *p = Out.buffer + Out.used;
+                memcpy(p, format->head, format->head_len);
+                p += format->head_len;
+                memcpy(p, start, end - start);
+                p += end - start;
+                memcpy(p, format->tail, format->tail_len);
+                Out.used += n;
+            } else {
+                Output_append(format->head, format->head_len);
+                Output_append(start, end - start);
+                Output_append(format->tail, format->tail_len);
+            }
+            break;
+        }
+        case FORMAT_PRINTF:
+            Output_printf(format, value);
+            break;
+    }
+    if (Out.line_buffered) {
+        Output_flush();
+    }
+}
+
+/* vim: set et ts=4 sts=4 sw=4: */
@@ -0,0 +1,52 @@
+#ifndef tinyc_output_h
+#define tinyc_output_h
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define OUTPUT_DEFAULT_BUFFER (64 * 1024)
+
+/*
+ * Output of println.
+ * Formats are split once, when the string is parsed, into the literal text
+ * around a single %d (or %i), so printing a line is two copies and an itoa
+ * into one buffer; the buffer goes out with write(2) when it fills up, at
+ * exit, or after every line in line-buffered mode.  Formats with other
+ * conversions are rendered by snprintf into the same buffer.
+ */
+typedef enum {
+    FORMAT_LITERAL,     /* no conversion; head holds the whole line */
+    FORMAT_INT,         /* head, the value in decimal, tail */
+    FORMAT_PRINTF       /* anything else */
+} FormatKind;
+
+typedef struct format_ {
+    const char *text;   /* the format as written */
+    FormatKind kind;
+    char *head;         /* literal text before the conversion, with %% resolved */
+    size_t head_len;
+    char *tail;         /* literal text after the conversion, ending in the newline */
+    size_t tail_len;
+} Format;
+
+/* Must be called before anything is printed; the buffer is flushed at exit. */
+void Output_init(size_t buffer_size, bool line_buffered);
+
+Format *Output_parseFormat(const char *text);
+
+/* println without a value passes 0, which only matters if the format has a conversion. */
+void Output_println(const Format *format, int value);
+
+void Output_flush(void);
+
+/*
+ * Keeps everything printed from now on in memory instead of writing it to
+ * stdout.  Output_captured() returns the text kept so far; it is not
+ * terminated and may contain NUL characters.
+ */
+void Output_capture(void);
+const char *Output_captured(size_t *len);
+
+#endif
+
+/* vim: set et ts=4 sts=4 sw=4: */
@@ -0,0 +1,146 @@
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include "purity.h"
+
+typedef struct {
+    SymbolSet *read;            /* globals read by some function */
+    SymbolSet *written;         /* globals assigned by some function */
+    SymbolSet *written_arrays;  /* arrays assigned by some function */
+} Effects;
+
+static bool SymbolSet_contains(SymbolSet *set, const Symbol *symbol) {
+    return SymbolSet_find(set, symbol) != SymbolSet_end(set);
+}
+
+static void Purity_collect(Effects *effects, const AST *ast) {
+    if (!ast) {
+        return;
+    }
+    switch (ast->code) {
+        case ETC_LIST: {
+            const size_t n = ASTVector_size(ast->AST_list);
+            for (size_t i = 0; i < n; ++i) {
+                Purity_collect(effects, ASTVector_at(ast->AST_list, i));
+            }
+            break;
+        }
+        case VAL_SYMBOL:
+            SymbolSet_insert(effects->read, ast->AST_symbol, NULL);
+            break;
+        case OP_ASSIGN:
+            SymbolSet_insert(effects->written, ast->AST_left->AST_symbol, NULL);
+            Purity_collect(effects, ast->AST_right);
+            break;
+        case OP_ASSIGN_ARRAY:
+            SymbolSet_insert(effects->written_arrays, ast->AST_first->AST_symbol, NULL);
+            Purity_collect(effects, ast->AST_second);
+            Purity_collect(effects, ast->AST_third);
+            break;
+        case CODE_RETURN:
+            Purity_collect(effects, ast->AST_unary);
+            break;
+        // the symbol on the left names a function, an array or a format
+        case OP_CALL:
+        case OP_REF_ARRAY:
+        case CODE_PRINTLN:
+        case OP_ASSIGN_LOCAL:
+            Purity_collect(effects, ast->AST_right);
+            break;
+        case VAL_NUM:
+        case VAL_STRING:
+        case VAL_LOCAL:
+        case CODE_VAR:
+            break;
+        default:
+            Purity_collect(effects, ast->AST_left);
+            Purity_collect(effects, ast->AST_right);
+            break;
+    }
+}
+
+// Returns whether the body is pure, assuming every function it calls that is marked pure is.
+static bool Purity_check(Effects *effects, const AST *ast) {
+    if (!ast) {
+        return true;
+    }
+    switch (ast->code) {
+        case ETC_LIST: {
+            const size_t n = ASTVector_size(ast->AST_list);
+            for (size_t i = 0; i < n; ++i) {
+                if (!Purity_check(effects, ASTVector_at(ast->AST_list, i))) {
+                    return false;
+                }
+            }
+            return true;
+        }
+        case CODE_PRINTLN:
+        case OP_ASSIGN_ARRAY:
+            return false;
+        case VAL_SYMBOL:
+            return !SymbolSet_contains(effects->written, ast->AST_symbol);
+        case OP_ASSIGN:
+            // a store nobody can read back (e.g. the counter of a for used as an if) is not an effect
+            return !SymbolSet_contains(effects->read, ast->AST_left->AST_symbol)
+                && Purity_check(effects, ast->AST_right);
+        case OP_REF_ARRAY:
+            return !SymbolSet_contains(effects->written_arrays, ast->AST_left->AST_symbol)
+                && Purity_check(effects, ast->AST_right);
+        case OP_CALL: {
+            const Symbol *callee = ast->AST_left->AST_symbol;
+            // calls to anything but a function always fail, which memoization does not change
+            if (callee->type == SYM_FUNC && !callee->SYM_pure) {
+                return false;
+            }
+            return Purity_check(effects, ast->AST_right);
+        }
+        case CODE_RETURN:
+            return Purity_check(effects, ast->AST_unary);
+        case OP_ASSIGN_LOCAL:
+            return Purity_check(effects, ast->AST_right);
+        case VAL_NUM:
+        case VAL_STRING:
+        case VAL_LOCAL:
+        case CODE_VAR:
+            return true;
+        default:
+            return Purity_check(effects, ast->AST_left) && Purity_check(effects, ast->AST_right);
+    }
+}
+
+unsigned long Purity_analyzeProgram(void) {
+    Effects effects = { SymbolSet_new(), SymbolSet_new(), SymbolSet_new() };
+    StrSymMapIterator it;
+    for (it = StrSymMap_begin(SymbolTable); it != StrSymMap_end(SymbolTable); it = StrSymMap_next(it)) {
+        Symbol *symbol = StrSymMap_value(it);
+        if (symbol->type == SYM_FUNC) {
+            Purity_collect(&effects, symbol->SYM_body);
+            symbol->SYM_pure = true;
+        }
+    }
+    // start from "everything is pure" so that recursive functions can be proven pure
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (it = StrSymMap_begin(SymbolTable); it != StrSymMap_end(SymbolTable); it = StrSymMap_next(it)) {
+            Symbol *symbol = StrSymMap_value(it);
+            if (symbol->type == SYM_FUNC && symbol->SYM_pure && !Purity_check(&effects, symbol->SYM_body)) {
+                symbol->SYM_pure = false;
+                changed = true;
+            }
+        }
+    }
+    unsigned long pure = 0;
+    for (it = StrSymMap_begin(SymbolTable); it != StrSymMap_end(SymbolTable); it = StrSymMap_next(it)) {
+        Symbol *symbol = StrSymMap_value(it);
+        if (symbol->type == SYM_FUNC && symbol->SYM_pure) {
+            ++pure;
+        }
+    }
+    SymbolSet_delete(effects.read);
+    SymbolSet_delete(effects.written);
+    SymbolSet_delete(effects.written_arrays);
+    return pure;
+}
+
+/* vim: set et ts=4 sts=4 sw=4: */
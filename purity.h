@@ -0,0 +1,16 @@
+#ifndef tinyc_purity_h
+#define tinyc_purity_h
+
+#include "AST.h"
+
+/*
+ * Marks with SYM_pure every function whose result depends only on its
+ * arguments: it prints nothing, writes no array and no global that any
+ * function reads, reads no global or array that any function writes, and
+ * calls only pure functions.  Returns the number of pure functions.
+ */
+unsigned long Purity_analyzeProgram(void);
+
+#endif
+
+/* vim: set et ts=4 sts=4 sw=4: */
@@ -0,0 +1,93 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <assert.h>
+#include "resolver.h"
+
+// Returns the frame slot of the parameter named by the symbol, or -1 for a global.
+static int Resolver_slot(SymbolVector *params, const Symbol *symbol) {
+    const size_t n = SymbolVector_size(params);
+    for (size_t i = 0; i < n; ++i) {
+        if (SymbolVector_at(params, i)->name == symbol->name) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void Resolver_resolveList(ASTVector *list, SymbolVector *params);
+
+static void Resolver_resolve(AST *ast, SymbolVector *params) {
+    if (!ast) {
+        return;
+    }
+    switch (ast->code) {
+        case VAL_SYMBOL: {
+            int slot = Resolver_slot(params, ast->AST_symbol);
+            if (slot >= 0) {
+                ast->code = VAL_LOCAL;
+                ast->AST_slot = slot;
+            }
+            break;
+        }
+        case OP_ASSIGN:
+            Resolver_resolve(ast->AST_left, params);
+            Resolver_resolve(ast->AST_right, params);
+            if (ast->AST_left->code == VAL_LOCAL) {
+                ast->code = OP_ASSIGN_LOCAL;
+            }
+            break;
+        case ETC_LIST:
+            Resolver_resolveList(ast->AST_list, params);
+            break;
+        case CODE_FOR:
+        case OP_ADD:
+        case OP_SUB:
+        case OP_MUL:
+        case OP_DIV:
+        case OP_COMPARE_LT:
+        case OP_COMPARE_GT:
+        case OP_COMPARE_LE:
+        case OP_COMPARE_GE:
+        case OP_COMPARE_EQ:
+        case OP_COMPARE_NEQ:
+            Resolver_resolve(ast->AST_left, params);
+            Resolver_resolve(ast->AST_right, params);
+            break;
+        case CODE_RETURN:
+            Resolver_resolve(ast->AST_unary, params);
+            break;
+        // the symbol on the left is always a global (function or array)
+        case CODE_PRINTLN:
+        case OP_CALL:
+        case OP_REF_ARRAY:
+            Resolver_resolve(ast->AST_right, params);
+            break;
+        case OP_ASSIGN_ARRAY:
+            Resolver_resolve(ast->AST_second, params);
+            Resolver_resolve(ast->AST_third, params);
+            break;
+        case VAL_NUM:
+        case VAL_STRING:
+        case VAL_LOCAL:
+        case OP_ASSIGN_LOCAL:
+        case CODE_VAR:
+            break;
+        default:
+            fprintf(stderr, "Resolver: unknown node (type: %d)\n", ast->code);
+            abort();
+    }
+}
+
+static void Resolver_resolveList(ASTVector *list, SymbolVector *params) {
+    const size_t n = ASTVector_size(list);
+    for (size_t i = 0; i < n; ++i) {
+        Resolver_resolve(ASTVector_at(list, i), params);
+    }
+}
+
+void Resolver_resolveFunction(Symbol *func) {
+    assert(func->type == SYM_FUNC);
+    Resolver_resolve(func->SYM_body, func->SYM_param);
+}
+
+/* vim: set et ts=4 sts=4 sw=4: */
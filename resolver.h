@@ -0,0 +1,16 @@
+#ifndef tinyc_resolver_h
+#define tinyc_resolver_h
+
+#include "AST.h"
+
+/*
+ * Binds every variable reference in the body of the function.
+ * References to a parameter become VAL_LOCAL / OP_ASSIGN_LOCAL with the
+ * index of the parameter in the call frame; all other references keep
+ * their Symbol, which is the storage of the global variable.
+ */
+void Resolver_resolveFunction(Symbol *func);
+
+#endif
+
+/* vim: set et ts=4 sts=4 sw=4: */
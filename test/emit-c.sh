@@ -0,0 +1,43 @@
+#!/bin/bash
+# Translates every test program to C, compiles it and checks that the
+# compiled program prints the same output and exits with the same status
+# as the interpreter.
+# Usage: test/emit-c.sh [path to tiny-c] [C compiler]
+cd "$(dirname "$0")"
+TINYC=${1:-../tiny-c}
+CC=${2:-cc}
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+failed=0
+for prog in *.tc; do
+    name=${prog%.tc}
+    # the braces keep bash from reporting programs that abort
+    { "$TINYC" < "$prog" > "$WORK/$name.expected" 2> "$WORK/$name.expected-err"; } 2> /dev/null
+    expected_status=$?
+    if ! "$TINYC" --emit-c "$WORK/$name.c" < "$prog" \
+            || ! $CC -std=c99 -O2 -o "$WORK/$name" "$WORK/$name.c"; then
+        echo "FAIL $prog (could not build)"
+        failed=1
+        continue
+    fi
+    # nothing the program prints while it is translated may end up in the C code
+    if ! "$TINYC" --emit-c - < "$prog" | cmp -s - "$WORK/$name.c"; then
+        echo "FAIL $prog (--emit-c - differs from --emit-c FILE)"
+        failed=1
+        continue
+    fi
+    { "$WORK/$name" > "$WORK/$name.actual" 2> "$WORK/$name.actual-err"; } 2> /dev/null
+    actual_status=$?
+    if [ $expected_status -ne $actual_status ]; then
+        echo "FAIL $prog (exit status $actual_status, expected $expected_status)"
+        failed=1
+    elif ! diff -u "$WORK/$name.expected" "$WORK/$name.actual" \
+            || ! diff -u "$WORK/$name.expected-err" "$WORK/$name.actual-err"; then
+        echo "FAIL $prog"
+        failed=1
+    else
+        echo "ok   $prog"
+    fi
+done
+exit $failed
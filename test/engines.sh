@@ -0,0 +1,34 @@
+#!/bin/bash
+# Runs every test program on each engine and checks that it prints the same
+# output and exits with the same status as the AST walker. The walker is
+# also run without the optimizer, which must not change what a program does.
+# Output is line buffered so that lines printed before an error are compared.
+# Usage: test/engines.sh [path to tiny-c]
+cd "$(dirname "$0")"
+TINYC=${1:-../tiny-c}
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+failed=0
+for prog in *.tc; do
+    name=${prog%.tc}
+    # the braces keep bash from reporting programs that abort
+    { "$TINYC" --line-buffered --engine=ast < "$prog" > "$WORK/$name.expected" 2> "$WORK/$name.expected-err"; } 2> /dev/null
+    expected_status=$?
+    # a threshold of 1 compiles every function with the JIT on its first call
+    for engine in "ast --no-optimize" vm closure jit "jit --jit-threshold=1"; do
+        { "$TINYC" --line-buffered --engine=$engine < "$prog" > "$WORK/$name.actual" 2> "$WORK/$name.actual-err"; } 2> /dev/null
+        actual_status=$?
+        if [ $expected_status -ne $actual_status ]; then
+            echo "FAIL $prog on $engine (exit status $actual_status, expected $expected_status)"
+            failed=1
+        elif ! diff -u "$WORK/$name.expected" "$WORK/$name.actual" \
+                || ! diff -u "$WORK/$name.expected-err" "$WORK/$name.actual-err"; then
+            echo "FAIL $prog on $engine"
+            failed=1
+        else
+            echo "ok   $prog on $engine"
+        fi
+    done
+done
+exit $failed
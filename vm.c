@@ -0,0 +1,254 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include "vm.h"
+#include "memo.h"
+#include "output.h"
+
+#define VM_INITIAL_STACK (1024)
+#define VM_INITIAL_FRAMES (256)
+
+typedef struct {
+    const int *ret;     /* instruction to resume in the caller, NULL for the entry function */
+    size_t fp;          /* frame base of the caller (offset in the operand stack) */
+    Memo *memo;         /* cache to record the result in, or NULL */
+    size_t key;         /* offset of the key of the call in the key stack */
+} CallFrame;
+
+typedef struct {
+    int *stack;
+    size_t stack_size;
+    CallFrame *frames;
+    size_t frames_size;
+    int *keys;          /* keys of the memoized calls in progress, innermost last */
+    size_t keys_size;
+    size_t keys_top;
+} VM;
+
+static void *VM_grow(void *p, size_t *size, size_t elem_size, size_t required) {
+    size_t n = *size ? *size : 1;
+    while (n < required) {
+        n *= 2;
+    }
+    p = realloc(p, n * elem_size);
+    if (!p) {
+        fprintf(stderr, "Cannot allocate memory for VM stack.\n");
+        exit(EXIT_FAILURE);
+    }
+    *size = n;
+    return p;
+}
+
+static void VM_undefinedSymbol(const char *prefix, const Symbol *symbol) {
+    fprintf(stderr, "%s undefined or uninitialized symbol: %s\n", prefix, symbol->name);
+    abort();
+}
+
+static void VM_unexpectedType(const Symbol *symbol) {
+    fprintf(stderr, "Error: symbol '%s' found but it has unexpected type (%d).\n", symbol->name, symbol->type);
+    exit(EXIT_FAILURE);
+}
+
+static void VM_indexOutOfRange() {
+    fprintf(stderr, "Error: Index out of range.\n");
+    exit(EXIT_FAILURE);
+}
+
+static void VM_checkCall(const BCSymbol *f, int argc) {
+    if (f->entry < 0) {
+        if (f->symbol->type == SYM_UNBOUND) VM_undefinedSymbol("[func] Used an", f->symbol);
+        VM_unexpectedType(f->symbol);
+    }
+    if (argc != f->argc) {
+        fprintf(stderr, "Argument Error (%d args given, but expects %d)\n", argc, f->argc);
+        abort();
+    }
+}
+
+int VM_execute(Bytecode *bc) {
+    BCSymbol *symbols = BCSymbolVector_at(bc->symbols, 0);
+    const Format **formats = FormatVector_empty(bc->formats) ? NULL : FormatVector_at(bc->formats, 0);
+    const int *code = CodeVector_at(bc->code, 0);
+    BCSymbol *f = &symbols[bc->main];
+
+    VM vm = { NULL, 0, NULL, 0, NULL, 0, 0 };
+    vm.stack = VM_grow(vm.stack, &vm.stack_size, sizeof(int), VM_INITIAL_STACK + f->max_stack);
+    vm.frames = VM_grow(vm.frames, &vm.frames_size, sizeof(CallFrame), VM_INITIAL_FRAMES);
+
+    CallFrame *frame = vm.frames;
+    int *fp = vm.stack;
+    int *sp = vm.stack;
+    const int *pc = code + f->entry;
+    frame->ret = NULL;
+    frame->fp = 0;
+    frame->memo = NULL;
+
+    for (;;) {
+        switch ((Opcode)*pc++) {
+            case BC_PUSH:
+                *sp++ = *pc++;
+                break;
+            case BC_POP:
+                --sp;
+                break;
+            case BC_LOAD_LOCAL:
+                *sp++ = fp[*pc++];
+                break;
+            case BC_STORE_LOCAL:
+                fp[*pc++] = sp[-1];
+                break;
+            case BC_LOAD_GLOBAL: {
+                const Symbol *symbol = symbols[*pc++].symbol;
+                if (symbol->type != SYM_VALUE) {
+                    if (symbol->type == SYM_UNBOUND) VM_undefinedSymbol("[expr] Used", symbol);
+                    VM_unexpectedType(symbol);
+                }
+                *sp++ = symbol->SYM_value;
+                break;
+            }
+            case BC_STORE_GLOBAL: {
+                Symbol *symbol = symbols[*pc++].symbol;
+                if (symbol->type != SYM_UNBOUND && symbol->type != SYM_VALUE) {
+                    fprintf(stderr, "Error: Attempt to assign to the unassignable variable %s.\n", symbol->name);
+                    abort();
+                }
+                symbol->type = SYM_VALUE;
+                symbol->SYM_value = sp[-1];
+                break;
+            }
+            case BC_LOAD_ARRAY: {
+                const Symbol *symbol = symbols[*pc++].symbol;
+                if (symbol->type != SYM_ARRAY) {
+                    if (symbol->type == SYM_UNBOUND) VM_undefinedSymbol("[func] Used an", symbol);
+                    VM_unexpectedType(symbol);
+                }
+                size_t idx = sp[-1];
+                if (symbol->SYM_array_size <= idx) VM_indexOutOfRange();
+                sp[-1] = symbol->SYM_array_data[idx];
+                break;
+            }
+            case BC_STORE_ARRAY: {
+                const Symbol *symbol = symbols[*pc++].symbol;
+                if (symbol->type != SYM_ARRAY) {
+                    fprintf(stderr, "Error: Attempt to assign to non-array variable %s.\n", symbol->name);
+                    exit(EXIT_FAILURE);
+                }
+                size_t idx = sp[-2];
+                if (symbol->SYM_array_size <= idx) VM_indexOutOfRange();
+                symbol->SYM_array_data[idx] = sp[-1];
+                sp[-2] = sp[-1];
+                --sp;
+                break;
+            }
+            case BC_ADD: sp[-2] = sp[-2] + sp[-1]; --sp; break;
+            case BC_SUB: sp[-2] = sp[-2] - sp[-1]; --sp; break;
+            case BC_MUL: sp[-2] = sp[-2] * sp[-1]; --sp; break;
+            case BC_DIV: sp[-2] = sp[-2] / sp[-1]; --sp; break;
+            case BC_LT:  sp[-2] = sp[-2] <  sp[-1]; --sp; break;
+            case BC_GT:  sp[-2] = sp[-2] >  sp[-1]; --sp; break;
+            case BC_LE:  sp[-2] = sp[-2] <= sp[-1]; --sp; break;
+            case BC_GE:  sp[-2] = sp[-2] >= sp[-1]; --sp; break;
+            case BC_EQ:  sp[-2] = sp[-2] == sp[-1]; --sp; break;
+            case BC_NEQ: sp[-2] = sp[-2] != sp[-1]; --sp; break;
+            case BC_JUMP: {
+                const int offset = *pc++;
+                pc += offset;
+                break;
+            }
+            case BC_JUMP_IF_TRUE: {
+                const int offset = *pc++;
+                if (*--sp) pc += offset;
+                break;
+            }
+            case BC_CHECK_CALL: {
+                const BCSymbol *callee = &symbols[*pc++];
+                VM_checkCall(callee, *pc++);
+                break;
+            }
+            // the compiler has checked the callee and argc, or emitted CHECK_CALL before the arguments
+            case BC_CALL: {
+                f = &symbols[*pc++];
+                const int argc = *pc++;
+                const size_t key = vm.keys_top;
+                if (f->memo) {
+                    if (key + MEMO_KEY_SIZE(argc) > vm.keys_size) {
+                        vm.keys = VM_grow(vm.keys, &vm.keys_size, sizeof(int), key + MEMO_KEY_SIZE(argc));
+                    }
+                    int cached;
+                    if (Memo_lookup(f->memo, sp - argc, vm.keys + key, &cached)) {
+                        sp -= argc;
+                        *sp++ = cached;
+                        break;
+                    }
+                    vm.keys_top += MEMO_KEY_SIZE(argc);
+                }
+                if (++frame == vm.frames + vm.frames_size) {
+                    const size_t depth = frame - vm.frames;
+                    vm.frames = VM_grow(vm.frames, &vm.frames_size, sizeof(CallFrame), depth + 1);
+                    frame = vm.frames + depth;
+                }
+                frame->ret = pc;
+                frame->fp = fp - vm.stack;
+                frame->memo = f->memo;
+                frame->key = key;
+                if ((size_t)(sp - vm.stack) + f->max_stack > vm.stack_size) {
+                    const size_t fp_offset = fp - vm.stack;
+                    const size_t sp_offset = sp - vm.stack;
+                    vm.stack = VM_grow(vm.stack, &vm.stack_size, sizeof(int), sp_offset + f->max_stack);
+                    fp = vm.stack + fp_offset;
+                    sp = vm.stack + sp_offset;
+                }
+                fp = sp - argc;
+                pc = code + f->entry;
+                break;
+            }
+            case BC_TAIL_CALL: {
+                f = &symbols[*pc++];
+                const int argc = *pc++;
+                // the arguments replace the current frame; the call frame is reused
+                memmove(fp, sp - argc, argc * sizeof(int));
+                sp = fp + argc;
+                if ((size_t)(sp - vm.stack) + f->max_stack > vm.stack_size) {
+                    const size_t fp_offset = fp - vm.stack;
+                    const size_t sp_offset = sp - vm.stack;
+                    vm.stack = VM_grow(vm.stack, &vm.stack_size, sizeof(int), sp_offset + f->max_stack);
+                    fp = vm.stack + fp_offset;
+                    sp = vm.stack + sp_offset;
+                }
+                pc = code + f->entry;
+                break;
+            }
+            case BC_RETURN: {
+                const int value = *--sp;
+                sp = fp;
+                if (!frame->ret) {
+                    free(vm.stack);
+                    free(vm.frames);
+                    free(vm.keys);
+                    return value;
+                }
+                if (frame->memo) {
+                    Memo_store(frame->memo, vm.keys + frame->key, value);
+                    vm.keys_top = frame->key;
+                }
+                pc = frame->ret;
+                fp = vm.stack + frame->fp;
+                --frame;
+                *sp++ = value;
+                break;
+            }
+            case BC_PRINTLN:
+                Output_println(formats[*pc++], 0);
+                break;
+            case BC_PRINTLN_VALUE:
+                Output_println(formats[*pc++], *--sp);
+                break;
+            default:
+                fprintf(stderr, "unknown instruction (opcode: %d)\n", pc[-1]);
+                abort();
+        }
+    }
+}
+
+/* vim: set et ts=4 sts=4 sw=4: */
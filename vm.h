@@ -0,0 +1,11 @@
+#ifndef tinyc_vm_h
+#define tinyc_vm_h
+
+#include "bytecode.h"
+
+/* Runs the entry function of the program and returns its return value. */
+int VM_execute(Bytecode *bc);
+
+#endif
+
+/* vim: set et ts=4 sts=4 sw=4: */